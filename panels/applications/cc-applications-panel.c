@@ -75,8 +75,11 @@ struct _CcApplicationsPanel
   gchar           *current_app_id;
   gchar           *current_portal_app_id;
 
-  GHashTable      *globs;
+  CcGlobs         *globs;
   GHashTable      *search_providers;
+#ifdef HAVE_SNAP
+  CcSnapInterfaces *snap_interfaces;
+#endif
 
   GDBusProxy      *perm_store;
   GSettings       *notification_settings;
@@ -99,6 +102,7 @@ struct _CcApplicationsPanel
   CcToggleRow     *microphone;
   CcInfoRow       *no_microphone;
   CcInfoRow       *builtin;
+  gboolean         has_other_permissions;
   GtkDialog       *builtin_dialog;
   GtkLabel        *builtin_label;
   GtkListBox      *builtin_list;
@@ -703,47 +707,31 @@ add_snap_permissions (CcApplicationsPanel *self,
   const gchar *snap_name;
   g_autoptr(GList) rows = NULL;
   gint index;
-  g_autoptr(SnapdClient) client = NULL;
-  g_autoptr(GPtrArray) interfaces = NULL;
-  g_autoptr(GPtrArray) plugs = NULL;
-  g_autoptr(GPtrArray) slots = NULL;
-  SnapdInterface *interface = NULL;
+  GPtrArray *plugs;
   gint added = 0;
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GError) interfaces_error = NULL;
 
   if (!g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
     return FALSE;
   snap_name = app_id + strlen (PORTAL_SNAP_PREFIX);
 
+  /* Rows are added from snap_interfaces_changed_cb() once loaded */
+  if (!cc_snap_interfaces_get_loaded (self->snap_interfaces))
+    return FALSE;
+
+  plugs = cc_snap_interfaces_get_plugs (self->snap_interfaces, snap_name);
+  if (plugs == NULL)
+    return FALSE;
+
   rows = gtk_container_get_children (GTK_CONTAINER (self->permission_list));
   index = g_list_index (rows, self->builtin);
   g_assert (index >= 0);
 
-  client = snapd_client_new ();
-
-  interfaces = snapd_client_get_interfaces2_sync (client,
-                                                  SNAPD_GET_INTERFACES_FLAGS_NONE,
-                                                  NULL,
-                                                  NULL, &interfaces_error);
-  if (interfaces == NULL)
-    g_warning ("Failed to get snap interfaces: %s", interfaces_error->message);
-
-  if (!snapd_client_get_connections2_sync (client,
-                                           SNAPD_GET_CONNECTIONS_FLAGS_SELECT_ALL,
-                                           NULL, NULL,
-                                           NULL, NULL,
-                                           &plugs, &slots,
-                                           NULL, &error))
-    {
-      g_warning ("Failed to get snap connections: %s", error->message);
-      return FALSE;
-    }
-
-  for (int i = 0; i < plugs->len; i++)
+  for (guint i = 0; i < plugs->len; i++)
     {
       SnapdPlug *plug = g_ptr_array_index (plugs, i);
+      SnapdInterface *interface;
       CcSnapRow *row;
+      GPtrArray *slots;
       g_autoptr(GPtrArray) available_slots = NULL;
       const gchar * const hidden_interfaces[] = { "content",
                                                   "desktop", "desktop-legacy",
@@ -753,35 +741,19 @@ add_snap_permissions (CcApplicationsPanel *self,
                                                   "x11",
                                                   NULL };
 
-      /* Skip if not relating to this snap */
-      if (g_strcmp0 (snapd_plug_get_snap (plug), snap_name) != 0)
-        continue;
-
       /* Ignore interfaces that are too low level to make sense to show or disable */
       if (g_strv_contains (hidden_interfaces, snapd_plug_get_interface (plug)))
         continue;
 
-      available_slots = g_ptr_array_new_with_free_func (g_object_unref);
-      for (int j = 0; j < slots->len; j++)
-        {
-          SnapdSlot *slot = g_ptr_array_index (slots, j);
-          if (g_strcmp0 (snapd_plug_get_interface (plug), snapd_slot_get_interface (slot)) != 0)
-            continue;
+      slots = cc_snap_interfaces_get_slots (self->snap_interfaces, snapd_plug_get_interface (plug));
+      if (slots != NULL)
+        available_slots = g_ptr_array_ref (slots);
+      else
+        available_slots = g_ptr_array_new_with_free_func (g_object_unref);
 
-          g_ptr_array_add (available_slots, g_object_ref (slot));
-        }
+      interface = cc_snap_interfaces_lookup_interface (self->snap_interfaces, snapd_plug_get_interface (plug));
 
-      if (interfaces != NULL)
-        {
-          for (int j = 0; j < interfaces->len; j++)
-            {
-              SnapdInterface *i = g_ptr_array_index (interfaces, j);
-              if (g_strcmp0 (snapd_interface_get_name (i), snapd_plug_get_interface (plug)) == 0)
-                interface = i;
-            }
-        }
-
-      row = cc_snap_row_new (cc_panel_get_cancellable (CC_PANEL (self)), interface, plug, available_slots);
+      row = cc_snap_row_new (cc_panel_get_cancellable (CC_PANEL (self)), self->snap_interfaces, interface, plug, available_slots);
       gtk_widget_show (GTK_WIDGET (row));
       gtk_list_box_insert (GTK_LIST_BOX (self->permission_list), GTK_WIDGET (row), index);
       index++;
@@ -790,6 +762,21 @@ add_snap_permissions (CcApplicationsPanel *self,
 
     return added > 0;
 }
+
+static void
+snap_interfaces_changed_cb (CcApplicationsPanel *self)
+{
+  gboolean has_snap;
+
+  if (self->current_portal_app_id == NULL)
+    return;
+
+  remove_snap_permissions (self);
+  has_snap = add_snap_permissions (self, NULL, self->current_portal_app_id);
+
+  gtk_widget_set_visible (GTK_WIDGET (self->permission_section),
+                          self->has_other_permissions || has_snap);
+}
 #endif
 
 static gint
@@ -916,15 +903,16 @@ update_permission_section (CcApplicationsPanel *self,
   gtk_widget_set_visible (GTK_WIDGET (self->no_location), set && disabled);
   has_any |= set;
 
-#ifdef HAVE_SNAP
-  remove_snap_permissions (self);
-  has_any |= add_snap_permissions (self, info, portal_app_id);
-#endif
-
   remove_static_permissions (self);
   has_builtin = add_static_permissions (self, info, portal_app_id);
   gtk_widget_set_visible (GTK_WIDGET (self->builtin), has_builtin);
   has_any |= has_builtin;
+  self->has_other_permissions = has_any;
+
+#ifdef HAVE_SNAP
+  remove_snap_permissions (self);
+  has_any |= add_snap_permissions (self, info, portal_app_id);
+#endif
 
   gtk_widget_set_visible (GTK_WIDGET (self->permission_section), has_any);
 }
@@ -1093,15 +1081,15 @@ add_file_type (CcApplicationsPanel *self,
 {
   CcActionRow *row;
   g_autofree gchar *desc = NULL;
+  g_autofree gchar *globs = NULL;
   gint pos;
-  const gchar *glob;
 
-  glob = g_hash_table_lookup (self->globs, type);
+  globs = cc_globs_describe (self->globs, type);
 
   desc = g_content_type_get_description (type);
   row = cc_action_row_new ();
   cc_action_row_set_title (row, desc);
-  cc_action_row_set_subtitle (row, glob ? glob : "");
+  cc_action_row_set_subtitle (row, globs);
   cc_action_row_set_action (row, _("Unset"), TRUE);
   g_object_set_data_full (G_OBJECT (row), "type", g_strdup (type), g_free);
   g_signal_connect_object (row, "activated", G_CALLBACK (unset_cb), self, G_CONNECT_SWAPPED);
@@ -1786,6 +1774,10 @@ static void
 apps_changed (CcApplicationsPanel *self)
 {
   populate_applications (self);
+#ifdef HAVE_SNAP
+  /* Installing or removing a snap changes its plugs and slots */
+  cc_snap_interfaces_refresh (self->snap_interfaces);
+#endif
 }
 
 static void
@@ -1902,7 +1894,10 @@ cc_applications_panel_finalize (GObject *object)
 
   g_clear_pointer (&self->current_app_id, g_free);
   g_clear_pointer (&self->current_portal_app_id, g_free);
-  g_clear_pointer (&self->globs, g_hash_table_unref);
+  g_clear_object (&self->globs);
+#ifdef HAVE_SNAP
+  g_clear_object (&self->snap_interfaces);
+#endif
   g_clear_pointer (&self->search_providers, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_applications_panel_parent_class)->finalize (object);
@@ -2148,6 +2143,12 @@ cc_applications_panel_init (CcApplicationsPanel *self)
   self->app_filter_id = g_signal_connect (self->manager, "app-filter-changed",
                                           G_CALLBACK (app_filter_changed_cb), self);
 #endif
+#ifdef HAVE_SNAP
+  self->snap_interfaces = cc_snap_interfaces_new (NULL);
+  g_signal_connect_object (self->snap_interfaces, "changed", G_CALLBACK (snap_interfaces_changed_cb), self, G_CONNECT_SWAPPED);
+  cc_snap_interfaces_refresh (self->snap_interfaces);
+#endif
+
   populate_applications (self);
 
   self->monitor = g_app_info_monitor_get ();
@@ -2163,7 +2164,7 @@ cc_applications_panel_init (CcApplicationsPanel *self)
                             on_perm_store_ready,
                             self);
 
-  self->globs = parse_globs ();
+  self->globs = cc_globs_get_default ();
   self->search_providers = parse_search_providers ();
 
   /* Select the first row */
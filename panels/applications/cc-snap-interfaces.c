@@ -0,0 +1,381 @@
+/* cc-snap-interfaces.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include "cc-snap-interfaces.h"
+
+/* A snapshot of the snapd interface graph, shared by all snap permission rows.
+ *
+ * The interfaces and connections are fetched concurrently and indexed by snap
+ * name (plugs) and interface name (slots, interface descriptions), so showing
+ * the permissions of one snap doesn't round-trip to snapd again. Refreshes
+ * requested while a fetch is in flight are coalesced into a single follow-up
+ * fetch.
+ */
+
+struct _CcSnapInterfaces
+{
+  GObject       parent_instance;
+
+  SnapdClient  *client;
+  GCancellable *cancellable;
+
+  gboolean      loading;
+  gboolean      refresh_pending;
+  gboolean      loaded;
+
+  GHashTable   *interfaces;         /* interface name → SnapdInterface */
+  GHashTable   *plugs_by_snap;      /* snap name → GPtrArray<SnapdPlug> */
+  GHashTable   *slots_by_interface; /* interface name → GPtrArray<SnapdSlot> */
+};
+
+G_DEFINE_TYPE (CcSnapInterfaces, cc_snap_interfaces, G_TYPE_OBJECT)
+
+enum
+{
+  CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+typedef struct
+{
+  CcSnapInterfaces *self;
+  GCancellable     *cancellable;
+  guint             n_pending;
+
+  GPtrArray        *interfaces;
+  GPtrArray        *plugs;
+  GPtrArray        *slots;
+  GError           *error;
+} LoadData;
+
+static void start_load (CcSnapInterfaces *self);
+
+static void
+load_data_free (LoadData *data)
+{
+  g_clear_pointer (&data->interfaces, g_ptr_array_unref);
+  g_clear_pointer (&data->plugs, g_ptr_array_unref);
+  g_clear_pointer (&data->slots, g_ptr_array_unref);
+  g_clear_error (&data->error);
+  g_clear_object (&data->cancellable);
+  g_free (data);
+}
+
+static void
+index_object (GHashTable  *table,
+              const gchar *key,
+              gpointer     object)
+{
+  GPtrArray *array;
+
+  array = g_hash_table_lookup (table, key);
+  if (array == NULL)
+    {
+      array = g_ptr_array_new_with_free_func (g_object_unref);
+      g_hash_table_insert (table, g_strdup (key), array);
+    }
+
+  g_ptr_array_add (array, g_object_ref (object));
+}
+
+static void
+build_indexes (CcSnapInterfaces *self,
+               LoadData         *data)
+{
+  guint i;
+
+  g_hash_table_remove_all (self->interfaces);
+  g_hash_table_remove_all (self->plugs_by_snap);
+  g_hash_table_remove_all (self->slots_by_interface);
+
+  /* Interface descriptions are only used for labels, so carry on without them */
+  if (data->interfaces != NULL)
+    {
+      for (i = 0; i < data->interfaces->len; i++)
+        {
+          SnapdInterface *interface = g_ptr_array_index (data->interfaces, i);
+
+          g_hash_table_insert (self->interfaces,
+                               g_strdup (snapd_interface_get_name (interface)),
+                               g_object_ref (interface));
+        }
+    }
+
+  for (i = 0; i < data->plugs->len; i++)
+    {
+      SnapdPlug *plug = g_ptr_array_index (data->plugs, i);
+      index_object (self->plugs_by_snap, snapd_plug_get_snap (plug), plug);
+    }
+
+  for (i = 0; i < data->slots->len; i++)
+    {
+      SnapdSlot *slot = g_ptr_array_index (data->slots, i);
+      index_object (self->slots_by_interface, snapd_slot_get_interface (slot), slot);
+    }
+}
+
+static void
+load_finished (LoadData *data)
+{
+  CcSnapInterfaces *self = data->self;
+
+  if (--data->n_pending > 0)
+    return;
+
+  /* The snapshot may be gone already */
+  if (g_cancellable_is_cancelled (data->cancellable))
+    {
+      load_data_free (data);
+      return;
+    }
+
+  self->loading = FALSE;
+
+  if (data->error != NULL)
+    {
+      g_warning ("Failed to get snap connections: %s", data->error->message);
+    }
+  else
+    {
+      build_indexes (self, data);
+      self->loaded = TRUE;
+
+      g_debug ("Loaded snap interfaces for %u snaps", g_hash_table_size (self->plugs_by_snap));
+      g_signal_emit (self, signals[CHANGED], 0);
+    }
+
+  load_data_free (data);
+
+  if (self->refresh_pending)
+    {
+      self->refresh_pending = FALSE;
+      start_load (self);
+    }
+}
+
+static void
+get_interfaces_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  LoadData *data = user_data;
+  g_autoptr(GError) error = NULL;
+
+  data->interfaces = snapd_client_get_interfaces2_finish (SNAPD_CLIENT (source), result, &error);
+  if (data->interfaces == NULL && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_warning ("Failed to get snap interfaces: %s", error->message);
+
+  load_finished (data);
+}
+
+static void
+get_connections_cb (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  LoadData *data = user_data;
+
+  snapd_client_get_connections2_finish (SNAPD_CLIENT (source), result,
+                                        NULL, NULL,
+                                        &data->plugs, &data->slots,
+                                        &data->error);
+
+  load_finished (data);
+}
+
+static void
+start_load (CcSnapInterfaces *self)
+{
+  LoadData *data;
+
+  data = g_new0 (LoadData, 1);
+  data->self = self;
+  data->cancellable = g_object_ref (self->cancellable);
+  data->n_pending = 2;
+
+  self->loading = TRUE;
+
+  snapd_client_get_interfaces2_async (self->client,
+                                      SNAPD_GET_INTERFACES_FLAGS_NONE,
+                                      NULL,
+                                      self->cancellable,
+                                      get_interfaces_cb,
+                                      data);
+
+  snapd_client_get_connections2_async (self->client,
+                                       SNAPD_GET_CONNECTIONS_FLAGS_SELECT_ALL,
+                                       NULL, NULL,
+                                       self->cancellable,
+                                       get_connections_cb,
+                                       data);
+}
+
+static void
+cc_snap_interfaces_dispose (GObject *object)
+{
+  CcSnapInterfaces *self = CC_SNAP_INTERFACES (object);
+
+  g_cancellable_cancel (self->cancellable);
+
+  G_OBJECT_CLASS (cc_snap_interfaces_parent_class)->dispose (object);
+}
+
+static void
+cc_snap_interfaces_finalize (GObject *object)
+{
+  CcSnapInterfaces *self = CC_SNAP_INTERFACES (object);
+
+  g_clear_object (&self->cancellable);
+  g_clear_object (&self->client);
+  g_clear_pointer (&self->interfaces, g_hash_table_unref);
+  g_clear_pointer (&self->plugs_by_snap, g_hash_table_unref);
+  g_clear_pointer (&self->slots_by_interface, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_snap_interfaces_parent_class)->finalize (object);
+}
+
+static void
+cc_snap_interfaces_class_init (CcSnapInterfacesClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = cc_snap_interfaces_dispose;
+  object_class->finalize = cc_snap_interfaces_finalize;
+
+  signals[CHANGED] = g_signal_new ("changed",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0,
+                                   NULL, NULL,
+                                   NULL,
+                                   G_TYPE_NONE, 0);
+}
+
+static void
+cc_snap_interfaces_init (CcSnapInterfaces *self)
+{
+  self->cancellable = g_cancellable_new ();
+  self->interfaces = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->plugs_by_snap = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->slots_by_interface = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * cc_snap_interfaces_new:
+ * @client: (nullable): the #SnapdClient to query, or %NULL for the system snapd
+ *
+ * Creates an empty snapshot. Call cc_snap_interfaces_refresh() to load it.
+ */
+CcSnapInterfaces *
+cc_snap_interfaces_new (SnapdClient *client)
+{
+  CcSnapInterfaces *self;
+
+  g_return_val_if_fail (client == NULL || SNAPD_IS_CLIENT (client), NULL);
+
+  self = g_object_new (CC_TYPE_SNAP_INTERFACES, NULL);
+  self->client = client != NULL ? g_object_ref (client) : snapd_client_new ();
+
+  return self;
+}
+
+SnapdClient *
+cc_snap_interfaces_get_client (CcSnapInterfaces *self)
+{
+  g_return_val_if_fail (CC_IS_SNAP_INTERFACES (self), NULL);
+  return self->client;
+}
+
+/**
+ * cc_snap_interfaces_refresh:
+ * @self: a #CcSnapInterfaces
+ *
+ * Fetches the interfaces and connections from snapd in the background.
+ * #CcSnapInterfaces::changed is emitted once the new snapshot is indexed.
+ */
+void
+cc_snap_interfaces_refresh (CcSnapInterfaces *self)
+{
+  g_return_if_fail (CC_IS_SNAP_INTERFACES (self));
+
+  if (self->loading)
+    {
+      self->refresh_pending = TRUE;
+      return;
+    }
+
+  start_load (self);
+}
+
+gboolean
+cc_snap_interfaces_get_loaded (CcSnapInterfaces *self)
+{
+  g_return_val_if_fail (CC_IS_SNAP_INTERFACES (self), FALSE);
+  return self->loaded;
+}
+
+/**
+ * cc_snap_interfaces_get_plugs:
+ * @self: a #CcSnapInterfaces
+ * @snap_name: name of a snap
+ *
+ * Returns: (transfer none) (nullable) (element-type SnapdPlug): the plugs of
+ * @snap_name, or %NULL if it has none.
+ */
+GPtrArray *
+cc_snap_interfaces_get_plugs (CcSnapInterfaces *self,
+                              const gchar      *snap_name)
+{
+  g_return_val_if_fail (CC_IS_SNAP_INTERFACES (self), NULL);
+  return g_hash_table_lookup (self->plugs_by_snap, snap_name);
+}
+
+/**
+ * cc_snap_interfaces_get_slots:
+ * @self: a #CcSnapInterfaces
+ * @interface_name: name of an interface
+ *
+ * Returns: (transfer none) (nullable) (element-type SnapdSlot): the slots
+ * providing @interface_name, or %NULL if there are none.
+ */
+GPtrArray *
+cc_snap_interfaces_get_slots (CcSnapInterfaces *self,
+                              const gchar      *interface_name)
+{
+  g_return_val_if_fail (CC_IS_SNAP_INTERFACES (self), NULL);
+  return g_hash_table_lookup (self->slots_by_interface, interface_name);
+}
+
+/**
+ * cc_snap_interfaces_lookup_interface:
+ * @self: a #CcSnapInterfaces
+ * @interface_name: name of an interface
+ *
+ * Returns: (transfer none) (nullable): the description of @interface_name
+ */
+SnapdInterface *
+cc_snap_interfaces_lookup_interface (CcSnapInterfaces *self,
+                                     const gchar      *interface_name)
+{
+  g_return_val_if_fail (CC_IS_SNAP_INTERFACES (self), NULL);
+  return g_hash_table_lookup (self->interfaces, interface_name);
+}
@@ -0,0 +1,46 @@
+/* cc-snap-interfaces.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <snapd-glib/snapd-glib.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_SNAP_INTERFACES (cc_snap_interfaces_get_type())
+G_DECLARE_FINAL_TYPE (CcSnapInterfaces, cc_snap_interfaces, CC, SNAP_INTERFACES, GObject)
+
+CcSnapInterfaces *cc_snap_interfaces_new              (SnapdClient      *client);
+
+SnapdClient      *cc_snap_interfaces_get_client       (CcSnapInterfaces *self);
+
+void              cc_snap_interfaces_refresh          (CcSnapInterfaces *self);
+
+gboolean          cc_snap_interfaces_get_loaded       (CcSnapInterfaces *self);
+
+GPtrArray        *cc_snap_interfaces_get_plugs        (CcSnapInterfaces *self,
+                                                       const gchar      *snap_name);
+
+GPtrArray        *cc_snap_interfaces_get_slots        (CcSnapInterfaces *self,
+                                                       const gchar      *interface_name);
+
+SnapdInterface   *cc_snap_interfaces_lookup_interface (CcSnapInterfaces *self,
+                                                       const gchar      *interface_name);
+
+G_END_DECLS
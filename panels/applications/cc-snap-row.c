@@ -35,6 +35,7 @@ struct _CcSnapRow
 
   GCancellable *cancellable;
 
+  CcSnapInterfaces *snap_interfaces;
   SnapdPlug    *plug;
   SnapdSlot    *connected_slot;
   GPtrArray    *slots;
@@ -120,6 +121,7 @@ connect_interface_cb (GObject *client, GAsyncResult *result, gpointer user_data)
     {
       g_clear_object (&self->connected_slot);
       self->connected_slot = g_object_ref (slot);
+      cc_snap_interfaces_refresh (self->snap_interfaces);
     }
   else
     {
@@ -135,16 +137,13 @@ connect_interface_cb (GObject *client, GAsyncResult *result, gpointer user_data)
 static void
 connect_plug (CcSnapRow *self, SnapdSlot *slot)
 {
-  g_autoptr(SnapdClient) client = NULL;
-
   /* already connected */
   if (self->connected_slot == slot)
     return;
 
   disable_controls (self);
 
-  client = snapd_client_new ();
-  snapd_client_connect_interface_async (client,
+  snapd_client_connect_interface_async (cc_snap_interfaces_get_client (self->snap_interfaces),
                                         snapd_plug_get_snap (self->plug), snapd_plug_get_name (self->plug),
                                         snapd_slot_get_snap (slot), snapd_slot_get_name (slot),
                                         NULL, NULL,
@@ -161,6 +160,7 @@ disconnect_interface_cb (GObject *client, GAsyncResult *result, gpointer user_da
   if (snapd_client_disconnect_interface_finish (SNAPD_CLIENT (client), result, &error))
     {
       g_clear_object (&self->connected_slot);
+      cc_snap_interfaces_refresh (self->snap_interfaces);
     }
   else
     {
@@ -176,16 +176,13 @@ disconnect_interface_cb (GObject *client, GAsyncResult *result, gpointer user_da
 static void
 disconnect_plug (CcSnapRow *self)
 {
-  g_autoptr(SnapdClient) client = NULL;
-
   /* already disconnected */
   if (self->connected_slot == NULL)
     return;
 
   disable_controls (self);
 
-  client = snapd_client_new ();
-  snapd_client_disconnect_interface_async (client,
+  snapd_client_disconnect_interface_async (cc_snap_interfaces_get_client (self->snap_interfaces),
                                            snapd_plug_get_snap (self->plug), snapd_plug_get_name (self->plug),
                                            NULL, NULL,
                                            NULL, NULL,
@@ -229,6 +226,7 @@ cc_snap_row_finalize (GObject *object)
   CcSnapRow *self = CC_SNAP_ROW (object);
 
   g_clear_object (&self->cancellable);
+  g_clear_object (&self->snap_interfaces);
   g_clear_object (&self->plug);
   g_clear_pointer (&self->slots, g_ptr_array_unref);
 
@@ -261,7 +259,7 @@ cc_snap_row_init (CcSnapRow *self)
 }
 
 CcSnapRow *
-cc_snap_row_new (GCancellable *cancellable, SnapdInterface *interface, SnapdPlug *plug, GPtrArray *slots)
+cc_snap_row_new (GCancellable *cancellable, CcSnapInterfaces *snap_interfaces, SnapdInterface *interface, SnapdPlug *plug, GPtrArray *slots)
 {
   CcSnapRow *self;
   GPtrArray *connected_slots;
@@ -273,6 +271,7 @@ cc_snap_row_new (GCancellable *cancellable, SnapdInterface *interface, SnapdPlug
   self = CC_SNAP_ROW (g_object_new (CC_TYPE_SNAP_ROW, NULL));
 
   self->cancellable = g_object_ref (cancellable);
+  self->snap_interfaces = g_object_ref (snap_interfaces);
   self->plug = g_object_ref (plug);
   self->slots = g_ptr_array_ref (slots);
 
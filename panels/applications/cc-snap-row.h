@@ -23,14 +23,17 @@
 #include <gtk/gtk.h>
 #include <snapd-glib/snapd-glib.h>
 
+#include "cc-snap-interfaces.h"
+
 G_BEGIN_DECLS
 
 #define CC_TYPE_SNAP_ROW (cc_snap_row_get_type())
 G_DECLARE_FINAL_TYPE (CcSnapRow, cc_snap_row, CC, SNAP_ROW, GtkListBoxRow)
 
-CcSnapRow* cc_snap_row_new      (GCancellable   *cancellable,
-                                 SnapdInterface *interface,
-                                 SnapdPlug      *plug,
-                                 GPtrArray      *slots);
+CcSnapRow* cc_snap_row_new      (GCancellable     *cancellable,
+                                 CcSnapInterfaces *snap_interfaces,
+                                 SnapdInterface   *interface,
+                                 SnapdPlug        *plug,
+                                 GPtrArray        *slots);
 
 G_END_DECLS
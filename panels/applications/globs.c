@@ -20,43 +20,482 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "globs.h"
 
-/* parse mime/globs and return a string->string hash table */
-GHashTable *
-parse_globs (void)
+/* Maps MIME types to the globs matching them.
+ *
+ * The index is built once per session from the binary mime.cache written by
+ * update-mime-database, so building the handler sections does not re-read
+ * and split the text databases every time. Data directories without a cache
+ * fall back to their mime/globs file. The index is dropped when any of the
+ * monitored files changes, and rebuilt on the next lookup.
+ */
+
+#define CACHE_MAJOR_VERSION 1
+#define CACHE_ENTRY_SIZE 12
+#define CACHE_MAX_SUFFIX_DEPTH 255
+
+/* Offsets into the mime.cache header */
+#define CACHE_LITERAL_LIST_OFFSET 12
+#define CACHE_SUFFIX_TREE_OFFSET 16
+#define CACHE_GLOB_LIST_OFFSET 20
+
+struct _CcGlobs
 {
-  GHashTable *globs;
-  const gchar * const *dirs;
-  gint i;
+  GObject     parent_instance;
+
+  GStrv       data_dirs;
+  GPtrArray  *monitors;
+
+  /* MIME type → GStrv of globs, NULL until the first lookup */
+  GHashTable *index;
+};
+
+G_DEFINE_TYPE (CcGlobs, cc_globs, G_TYPE_OBJECT)
 
-  globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+enum
+{
+  CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
 
-  dirs = g_get_system_data_dirs ();
+static void
+add_glob (GHashTable  *globs,
+          const gchar *type,
+          const gchar *glob)
+{
+  GPtrArray *array;
 
-  for (i = 0; dirs[i]; i++)
+  array = g_hash_table_lookup (globs, type);
+  if (array == NULL)
     {
-      g_autofree gchar *file = g_build_filename (dirs[i], "mime", "globs", NULL);
-      g_autofree gchar *contents = NULL;
+      array = g_ptr_array_new_with_free_func (g_free);
+      g_hash_table_insert (globs, g_strdup (type), array);
+    }
+
+  if (!g_ptr_array_find_with_equal_func (array, glob, g_str_equal, NULL))
+    g_ptr_array_add (array, g_strdup (glob));
+}
+
+static gboolean
+cache_get_uint32 (GBytes  *cache,
+                  guint32  offset,
+                  guint32 *out_value)
+{
+  const guchar *data;
+  gsize size;
+  guint32 value;
+
+  data = g_bytes_get_data (cache, &size);
+  if (offset > size || size - offset < sizeof (guint32))
+    return FALSE;
+
+  memcpy (&value, data + offset, sizeof (guint32));
+  *out_value = GUINT32_FROM_BE (value);
 
-      if (g_file_get_contents (file, &contents, NULL, NULL))
+  return TRUE;
+}
+
+static const gchar *
+cache_get_string (GBytes  *cache,
+                  guint32  offset)
+{
+  const gchar *data;
+  gsize size;
+
+  data = g_bytes_get_data (cache, &size);
+  if (offset >= size || memchr (data + offset, '\0', size - offset) == NULL)
+    return NULL;
+
+  return data + offset;
+}
+
+static gboolean
+cache_check_entries (GBytes  *cache,
+                     guint32  offset,
+                     guint32  n_entries)
+{
+  gsize size = g_bytes_get_size (cache);
+
+  return offset <= size && n_entries <= (size - offset) / CACHE_ENTRY_SIZE;
+}
+
+/* Literal and glob lists share the same layout: a count followed by
+ * (pattern offset, MIME type offset, weight) entries. */
+static gboolean
+cache_load_list (GHashTable *globs,
+                 GBytes     *cache,
+                 guint32     header_offset)
+{
+  guint32 list_offset;
+  guint32 n_entries;
+  guint32 i;
+
+  if (!cache_get_uint32 (cache, header_offset, &list_offset) ||
+      !cache_get_uint32 (cache, list_offset, &n_entries) ||
+      !cache_check_entries (cache, list_offset + 4, n_entries))
+    return FALSE;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      guint32 entry = list_offset + 4 + i * CACHE_ENTRY_SIZE;
+      guint32 pattern_offset, type_offset;
+      const gchar *pattern, *type;
+
+      if (!cache_get_uint32 (cache, entry, &pattern_offset) ||
+          !cache_get_uint32 (cache, entry + 4, &type_offset))
+        return FALSE;
+
+      pattern = cache_get_string (cache, pattern_offset);
+      type = cache_get_string (cache, type_offset);
+      if (pattern == NULL || type == NULL)
+        return FALSE;
+
+      add_glob (globs, type, pattern);
+    }
+
+  return TRUE;
+}
+
+/* The reverse suffix tree stores "*.ext" globs one character per node, last
+ * character first. Leaves have a zero character and point to the MIME type. */
+static gboolean
+cache_load_suffix_nodes (GHashTable *globs,
+                         GBytes     *cache,
+                         guint32     offset,
+                         guint32     n_nodes,
+                         GString    *suffix,
+                         guint       depth)
+{
+  guint32 i;
+
+  if (depth > CACHE_MAX_SUFFIX_DEPTH || !cache_check_entries (cache, offset, n_nodes))
+    return FALSE;
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      guint32 node = offset + i * CACHE_ENTRY_SIZE;
+      guint32 character, value1, value2;
+
+      if (!cache_get_uint32 (cache, node, &character) ||
+          !cache_get_uint32 (cache, node + 4, &value1) ||
+          !cache_get_uint32 (cache, node + 8, &value2))
+        return FALSE;
+
+      if (character == 0)
         {
-          g_auto(GStrv) strv = NULL;
-          int i;
+          g_autofree gchar *reversed = NULL;
+          g_autofree gchar *glob = NULL;
+          const gchar *type;
 
-          strv = g_strsplit (contents, "\n", 0);
-          for (i = 0; strv[i]; i++)
-            {
-              g_auto(GStrv) parts = NULL;
+          type = cache_get_string (cache, value1);
+          if (type == NULL)
+            return FALSE;
 
-              if (strv[i][0] == '#' || strv[i][0] == '\0')
-                continue;
+          reversed = g_utf8_strreverse (suffix->str, suffix->len);
+          glob = g_strconcat ("*", reversed, NULL);
+          add_glob (globs, type, glob);
+        }
+      else
+        {
+          gsize len = suffix->len;
+
+          if (!g_unichar_validate (character))
+            return FALSE;
 
-              parts = g_strsplit (strv[i], ":", 2);
-              g_hash_table_insert (globs, g_strdup (parts[0]), g_strdup (parts[1]));
-            }
+          g_string_append_unichar (suffix, character);
+          if (!cache_load_suffix_nodes (globs, cache, value2, value1, suffix, depth + 1))
+            return FALSE;
+          g_string_truncate (suffix, len);
         }
     }
 
-  return globs;
+  return TRUE;
+}
+
+static gboolean
+load_mime_cache (GHashTable  *globs,
+                 const gchar *dir)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GBytes) cache = NULL;
+  g_autoptr(GHashTable) cache_globs = NULL;
+  g_autoptr(GString) suffix = NULL;
+  g_autofree gchar *file = NULL;
+  g_autoptr(GError) error = NULL;
+  GHashTableIter iter;
+  const gchar *type;
+  GPtrArray *array;
+  guint32 tree_offset, n_roots, first_root;
+  guint32 version;
+  guint i;
+
+  file = g_build_filename (dir, "mime", "mime.cache", NULL);
+  mapped = g_mapped_file_new (file, FALSE, &error);
+  if (mapped == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Could not map %s: %s", file, error->message);
+      return FALSE;
+    }
+
+  cache = g_mapped_file_get_bytes (mapped);
+
+  if (!cache_get_uint32 (cache, 0, &version) || (version >> 16) != CACHE_MAJOR_VERSION)
+    {
+      g_debug ("Ignoring %s: unsupported version", file);
+      return FALSE;
+    }
+
+  /* Don't merge anything from a truncated or corrupt cache */
+  cache_globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  suffix = g_string_new (NULL);
+
+  if (!cache_load_list (cache_globs, cache, CACHE_LITERAL_LIST_OFFSET) ||
+      !cache_load_list (cache_globs, cache, CACHE_GLOB_LIST_OFFSET) ||
+      !cache_get_uint32 (cache, CACHE_SUFFIX_TREE_OFFSET, &tree_offset) ||
+      !cache_get_uint32 (cache, tree_offset, &n_roots) ||
+      !cache_get_uint32 (cache, tree_offset + 4, &first_root) ||
+      !cache_load_suffix_nodes (cache_globs, cache, first_root, n_roots, suffix, 0))
+    {
+      g_warning ("Ignoring corrupt MIME cache %s", file);
+      return FALSE;
+    }
+
+  g_hash_table_iter_init (&iter, cache_globs);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &type, (gpointer *) &array))
+    {
+      for (i = 0; i < array->len; i++)
+        add_glob (globs, type, g_ptr_array_index (array, i));
+    }
+
+  return TRUE;
+}
+
+/* Fallback for data directories that only ship the text database */
+static void
+load_globs_file (GHashTable  *globs,
+                 const gchar *dir)
+{
+  g_autofree gchar *file = g_build_filename (dir, "mime", "globs", NULL);
+  g_autofree gchar *contents = NULL;
+  g_auto(GStrv) strv = NULL;
+  gint i;
+
+  if (!g_file_get_contents (file, &contents, NULL, NULL))
+    return;
+
+  strv = g_strsplit (contents, "\n", 0);
+  for (i = 0; strv[i]; i++)
+    {
+      gchar *glob;
+
+      if (strv[i][0] == '#' || strv[i][0] == '\0')
+        continue;
+
+      glob = strchr (strv[i], ':');
+      if (glob == NULL)
+        continue;
+
+      *glob++ = '\0';
+      add_glob (globs, strv[i], glob);
+    }
+}
+
+static gint
+compare_globs (gconstpointer a,
+               gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+static void
+ensure_index (CcGlobs *self)
+{
+  g_autoptr(GHashTable) globs = NULL;
+  GHashTableIter iter;
+  gchar *type;
+  GPtrArray *array;
+  gint i;
+
+  if (self->index != NULL)
+    return;
+
+  globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; self->data_dirs[i]; i++)
+    {
+      if (!load_mime_cache (globs, self->data_dirs[i]))
+        load_globs_file (globs, self->data_dirs[i]);
+    }
+
+  /* Steal the collected arrays into NULL-terminated vectors */
+  self->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_strfreev);
+
+  g_hash_table_iter_init (&iter, globs);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &type, (gpointer *) &array))
+    {
+      g_ptr_array_sort (array, compare_globs);
+      g_ptr_array_set_free_func (array, NULL);
+      g_ptr_array_add (array, NULL);
+      g_hash_table_insert (self->index, g_strdup (type), g_ptr_array_free (array, FALSE));
+    }
+
+  g_debug ("Indexed globs for %u MIME types", g_hash_table_size (self->index));
+}
+
+static void
+on_database_changed_cb (CcGlobs           *self,
+                        GFile             *file,
+                        GFile             *other_file,
+                        GFileMonitorEvent  event_type)
+{
+  if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED ||
+      event_type == G_FILE_MONITOR_EVENT_PRE_UNMOUNT)
+    return;
+
+  if (self->index == NULL)
+    return;
+
+  g_debug ("MIME database changed, dropping glob index");
+
+  g_clear_pointer (&self->index, g_hash_table_unref);
+  g_signal_emit (self, signals[CHANGED], 0);
+}
+
+static void
+monitor_file (CcGlobs     *self,
+              const gchar *dir,
+              const gchar *basename)
+{
+  g_autofree gchar *path = g_build_filename (dir, "mime", basename, NULL);
+  g_autoptr(GFile) file = g_file_new_for_path (path);
+  g_autoptr(GError) error = NULL;
+  GFileMonitor *monitor;
+
+  monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, &error);
+  if (monitor == NULL)
+    {
+      g_debug ("Could not monitor %s: %s", path, error->message);
+      return;
+    }
+
+  g_signal_connect_object (monitor, "changed", G_CALLBACK (on_database_changed_cb), self, G_CONNECT_SWAPPED);
+  g_ptr_array_add (self->monitors, monitor);
+}
+
+static void
+cc_globs_finalize (GObject *object)
+{
+  CcGlobs *self = CC_GLOBS (object);
+
+  g_clear_pointer (&self->monitors, g_ptr_array_unref);
+  g_clear_pointer (&self->index, g_hash_table_unref);
+  g_clear_pointer (&self->data_dirs, g_strfreev);
+
+  G_OBJECT_CLASS (cc_globs_parent_class)->finalize (object);
+}
+
+static void
+cc_globs_class_init (CcGlobsClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_globs_finalize;
+
+  signals[CHANGED] = g_signal_new ("changed",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0,
+                                   NULL, NULL,
+                                   NULL,
+                                   G_TYPE_NONE, 0);
+}
+
+static void
+cc_globs_init (CcGlobs *self)
+{
+  self->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+CcGlobs *
+cc_globs_new (const gchar * const *data_dirs)
+{
+  CcGlobs *self;
+  gint i;
+
+  g_return_val_if_fail (data_dirs != NULL, NULL);
+
+  self = g_object_new (CC_TYPE_GLOBS, NULL);
+  self->data_dirs = g_strdupv ((gchar **) data_dirs);
+
+  for (i = 0; self->data_dirs[i]; i++)
+    {
+      monitor_file (self, self->data_dirs[i], "mime.cache");
+      monitor_file (self, self->data_dirs[i], "globs");
+    }
+
+  return self;
+}
+
+/**
+ * cc_globs_get_default:
+ *
+ * Returns: (transfer full): the glob index for the system data directories,
+ * shared by the whole session.
+ */
+CcGlobs *
+cc_globs_get_default (void)
+{
+  static CcGlobs *default_globs = NULL;
+
+  if (g_once_init_enter (&default_globs))
+    g_once_init_leave (&default_globs, cc_globs_new (g_get_system_data_dirs ()));
+
+  return g_object_ref (default_globs);
+}
+
+/**
+ * cc_globs_lookup:
+ * @self: a #CcGlobs
+ * @type: a MIME type
+ *
+ * Returns: (transfer none) (nullable): the sorted globs matching @type, or
+ * %NULL if there are none. Only valid until the next #CcGlobs::changed.
+ */
+const gchar * const *
+cc_globs_lookup (CcGlobs     *self,
+                 const gchar *type)
+{
+  g_return_val_if_fail (CC_IS_GLOBS (self), NULL);
+  g_return_val_if_fail (type != NULL, NULL);
+
+  ensure_index (self);
+
+  return g_hash_table_lookup (self->index, type);
+}
+
+/**
+ * cc_globs_describe:
+ * @self: a #CcGlobs
+ * @type: a MIME type
+ *
+ * Returns: (transfer full): the globs matching @type joined for display,
+ * or an empty string.
+ */
+gchar *
+cc_globs_describe (CcGlobs     *self,
+                   const gchar *type)
+{
+  const gchar * const *globs;
+
+  globs = cc_globs_lookup (self, type);
+  if (globs == NULL)
+    return g_strdup ("");
+
+  return g_strjoinv (", ", (gchar **) globs);
 }
@@ -24,6 +24,17 @@
 
 G_BEGIN_DECLS
 
-GHashTable* parse_globs (void);
+#define CC_TYPE_GLOBS (cc_globs_get_type())
+G_DECLARE_FINAL_TYPE (CcGlobs, cc_globs, CC, GLOBS, GObject)
+
+CcGlobs             *cc_globs_new         (const gchar * const *data_dirs);
+
+CcGlobs             *cc_globs_get_default (void);
+
+const gchar * const *cc_globs_lookup      (CcGlobs             *self,
+                                           const gchar         *type);
+
+gchar               *cc_globs_describe    (CcGlobs             *self,
+                                           const gchar         *type);
 
 G_END_DECLS
@@ -30,18 +30,37 @@
 
 /* The number of items we signal as "added" before
  * returning to the main loop */
-#define NUM_ITEMS_PER_BATCH 1
+#define NUM_ITEMS_PER_BATCH 16
 
 struct _CcBackgroundXml
 {
   GObject      parent_instance;
 
   GHashTable  *wp_hash;
-  GAsyncQueue *item_added_queue;
+  GAsyncQueue *item_added_queue; /* ParsedItem */
   guint        item_added_id;
   GSList      *monitors; /* GSList of GFileMonitor */
 };
 
+typedef struct
+{
+  gchar            *id;
+  CcBackgroundItem *item;
+} ParsedItem;
+
+/* Parsed contents of a collection file, shared by all instances and
+ * reused for as long as the file is unchanged. Files are edited in place
+ * too, so the mtime of their directory isn't enough to go by. */
+typedef struct
+{
+  guint64    mtime;
+  goffset    size;
+  GPtrArray *items; /* ParsedItem */
+} FileCache;
+
+G_LOCK_DEFINE_STATIC (file_cache);
+static GHashTable *file_cache = NULL; /* path → FileCache */
+
 enum {
 	ADDED,
 	LAST_SIGNAL
@@ -107,39 +126,96 @@ enum_string_to_value (GType type,
 	return value->value;
 }
 
+static void
+parsed_item_free (ParsedItem *parsed)
+{
+	g_free (parsed->id);
+	g_object_unref (parsed->item);
+	g_free (parsed);
+}
+
+static ParsedItem *
+parsed_item_copy (ParsedItem *parsed)
+{
+	ParsedItem *copy;
+
+	copy = g_new0 (ParsedItem, 1);
+	copy->id = g_strdup (parsed->id);
+	copy->item = cc_background_item_copy (parsed->item);
+
+	return copy;
+}
+
+static void
+file_cache_free (FileCache *cache)
+{
+	g_ptr_array_unref (cache->items);
+	g_free (cache);
+}
+
+static void
+file_cache_invalidate (const gchar *path)
+{
+	G_LOCK (file_cache);
+	if (file_cache != NULL)
+		g_hash_table_remove (file_cache, path);
+	G_UNLOCK (file_cache);
+}
+
+/* Must be called from the main thread */
+static gboolean
+add_parsed_item (CcBackgroundXml *xml,
+		 ParsedItem      *parsed)
+{
+	/* Make sure we don't already have this one */
+	if (g_hash_table_lookup (xml->wp_hash, parsed->id) != NULL)
+		return FALSE;
+
+	g_hash_table_insert (xml->wp_hash,
+			     g_strdup (parsed->id),
+			     g_object_ref (parsed->item));
+	g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, parsed->item);
+
+	return TRUE;
+}
+
 static gboolean
 idle_emit (CcBackgroundXml *xml)
 {
+	gboolean more;
 	gint i;
 
-	g_async_queue_lock (xml->item_added_queue);
-
 	for (i = 0; i < NUM_ITEMS_PER_BATCH; i++) {
-		g_autoptr(GObject) item = NULL;
+		ParsedItem *parsed;
 
-		item = g_async_queue_try_pop_unlocked (xml->item_added_queue);
-		if (item == NULL)
+		parsed = g_async_queue_try_pop (xml->item_added_queue);
+		if (parsed == NULL)
 			break;
-		g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+
+		add_parsed_item (xml, parsed);
+		parsed_item_free (parsed);
 	}
 
+	g_async_queue_lock (xml->item_added_queue);
+	more = g_async_queue_length_unlocked (xml->item_added_queue) > 0;
+	if (!more)
+		xml->item_added_id = 0;
 	g_async_queue_unlock (xml->item_added_queue);
 
-        if (g_async_queue_length (xml->item_added_queue) > 0) {
-                return TRUE;
-        } else {
-                xml->item_added_id = 0;
-                return FALSE;
-        }
+	return more;
 }
 
+/* Takes ownership of the items in @items */
 static void
 emit_added_in_idle (CcBackgroundXml *xml,
-		    GObject         *object)
+		    GPtrArray       *items)
 {
+	guint i;
+
 	g_async_queue_lock (xml->item_added_queue);
-	g_async_queue_push_unlocked (xml->item_added_queue, object);
-	if (xml->item_added_id == 0)
+	for (i = 0; i < items->len; i++)
+		g_async_queue_push_unlocked (xml->item_added_queue, g_ptr_array_index (items, i));
+	if (xml->item_added_id == 0 && items->len > 0)
 		xml->item_added_id = g_idle_add ((GSourceFunc) idle_emit, xml);
 	g_async_queue_unlock (xml->item_added_queue);
 }
@@ -148,23 +224,22 @@ emit_added_in_idle (CcBackgroundXml *xml,
 #define UNSET_FLAG(flag) G_STMT_START{ (flags&=~(flag)); }G_STMT_END
 #define SET_FLAG(flag) G_STMT_START{ (flags|=flag); }G_STMT_END
 
-static gboolean
-cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
-				     const gchar     *filename,
-				     gboolean         in_thread)
+/* Only parses @filename, so it is safe to call from any thread */
+static GPtrArray *
+cc_background_xml_parse_file (const gchar *filename)
 {
   xmlDoc * wplist;
   xmlNode * root, * list, * wpa;
   xmlChar * nodelang;
   const gchar * const * syslangs;
+  GPtrArray *items;
   gint i;
-  gboolean retval;
 
-  wplist = xmlParseFile (filename);
-  retval = FALSE;
+  items = g_ptr_array_new_with_free_func ((GDestroyNotify) parsed_item_free);
 
+  wplist = xmlParseFile (filename);
   if (!wplist)
-    return retval;
+    return items;
 
   syslangs = g_get_language_names ();
 
@@ -176,7 +251,7 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
       CcBackgroundItemFlags flags;
       g_autofree gchar *uri = NULL;
       g_autofree gchar *cname = NULL;
-      g_autofree gchar *id = NULL;
+      ParsedItem *parsed;
 
       flags = 0;
       item = cc_background_item_new (NULL);
@@ -297,26 +372,34 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
       /* FIXME, this is a broken way of doing,
        * need to use proper code here */
       uri = g_filename_to_uri (filename, NULL, NULL);
-      id = g_strdup_printf ("%s#%s", uri, cname);
-
-      /* Make sure we don't already have this one and that filename exists */
-      if (g_hash_table_lookup (xml->wp_hash, id) != NULL) {
-	continue;
-      }
 
       g_object_set (G_OBJECT (item), "flags", flags, NULL);
-      g_hash_table_insert (xml->wp_hash,
-                           g_strdup (id),
-                           g_object_ref (item));
-      if (in_thread)
-        emit_added_in_idle (xml, g_object_ref (G_OBJECT (item)));
-      else
-        g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
-      retval = TRUE;
+
+      parsed = g_new0 (ParsedItem, 1);
+      parsed->id = g_strdup_printf ("%s#%s", uri, cname);
+      parsed->item = g_steal_pointer (&item);
+      g_ptr_array_add (items, parsed);
     }
   }
   xmlFreeDoc (wplist);
 
+  return items;
+}
+
+static gboolean
+cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
+				     const gchar     *filename)
+{
+  g_autoptr(GPtrArray) items = NULL;
+  gboolean retval = FALSE;
+  guint i;
+
+  items = cc_background_xml_parse_file (filename);
+  for (i = 0; i < items->len; i++) {
+    if (add_parsed_item (xml, g_ptr_array_index (items, i)))
+      retval = TRUE;
+  }
+
   return retval;
 }
 
@@ -333,7 +416,8 @@ gnome_wp_file_changed (GFileMonitor *monitor,
   case G_FILE_MONITOR_EVENT_CHANGED:
   case G_FILE_MONITOR_EVENT_CREATED:
     filename = g_file_get_path (file);
-    cc_background_xml_load_xml_internal (data, filename, FALSE);
+    file_cache_invalidate (filename);
+    cc_background_xml_load_xml_internal (data, filename);
     break;
   default:
     break;
@@ -367,70 +451,97 @@ cc_background_xml_add_monitor (GFile      *directory,
   data->monitors = g_slist_prepend (data->monitors, monitor);
 }
 
+/* Returns the items in @filename, parsing it only if it changed since
+ * it was last loaded. The cached items are shared, the caller gets
+ * copies. Called from the worker thread. */
 static void
-cc_background_xml_load_from_dir (const gchar      *path,
-				 CcBackgroundXml  *data,
-				 gboolean          in_thread)
+cc_background_xml_load_file (const gchar *filename,
+                             GFileInfo   *info,
+                             GPtrArray   *copies)
+{
+  g_autoptr(GPtrArray) items = NULL;
+  FileCache *cache;
+  guint64 mtime;
+  goffset size;
+  guint i;
+
+  mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+          g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  size = g_file_info_get_size (info);
+
+  G_LOCK (file_cache);
+  cache = file_cache ? g_hash_table_lookup (file_cache, filename) : NULL;
+  if (cache != NULL && cache->mtime == mtime && cache->size == size)
+    items = g_ptr_array_ref (cache->items);
+  G_UNLOCK (file_cache);
+
+  if (items == NULL) {
+    items = cc_background_xml_parse_file (filename);
+
+    cache = g_new0 (FileCache, 1);
+    cache->mtime = mtime;
+    cache->size = size;
+    cache->items = g_ptr_array_ref (items);
+
+    G_LOCK (file_cache);
+    if (file_cache == NULL)
+      file_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, (GDestroyNotify) file_cache_free);
+    g_hash_table_insert (file_cache, g_strdup (filename), cache);
+    G_UNLOCK (file_cache);
+  }
+
+  for (i = 0; i < items->len; i++)
+    g_ptr_array_add (copies, parsed_item_copy (g_ptr_array_index (items, i)));
+}
+
+/* Returns copies of the items of all the files in @path, or NULL if it
+ * isn't a directory. Called from the worker thread. */
+static GPtrArray *
+cc_background_xml_load_from_dir (const gchar  *path,
+				 GCancellable *cancellable)
 {
   g_autoptr(GFile) directory = NULL;
   g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GPtrArray) copies = NULL;
   g_autoptr(GError) error = NULL;
 
-  if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
-    return;
-  }
-
   directory = g_file_new_for_path (path);
   enumerator = g_file_enumerate_children (directory,
-                                          G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                          G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
                                           G_FILE_QUERY_INFO_NONE,
-                                          NULL,
+                                          cancellable,
                                           &error);
   if (error != NULL) {
-    g_warning ("Unable to check directory %s: %s", path, error->message);
-    return;
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+        !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY) &&
+        !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning ("Unable to check directory %s: %s", path, error->message);
+    return NULL;
   }
 
+  copies = g_ptr_array_new_with_free_func ((GDestroyNotify) parsed_item_free);
+
   while (TRUE) {
     g_autoptr(GFileInfo) info = NULL;
-    const gchar *filename;
     g_autofree gchar *fullpath = NULL;
 
-    info = g_file_enumerator_next_file (enumerator, NULL, NULL);
-    if (info == NULL) {
-        g_file_enumerator_close (enumerator, NULL, NULL);
-        cc_background_xml_add_monitor (directory, data);
-        return;
-    }
+    if (g_cancellable_is_cancelled (cancellable))
+      return NULL;
 
-    filename = g_file_info_get_name (info);
-    fullpath = g_build_filename (path, filename, NULL);
+    info = g_file_enumerator_next_file (enumerator, NULL, NULL);
+    if (info == NULL)
+      break;
 
-    cc_background_xml_load_xml_internal (data, fullpath, in_thread);
+    fullpath = g_build_filename (path, g_file_info_get_name (info), NULL);
+    cc_background_xml_load_file (fullpath, info, copies);
   }
-}
+  g_file_enumerator_close (enumerator, NULL, NULL);
 
-static void
-cc_background_xml_load_list (CcBackgroundXml *data,
-			     gboolean         in_thread)
-{
-  const char * const *system_data_dirs;
-  g_autofree gchar *datadir = NULL;
-  gint i;
-
-  datadir = g_build_filename (g_get_user_data_dir (),
-                              "gnome-background-properties",
-                              NULL);
-  cc_background_xml_load_from_dir (datadir, data, in_thread);
-
-  system_data_dirs = g_get_system_data_dirs ();
-  for (i = 0; system_data_dirs[i]; i++) {
-    g_autofree gchar *sdatadir = NULL;
-    sdatadir = g_build_filename (system_data_dirs[i],
-                                "gnome-background-properties",
-				NULL);
-    cc_background_xml_load_from_dir (sdatadir, data, in_thread);
-  }
+  return g_steal_pointer (&copies);
 }
 
 gboolean
@@ -450,7 +561,73 @@ load_list_thread (GTask *task,
 		  GCancellable *cancellable)
 {
 	CcBackgroundXml *xml = CC_BACKGROUND_XML (source_object);
-	cc_background_xml_load_list (xml, TRUE);
+	g_autoptr(GPtrArray) directories = NULL;
+	const char * const *system_data_dirs;
+	g_autofree gchar *datadir = NULL;
+	gint i;
+
+	directories = g_ptr_array_new_with_free_func (g_free);
+
+	datadir = g_build_filename (g_get_user_data_dir (),
+				    "gnome-background-properties",
+				    NULL);
+	g_ptr_array_add (directories, g_steal_pointer (&datadir));
+
+	system_data_dirs = g_get_system_data_dirs ();
+	for (i = 0; system_data_dirs[i]; i++) {
+		g_ptr_array_add (directories,
+				 g_build_filename (system_data_dirs[i],
+						   "gnome-background-properties",
+						   NULL));
+	}
+
+	/* Keep the directories that exist, to be monitored once done */
+	for (i = 0; i < (gint) directories->len; ) {
+		g_autoptr(GPtrArray) items = NULL;
+
+		if (g_task_return_error_if_cancelled (task))
+			return;
+
+		items = cc_background_xml_load_from_dir (g_ptr_array_index (directories, i), cancellable);
+		if (items == NULL) {
+			g_ptr_array_remove_index (directories, i);
+			continue;
+		}
+
+		/* Items are handed to the main thread a directory at a time */
+		emit_added_in_idle (xml, items);
+		g_ptr_array_set_free_func (items, NULL);
+		i++;
+	}
+
+	g_task_return_pointer (task, g_steal_pointer (&directories), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+load_list_done_cb (GObject      *source_object,
+		   GAsyncResult *result,
+		   gpointer      user_data)
+{
+	CcBackgroundXml *xml = CC_BACKGROUND_XML (source_object);
+	g_autoptr(GTask) task = user_data;
+	g_autoptr(GPtrArray) directories = NULL;
+	GError *error = NULL;
+	guint i;
+
+	directories = g_task_propagate_pointer (G_TASK (result), &error);
+	if (directories == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* Monitors deliver their events to the thread they were created in */
+	for (i = 0; i < directories->len; i++) {
+		g_autoptr(GFile) directory = NULL;
+
+		directory = g_file_new_for_path (g_ptr_array_index (directories, i));
+		cc_background_xml_add_monitor (directory, xml);
+	}
+
 	g_task_return_boolean (task, TRUE);
 }
 
@@ -460,12 +637,16 @@ cc_background_xml_load_list_async (CcBackgroundXml *xml,
 				   GAsyncReadyCallback callback,
 				   gpointer user_data)
 {
-	g_autoptr(GTask) task = NULL;
+	g_autoptr(GTask) thread_task = NULL;
+	GTask *task;
 
 	g_return_if_fail (CC_IS_BACKGROUND_XML (xml));
 
 	task = g_task_new (xml, cancellable, callback, user_data);
-	g_task_run_in_thread (task, load_list_thread);
+	g_task_set_source_tag (task, cc_background_xml_load_list_async);
+
+	thread_task = g_task_new (xml, cancellable, load_list_done_cb, task);
+	g_task_run_in_thread (thread_task, load_list_thread);
 }
 
 gboolean
@@ -477,7 +658,7 @@ cc_background_xml_load_xml (CcBackgroundXml *xml,
 	if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) == FALSE)
 		return FALSE;
 
-	return cc_background_xml_load_xml_internal (xml, filename, FALSE);
+	return cc_background_xml_load_xml_internal (xml, filename);
 }
 
 static void
@@ -638,7 +819,7 @@ cc_background_xml_init (CcBackgroundXml *xml)
                                               g_str_equal,
                                               (GDestroyNotify) g_free,
                                               (GDestroyNotify) g_object_unref);
-	xml->item_added_queue = g_async_queue_new_full ((GDestroyNotify) g_object_unref);
+	xml->item_added_queue = g_async_queue_new_full ((GDestroyNotify) parsed_item_free);
 }
 
 CcBackgroundXml *
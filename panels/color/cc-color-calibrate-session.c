@@ -0,0 +1,441 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <colord.h>
+#include <colord-session/cd-session.h>
+
+#include "cc-color-calibrate-session.h"
+
+/*
+ * Talks to the colord-session helper that drives the sensor.
+ *
+ * A calibration is a single asynchronous operation: it starts with the
+ * Start call and ends when the helper sends Finished.  In between, the
+ * helper's progress, samples, gamma ramps and requests for the user to do
+ * something are passed on as signals as they arrive.  Cancelling tells the
+ * helper to stop and returns straight away, without waiting for it.
+ */
+
+struct _CcColorCalibrateSession
+{
+  GObject     parent_instance;
+
+  GDBusProxy *proxy;
+  GTask      *task;
+  gulong      cancelled_id;
+  guint       cancelled_idle_id;
+};
+
+G_DEFINE_TYPE (CcColorCalibrateSession, cc_color_calibrate_session, G_TYPE_OBJECT)
+
+enum {
+  SIGNAL_PROGRESS,
+  SIGNAL_UPDATE_SAMPLE,
+  SIGNAL_UPDATE_GAMMA,
+  SIGNAL_INTERACTION_REQUIRED,
+  SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+GQuark
+cc_color_calibrate_session_error_quark (void)
+{
+  static GQuark quark = 0;
+  if (!quark)
+    quark = g_quark_from_static_string ("CcColorCalibrateError");
+  return quark;
+}
+
+static void
+cc_color_calibrate_session_return (CcColorCalibrateSession *session,
+                                   gchar                   *profile_path,
+                                   GError                  *error)
+{
+  g_autoptr(GTask) task = g_steal_pointer (&session->task);
+
+  g_assert (task != NULL);
+
+  g_clear_handle_id (&session->cancelled_idle_id, g_source_remove);
+  if (session->cancelled_id != 0)
+    {
+      g_cancellable_disconnect (g_task_get_cancellable (task), session->cancelled_id);
+      session->cancelled_id = 0;
+    }
+
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, profile_path, g_free);
+}
+
+static void
+cc_color_calibrate_session_call_cb (GObject      *object,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+  const gchar *method_name = user_data;
+  g_autoptr(GVariant) retval = NULL;
+  g_autoptr(GError) error = NULL;
+
+  retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (object), res, &error);
+  if (retval == NULL)
+    g_warning ("Failed to send %s: %s", method_name, error->message);
+}
+
+static gboolean
+cc_color_calibrate_session_cancelled_idle_cb (gpointer user_data)
+{
+  CcColorCalibrateSession *session = CC_COLOR_CALIBRATE_SESSION (user_data);
+
+  session->cancelled_idle_id = 0;
+
+  /* cancel the calibration to ensure the helper quits */
+  g_dbus_proxy_call (session->proxy,
+                     "Cancel",
+                     NULL,
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     cc_color_calibrate_session_call_cb,
+                     (gpointer) "Cancel");
+
+  cc_color_calibrate_session_return (session, NULL,
+                                     g_error_new_literal (G_IO_ERROR,
+                                                          G_IO_ERROR_CANCELLED,
+                                                          "Calibration was cancelled"));
+  return G_SOURCE_REMOVE;
+}
+
+static void
+cc_color_calibrate_session_cancelled_cb (GCancellable            *cancellable,
+                                         CcColorCalibrateSession *session)
+{
+  /* the handler can't be disconnected from here */
+  if (session->cancelled_idle_id == 0)
+    session->cancelled_idle_id = g_idle_add (cc_color_calibrate_session_cancelled_idle_cb, session);
+}
+
+static void
+cc_color_calibrate_session_start_cb (GObject      *object,
+                                     GAsyncResult *res,
+                                     gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  CcColorCalibrateSession *session = g_task_get_source_object (task);
+  g_autoptr(GVariant) retval = NULL;
+  GError *error = NULL;
+
+  retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (object), res, &error);
+
+  /* the calibration may already be over */
+  if (session->task != task)
+    {
+      g_clear_error (&error);
+      return;
+    }
+
+  /* otherwise wait for Finished */
+  if (retval == NULL)
+    cc_color_calibrate_session_return (session, NULL, error);
+}
+
+static void
+cc_color_calibrate_session_finished (CcColorCalibrateSession *session,
+                                     GVariant                *parameters)
+{
+  g_autoptr(GVariant) dict = NULL;
+  const gchar *profile_path = NULL;
+  const gchar *details = NULL;
+  guint32 error_code;
+
+  /* not ours, or already cancelled */
+  if (session->task == NULL)
+    return;
+
+  g_variant_get (parameters, "(u@a{sv})", &error_code, &dict);
+  if (error_code != CD_SESSION_ERROR_NONE)
+    {
+      if (!g_variant_lookup (dict, "ErrorDetails", "&s", &details))
+        details = "failed to calibrate";
+      cc_color_calibrate_session_return (session, NULL,
+                                         g_error_new_literal (CC_COLOR_CALIBRATE_SESSION_ERROR,
+                                                              error_code,
+                                                              details));
+      return;
+    }
+
+  g_variant_lookup (dict, "ProfilePath", "&s", &profile_path);
+  cc_color_calibrate_session_return (session, g_strdup (profile_path), NULL);
+}
+
+static void
+cc_color_calibrate_session_signal_cb (CcColorCalibrateSession *session,
+                                      const gchar             *sender_name,
+                                      const gchar             *signal_name,
+                                      GVariant                *parameters)
+{
+  if (g_strcmp0 (signal_name, "Finished") == 0)
+    {
+      cc_color_calibrate_session_finished (session, parameters);
+      return;
+    }
+  if (g_strcmp0 (signal_name, "UpdateSample") == 0)
+    {
+      gdouble red, green, blue;
+
+      g_variant_get (parameters, "(ddd)", &red, &green, &blue);
+      g_signal_emit (session, signals[SIGNAL_UPDATE_SAMPLE], 0, red, green, blue);
+      return;
+    }
+  if (g_strcmp0 (signal_name, "InteractionRequired") == 0)
+    {
+      const gchar *message;
+      const gchar *image;
+      guint32 code;
+
+      g_variant_get (parameters, "(u&s&s)", &code, &message, &image);
+      g_debug ("Interaction required type %u: %s", code, message);
+      g_signal_emit (session, signals[SIGNAL_INTERACTION_REQUIRED], 0, code, message, image);
+      return;
+    }
+  if (g_strcmp0 (signal_name, "UpdateGamma") == 0)
+    {
+      g_autoptr(GVariantIter) iter = NULL;
+      g_autoptr(GPtrArray) array = NULL;
+      CdColorRGB color;
+
+      g_variant_get (parameters, "(a(ddd))", &iter);
+      array = g_ptr_array_new_with_free_func (g_free);
+      while (g_variant_iter_loop (iter, "(ddd)", &color.R, &color.G, &color.B))
+        {
+          CdColorRGB *color_tmp = cd_color_rgb_new ();
+
+          cd_color_rgb_copy (&color, color_tmp);
+          g_ptr_array_add (array, color_tmp);
+        }
+      g_signal_emit (session, signals[SIGNAL_UPDATE_GAMMA], 0, array);
+      return;
+    }
+  g_warning ("got unknown signal %s", signal_name);
+}
+
+static void
+cc_color_calibrate_session_property_changed_cb (CcColorCalibrateSession *session,
+                                                GVariant                *changed_properties,
+                                                GStrv                    invalidated_properties)
+{
+  guint32 value;
+
+  if (g_variant_lookup (changed_properties, "Progress", "u", &value))
+    g_signal_emit (session, signals[SIGNAL_PROGRESS], 0, value);
+}
+
+static void
+cc_color_calibrate_session_proxy_cb (GObject      *object,
+                                     GAsyncResult *res,
+                                     gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  CcColorCalibrateSession *session;
+  GDBusProxy *proxy;
+  GError *error = NULL;
+
+  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+  if (proxy == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  session = g_object_new (CC_TYPE_COLOR_CALIBRATE_SESSION, NULL);
+  session->proxy = proxy;
+  g_signal_connect_object (proxy, "g-properties-changed",
+                           G_CALLBACK (cc_color_calibrate_session_property_changed_cb),
+                           session, G_CONNECT_SWAPPED);
+  g_signal_connect_object (proxy, "g-signal",
+                           G_CALLBACK (cc_color_calibrate_session_signal_cb),
+                           session, G_CONNECT_SWAPPED);
+
+  g_task_return_pointer (task, session, g_object_unref);
+}
+
+/* Connects to the helper, starting it if needed */
+void
+cc_color_calibrate_session_new_async (GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_calibrate_session_new_async);
+
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                            G_DBUS_PROXY_FLAGS_NONE,
+                            NULL,
+                            CD_SESSION_DBUS_SERVICE,
+                            CD_SESSION_DBUS_PATH,
+                            CD_SESSION_DBUS_INTERFACE_DISPLAY,
+                            cancellable,
+                            cc_color_calibrate_session_proxy_cb,
+                            task);
+}
+
+CcColorCalibrateSession *
+cc_color_calibrate_session_new_finish (GAsyncResult  *result,
+                                       GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/*
+ * Runs a calibration of the device with the sensor.  Only one calibration
+ * can run at a time.  Errors reported by the helper are in the
+ * CC_COLOR_CALIBRATE_SESSION_ERROR domain.
+ */
+void
+cc_color_calibrate_session_start_async (CcColorCalibrateSession *session,
+                                        const gchar             *device_id,
+                                        const gchar             *sensor_id,
+                                        GVariant                *options,
+                                        GCancellable            *cancellable,
+                                        GAsyncReadyCallback      callback,
+                                        gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (CC_IS_COLOR_CALIBRATE_SESSION (session));
+  g_return_if_fail (session->task == NULL);
+
+  task = g_task_new (session, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_calibrate_session_start_async);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_variant_unref (g_variant_ref_sink (options));
+      return;
+    }
+
+  session->task = g_object_ref (task);
+  if (cancellable != NULL)
+    session->cancelled_id = g_cancellable_connect (cancellable,
+                                                   G_CALLBACK (cc_color_calibrate_session_cancelled_cb),
+                                                   session, NULL);
+
+  /* not cancellable, the helper has to be told with Cancel */
+  g_dbus_proxy_call (session->proxy,
+                     "Start",
+                     g_variant_new ("(ss@a{sv})", device_id, sensor_id, options),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     cc_color_calibrate_session_start_cb,
+                     g_steal_pointer (&task));
+}
+
+/*
+ * Returns the object path of the new profile, or NULL if the helper didn't
+ * say where it is.
+ */
+gchar *
+cc_color_calibrate_session_start_finish (CcColorCalibrateSession  *session,
+                                         GAsyncResult             *result,
+                                         GError                  **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, session), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/* Tells the helper the user did what it asked for */
+void
+cc_color_calibrate_session_resume (CcColorCalibrateSession *session)
+{
+  g_return_if_fail (CC_IS_COLOR_CALIBRATE_SESSION (session));
+
+  g_dbus_proxy_call (session->proxy,
+                     "Resume",
+                     NULL,
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     cc_color_calibrate_session_call_cb,
+                     (gpointer) "Resume");
+}
+
+static void
+cc_color_calibrate_session_finalize (GObject *object)
+{
+  CcColorCalibrateSession *session = CC_COLOR_CALIBRATE_SESSION (object);
+
+  /* a running calibration keeps the session alive */
+  g_assert (session->task == NULL);
+  g_clear_object (&session->proxy);
+
+  G_OBJECT_CLASS (cc_color_calibrate_session_parent_class)->finalize (object);
+}
+
+static void
+cc_color_calibrate_session_class_init (CcColorCalibrateSessionClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_color_calibrate_session_finalize;
+
+  signals[SIGNAL_PROGRESS] =
+    g_signal_new ("progress",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  1, G_TYPE_UINT);
+
+  signals[SIGNAL_UPDATE_SAMPLE] =
+    g_signal_new ("update-sample",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  3, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
+
+  /* a GPtrArray of CdColorRGB */
+  signals[SIGNAL_UPDATE_GAMMA] =
+    g_signal_new ("update-gamma",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  1, G_TYPE_PTR_ARRAY);
+
+  /* a CdSessionInteraction, the message and an image path */
+  signals[SIGNAL_INTERACTION_REQUIRED] =
+    g_signal_new ("interaction-required",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  3, G_TYPE_UINT, G_TYPE_STRING, G_TYPE_STRING);
+}
+
+static void
+cc_color_calibrate_session_init (CcColorCalibrateSession *session)
+{
+}
@@ -0,0 +1,50 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Error codes are CdSessionError values */
+#define CC_COLOR_CALIBRATE_SESSION_ERROR (cc_color_calibrate_session_error_quark ())
+
+#define CC_TYPE_COLOR_CALIBRATE_SESSION (cc_color_calibrate_session_get_type ())
+G_DECLARE_FINAL_TYPE (CcColorCalibrateSession, cc_color_calibrate_session, CC, COLOR_CALIBRATE_SESSION, GObject)
+
+GQuark                   cc_color_calibrate_session_error_quark  (void);
+
+void                     cc_color_calibrate_session_new_async    (GCancellable             *cancellable,
+                                                                  GAsyncReadyCallback       callback,
+                                                                  gpointer                  user_data);
+CcColorCalibrateSession *cc_color_calibrate_session_new_finish   (GAsyncResult             *result,
+                                                                  GError                  **error);
+
+void                     cc_color_calibrate_session_start_async  (CcColorCalibrateSession  *session,
+                                                                  const gchar              *device_id,
+                                                                  const gchar              *sensor_id,
+                                                                  GVariant                 *options,
+                                                                  GCancellable             *cancellable,
+                                                                  GAsyncReadyCallback       callback,
+                                                                  gpointer                  user_data);
+gchar                   *cc_color_calibrate_session_start_finish (CcColorCalibrateSession  *session,
+                                                                  GAsyncResult             *result,
+                                                                  GError                  **error);
+
+void                     cc_color_calibrate_session_resume       (CcColorCalibrateSession  *session);
+
+G_END_DECLS
@@ -32,6 +32,7 @@
 #include <libgnome-desktop/gnome-rr.h>
 
 #include "cc-color-calibrate.h"
+#include "cc-color-calibrate-session.h"
 
 #define CALIBRATE_WINDOW_OPACITY 0.9
 
@@ -44,9 +45,11 @@ struct _CcColorCalibrate
   CdSensor        *sensor;
   CdProfile       *profile;
   gchar           *title;
-  GDBusProxy      *proxy_helper;
+  CcColorCalibrateSession *session;
   GDBusProxy      *proxy_inhibit;
-  GMainLoop       *loop;
+  GTask           *task;
+  GCancellable    *cancellable;
+  gulong           cancelled_id;
   GnomeRROutput   *output;
   GnomeRRScreen   *x11_screen;
   GtkBuilder      *builder;
@@ -58,24 +61,16 @@ struct _CcColorCalibrate
   gdouble          target_gamma;
   gint             inhibit_fd;
   gint             inhibit_cookie;
-  CdSessionError   session_error_code;
+  gboolean         session_finished;
+  GError          *session_error;
 };
 
-#define CD_SESSION_ERROR   cc_color_calibrate_error_quark()
+#define CD_SESSION_ERROR   CC_COLOR_CALIBRATE_SESSION_ERROR
 
 #define COLORD_SETTINGS_SCHEMA  "org.freedesktop.ColorHelper"
 
 G_DEFINE_TYPE (CcColorCalibrate, cc_color_calibrate, G_TYPE_OBJECT)
 
-static GQuark
-cc_color_calibrate_error_quark (void)
-{
-  static GQuark quark = 0;
-  if (!quark)
-    quark = g_quark_from_static_string ("CcColorCalibrateError");
-  return quark;
-}
-
 void
 cc_color_calibrate_set_kind (CcColorCalibrate *calibrate,
                              CdSensorCap kind)
@@ -279,24 +274,15 @@ cc_color_calibrate_calib_set_output_gamma (CcColorCalibrate *calibrate,
 }
 
 static void
-cc_color_calibrate_property_changed_cb (CcColorCalibrate *calibrate,
-                                        GVariant *changed_properties,
-                                        GStrv invalidated_properties)
+cc_color_calibrate_progress_cb (CcColorCalibrate *calibrate,
+                                guint value)
 {
-  gboolean ret;
   GtkWidget *widget;
-  guint value;
 
-  ret = g_variant_lookup (changed_properties,
-                          "Progress",
-                          "u", &value);
-  if (ret)
-    {
-      widget = GTK_WIDGET (gtk_builder_get_object (calibrate->builder,
-                                                   "progressbar_status"));
-      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (widget),
-                                     value / 100.0f);
-    }
+  widget = GTK_WIDGET (gtk_builder_get_object (calibrate->builder,
+                                               "progressbar_status"));
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (widget),
+                                 value / 100.0f);
 }
 
 static void
@@ -427,8 +413,7 @@ cc_color_calibrate_finished (CcColorCalibrate *calibrate,
   g_autoptr(GString) str = NULL;
   const gchar *tmp;
 
-  /* save failure so we can get this after we've quit the loop */
-  calibrate->session_error_code = code;
+  calibrate->session_finished = TRUE;
 
   /* show correct buttons */
   widget = GTK_WIDGET (gtk_builder_get_object (calibrate->builder,
@@ -472,135 +457,57 @@ cc_color_calibrate_finished (CcColorCalibrate *calibrate,
 }
 
 static void
-cc_color_calibrate_signal_cb (CcColorCalibrate *calibrate,
-                              const gchar *sender_name,
-                              const gchar *signal_name,
-                              GVariant *parameters)
+cc_color_calibrate_update_sample_cb (CcColorCalibrate *calibrate,
+                                     gdouble red,
+                                     gdouble green,
+                                     gdouble blue)
 {
   CdColorRGB color;
-  CdColorRGB *color_tmp;
-  const gchar *image = NULL;
-  const gchar *message;
-  const gchar *profile_path = NULL;
-  const gchar *str = NULL;
-  gboolean ret;
-  g_autoptr(GError) error = NULL;
-  GPtrArray *array = NULL;
   GtkImage *img;
   GtkLabel *label;
-  g_autoptr(GVariant) dict = NULL;
 
-  if (g_strcmp0 (signal_name, "Finished") == 0)
-    {
-      CdSessionError error_code;
-
-      g_variant_get (parameters, "(u@a{sv})",
-                     &error_code,
-                     &dict);
-      g_variant_lookup (dict, "ErrorDetails", "&s", &str);
-      ret = g_variant_lookup (dict, "ProfilePath", "&s", &profile_path);
-      if (ret)
-        calibrate->profile = cd_profile_new_with_object_path (profile_path);
-      cc_color_calibrate_finished (calibrate, error_code, str);
-      return;
-    }
-  if (g_strcmp0 (signal_name, "UpdateSample") == 0)
-    {
-      g_variant_get (parameters, "(ddd)",
-                     &color.R,
-                     &color.G,
-                     &color.B);
-      img = GTK_IMAGE (gtk_builder_get_object (calibrate->builder,
-                                               "image_status"));
-      gtk_widget_set_visible (GTK_WIDGET (img), FALSE);
-      gtk_widget_set_visible (GTK_WIDGET (calibrate->sample_widget), TRUE);
-      cd_sample_widget_set_color (CD_SAMPLE_WIDGET (calibrate->sample_widget),
-                                  &color);
-
-      /* for Lenovo W700 and W520 laptops we almost fullscreen the
-       * sample widget as the device is actually embedded in the
-       * palmrest! */
-      if (cd_sensor_get_embedded (calibrate->sensor))
-        {
-          g_debug ("Making sample window larger for embedded sensor");
-          gtk_widget_set_size_request (calibrate->sample_widget, 1000, 600);
-        }
-
-      /* set the generic label too */
-      label = GTK_LABEL (gtk_builder_get_object (calibrate->builder,
-                                                 "label_status"));
-      /* TRANSLATORS: The user has to be careful not to knock the
-       * display off the screen (although we do cope if this is
-       * detected early enough) */
-      gtk_label_set_label (label, _("Do not disturb the calibration device while in progress"));
-      return;
-    }
-  if (g_strcmp0 (signal_name, "InteractionRequired") == 0)
-    {
-      CdSessionInteraction code;
-
-      g_variant_get (parameters, "(u&s&s)",
-                     &code,
-                     &message,
-                     &image);
-      g_debug ("Interaction required type %i: %s",
-               code, message);
-      cc_color_calibrate_interaction_required (calibrate,
-                                               code,
-                                               message,
-                                               image);
-      return;
-    }
-  if (g_strcmp0 (signal_name, "UpdateGamma") == 0)
+  cd_color_rgb_set (&color, red, green, blue);
+  img = GTK_IMAGE (gtk_builder_get_object (calibrate->builder,
+                                           "image_status"));
+  gtk_widget_set_visible (GTK_WIDGET (img), FALSE);
+  gtk_widget_set_visible (GTK_WIDGET (calibrate->sample_widget), TRUE);
+  cd_sample_widget_set_color (CD_SAMPLE_WIDGET (calibrate->sample_widget),
+                              &color);
+
+  /* for Lenovo W700 and W520 laptops we almost fullscreen the
+   * sample widget as the device is actually embedded in the
+   * palmrest! */
+  if (cd_sensor_get_embedded (calibrate->sensor))
     {
-      g_autoptr(GVariantIter) iter = NULL;
-
-      g_variant_get (parameters,
-                     "(a(ddd))",
-                     &iter);
-      array = g_ptr_array_new_with_free_func (g_free);
-      while (g_variant_iter_loop (iter, "(ddd)",
-                                  &color.R,
-                                  &color.G,
-                                  &color.B))
-        {
-          color_tmp = cd_color_rgb_new ();
-          cd_color_rgb_copy (&color, color_tmp);
-          g_ptr_array_add (array, color_tmp);
-        }
-      ret = cc_color_calibrate_calib_set_output_gamma (calibrate,
-                                                       array,
-                                                       &error);
-      if (!ret)
-        {
-          g_warning ("failed to update gamma: %s",
-                     error->message);
-          return;
-        }
-      return;
+      g_debug ("Making sample window larger for embedded sensor");
+      gtk_widget_set_size_request (calibrate->sample_widget, 1000, 600);
     }
-  g_warning ("got unknown signal %s", signal_name);
+
+  /* set the generic label too */
+  label = GTK_LABEL (gtk_builder_get_object (calibrate->builder,
+                                             "label_status"));
+  /* TRANSLATORS: The user has to be careful not to knock the
+   * display off the screen (although we do cope if this is
+   * detected early enough) */
+  gtk_label_set_label (label, _("Do not disturb the calibration device while in progress"));
 }
 
 static void
-cc_color_calibrate_cancel (CcColorCalibrate *calibrate)
+cc_color_calibrate_update_gamma_cb (CcColorCalibrate *calibrate,
+                                    GPtrArray *array)
 {
-  g_autoptr(GVariant) retval = NULL;
   g_autoptr(GError) error = NULL;
 
-  /* cancel the calibration to ensure the helper quits */
-  retval = g_dbus_proxy_call_sync (calibrate->proxy_helper,
-                                   "Cancel",
-                                   NULL,
-                                   G_DBUS_CALL_FLAGS_NONE,
-                                   -1,
-                                   NULL,
-                                   &error);
-  if (retval == NULL)
-    g_warning ("Failed to send Cancel: %s", error->message);
+  if (!cc_color_calibrate_calib_set_output_gamma (calibrate, array, &error))
+    g_warning ("failed to update gamma: %s", error->message);
+}
 
-  /* return */
-  g_main_loop_quit (calibrate->loop);
+static void
+cc_color_calibrate_cancel (CcColorCalibrate *calibrate)
+{
+  /* the helper is told to quit when the session notices */
+  if (calibrate->cancellable != NULL)
+    g_cancellable_cancel (calibrate->cancellable);
 }
 
 static gboolean
@@ -691,18 +598,73 @@ cc_color_calibrate_window_state_cb (CcColorCalibrate *calibrate,
   return TRUE;
 }
 
+static void
+cc_color_calibrate_uninhibit (CcColorCalibrate *calibrate)
+{
+  GtkApplication *application;
+
+  if (calibrate->inhibit_fd != -1)
+    {
+      close (calibrate->inhibit_fd);
+      calibrate->inhibit_fd = -1;
+    }
+
+  if (calibrate->inhibit_cookie != 0)
+    {
+      application = GTK_APPLICATION (g_application_get_default ());
+      gtk_application_uninhibit (application, calibrate->inhibit_cookie);
+      calibrate->inhibit_cookie = 0;
+    }
+}
+
+static void
+cc_color_calibrate_stop (CcColorCalibrate *calibrate)
+{
+  g_autoptr(GTask) task = g_steal_pointer (&calibrate->task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  GtkWidget *window;
+
+  window = GTK_WIDGET (gtk_builder_get_object (calibrate->builder,
+                                               "dialog_calibrate"));
+  gtk_widget_hide (window);
+
+  /* also drops an Inhibit call still on its way */
+  g_cancellable_cancel (calibrate->cancellable);
+  g_clear_object (&calibrate->cancellable);
+  if (calibrate->cancelled_id != 0)
+    {
+      g_cancellable_disconnect (cancellable, calibrate->cancelled_id);
+      calibrate->cancelled_id = 0;
+    }
+
+  /* we can go idle now */
+  cc_color_calibrate_uninhibit (calibrate);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_clear_error (&calibrate->session_error);
+      return;
+    }
+  if (calibrate->session_error != NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&calibrate->session_error));
+      return;
+    }
+  g_task_return_boolean (task, TRUE);
+}
+
 static void
 cc_color_calibrate_button_done_cb (CcColorCalibrate *calibrate)
 {
-  g_main_loop_quit (calibrate->loop);
+  if (calibrate->task == NULL)
+    return;
+  cc_color_calibrate_stop (calibrate);
 }
 
 static void
 cc_color_calibrate_button_start_cb (CcColorCalibrate *calibrate)
 {
   GtkWidget *widget;
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GVariant) retval = NULL;
 
   /* set correct buttons */
   widget = GTK_WIDGET (gtk_builder_get_object (calibrate->builder,
@@ -713,15 +675,7 @@ cc_color_calibrate_button_start_cb (CcColorCalibrate *calibrate)
   gtk_widget_set_visible (widget, FALSE);
 
   /* continue */
-  retval = g_dbus_proxy_call_sync (calibrate->proxy_helper,
-                                   "Resume",
-                                   NULL,
-                                   G_DBUS_CALL_FLAGS_NONE,
-                                   -1,
-                                   NULL,
-                                   &error);
-  if (retval == NULL)
-    g_warning ("Failed to send Resume: %s", error->message);
+  cc_color_calibrate_session_resume (calibrate->session);
 }
 
 static void
@@ -771,31 +725,42 @@ cc_color_calibrate_alpha_screen_changed_cb (CcColorCalibrate *calibrate)
 }
 
 static void
-cc_color_calibrate_uninhibit (CcColorCalibrate *calibrate)
+cc_color_calibrate_inhibit_cb (GObject *object,
+                               GAsyncResult *res,
+                               gpointer user_data)
 {
-  GtkApplication *application;
+  CcColorCalibrate *calibrate;
+  g_autoptr(GError) error = NULL;
+  gint idx;
+  g_autoptr(GUnixFDList) fd_list = NULL;
+  g_autoptr(GVariant) retval = NULL;
 
-  if (calibrate->inhibit_fd != -1)
+  retval = g_dbus_proxy_call_with_unix_fd_list_finish (G_DBUS_PROXY (object),
+                                                       &fd_list,
+                                                       res,
+                                                       &error);
+  if (retval == NULL)
     {
-      close (calibrate->inhibit_fd);
-      calibrate->inhibit_fd = -1;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to send Inhibit: %s", error->message);
+      return;
     }
 
-  if (calibrate->inhibit_cookie != 0)
+  calibrate = CC_COLOR_CALIBRATE (user_data);
+
+  g_variant_get (retval, "(h)", &idx);
+  calibrate->inhibit_fd = g_unix_fd_list_get (fd_list, idx, &error);
+  if (calibrate->inhibit_fd == -1)
     {
-      application = GTK_APPLICATION (g_application_get_default ());
-      gtk_application_uninhibit (application, calibrate->inhibit_cookie);
-      calibrate->inhibit_cookie = 0;
+      g_warning ("Failed to receive system inhibitor fd: %s", error->message);
+      return;
     }
+  g_debug ("System inhibitor fd is %d", calibrate->inhibit_fd);
 }
 
 static void
 cc_color_calibrate_inhibit (CcColorCalibrate *calibrate, GtkWindow *window)
 {
-  g_autoptr(GError) error = NULL;
-  gint idx;
-  g_autoptr(GUnixFDList) fd_list = NULL;
-  g_autoptr(GVariant) retval = NULL;
   GtkApplication *application;
 
   /* inhibit basically everything we can */
@@ -809,105 +774,244 @@ cc_color_calibrate_inhibit (CcColorCalibrate *calibrate, GtkWindow *window)
                                                   "Display calibration in progress");
 
   /* tell logind to disallow the lid switch */
-  retval = g_dbus_proxy_call_with_unix_fd_list_sync (calibrate->proxy_inhibit,
-                                                     "Inhibit",
-                                                     g_variant_new ("(ssss)",
-                                                                    "shutdown:"
-                                                                    "sleep:"
-                                                                    "idle:"
-                                                                    "handle-lid-switch",
-                                                                    "Display Calibrator",
-                                                                    "Display calibration in progress",
-                                                                    "block"),
-                                                     G_DBUS_CALL_FLAGS_NONE,
-                                                     -1,
-                                                     NULL,
-                                                     &fd_list,
-                                                     NULL,
-                                                     &error);
-  if (retval == NULL)
+  g_dbus_proxy_call_with_unix_fd_list (calibrate->proxy_inhibit,
+                                       "Inhibit",
+                                       g_variant_new ("(ssss)",
+                                                      "shutdown:"
+                                                      "sleep:"
+                                                      "idle:"
+                                                      "handle-lid-switch",
+                                                      "Display Calibrator",
+                                                      "Display calibration in progress",
+                                                      "block"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,
+                                       NULL,
+                                       calibrate->cancellable,
+                                       cc_color_calibrate_inhibit_cb,
+                                       calibrate);
+}
+
+typedef struct
+{
+  guint   n_pending;
+  GError *error;
+} SetupData;
+
+static void
+setup_data_free (SetupData *data)
+{
+  g_clear_error (&data->error);
+  g_free (data);
+}
+
+static void
+cc_color_calibrate_setup_complete (GTask *task,
+                                   GError *error)
+{
+  SetupData *data = g_task_get_task_data (task);
+
+  /* keep the first error */
+  if (data->error == NULL)
+    data->error = error;
+  else if (error != NULL)
+    g_error_free (error);
+
+  g_assert (data->n_pending > 0);
+  if (--data->n_pending > 0)
+    return;
+
+  if (data->error != NULL)
+    g_task_return_error (task, g_steal_pointer (&data->error));
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+cc_color_calibrate_proxy_inhibit_cb (GObject *object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  CcColorCalibrate *calibrate = g_task_get_source_object (task);
+  GDBusProxy *proxy;
+  GError *error = NULL;
+
+  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+  if (proxy != NULL)
     {
-      g_warning ("Failed to send Inhibit: %s", error->message);
-      return;
+      g_clear_object (&calibrate->proxy_inhibit);
+      calibrate->proxy_inhibit = proxy;
     }
-  g_variant_get (retval, "(h)", &idx);
-  calibrate->inhibit_fd = g_unix_fd_list_get (fd_list, idx, &error);
-  if (calibrate->inhibit_fd == -1)
+  cc_color_calibrate_setup_complete (task, error);
+}
+
+static void
+cc_color_calibrate_session_new_cb (GObject *object,
+                                   GAsyncResult *res,
+                                   gpointer user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  CcColorCalibrate *calibrate = g_task_get_source_object (task);
+  CcColorCalibrateSession *session;
+  GError *error = NULL;
+
+  session = cc_color_calibrate_session_new_finish (res, &error);
+  if (session != NULL)
     {
-      g_warning ("Failed to receive system inhibitor fd: %s", error->message);
+      g_clear_object (&calibrate->session);
+      calibrate->session = session;
+      g_signal_connect_object (session, "progress",
+                               G_CALLBACK (cc_color_calibrate_progress_cb),
+                               calibrate, G_CONNECT_SWAPPED);
+      g_signal_connect_object (session, "update-sample",
+                               G_CALLBACK (cc_color_calibrate_update_sample_cb),
+                               calibrate, G_CONNECT_SWAPPED);
+      g_signal_connect_object (session, "update-gamma",
+                               G_CALLBACK (cc_color_calibrate_update_gamma_cb),
+                               calibrate, G_CONNECT_SWAPPED);
+      g_signal_connect_object (session, "interaction-required",
+                               G_CALLBACK (cc_color_calibrate_interaction_required),
+                               calibrate, G_CONNECT_SWAPPED);
+    }
+  cc_color_calibrate_setup_complete (task, error);
+}
+
+/*
+ * Connects to logind and to the calibration helper, both at once.  Does
+ * nothing if that was already done.
+ */
+void
+cc_color_calibrate_setup_async (CcColorCalibrate *calibrate,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  SetupData *data;
+
+  g_return_if_fail (CC_IS_COLOR_CALIBRATE (calibrate));
+  g_return_if_fail (calibrate->device_kind != CD_SENSOR_CAP_UNKNOWN);
+
+  task = g_task_new (calibrate, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_calibrate_setup_async);
+
+  if (calibrate->proxy_inhibit != NULL && calibrate->session != NULL)
+    {
+      g_task_return_boolean (task, TRUE);
       return;
     }
-  g_debug ("System inhibitor fd is %d", calibrate->inhibit_fd);
+
+  data = g_new0 (SetupData, 1);
+  data->n_pending = 2;
+  g_task_set_task_data (task, data, (GDestroyNotify) setup_data_free);
+
+  /* use logind to disable system state idle */
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+                            G_DBUS_PROXY_FLAGS_NONE,
+                            NULL,
+                            "org.freedesktop.login1",
+                            "/org/freedesktop/login1",
+                            "org.freedesktop.login1.Manager",
+                            cancellable,
+                            cc_color_calibrate_proxy_inhibit_cb,
+                            g_object_ref (task));
+
+  /* start the calibration session daemon */
+  cc_color_calibrate_session_new_async (cancellable,
+                                        cc_color_calibrate_session_new_cb,
+                                        g_object_ref (task));
 }
 
 gboolean
-cc_color_calibrate_setup (CcColorCalibrate *calibrate,
-                          GError **error)
+cc_color_calibrate_setup_finish (CcColorCalibrate *calibrate,
+                                 GAsyncResult *result,
+                                 GError **error)
 {
-  gboolean ret = TRUE;
+  g_return_val_if_fail (g_task_is_valid (result, calibrate), FALSE);
 
-  g_return_val_if_fail (CC_IS_COLOR_CALIBRATE (calibrate), FALSE);
-  g_return_val_if_fail (calibrate->device_kind != CD_SENSOR_CAP_UNKNOWN, FALSE);
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-  /* use logind to disable system state idle */
-  calibrate->proxy_inhibit = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
-                                                            G_DBUS_PROXY_FLAGS_NONE,
-                                                            NULL,
-                                                            "org.freedesktop.login1",
-                                                            "/org/freedesktop/login1",
-                                                            "org.freedesktop.login1.Manager",
-                                                            NULL,
-                                                            error);
-  if (calibrate->proxy_inhibit == NULL)
+static void
+cc_color_calibrate_session_start_cb (GObject *object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+  g_autoptr(CcColorCalibrate) calibrate = CC_COLOR_CALIBRATE (user_data);
+  g_autofree gchar *profile_path = NULL;
+  g_autoptr(GError) error = NULL;
+  CdSessionError code = CD_SESSION_ERROR_INTERNAL;
+
+  profile_path = cc_color_calibrate_session_start_finish (CC_COLOR_CALIBRATE_SESSION (object),
+                                                          res,
+                                                          &error);
+
+  /* the user or the caller gave up, there's nothing to show */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      ret = FALSE;
-      goto out;
+      cc_color_calibrate_stop (calibrate);
+      return;
     }
 
-  /* start the calibration session daemon */
-  calibrate->proxy_helper = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                           G_DBUS_PROXY_FLAGS_NONE,
-                                                           NULL,
-                                                           CD_SESSION_DBUS_SERVICE,
-                                                           CD_SESSION_DBUS_PATH,
-                                                           CD_SESSION_DBUS_INTERFACE_DISPLAY,
-                                                           NULL,
-                                                           error);
-  if (calibrate->proxy_helper == NULL)
+  if (error == NULL)
     {
-      ret = FALSE;
-      goto out;
+      if (profile_path != NULL)
+        calibrate->profile = cd_profile_new_with_object_path (profile_path);
+      cc_color_calibrate_finished (calibrate, CD_SESSION_ERROR_NONE, NULL);
+      return;
     }
-  g_signal_connect_object (calibrate->proxy_helper,
-                           "g-properties-changed",
-                           G_CALLBACK (cc_color_calibrate_property_changed_cb),
-                           calibrate, G_CONNECT_SWAPPED);
-  g_signal_connect_object (calibrate->proxy_helper,
-                           "g-signal",
-                           G_CALLBACK (cc_color_calibrate_signal_cb),
-                           calibrate, G_CONNECT_SWAPPED);
-out:
-  return ret;
+
+  /* wait for the user to press "Done" */
+  if (error->domain == CC_COLOR_CALIBRATE_SESSION_ERROR)
+    code = error->code;
+  cc_color_calibrate_finished (calibrate, code, error->message);
+  calibrate->session_error = g_steal_pointer (&error);
 }
 
-gboolean
-cc_color_calibrate_start (CcColorCalibrate *calibrate,
-                          GtkWindow *parent,
-                          GError **error)
+static void
+cc_color_calibrate_cancelled_cb (GCancellable *cancellable,
+                                 GCancellable *run_cancellable)
 {
+  g_cancellable_cancel (run_cancellable);
+}
+
+/*
+ * Shows the calibration window and runs the calibration, until the user
+ * either closes the window or cancels.  A calibration the user cancelled
+ * isn't an error, but then there's no profile.  Needs a successful
+ * cc_color_calibrate_setup_async() first.
+ */
+void
+cc_color_calibrate_start_async (CcColorCalibrate *calibrate,
+                                GtkWindow *parent,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GError) error = NULL;
   const gchar *name;
   GtkWidget *widget;
   GtkWindow *window;
   GVariantBuilder builder;
-  g_autoptr(GVariant) retval = NULL;
 
-  g_return_val_if_fail (CC_IS_COLOR_CALIBRATE (calibrate), FALSE);
+  g_return_if_fail (CC_IS_COLOR_CALIBRATE (calibrate));
+  g_return_if_fail (calibrate->session != NULL);
+  g_return_if_fail (calibrate->task == NULL);
+
+  task = g_task_new (calibrate, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_calibrate_start_async);
 
   /* get screen */
+  g_clear_object (&calibrate->x11_screen);
   name = cd_device_get_metadata_item (calibrate->device,
                                       CD_DEVICE_METADATA_XRANDR_NAME);
-  if (!cc_color_calibrate_calib_setup_screen (calibrate, name, error))
-    return FALSE;
+  if (!cc_color_calibrate_calib_setup_screen (calibrate, name, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
   g_variant_builder_add (&builder,
@@ -930,18 +1034,25 @@ cc_color_calibrate_start (CcColorCalibrate *calibrate,
                          "{sv}",
                          "DeviceKind",
                          g_variant_new_uint32 (calibrate->device_kind));
-  retval = g_dbus_proxy_call_sync (calibrate->proxy_helper,
-                                   "Start",
-                                   g_variant_new ("(ssa{sv})",
-                                                  cd_device_get_id (calibrate->device),
-                                                  cd_sensor_get_id (calibrate->sensor),
-                                                  &builder),
-                                   G_DBUS_CALL_FLAGS_NONE,
-                                   -1,
-                                   NULL,
-                                   error);
-  if (retval == NULL)
-    return FALSE;
+
+  /* cancelled by the caller, or by the user from the window */
+  calibrate->task = g_steal_pointer (&task);
+  calibrate->cancellable = g_cancellable_new ();
+  if (cancellable != NULL)
+    calibrate->cancelled_id = g_cancellable_connect (cancellable,
+                                                     G_CALLBACK (cc_color_calibrate_cancelled_cb),
+                                                     g_object_ref (calibrate->cancellable),
+                                                     g_object_unref);
+  calibrate->session_finished = FALSE;
+  g_clear_object (&calibrate->profile);
+
+  cc_color_calibrate_session_start_async (calibrate->session,
+                                          cd_device_get_id (calibrate->device),
+                                          cd_sensor_get_id (calibrate->sensor),
+                                          g_variant_builder_end (&builder),
+                                          calibrate->cancellable,
+                                          cc_color_calibrate_session_start_cb,
+                                          g_object_ref (calibrate));
 
   /* set this above our parent */
   window = GTK_WINDOW (gtk_builder_get_object (calibrate->builder,
@@ -965,31 +1076,26 @@ cc_color_calibrate_start (CcColorCalibrate *calibrate,
 
   /* stop the computer from auto-suspending or turning off the screen */
   cc_color_calibrate_inhibit (calibrate, parent);
+}
 
-  g_main_loop_run (calibrate->loop);
-  gtk_widget_hide (GTK_WIDGET (window));
-
-  /* we can go idle now */
-  cc_color_calibrate_uninhibit (calibrate);
-
-  /* see if we failed */
-  if (calibrate->session_error_code != CD_SESSION_ERROR_NONE)
-    {
-      g_set_error_literal (error,
-                           CD_SESSION_ERROR,
-                           CD_SESSION_ERROR_INTERNAL,
-                           "failed to calibrate");
-      return FALSE;
-    }
+gboolean
+cc_color_calibrate_start_finish (CcColorCalibrate *calibrate,
+                                 GAsyncResult *result,
+                                 GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, calibrate), FALSE);
 
-  return TRUE;
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 static gboolean
 cc_color_calibrate_delete_event_cb (CcColorCalibrate *calibrate)
 {
   /* do not destroy the window */
-  cc_color_calibrate_cancel (calibrate);
+  if (calibrate->session_finished)
+    cc_color_calibrate_button_done_cb (calibrate);
+  else
+    cc_color_calibrate_cancel (calibrate);
   return TRUE;
 }
 
@@ -1001,12 +1107,13 @@ cc_color_calibrate_finalize (GObject *object)
   g_clear_pointer ((GtkWidget **)&calibrate->window, gtk_widget_destroy);
   g_clear_object (&calibrate->builder);
   g_clear_object (&calibrate->device);
-  g_clear_object (&calibrate->proxy_helper);
+  g_clear_object (&calibrate->session);
   g_clear_object (&calibrate->proxy_inhibit);
   g_clear_object (&calibrate->sensor);
+  g_clear_object (&calibrate->profile);
   g_clear_object (&calibrate->x11_screen);
+  g_clear_error (&calibrate->session_error);
   g_free (calibrate->title);
-  g_main_loop_unref (calibrate->loop);
 
   G_OBJECT_CLASS (cc_color_calibrate_parent_class)->finalize (object);
 }
@@ -1028,7 +1135,6 @@ cc_color_calibrate_init (CcColorCalibrate *calibrate)
   GtkWidget *widget;
   GtkWindow *window;
 
-  calibrate->loop = g_main_loop_new (NULL, FALSE);
   calibrate->inhibit_fd = -1;
 
   /* load UI */
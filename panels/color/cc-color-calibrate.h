@@ -44,10 +44,20 @@ void      cc_color_calibrate_set_sensor     (CcColorCalibrate *calibrate,
                                              CdSensor         *sensor);
 void      cc_color_calibrate_set_title      (CcColorCalibrate *calibrate,
                                              const gchar      *title);
-gboolean  cc_color_calibrate_start          (CcColorCalibrate *calibrate,
-                                             GtkWindow        *parent,
+void      cc_color_calibrate_setup_async    (CcColorCalibrate *calibrate,
+                                             GCancellable     *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer          user_data);
+gboolean  cc_color_calibrate_setup_finish   (CcColorCalibrate *calibrate,
+                                             GAsyncResult     *result,
                                              GError          **error);
-gboolean  cc_color_calibrate_setup          (CcColorCalibrate *calibrate,
+void      cc_color_calibrate_start_async    (CcColorCalibrate *calibrate,
+                                             GtkWindow        *parent,
+                                             GCancellable     *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer          user_data);
+gboolean  cc_color_calibrate_start_finish   (CcColorCalibrate *calibrate,
+                                             GAsyncResult     *result,
                                              GError          **error);
 CdProfile *cc_color_calibrate_get_profile   (CcColorCalibrate *calibrate);
 
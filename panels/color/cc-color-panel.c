@@ -34,6 +34,8 @@
 #include "cc-color-common.h"
 #include "cc-color-device.h"
 #include "cc-color-profile.h"
+#include "cc-color-profile-cache.h"
+#include "cc-color-row-index.h"
 
 struct _CcColorPanel
 {
@@ -42,7 +44,12 @@ struct _CcColorPanel
   CdClient      *client;
   CdDevice      *current_device;
   GPtrArray     *devices;
+  guint          devices_connecting;
+  CcColorProfileCache *profile_cache;
+  guint          assign_refresh_id;
   GPtrArray     *sensors;
+  GPtrArray     *sensors_connecting;
+  guint          sensors_pending;
   GDBusProxy    *proxy;
   GSettings     *settings;
   GSettings     *settings_colord;
@@ -86,6 +93,7 @@ struct _CcColorPanel
   CcColorCalibrate *calibrate;
   GtkListBox    *list_box;
   gchar         *list_box_filter;
+  CcColorRowIndex *row_index;
   GtkSizeGroup  *list_box_size;
   gboolean       is_live_cd;
   gboolean       model_is_changing;
@@ -304,38 +312,68 @@ gcm_prefs_calib_prepare_cb (CcColorPanel *panel,
 }
 
 static void
-gcm_prefs_calib_apply_cb (CcColorPanel *prefs)
+gcm_prefs_calib_start_cb (GObject      *object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
 {
-  gboolean ret;
+  CcColorPanel *prefs;
   g_autoptr(GError) error = NULL;
-  GtkWindow *window = NULL;
+  gboolean ret;
 
-  /* setup the calibration object with items that can fail */
-  gtk_widget_show (prefs->button_calib_upload);
-  ret = cc_color_calibrate_setup (prefs->calibrate,
-                                  &error);
-  if (!ret)
-    {
-      g_warning ("failed to setup calibrate: %s", error->message);
-      return;
-    }
+  ret = cc_color_calibrate_start_finish (CC_COLOR_CALIBRATE (object), res, &error);
+  if (!ret && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  /* Only cast the parameters after making sure it wasn't cancelled */
+  prefs = CC_COLOR_PANEL (user_data);
 
-  /* actually start the calibration */
-  window = GTK_WINDOW (prefs->assistant_calib);
-  ret = cc_color_calibrate_start (prefs->calibrate,
-                                  window,
-                                  &error);
   if (!ret)
     {
       g_warning ("failed to start calibrate: %s", error->message);
-      gtk_widget_hide (GTK_WIDGET (window));
+      gtk_widget_hide (prefs->assistant_calib);
       return;
     }
 
   /* if we are a LiveCD then don't close the window as there is another
    * summary pane with the export button */
   if (!prefs->is_live_cd)
-    gtk_widget_hide (GTK_WIDGET (window));
+    gtk_widget_hide (prefs->assistant_calib);
+}
+
+static void
+gcm_prefs_calib_setup_cb (GObject      *object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  CcColorPanel *prefs;
+  g_autoptr(GError) error = NULL;
+
+  if (!cc_color_calibrate_setup_finish (CC_COLOR_CALIBRATE (object), res, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to setup calibrate: %s", error->message);
+      return;
+    }
+
+  prefs = CC_COLOR_PANEL (user_data);
+
+  /* actually start the calibration */
+  cc_color_calibrate_start_async (prefs->calibrate,
+                                  GTK_WINDOW (prefs->assistant_calib),
+                                  cc_panel_get_cancellable (CC_PANEL (prefs)),
+                                  gcm_prefs_calib_start_cb,
+                                  prefs);
+}
+
+static void
+gcm_prefs_calib_apply_cb (CcColorPanel *prefs)
+{
+  /* setup the calibration object with items that can fail */
+  gtk_widget_show (prefs->button_calib_upload);
+  cc_color_calibrate_setup_async (prefs->calibrate,
+                                  cc_panel_get_cancellable (CC_PANEL (prefs)),
+                                  gcm_prefs_calib_setup_cb,
+                                  prefs);
 }
 
 static gboolean
@@ -692,10 +730,12 @@ gcm_prefs_profile_exists_in_array (GPtrArray *array, CdProfile *profile)
   CdProfile *profile_tmp;
   guint i;
 
+  /* the device profiles may not be connected, so compare the paths */
   for (i = 0; i < array->len; i++)
     {
       profile_tmp = g_ptr_array_index (array, i);
-      if (cd_profile_equal (profile, profile_tmp))
+      if (g_strcmp0 (cd_profile_get_object_path (profile),
+                     cd_profile_get_object_path (profile_tmp)) == 0)
          return TRUE;
     }
   return FALSE;
@@ -707,7 +747,6 @@ gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
 {
   CdProfile *profile_tmp;
   gboolean ret;
-  g_autoptr(GError) error = NULL;
   g_autoptr(GPtrArray) profile_array = NULL;
   GtkTreeIter iter;
   guint i;
@@ -723,32 +762,14 @@ gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
 
   gtk_widget_hide (prefs->label_assign_warning);
 
-  /* get profiles */
-  profile_array = cd_client_get_profiles_sync (prefs->client,
-                                               cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                               &error);
-  if (profile_array == NULL)
-    {
-      g_warning ("failed to get profiles: %s",
-           error->message);
-      return;
-    }
+  /* get profiles, the cache fills in the rest while loading */
+  profile_array = cc_color_profile_cache_get_profiles (prefs->profile_cache);
 
   /* add profiles of the right kind */
   for (i = 0; i < profile_array->len; i++)
     {
       profile_tmp = g_ptr_array_index (profile_array, i);
 
-      /* get properties */
-      ret = cd_profile_connect_sync (profile_tmp,
-                                     cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                     &error);
-      if (!ret)
-        {
-          g_warning ("failed to get profile: %s", error->message);
-          return;
-        }
-
       /* don't add any of the already added profiles */
       if (profiles != NULL)
         {
@@ -776,9 +797,12 @@ gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
 }
 
 static void
-gcm_prefs_calib_upload_cb (CcColorPanel *prefs)
+gcm_prefs_calib_upload_connect_cb (GObject *object,
+                                   GAsyncResult *res,
+                                   gpointer user_data)
 {
-  CdProfile *profile;
+  CcColorPanel *prefs;
+  CdProfile *profile = CD_PROFILE (object);
   const gchar *uri;
   gboolean ret;
   g_autofree gchar *upload_uri = NULL;
@@ -792,14 +816,16 @@ gcm_prefs_calib_upload_cb (CcColorPanel *prefs)
   g_autoptr(SoupMultipart) multipart = NULL;
   g_autoptr(SoupSession) session = NULL;
 
-  profile = cc_color_calibrate_get_profile (prefs->calibrate);
-  ret = cd_profile_connect_sync (profile, NULL, &error);
+  ret = cd_profile_connect_finish (profile, res, &error);
   if (!ret)
     {
-      g_warning ("Failed to get imported profile: %s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get imported profile: %s", error->message);
       return;
     }
 
+  prefs = CC_COLOR_PANEL (user_data);
+
   /* read file */
   ret = g_file_get_contents (cd_profile_get_filename (profile),
                              &data,
@@ -861,9 +887,21 @@ gcm_prefs_calib_upload_cb (CcColorPanel *prefs)
 }
 
 static void
-gcm_prefs_calib_export_cb (CcColorPanel *prefs)
+gcm_prefs_calib_upload_cb (CcColorPanel *prefs)
 {
-  CdProfile *profile;
+  cd_profile_connect (cc_color_calibrate_get_profile (prefs->calibrate),
+                      cc_panel_get_cancellable (CC_PANEL (prefs)),
+                      gcm_prefs_calib_upload_connect_cb,
+                      prefs);
+}
+
+static void
+gcm_prefs_calib_export_connect_cb (GObject *object,
+                                   GAsyncResult *res,
+                                   gpointer user_data)
+{
+  CcColorPanel *prefs;
+  CdProfile *profile = CD_PROFILE (object);
   gboolean ret;
   g_autofree gchar *default_name = NULL;
   g_autoptr(GError) error = NULL;
@@ -871,14 +909,16 @@ gcm_prefs_calib_export_cb (CcColorPanel *prefs)
   g_autoptr(GFile) source = NULL;
   GtkWidget *dialog;
 
-  profile = cc_color_calibrate_get_profile (prefs->calibrate);
-  ret = cd_profile_connect_sync (profile, NULL, &error);
+  ret = cd_profile_connect_finish (profile, res, &error);
   if (!ret)
     {
-      g_warning ("Failed to get imported profile: %s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get imported profile: %s", error->message);
       return;
     }
 
+  prefs = CC_COLOR_PANEL (user_data);
+
   /* TRANSLATORS: this is the dialog to save the ICC profile */
   dialog = gtk_file_chooser_dialog_new (_("Save Profile"),
                                         GTK_WINDOW (prefs->main_window),
@@ -909,6 +949,15 @@ gcm_prefs_calib_export_cb (CcColorPanel *prefs)
   gtk_widget_destroy (dialog);
 }
 
+static void
+gcm_prefs_calib_export_cb (CcColorPanel *prefs)
+{
+  cd_profile_connect (cc_color_calibrate_get_profile (prefs->calibrate),
+                      cc_panel_get_cancellable (CC_PANEL (prefs)),
+                      gcm_prefs_calib_export_connect_cb,
+                      prefs);
+}
+
 static void
 gcm_prefs_calib_export_link_cb (CcColorPanel *prefs,
                                 const gchar *url)
@@ -936,6 +985,65 @@ gcm_prefs_profile_add_cb (CcColorPanel *prefs)
   gtk_window_set_transient_for (GTK_WINDOW (prefs->dialog_assign), GTK_WINDOW (prefs->main_window));
 }
 
+static gboolean
+gcm_prefs_assign_refresh_cb (gpointer user_data)
+{
+  CcColorPanel *prefs = CC_COLOR_PANEL (user_data);
+  GtkTreeIter iter;
+  GtkTreeModel *model;
+  GtkTreeSelection *selection;
+  g_autoptr(CdProfile) selected = NULL;
+  g_autoptr(GPtrArray) profiles = NULL;
+  gboolean valid;
+
+  prefs->assign_refresh_id = 0;
+
+  if (!gtk_widget_get_visible (prefs->dialog_assign))
+    return G_SOURCE_REMOVE;
+
+  /* keep the selection across the refresh */
+  selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (prefs->treeview_assign));
+  if (gtk_tree_selection_get_selected (selection, &model, &iter))
+    gtk_tree_model_get (model, &iter,
+                        GCM_PREFS_COMBO_COLUMN_PROFILE, &selected,
+                        -1);
+
+  profiles = cd_device_get_profiles (prefs->current_device);
+  gcm_prefs_add_profiles_suitable_for_devices (prefs, profiles);
+
+  if (selected == NULL)
+    return G_SOURCE_REMOVE;
+  valid = gtk_tree_model_get_iter_first (prefs->liststore_assign, &iter);
+  while (valid)
+    {
+      g_autoptr(CdProfile) profile_tmp = NULL;
+
+      gtk_tree_model_get (prefs->liststore_assign, &iter,
+                          GCM_PREFS_COMBO_COLUMN_PROFILE, &profile_tmp,
+                          -1);
+      if (profile_tmp == selected)
+        {
+          gtk_tree_selection_select_iter (selection, &iter);
+          break;
+        }
+      valid = gtk_tree_model_iter_next (prefs->liststore_assign, &iter);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gcm_prefs_profile_cache_changed_cb (CcColorPanel *prefs)
+{
+  /* only the assign dialog shows the cache directly */
+  if (!gtk_widget_get_visible (prefs->dialog_assign))
+    return;
+
+  /* the cache changes once per profile while loading, rebuild once */
+  if (prefs->assign_refresh_id == 0)
+    prefs->assign_refresh_id = g_idle_add (gcm_prefs_assign_refresh_cb, prefs);
+}
+
 static void
 gcm_prefs_profile_remove_cb (CcColorPanel *prefs)
 {
@@ -1365,50 +1473,100 @@ gcm_prefs_button_assign_import_cb (CcColorPanel *prefs)
 }
 
 static void
-gcm_prefs_sensor_coldplug (CcColorPanel *prefs)
+gcm_prefs_sensor_connect_cb (GObject *object,
+                             GAsyncResult *res,
+                             gpointer user_data)
 {
-  CdSensor *sensor_tmp;
+  CcColorPanel *prefs;
+  CdSensor *sensor = CD_SENSOR (object);
   gboolean ret;
   g_autoptr(GError) error = NULL;
-  g_autoptr(GPtrArray) sensors = NULL;
-  guint i;
 
-  /* unref old */
+  ret = cd_sensor_connect_finish (sensor, res, &error);
+  if (!ret && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  prefs = CC_COLOR_PANEL (user_data);
+
+  /* the sensors changed again in the meantime */
+  if (prefs->sensors_connecting == NULL ||
+      !g_ptr_array_find (prefs->sensors_connecting, sensor, NULL))
+    return;
+
+  if (!ret)
+    {
+      g_warning ("%s", error->message);
+      g_ptr_array_remove (prefs->sensors_connecting, sensor);
+    }
+
+  /* wait for the others */
+  if (--prefs->sensors_pending > 0)
+    return;
+
   g_clear_pointer (&prefs->sensors, g_ptr_array_unref);
+  prefs->sensors = g_steal_pointer (&prefs->sensors_connecting);
+  gcm_prefs_set_calibrate_button_sensitivity (prefs);
+}
 
-  /* no present */
-  sensors = cd_client_get_sensors_sync (prefs->client, NULL, &error);
+static void
+gcm_prefs_get_sensors_cb (GObject *object,
+                          GAsyncResult *res,
+                          gpointer user_data)
+{
+  CcColorPanel *prefs;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) sensors = NULL;
+  guint i;
+
+  sensors = cd_client_get_sensors_finish (CD_CLIENT (object), res, &error);
   if (sensors == NULL)
     {
-      g_warning ("%s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
       return;
     }
-  if (sensors->len == 0)
-    return;
 
-  /* save a copy of the sensor list */
-  prefs->sensors = g_ptr_array_ref (sensors);
+  prefs = CC_COLOR_PANEL (user_data);
+
+  /* drop any list still being connected */
+  g_clear_pointer (&prefs->sensors_connecting, g_ptr_array_unref);
 
-  /* connect to each sensor */
+  /* no present */
+  if (sensors->len == 0)
+    {
+      g_clear_pointer (&prefs->sensors, g_ptr_array_unref);
+      gcm_prefs_set_calibrate_button_sensitivity (prefs);
+      return;
+    }
+
+  /* connect to all the sensors at once */
+  prefs->sensors_connecting = g_ptr_array_ref (sensors);
+  prefs->sensors_pending = sensors->len;
   for (i = 0; i < sensors->len; i++)
     {
-      sensor_tmp = g_ptr_array_index (sensors, i);
-      ret = cd_sensor_connect_sync (sensor_tmp, NULL, &error);
-      if (!ret)
-        {
-          g_warning ("%s", error->message);
-          return;
-        }
+      cd_sensor_connect (g_ptr_array_index (sensors, i),
+                         cc_panel_get_cancellable (CC_PANEL (prefs)),
+                         gcm_prefs_sensor_connect_cb,
+                         prefs);
     }
 }
 
+static void
+gcm_prefs_sensor_coldplug (CcColorPanel *prefs)
+{
+  cd_client_get_sensors (prefs->client,
+                         cc_panel_get_cancellable (CC_PANEL (prefs)),
+                         gcm_prefs_get_sensors_cb,
+                         prefs);
+}
+
 static void
 gcm_prefs_client_sensor_changed_cb (CdClient *client,
                                     CdSensor *sensor,
                                     CcColorPanel *prefs)
 {
+  /* the calibrate button is updated once the sensors are connected */
   gcm_prefs_sensor_coldplug (prefs);
-  gcm_prefs_set_calibrate_button_sensitivity (prefs);
 }
 
 static void
@@ -1417,19 +1575,13 @@ gcm_prefs_add_device_profile (CcColorPanel *prefs,
                               CdProfile *profile,
                               gboolean is_default)
 {
-  gboolean ret;
-  g_autoptr(GError) error = NULL;
   GtkWidget *widget;
 
-  /* get properties */
-  ret = cd_profile_connect_sync (profile,
-                                 cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                 &error);
-  if (!ret)
-    {
-      g_warning ("failed to get profile: %s", error->message);
-      return;
-    }
+  /* get properties, profiles failing to connect aren't cached */
+  profile = cc_color_profile_cache_lookup (prefs->profile_cache,
+                                           cd_profile_get_object_path (profile));
+  if (profile == NULL)
+    return;
 
   /* ignore profiles from other user accounts */
   if (!cd_profile_has_access (profile))
@@ -1453,126 +1605,106 @@ gcm_prefs_add_device_profile (CcColorPanel *prefs,
   gtk_widget_show (widget);
   gtk_container_add (GTK_CONTAINER (prefs->list_box), widget);
   gtk_size_group_add_widget (prefs->list_box_size, widget);
+  cc_color_row_index_add_profile (prefs->row_index,
+                                  cd_device_get_object_path (device),
+                                  cd_profile_get_object_path (profile),
+                                  widget);
 }
 
 static void
-gcm_prefs_add_device_profiles (CcColorPanel *prefs, CdDevice *device)
+gcm_prefs_device_refresh_profiles (CcColorPanel *prefs, CdDevice *device)
 {
   CdProfile *profile_tmp;
+  g_autofree const gchar **object_paths = NULL;
+  g_autoptr(GArray) missing = NULL;
   g_autoptr(GPtrArray) profiles = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
   guint i;
 
-  /* add profiles */
+  /* diff the rows of the device against Device.Profiles -- for flicker-free changes */
   profiles = cd_device_get_profiles (device);
-  if (profiles == NULL)
-    return;
+  object_paths = g_new (const gchar *, profiles->len);
   for (i = 0; i < profiles->len; i++)
     {
       profile_tmp = g_ptr_array_index (profiles, i);
-      gcm_prefs_add_device_profile (prefs, device, profile_tmp, i == 0);
+      object_paths[i] = cd_profile_get_object_path (profile_tmp);
     }
-}
+  missing = g_array_new (FALSE, FALSE, sizeof (guint));
+  removed = cc_color_row_index_update_profiles (prefs->row_index,
+                                                cd_device_get_object_path (device),
+                                                object_paths,
+                                                profiles->len,
+                                                missing);
 
-/* find the profile in the array -- for flicker-free changes */
-static gboolean
-gcm_prefs_find_profile_by_object_path (GPtrArray *profiles,
-                                       const gchar *object_path)
-{
-  CdProfile *profile_tmp;
-  guint i;
+  /* remove anything in the list view that's not in Device.Profiles */
+  for (i = 0; i < removed->len; i++)
+    gtk_widget_destroy (GTK_WIDGET (g_ptr_array_index (removed, i)));
 
-  for (i = 0; i < profiles->len; i++)
+  /* add anything in Device.Profiles that's not in the list view */
+  for (i = 0; i < missing->len; i++)
     {
-      profile_tmp = g_ptr_array_index (profiles, i);
-      if (g_strcmp0 (cd_profile_get_object_path (profile_tmp), object_path) == 0)
-        return TRUE;
+      guint position = g_array_index (missing, guint, i);
+
+      profile_tmp = g_ptr_array_index (profiles, position);
+      gcm_prefs_add_device_profile (prefs, device, profile_tmp, position == 0);
     }
-  return FALSE;
+
+  /* resort */
+  gtk_list_box_invalidate_sort (prefs->list_box);
 }
 
-/* find the profile in the list view -- for flicker-free changes */
-static gboolean
-gcm_prefs_find_widget_by_object_path (GList *list,
-                                      const gchar *object_path_device,
-                                      const gchar *object_path_profile)
+typedef struct
 {
-  GList *l;
-  CdDevice *device_tmp;
-  CdProfile *profile_tmp;
+  CcColorPanel *prefs;
+  CdDevice     *device;
+} DeviceProfilesData;
+
+static void
+gcm_prefs_device_profiles_ensure_cb (GObject *object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+  DeviceProfilesData *data = user_data;
+  g_autoptr(CdDevice) device = data->device;
+  CcColorPanel *prefs = data->prefs;
+  g_autoptr(GError) error = NULL;
 
-  for (l = list; l != NULL; l = l->next)
+  g_free (data);
+  if (!cc_color_profile_cache_ensure_finish (CC_COLOR_PROFILE_CACHE (object), res, &error))
     {
-      if (!CC_IS_COLOR_PROFILE (l->data))
-        continue;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profiles: %s", error->message);
+      return;
+    }
 
-      /* correct device ? */
-      device_tmp = cc_color_profile_get_device (CC_COLOR_PROFILE (l->data));
-      if (g_strcmp0 (object_path_device,
-                     cd_device_get_object_path (device_tmp)) != 0)
-        {
-          continue;
-        }
+  /* the panel may have been disposed, or the device removed in the
+   * meantime */
+  if (prefs->devices == NULL ||
+      !g_ptr_array_find (prefs->devices, device, NULL))
+    return;
 
-      /* this profile */
-      profile_tmp = cc_color_profile_get_profile (CC_COLOR_PROFILE (l->data));
-      if (g_strcmp0 (object_path_profile,
-                     cd_profile_get_object_path (profile_tmp)) == 0)
-        {
-          return TRUE;
-        }
-    }
-  return FALSE;
+  gcm_prefs_device_refresh_profiles (prefs, device);
 }
 
 static void
 gcm_prefs_device_changed_cb (CcColorPanel *prefs, CdDevice *device)
 {
-  CdDevice *device_tmp;
-  CdProfile *profile_tmp;
-  gboolean ret;
-  GList *l;
-  g_autoptr(GList) list = NULL;
-  GPtrArray *profiles;
-  guint i;
+  DeviceProfilesData *data;
+  g_autoptr(GPtrArray) profiles = NULL;
 
-  /* remove anything in the list view that's not in Device.Profiles */
   profiles = cd_device_get_profiles (device);
-  list = gtk_container_get_children (GTK_CONTAINER (prefs->list_box));
-  for (l = list; l != NULL; l = l->next)
-    {
-      if (!CC_IS_COLOR_PROFILE (l->data))
-        continue;
-
-      /* correct device ? */
-      device_tmp = cc_color_profile_get_device (CC_COLOR_PROFILE (l->data));
-      if (g_strcmp0 (cd_device_get_id (device),
-                     cd_device_get_id (device_tmp)) != 0)
-        continue;
-
-      /* if profile is not in Device.Profiles then remove */
-      profile_tmp = cc_color_profile_get_profile (CC_COLOR_PROFILE (l->data));
-      ret = gcm_prefs_find_profile_by_object_path (profiles,
-                                                   cd_profile_get_object_path (profile_tmp));
-      if (!ret) {
-        gtk_widget_destroy (GTK_WIDGET (l->data));
-        /* Don't look at the destroyed widget below */
-        l->data = NULL;
-      }
-    }
-
-  /* add anything in Device.Profiles that's not in the list view */
-  for (i = 0; i < profiles->len; i++)
-    {
-      profile_tmp = g_ptr_array_index (profiles, i);
-      ret = gcm_prefs_find_widget_by_object_path (list,
-                                                  cd_device_get_object_path (device),
-                                                  cd_profile_get_object_path (profile_tmp));
-      if (!ret)
-        gcm_prefs_add_device_profile (prefs, device, profile_tmp, i == 0);
-    }
+  if (profiles == NULL)
+    return;
 
-  /* resort */
-  gtk_list_box_invalidate_sort (prefs->list_box);
+  /* connect any new profiles all at once before showing them */
+  data = g_new0 (DeviceProfilesData, 1);
+  data->prefs = prefs;
+  data->device = g_object_ref (device);
+  cc_color_profile_cache_ensure_async (prefs->profile_cache,
+                                       profiles,
+                                       cc_panel_get_cancellable (CC_PANEL (prefs)),
+                                       gcm_prefs_device_profiles_ensure_cb,
+                                       data);
 }
 
 static void
@@ -1593,12 +1725,10 @@ gcm_prefs_device_expanded_changed_cb (CcColorPanel *prefs,
       prefs->list_box_filter = g_strdup (cd_device_get_id (cc_color_device_get_device (widget)));
 
       /* unexpand other device widgets */
-      list = gtk_container_get_children (GTK_CONTAINER (prefs->list_box));
+      list = cc_color_row_index_get_devices (prefs->row_index);
       prefs->model_is_changing = TRUE;
       for (l = list; l != NULL; l = l->next)
         {
-          if (!CC_IS_COLOR_DEVICE (l->data))
-            continue;
           if (l->data != widget)
             cc_color_device_set_expanded (CC_COLOR_DEVICE (l->data), FALSE);
         }
@@ -1612,79 +1742,112 @@ gcm_prefs_device_expanded_changed_cb (CcColorPanel *prefs,
 }
 
 static void
-gcm_prefs_add_device (CcColorPanel *prefs, CdDevice *device)
+gcm_prefs_update_device_list_extra_entry (CcColorPanel *prefs)
+{
+  g_autoptr(GList) device_widgets = NULL;
+  guint number_of_devices;
+
+  /* any devices to show? */
+  device_widgets = cc_color_row_index_get_devices (prefs->row_index);
+  number_of_devices = g_list_length (device_widgets);
+  gtk_widget_set_visible (prefs->label_no_devices, number_of_devices == 0);
+  gtk_widget_set_visible (prefs->box_devices, number_of_devices > 0);
+
+  /* if we have only one device expand it by default */
+  if (number_of_devices == 1)
+    cc_color_device_set_expanded (CC_COLOR_DEVICE (device_widgets->data), TRUE);
+}
+
+static void
+gcm_prefs_device_connect_cb (GObject *object,
+                             GAsyncResult *res,
+                             gpointer user_data)
 {
+  CcColorPanel *prefs;
+  CdDevice *device = CD_DEVICE (object);
   gboolean ret;
   g_autoptr(GError) error = NULL;
   GtkWidget *widget;
 
-  /* get device properties */
-  ret = cd_device_connect_sync (device, cc_panel_get_cancellable (CC_PANEL (prefs)), &error);
+  ret = cd_device_connect_finish (device, res, &error);
+  if (!ret && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  prefs = CC_COLOR_PANEL (user_data);
+  prefs->devices_connecting--;
+
   if (!ret)
     {
       g_warning ("failed to connect to the device: %s", error->message);
-      return;
+      g_signal_handlers_disconnect_by_func (device,
+                                            G_CALLBACK (gcm_prefs_device_changed_cb),
+                                            prefs);
+      g_ptr_array_remove (prefs->devices, device);
+    }
+  else if (g_ptr_array_find (prefs->devices, device, NULL))
+    {
+      /* add device */
+      widget = cc_color_device_new (device);
+      g_signal_connect_object (widget, "expanded-changed",
+                               G_CALLBACK (gcm_prefs_device_expanded_changed_cb), prefs, G_CONNECT_SWAPPED);
+      gtk_widget_show (widget);
+      gtk_container_add (GTK_CONTAINER (prefs->list_box), widget);
+      gtk_size_group_add_widget (prefs->list_box_size, widget);
+      cc_color_row_index_add_device (prefs->row_index,
+                                     cd_device_get_object_path (device),
+                                     widget);
+      gtk_list_box_invalidate_sort (prefs->list_box);
+
+      /* add profiles */
+      gcm_prefs_device_changed_cb (prefs, device);
     }
 
-  /* add device */
-  widget = cc_color_device_new (device);
-  g_signal_connect_object (widget, "expanded-changed",
-                           G_CALLBACK (gcm_prefs_device_expanded_changed_cb), prefs, G_CONNECT_SWAPPED);
-  gtk_widget_show (widget);
-  gtk_container_add (GTK_CONTAINER (prefs->list_box), widget);
-  gtk_size_group_add_widget (prefs->list_box_size, widget);
-
-  /* add profiles */
-  gcm_prefs_add_device_profiles (prefs, device);
+  /* only decide about the 'No devices detected' entry once all are in */
+  if (prefs->devices_connecting == 0)
+    gcm_prefs_update_device_list_extra_entry (prefs);
+}
 
-  /* watch for changes */
+static void
+gcm_prefs_add_device (CcColorPanel *prefs, CdDevice *device)
+{
+  /* watch for changes, the device is shown once connected */
   g_ptr_array_add (prefs->devices, g_object_ref (device));
   g_signal_connect_object (device, "changed",
                            G_CALLBACK (gcm_prefs_device_changed_cb), prefs, G_CONNECT_SWAPPED);
-  gtk_list_box_invalidate_sort (prefs->list_box);
+
+  /* get device properties */
+  prefs->devices_connecting++;
+  cd_device_connect (device,
+                     cc_panel_get_cancellable (CC_PANEL (prefs)),
+                     gcm_prefs_device_connect_cb,
+                     prefs);
 }
 
 static void
 gcm_prefs_remove_device (CcColorPanel *prefs, CdDevice *device)
 {
   CdDevice *device_tmp;
-  GList *l;
-  g_autoptr(GList) list = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  guint i;
+
+  removed = cc_color_row_index_remove_device (prefs->row_index,
+                                              cd_device_get_object_path (device));
+  for (i = 0; i < removed->len; i++)
+    gtk_widget_destroy (GTK_WIDGET (g_ptr_array_index (removed, i)));
 
-  list = gtk_container_get_children (GTK_CONTAINER (prefs->list_box));
-  for (l = list; l != NULL; l = l->next)
+  /* the signal may carry a different object for the same device */
+  for (i = 0; i < prefs->devices->len; i++)
     {
-      if (CC_IS_COLOR_DEVICE (l->data))
-        device_tmp = cc_color_device_get_device (CC_COLOR_DEVICE (l->data));
-      else
-        device_tmp = cc_color_profile_get_device (CC_COLOR_PROFILE (l->data));
+      device_tmp = g_ptr_array_index (prefs->devices, i);
       if (g_strcmp0 (cd_device_get_object_path (device),
-                     cd_device_get_object_path (device_tmp)) == 0)
-        {
-          gtk_widget_destroy (GTK_WIDGET (l->data));
-        }
+                     cd_device_get_object_path (device_tmp)) != 0)
+        continue;
+      g_signal_handlers_disconnect_by_func (device_tmp,
+                                            G_CALLBACK (gcm_prefs_device_changed_cb),
+                                            prefs);
+      g_ptr_array_remove_index (prefs->devices, i);
+      break;
     }
-  g_signal_handlers_disconnect_by_func (device,
-                                        G_CALLBACK (gcm_prefs_device_changed_cb),
-                                        prefs);
-  g_ptr_array_remove (prefs->devices, device);
-}
-
-static void
-gcm_prefs_update_device_list_extra_entry (CcColorPanel *prefs)
-{
-  g_autoptr(GList) device_widgets = NULL;
-  guint number_of_devices;
-
-  /* any devices to show? */
-  device_widgets = gtk_container_get_children (GTK_CONTAINER (prefs->list_box));
-  number_of_devices = g_list_length (device_widgets);
-  gtk_widget_set_visible (prefs->label_no_devices, number_of_devices == 0);
-  gtk_widget_set_visible (prefs->box_devices, number_of_devices > 0);
-
-  /* if we have only one device expand it by default */
-  if (number_of_devices == 1)
-    cc_color_device_set_expanded (CC_COLOR_DEVICE (device_widgets->data), TRUE);
 }
 
 static void
@@ -1692,11 +1855,8 @@ gcm_prefs_device_added_cb (CdClient *client,
                            CdDevice *device,
                            CcColorPanel *prefs)
 {
-  /* add the device */
+  /* add the device, this updates the 'No devices detected' entry */
   gcm_prefs_add_device (prefs, device);
-
-  /* ensure we're not showing the 'No devices detected' entry */
-  gcm_prefs_update_device_list_extra_entry (prefs);
 }
 
 static void
@@ -1738,7 +1898,8 @@ gcm_prefs_get_devices_cb (GObject *object,
     }
 
   /* ensure we show the 'No devices detected' entry if empty */
-  gcm_prefs_update_device_list_extra_entry (prefs);
+  if (devices->len == 0)
+    gcm_prefs_update_device_list_extra_entry (prefs);
 }
 
 static void
@@ -1804,6 +1965,18 @@ gcm_prefs_list_box_row_activated_cb (CcColorPanel *prefs,
     }
 }
 
+static void
+gcm_prefs_profile_cache_load_cb (GObject *object,
+                                 GAsyncResult *res,
+                                 gpointer user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  if (!cc_color_profile_cache_load_finish (CC_COLOR_PROFILE_CACHE (object), res, &error) &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_warning ("failed to get profiles: %s", error->message);
+}
+
 static void
 gcm_prefs_connect_cb (GObject *object,
                       GAsyncResult *res,
@@ -1836,6 +2009,12 @@ gcm_prefs_connect_cb (GObject *object,
                          cc_panel_get_cancellable (CC_PANEL (prefs)),
                          gcm_prefs_get_devices_cb,
                          prefs);
+
+  /* connect all the profiles up front for the assign dialog */
+  cc_color_profile_cache_load_async (prefs->profile_cache,
+                                     cc_panel_get_cancellable (CC_PANEL (prefs)),
+                                     gcm_prefs_profile_cache_load_cb,
+                                     prefs);
 }
 
 static gboolean
@@ -1913,10 +2092,16 @@ cc_color_panel_dispose (GObject *object)
   g_clear_object (&prefs->client);
   g_clear_object (&prefs->current_device);
   g_clear_pointer (&prefs->devices, g_ptr_array_unref);
+  if (prefs->profile_cache != NULL)
+    g_signal_handlers_disconnect_by_data (prefs->profile_cache, prefs);
+  g_clear_object (&prefs->profile_cache);
+  g_clear_handle_id (&prefs->assign_refresh_id, g_source_remove);
   g_clear_object (&prefs->calibrate);
   g_clear_object (&prefs->list_box_size);
   g_clear_pointer (&prefs->sensors, g_ptr_array_unref);
+  g_clear_pointer (&prefs->sensors_connecting, g_ptr_array_unref);
   g_clear_pointer (&prefs->list_box_filter, g_free);
+  g_clear_pointer (&prefs->row_index, cc_color_row_index_free);
   g_clear_pointer (&prefs->dialog_assign, gtk_widget_destroy);
 
   G_OBJECT_CLASS (cc_color_panel_parent_class)->dispose (object);
@@ -2008,13 +2193,13 @@ static gboolean
 cc_color_panel_filter_func (GtkListBoxRow *row, void *user_data)
 {
   CcColorPanel *prefs = CC_COLOR_PANEL (user_data);
-  g_autoptr(CdDevice) device = NULL;
+  CdDevice *device;
 
   /* always show all devices */
   if (CC_IS_COLOR_DEVICE (row))
     return TRUE;
 
-  g_object_get (row, "device", &device, NULL);
+  device = cc_color_profile_get_device (CC_COLOR_PROFILE (row));
   return g_strcmp0 (cd_device_get_id (device), prefs->list_box_filter) == 0;
 }
 
@@ -2223,6 +2408,11 @@ cc_color_panel_init (CcColorPanel *prefs)
   g_signal_connect_object (prefs->client, "device-removed",
                            G_CALLBACK (gcm_prefs_device_removed_cb), prefs, 0);
 
+  /* keep the connected profiles around */
+  prefs->profile_cache = cc_color_profile_cache_new (prefs->client);
+  g_signal_connect_object (prefs->profile_cache, "changed",
+                           G_CALLBACK (gcm_prefs_profile_cache_changed_cb), prefs, G_CONNECT_SWAPPED);
+
   /* use a listbox for the main UI */
   prefs->list_box = GTK_LIST_BOX (gtk_list_box_new ());
   gtk_list_box_set_filter_func (prefs->list_box,
@@ -2246,6 +2436,7 @@ cc_color_panel_init (CcColorPanel *prefs)
                            G_CALLBACK (gcm_prefs_list_box_row_activated_cb),
                            prefs, G_CONNECT_SWAPPED);
   prefs->list_box_size = gtk_size_group_new (GTK_SIZE_GROUP_VERTICAL);
+  prefs->row_index = cc_color_row_index_new ();
 
   gtk_container_add (GTK_CONTAINER (prefs->frame_devices), GTK_WIDGET (prefs->list_box));
   gtk_widget_show (GTK_WIDGET (prefs->list_box));
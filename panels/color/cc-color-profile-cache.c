@@ -0,0 +1,458 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "cc-color-profile-cache.h"
+
+/*
+ * Connected colord profiles, by object path.
+ *
+ * Connecting a profile is a D-Bus round trip, so all the connections the
+ * cache needs are started at once and waited for together.  A profile that
+ * is already being connected isn't connected a second time, the new caller
+ * just waits for the same connection.  A connection is cancelled once every
+ * caller waiting for it has been cancelled, unless colord announced the
+ * profile itself.  Once connected, profiles stay in the cache until colord
+ * removes them, and keep their properties up to date by themselves.
+ */
+
+struct _CcColorProfileCache
+{
+  GObject       parent_instance;
+
+  CdClient     *client;
+  GHashTable   *profiles;
+  GHashTable   *connecting;
+  gboolean      loaded;
+};
+
+G_DEFINE_TYPE (CcColorProfileCache, cc_color_profile_cache, G_TYPE_OBJECT)
+
+enum {
+  SIGNAL_CHANGED,
+  SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+typedef struct
+{
+  GPtrArray    *waiters;
+  GCancellable *cancellable;
+  gboolean      removed;
+  gboolean      added;
+} Connecting;
+
+typedef struct
+{
+  guint    n_pending;
+  gboolean is_load;
+  gulong   cancelled_id;
+} EnsureData;
+
+static void
+connecting_free (Connecting *connecting)
+{
+  g_ptr_array_unref (connecting->waiters);
+  g_object_unref (connecting->cancellable);
+  g_free (connecting);
+}
+
+static void
+ensure_data_complete (CcColorProfileCache *cache,
+                      GTask               *task)
+{
+  EnsureData *data = g_task_get_task_data (task);
+
+  g_assert (data->n_pending > 0);
+  if (--data->n_pending > 0)
+    return;
+
+  if (data->cancelled_id != 0)
+    g_signal_handler_disconnect (g_task_get_cancellable (task), data->cancelled_id);
+  data->cancelled_id = 0;
+
+  if (data->is_load)
+    cache->loaded = TRUE;
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+cc_color_profile_cache_profile_connect_cb (GObject      *object,
+                                           GAsyncResult *res,
+                                           gpointer      user_data)
+{
+  CcColorProfileCache *cache;
+  CdProfile *profile = CD_PROFILE (object);
+  Connecting *connecting;
+  const gchar *object_path;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) waiters = NULL;
+  gboolean ret;
+  guint i;
+
+  ret = cd_profile_connect_finish (profile, res, &error);
+  if (!ret && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  /* Only cast the parameters after making sure it wasn't cancelled, the
+   * cache may already be gone otherwise, or it has dropped the connection */
+  cache = CC_COLOR_PROFILE_CACHE (user_data);
+
+  object_path = cd_profile_get_object_path (profile);
+  connecting = g_hash_table_lookup (cache->connecting, object_path);
+  g_assert (connecting != NULL);
+
+  if (!ret)
+    g_warning ("failed to get profile: %s", error->message);
+  else if (!connecting->removed)
+    g_hash_table_insert (cache->profiles,
+                         g_strdup (object_path),
+                         g_object_ref (profile));
+
+  waiters = g_ptr_array_ref (connecting->waiters);
+  g_hash_table_remove (cache->connecting, object_path);
+
+  if (ret)
+    g_signal_emit (cache, signals[SIGNAL_CHANGED], 0);
+
+  for (i = 0; i < waiters->len; i++)
+    ensure_data_complete (cache, g_ptr_array_index (waiters, i));
+}
+
+/* Makes task wait for profile to be connected, unless it already is.  A NULL
+ * task keeps the connection going regardless of cancellation. */
+static void
+cc_color_profile_cache_connect_profile (CcColorProfileCache *cache,
+                                        CdProfile           *profile,
+                                        GTask               *task)
+{
+  Connecting *connecting;
+  const gchar *object_path;
+
+  object_path = cd_profile_get_object_path (profile);
+  if (g_hash_table_contains (cache->profiles, object_path))
+    return;
+
+  connecting = g_hash_table_lookup (cache->connecting, object_path);
+  if (connecting == NULL)
+    {
+      connecting = g_new0 (Connecting, 1);
+      connecting->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+      connecting->cancellable = g_cancellable_new ();
+      g_hash_table_insert (cache->connecting, g_strdup (object_path), connecting);
+
+      cd_profile_connect (profile,
+                          connecting->cancellable,
+                          cc_color_profile_cache_profile_connect_cb,
+                          cache);
+    }
+
+  if (task == NULL)
+    connecting->added = TRUE;
+  else
+    {
+      EnsureData *data = g_task_get_task_data (task);
+
+      g_ptr_array_add (connecting->waiters, g_object_ref (task));
+      data->n_pending++;
+    }
+}
+
+static void
+cc_color_profile_cache_task_cancelled_cb (GCancellable *cancellable,
+                                          gpointer      user_data)
+{
+  g_autoptr(GTask) task = g_object_ref (G_TASK (user_data));
+  CcColorProfileCache *cache = g_task_get_source_object (task);
+  EnsureData *data = g_task_get_task_data (task);
+  GHashTableIter iter;
+  Connecting *connecting;
+
+  /* Stop waiting, and drop the connections nobody else waits for */
+  g_hash_table_iter_init (&iter, cache->connecting);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &connecting))
+    {
+      while (g_ptr_array_remove (connecting->waiters, task))
+        ;
+
+      if (connecting->waiters->len == 0 && !connecting->added)
+        {
+          g_cancellable_cancel (connecting->cancellable);
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+
+  g_signal_handler_disconnect (cancellable, data->cancelled_id);
+  data->cancelled_id = 0;
+  data->n_pending = 0;
+  g_task_return_error_if_cancelled (task);
+}
+
+static void
+cc_color_profile_cache_connect_profiles (CcColorProfileCache *cache,
+                                         GPtrArray           *profiles,
+                                         GTask               *task)
+{
+  EnsureData *data = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  guint i;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  /* Not g_cancellable_connect(), the handler has to go away with the task */
+  if (cancellable != NULL)
+    data->cancelled_id = g_signal_connect_object (cancellable, "cancelled",
+                                                  G_CALLBACK (cc_color_profile_cache_task_cancelled_cb),
+                                                  task, 0);
+
+  /* Hold the task open until every connection has been started */
+  data->n_pending = 1;
+  for (i = 0; i < profiles->len; i++)
+    cc_color_profile_cache_connect_profile (cache, g_ptr_array_index (profiles, i), task);
+  ensure_data_complete (cache, task);
+}
+
+static void
+cc_color_profile_cache_get_profiles_cb (GObject      *object,
+                                        GAsyncResult *res,
+                                        gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) profiles = NULL;
+
+  profiles = cd_client_get_profiles_finish (CD_CLIENT (object), res, &error);
+  if (profiles == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  cc_color_profile_cache_connect_profiles (g_task_get_source_object (task), profiles, task);
+}
+
+/**
+ * cc_color_profile_cache_load_async:
+ *
+ * Fetches every profile known to colord and connects the ones that aren't
+ * in the cache yet, in parallel.  The client has to be connected.
+ */
+void
+cc_color_profile_cache_load_async (CcColorProfileCache *cache,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  GTask *task;
+  EnsureData *data;
+
+  g_return_if_fail (CC_IS_COLOR_PROFILE_CACHE (cache));
+
+  task = g_task_new (cache, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_profile_cache_load_async);
+  data = g_new0 (EnsureData, 1);
+  data->is_load = TRUE;
+  g_task_set_task_data (task, data, g_free);
+
+  cd_client_get_profiles (cache->client,
+                          cancellable,
+                          cc_color_profile_cache_get_profiles_cb,
+                          task);
+}
+
+gboolean
+cc_color_profile_cache_load_finish (CcColorProfileCache  *cache,
+                                    GAsyncResult         *result,
+                                    GError              **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cache), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * cc_color_profile_cache_ensure_async:
+ *
+ * Connects the profiles in the array that aren't in the cache yet, in
+ * parallel.  Profiles that fail to connect are left out of the cache, so
+ * callers should look every profile up once this completes.  Cancelling
+ * stops the connections no other caller is waiting for.
+ */
+void
+cc_color_profile_cache_ensure_async (CcColorProfileCache *cache,
+                                     GPtrArray           *profiles,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (CC_IS_COLOR_PROFILE_CACHE (cache));
+
+  task = g_task_new (cache, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_profile_cache_ensure_async);
+  g_task_set_task_data (task, g_new0 (EnsureData, 1), g_free);
+
+  cc_color_profile_cache_connect_profiles (cache, profiles, task);
+}
+
+gboolean
+cc_color_profile_cache_ensure_finish (CcColorProfileCache  *cache,
+                                      GAsyncResult         *result,
+                                      GError              **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cache), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* Returns the connected profile, or NULL if it isn't in the cache */
+CdProfile *
+cc_color_profile_cache_lookup (CcColorProfileCache *cache,
+                               const gchar         *object_path)
+{
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CACHE (cache), NULL);
+
+  return g_hash_table_lookup (cache->profiles, object_path);
+}
+
+GPtrArray *
+cc_color_profile_cache_get_profiles (CcColorProfileCache *cache)
+{
+  GHashTableIter iter;
+  GPtrArray *profiles;
+  gpointer profile;
+
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CACHE (cache), NULL);
+
+  profiles = g_ptr_array_new_full (g_hash_table_size (cache->profiles), g_object_unref);
+  g_hash_table_iter_init (&iter, cache->profiles);
+  while (g_hash_table_iter_next (&iter, NULL, &profile))
+    g_ptr_array_add (profiles, g_object_ref (profile));
+
+  return profiles;
+}
+
+gboolean
+cc_color_profile_cache_is_loaded (CcColorProfileCache *cache)
+{
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CACHE (cache), FALSE);
+
+  return cache->loaded;
+}
+
+static void
+cc_color_profile_cache_profile_added_cb (CcColorProfileCache *cache,
+                                         CdProfile           *profile)
+{
+  cc_color_profile_cache_connect_profile (cache, profile, NULL);
+}
+
+static void
+cc_color_profile_cache_profile_removed_cb (CcColorProfileCache *cache,
+                                           CdProfile           *profile)
+{
+  const gchar *object_path = cd_profile_get_object_path (profile);
+  Connecting *connecting;
+
+  connecting = g_hash_table_lookup (cache->connecting, object_path);
+  if (connecting != NULL)
+    connecting->removed = TRUE;
+
+  if (g_hash_table_remove (cache->profiles, object_path))
+    g_signal_emit (cache, signals[SIGNAL_CHANGED], 0);
+}
+
+static void
+cc_color_profile_cache_profile_changed_cb (CcColorProfileCache *cache,
+                                           CdProfile           *profile)
+{
+  /* The cached profile updates its own properties */
+  if (g_hash_table_contains (cache->profiles, cd_profile_get_object_path (profile)))
+    g_signal_emit (cache, signals[SIGNAL_CHANGED], 0);
+}
+
+static void
+cc_color_profile_cache_dispose (GObject *object)
+{
+  CcColorProfileCache *cache = CC_COLOR_PROFILE_CACHE (object);
+  GHashTableIter iter;
+  Connecting *connecting;
+
+  if (cache->connecting != NULL)
+    {
+      g_hash_table_iter_init (&iter, cache->connecting);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &connecting))
+        g_cancellable_cancel (connecting->cancellable);
+    }
+  if (cache->client != NULL)
+    g_signal_handlers_disconnect_by_data (cache->client, cache);
+  g_clear_object (&cache->client);
+  g_clear_pointer (&cache->profiles, g_hash_table_unref);
+  g_clear_pointer (&cache->connecting, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_color_profile_cache_parent_class)->dispose (object);
+}
+
+static void
+cc_color_profile_cache_class_init (CcColorProfileCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = cc_color_profile_cache_dispose;
+
+  /* Emitted when profiles are added to or removed from the cache, or when
+   * a cached profile changes */
+  signals[SIGNAL_CHANGED] =
+    g_signal_new ("changed",
+                  G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+cc_color_profile_cache_init (CcColorProfileCache *cache)
+{
+  cache->profiles = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, g_object_unref);
+  cache->connecting = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, (GDestroyNotify) connecting_free);
+}
+
+CcColorProfileCache *
+cc_color_profile_cache_new (CdClient *client)
+{
+  CcColorProfileCache *cache;
+
+  cache = g_object_new (CC_TYPE_COLOR_PROFILE_CACHE, NULL);
+  cache->client = g_object_ref (client);
+
+  g_signal_connect_object (client, "profile-added",
+                           G_CALLBACK (cc_color_profile_cache_profile_added_cb),
+                           cache, G_CONNECT_SWAPPED);
+  g_signal_connect_object (client, "profile-removed",
+                           G_CALLBACK (cc_color_profile_cache_profile_removed_cb),
+                           cache, G_CONNECT_SWAPPED);
+  g_signal_connect_object (client, "profile-changed",
+                           G_CALLBACK (cc_color_profile_cache_profile_changed_cb),
+                           cache, G_CONNECT_SWAPPED);
+
+  return cache;
+}
@@ -0,0 +1,51 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <colord.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_COLOR_PROFILE_CACHE (cc_color_profile_cache_get_type ())
+G_DECLARE_FINAL_TYPE (CcColorProfileCache, cc_color_profile_cache, CC, COLOR_PROFILE_CACHE, GObject)
+
+CcColorProfileCache *cc_color_profile_cache_new           (CdClient             *client);
+
+void                 cc_color_profile_cache_load_async    (CcColorProfileCache  *cache,
+                                                           GCancellable         *cancellable,
+                                                           GAsyncReadyCallback   callback,
+                                                           gpointer              user_data);
+gboolean             cc_color_profile_cache_load_finish   (CcColorProfileCache  *cache,
+                                                           GAsyncResult         *result,
+                                                           GError              **error);
+
+void                 cc_color_profile_cache_ensure_async  (CcColorProfileCache  *cache,
+                                                           GPtrArray            *profiles,
+                                                           GCancellable         *cancellable,
+                                                           GAsyncReadyCallback   callback,
+                                                           gpointer              user_data);
+gboolean             cc_color_profile_cache_ensure_finish (CcColorProfileCache  *cache,
+                                                           GAsyncResult         *result,
+                                                           GError              **error);
+
+CdProfile           *cc_color_profile_cache_lookup        (CcColorProfileCache  *cache,
+                                                           const gchar          *object_path);
+GPtrArray           *cc_color_profile_cache_get_profiles  (CcColorProfileCache  *cache);
+gboolean             cc_color_profile_cache_is_loaded     (CcColorProfileCache  *cache);
+
+G_END_DECLS
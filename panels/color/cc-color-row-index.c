@@ -0,0 +1,228 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-color-row-index.h"
+
+/*
+ * The rows of the device list, by colord object path: one row per device,
+ * and one row per profile of that device.  The index doesn't own the rows,
+ * rows removed from it are handed back to the caller to destroy.
+ */
+
+typedef struct
+{
+  gpointer    row;
+  GHashTable *profiles;
+} DeviceRows;
+
+struct _CcColorRowIndex
+{
+  GHashTable *devices;
+};
+
+static void
+device_rows_free (DeviceRows *rows)
+{
+  g_hash_table_unref (rows->profiles);
+  g_free (rows);
+}
+
+CcColorRowIndex *
+cc_color_row_index_new (void)
+{
+  CcColorRowIndex *index;
+
+  index = g_new0 (CcColorRowIndex, 1);
+  index->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, (GDestroyNotify) device_rows_free);
+
+  return index;
+}
+
+void
+cc_color_row_index_free (CcColorRowIndex *index)
+{
+  g_hash_table_unref (index->devices);
+  g_free (index);
+}
+
+static DeviceRows *
+ensure_device (CcColorRowIndex *index,
+               const gchar     *device_path)
+{
+  DeviceRows *rows;
+
+  rows = g_hash_table_lookup (index->devices, device_path);
+  if (rows == NULL)
+    {
+      rows = g_new0 (DeviceRows, 1);
+      rows->profiles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      g_hash_table_insert (index->devices, g_strdup (device_path), rows);
+    }
+
+  return rows;
+}
+
+void
+cc_color_row_index_add_device (CcColorRowIndex *index,
+                               const gchar     *device_path,
+                               gpointer         row)
+{
+  ensure_device (index, device_path)->row = row;
+}
+
+gpointer
+cc_color_row_index_lookup_device (CcColorRowIndex *index,
+                                  const gchar     *device_path)
+{
+  DeviceRows *rows;
+
+  rows = g_hash_table_lookup (index->devices, device_path);
+  return rows != NULL ? rows->row : NULL;
+}
+
+/*
+ * Forgets about the device.  Returns its row, if any, followed by the rows
+ * of its profiles.
+ */
+GPtrArray *
+cc_color_row_index_remove_device (CcColorRowIndex *index,
+                                  const gchar     *device_path)
+{
+  DeviceRows *rows;
+  GHashTableIter iter;
+  GPtrArray *removed;
+  gpointer row;
+
+  removed = g_ptr_array_new ();
+
+  rows = g_hash_table_lookup (index->devices, device_path);
+  if (rows == NULL)
+    return removed;
+
+  if (rows->row != NULL)
+    g_ptr_array_add (removed, rows->row);
+  g_hash_table_iter_init (&iter, rows->profiles);
+  while (g_hash_table_iter_next (&iter, NULL, &row))
+    g_ptr_array_add (removed, row);
+
+  g_hash_table_remove (index->devices, device_path);
+
+  return removed;
+}
+
+/* Returns the device rows, in no particular order */
+GList *
+cc_color_row_index_get_devices (CcColorRowIndex *index)
+{
+  GHashTableIter iter;
+  DeviceRows *rows;
+  GList *list = NULL;
+
+  g_hash_table_iter_init (&iter, index->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &rows))
+    {
+      if (rows->row != NULL)
+        list = g_list_prepend (list, rows->row);
+    }
+
+  return list;
+}
+
+guint
+cc_color_row_index_get_n_devices (CcColorRowIndex *index)
+{
+  GHashTableIter iter;
+  DeviceRows *rows;
+  guint n_devices = 0;
+
+  g_hash_table_iter_init (&iter, index->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &rows))
+    {
+      if (rows->row != NULL)
+        n_devices++;
+    }
+
+  return n_devices;
+}
+
+void
+cc_color_row_index_add_profile (CcColorRowIndex *index,
+                                const gchar     *device_path,
+                                const gchar     *profile_path,
+                                gpointer         row)
+{
+  DeviceRows *rows = ensure_device (index, device_path);
+
+  g_hash_table_insert (rows->profiles, g_strdup (profile_path), row);
+}
+
+gpointer
+cc_color_row_index_lookup_profile (CcColorRowIndex *index,
+                                   const gchar     *device_path,
+                                   const gchar     *profile_path)
+{
+  DeviceRows *rows;
+
+  rows = g_hash_table_lookup (index->devices, device_path);
+  if (rows == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (rows->profiles, profile_path);
+}
+
+/*
+ * Brings the profiles of the device in line with profile_paths.  Returns
+ * the rows of the profiles that are gone, which are forgotten, and appends
+ * the positions in profile_paths that don't have a row yet to missing.
+ */
+GPtrArray *
+cc_color_row_index_update_profiles (CcColorRowIndex  *index,
+                                    const gchar      *device_path,
+                                    const gchar     **profile_paths,
+                                    guint             n_profile_paths,
+                                    GArray           *missing)
+{
+  g_autoptr(GHashTable) wanted = NULL;
+  GHashTableIter iter;
+  DeviceRows *rows;
+  GPtrArray *removed;
+  gpointer key, row;
+  guint i;
+
+  removed = g_ptr_array_new ();
+  rows = ensure_device (index, device_path);
+
+  wanted = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < n_profile_paths; i++)
+    {
+      if (!g_hash_table_add (wanted, (gpointer) profile_paths[i]))
+        continue;
+      if (!g_hash_table_contains (rows->profiles, profile_paths[i]))
+        g_array_append_val (missing, i);
+    }
+
+  g_hash_table_iter_init (&iter, rows->profiles);
+  while (g_hash_table_iter_next (&iter, &key, &row))
+    {
+      if (g_hash_table_contains (wanted, key))
+        continue;
+      g_ptr_array_add (removed, row);
+      g_hash_table_iter_remove (&iter);
+    }
+
+  return removed;
+}
@@ -0,0 +1,53 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcColorRowIndex CcColorRowIndex;
+
+CcColorRowIndex *cc_color_row_index_new             (void);
+void             cc_color_row_index_free            (CcColorRowIndex *index);
+
+void             cc_color_row_index_add_device      (CcColorRowIndex *index,
+                                                     const gchar     *device_path,
+                                                     gpointer         row);
+gpointer         cc_color_row_index_lookup_device   (CcColorRowIndex *index,
+                                                     const gchar     *device_path);
+GPtrArray       *cc_color_row_index_remove_device   (CcColorRowIndex *index,
+                                                     const gchar     *device_path);
+GList           *cc_color_row_index_get_devices     (CcColorRowIndex *index);
+guint            cc_color_row_index_get_n_devices   (CcColorRowIndex *index);
+
+void             cc_color_row_index_add_profile     (CcColorRowIndex *index,
+                                                     const gchar     *device_path,
+                                                     const gchar     *profile_path,
+                                                     gpointer         row);
+gpointer         cc_color_row_index_lookup_profile  (CcColorRowIndex *index,
+                                                     const gchar     *device_path,
+                                                     const gchar     *profile_path);
+GPtrArray       *cc_color_row_index_update_profiles (CcColorRowIndex *index,
+                                                     const gchar     *device_path,
+                                                     const gchar    **profile_paths,
+                                                     guint            n_profile_paths,
+                                                     GArray          *missing);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcColorRowIndex, cc_color_row_index_free)
+
+G_END_DECLS
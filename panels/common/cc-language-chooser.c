@@ -32,19 +32,32 @@
 
 #include "list-box-helper.h"
 #include "cc-common-language.h"
+#include "cc-locale-index.h"
 #include "cc-util.h"
 
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 #include <libgnome-desktop/gnome-languages.h>
 
+/* How many more rows to create once the list is scrolled near its end */
+#define ROWS_PER_BATCH 50
+
 struct _CcLanguageChooser {
         GtkDialog parent_instance;
 
-        GtkSearchEntry *language_filter_entry;
-        GtkListBox     *language_listbox;
-        GtkListBoxRow  *more_row;
-        GtkSearchBar   *search_bar;
-        GtkButton      *select_button;
+        GtkSearchEntry    *language_filter_entry;
+        GtkListBox        *language_listbox;
+        GtkListBoxRow     *more_row;
+        GtkScrolledWindow *scrolled_window;
+        GtkSearchBar      *search_bar;
+        GtkButton         *select_button;
+
+        GCancellable *cancellable;
+        CcLocaleIndex *index;
+        GHashTable *initial;
+        /* CcLocaleEntry → CcLanguageRow, for the rows created so far */
+        GHashTable *rows;
+        /* position in the sorted entries the next batch starts from */
+        guint n_sorted_done;
 
         gboolean showing_extra;
         gchar *language;
@@ -54,42 +67,114 @@ struct _CcLanguageChooser {
 G_DEFINE_TYPE (CcLanguageChooser, cc_language_chooser, GTK_TYPE_DIALOG)
 
 static void
-add_all_languages (CcLanguageChooser *self)
+add_language_row (CcLanguageChooser   *self,
+                  const CcLocaleEntry *entry)
+{
+        CcLanguageRow *row;
+        gboolean is_selected;
+        gboolean is_initial;
+
+        if (!entry->has_font || g_hash_table_contains (self->rows, entry))
+                return;
+
+        row = cc_language_row_new (entry);
+        gtk_widget_show (GTK_WIDGET (row));
+
+        /* the selected language is always shown */
+        is_selected = g_strcmp0 (entry->locale_id, self->language) == 0;
+        is_initial = g_hash_table_contains (self->initial, entry->locale_id);
+        cc_language_row_set_is_extra (row, !is_initial && !is_selected);
+        cc_language_row_set_checked (row, is_selected);
+        if (is_selected)
+                gtk_widget_set_sensitive (GTK_WIDGET (self->select_button), TRUE);
+
+        gtk_list_box_prepend (self->language_listbox, GTK_WIDGET (row));
+        g_hash_table_insert (self->rows, (gpointer) entry, row);
+}
+
+/* Creates up to n_rows more rows, following the sort order */
+static void
+add_more_languages (CcLanguageChooser *self,
+                    guint              n_rows)
 {
-        g_auto(GStrv) locale_ids = NULL;
-        g_autoptr(GHashTable) initial = NULL;
+        GPtrArray *sorted;
 
-        locale_ids = gnome_get_all_locales ();
-        initial = cc_common_language_get_initial_languages ();
-        for (int i = 0; locale_ids[i] != NULL; i++) {
-                CcLanguageRow *row;
-                gboolean is_initial;
+        /* not loaded yet, or disposed */
+        if (self->index == NULL || self->rows == NULL)
+                return;
 
-                if (!cc_common_language_has_font (locale_ids[i]))
+        sorted = cc_locale_index_get_by_language (self->index);
+        while (self->n_sorted_done < sorted->len && n_rows > 0) {
+                const CcLocaleEntry *entry = g_ptr_array_index (sorted, self->n_sorted_done++);
+
+                if (!entry->has_font || g_hash_table_contains (self->rows, entry))
                         continue;
 
-                row = cc_language_row_new (locale_ids[i]);
-                gtk_widget_show (GTK_WIDGET (row));
-                is_initial = (g_hash_table_lookup (initial, locale_ids[i]) != NULL);
-                cc_language_row_set_is_extra (row, !is_initial);
-                gtk_list_box_prepend (self->language_listbox, GTK_WIDGET (row));
+                add_language_row (self, entry);
+                n_rows--;
         }
 }
 
-static gboolean
-match_all (gchar       **words,
-           const gchar  *str)
+static void
+vadjustment_changed_cb (CcLanguageChooser *self,
+                        GtkAdjustment     *adjustment)
 {
-        gchar **w;
+        gdouble value, page_size, upper;
 
-        if (str == NULL)
-                return FALSE;
+        if (!self->showing_extra || self->filter_words)
+                return;
+
+        /* Adding rows changes the upper bound, which gets us here again
+         * until a page's worth of rows is past the visible ones */
+        value = gtk_adjustment_get_value (adjustment);
+        page_size = gtk_adjustment_get_page_size (adjustment);
+        upper = gtk_adjustment_get_upper (adjustment);
+        if (value + 2 * page_size >= upper)
+                add_more_languages (self, ROWS_PER_BATCH);
+}
+
+static void
+locale_index_ready_cb (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+        CcLanguageChooser *self;
+        g_autoptr(GError) error = NULL;
+        CcLocaleIndex *index;
+        GHashTableIter iter;
+        gpointer key;
+
+        index = cc_locale_index_get_default_finish (res, &error);
+        if (index == NULL) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Failed to load the languages: %s", error->message);
+                return;
+        }
+
+        self = CC_LANGUAGE_CHOOSER (user_data);
+        self->index = index;
+
+        g_hash_table_iter_init (&iter, self->initial);
+        while (g_hash_table_iter_next (&iter, &key, NULL)) {
+                const CcLocaleEntry *entry = cc_locale_index_lookup (index, key);
+
+                if (entry != NULL)
+                        add_language_row (self, entry);
+        }
 
-        for (w = words; *w; ++w)
-                if (!strstr (str, *w))
-                        return FALSE;
+        if (self->language != NULL) {
+                const CcLocaleEntry *entry = cc_locale_index_lookup (index, self->language);
 
-        return TRUE;
+                if (entry != NULL)
+                        add_language_row (self, entry);
+        }
+
+        if (self->filter_words)
+                add_more_languages (self, G_MAXUINT);
+        else if (self->showing_extra)
+                add_more_languages (self, ROWS_PER_BATCH);
+
+        gtk_list_box_invalidate_filter (self->language_listbox);
 }
 
 static gboolean
@@ -97,11 +182,6 @@ language_visible (GtkListBoxRow *row,
                   gpointer   user_data)
 {
         CcLanguageChooser *self = user_data;
-        g_autofree gchar *language = NULL;
-        g_autofree gchar *country = NULL;
-        g_autofree gchar *language_local = NULL;
-        g_autofree gchar *country_local = NULL;
-        gboolean visible;
 
         if (row == self->more_row)
                 return !self->showing_extra;
@@ -115,27 +195,8 @@ language_visible (GtkListBoxRow *row,
         if (!self->filter_words)
                 return TRUE;
 
-        language =
-                cc_util_normalize_casefold_and_unaccent (cc_language_row_get_language (CC_LANGUAGE_ROW (row)));
-        visible = match_all (self->filter_words, language);
-        if (visible)
-                return TRUE;
-
-        country =
-                cc_util_normalize_casefold_and_unaccent (cc_language_row_get_country (CC_LANGUAGE_ROW (row)));
-        visible = match_all (self->filter_words, country);
-        if (visible)
-                return TRUE;
-
-        language_local =
-                cc_util_normalize_casefold_and_unaccent (cc_language_row_get_language_local (CC_LANGUAGE_ROW (row)));
-        visible = match_all (self->filter_words, language_local);
-        if (visible)
-                return TRUE;
-
-        country_local =
-                cc_util_normalize_casefold_and_unaccent (cc_language_row_get_country_local (CC_LANGUAGE_ROW (row)));
-        return match_all (self->filter_words, country_local);
+        return cc_locale_entry_match_language (cc_language_row_get_entry (CC_LANGUAGE_ROW (row)),
+                                               self->filter_words);
 }
 
 static gint
@@ -143,18 +204,13 @@ sort_languages (GtkListBoxRow *a,
                 GtkListBoxRow *b,
                 gpointer   data)
 {
-        int d;
-
         if (!CC_IS_LANGUAGE_ROW (a))
                 return 1;
         if (!CC_IS_LANGUAGE_ROW (b))
                 return -1;
 
-        d = g_strcmp0 (cc_language_row_get_language (CC_LANGUAGE_ROW (a)), cc_language_row_get_language (CC_LANGUAGE_ROW (b)));
-        if (d != 0)
-                return d;
-
-        return g_strcmp0 (cc_language_row_get_country (CC_LANGUAGE_ROW (a)), cc_language_row_get_country (CC_LANGUAGE_ROW (b)));
+        return cc_locale_entry_compare_language (cc_language_row_get_entry (CC_LANGUAGE_ROW (a)),
+                                                 cc_language_row_get_entry (CC_LANGUAGE_ROW (b)));
 }
 
 static void
@@ -171,6 +227,9 @@ language_filter_entry_search_changed_cb (CcLanguageChooser *self)
                 return;
         }
         self->filter_words = g_strsplit_set (g_strstrip (filter_contents), " ", 0);
+
+        /* matches can be anywhere in the list */
+        add_more_languages (self, G_MAXUINT);
         gtk_list_box_invalidate_filter (self->language_listbox);
 }
 
@@ -186,6 +245,8 @@ show_more (CcLanguageChooser *self, gboolean visible)
         gtk_widget_grab_focus (visible ? GTK_WIDGET (self->language_filter_entry) : GTK_WIDGET (self->language_listbox));
 
         self->showing_extra = visible;
+        if (visible)
+                add_more_languages (self, ROWS_PER_BATCH);
 
         gtk_list_box_invalidate_filter (self->language_listbox);
 }
@@ -220,8 +281,20 @@ set_locale_id (CcLanguageChooser *self,
                 }
         }
 
-        g_free (self->language);
-        self->language = g_strdup (locale_id);
+        if (locale_id != self->language) {
+                g_free (self->language);
+                self->language = g_strdup (locale_id);
+        }
+
+        /* the row may not have been created yet */
+        if (self->index != NULL && locale_id != NULL) {
+                const CcLocaleEntry *entry = cc_locale_index_lookup (self->index, locale_id);
+
+                if (entry != NULL && !g_hash_table_contains (self->rows, entry)) {
+                        add_language_row (self, entry);
+                        gtk_list_box_invalidate_filter (self->language_listbox);
+                }
+        }
 }
 
 static void
@@ -266,6 +339,8 @@ activate_default_cb (CcLanguageChooser *self)
 void
 cc_language_chooser_init (CcLanguageChooser *self)
 {
+        GtkAdjustment *adjustment;
+
         g_resources_register (cc_common_get_resource ());
 
         gtk_widget_init_template (GTK_WIDGET (self));
@@ -278,9 +353,18 @@ cc_language_chooser_init (CcLanguageChooser *self)
                                          GTK_SELECTION_NONE);
         gtk_list_box_set_header_func (self->language_listbox,
                                       cc_list_box_update_header_func, NULL, NULL);
-        add_all_languages (self);
 
-        gtk_list_box_invalidate_filter (self->language_listbox);
+        self->initial = cc_common_language_get_initial_languages ();
+        self->rows = g_hash_table_new (NULL, NULL);
+        self->cancellable = g_cancellable_new ();
+
+        adjustment = gtk_scrolled_window_get_vadjustment (self->scrolled_window);
+        g_signal_connect_object (adjustment, "changed",
+                                 G_CALLBACK (vadjustment_changed_cb), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (adjustment, "value-changed",
+                                 G_CALLBACK (vadjustment_changed_cb), self, G_CONNECT_SWAPPED);
+
+        cc_locale_index_get_default (self->cancellable, locale_index_ready_cb, self);
 }
 
 static void
@@ -288,6 +372,11 @@ cc_language_chooser_dispose (GObject *object)
 {
         CcLanguageChooser *self = CC_LANGUAGE_CHOOSER (object);
 
+        g_cancellable_cancel (self->cancellable);
+        g_clear_object (&self->cancellable);
+        self->index = NULL;
+        g_clear_pointer (&self->initial, g_hash_table_unref);
+        g_clear_pointer (&self->rows, g_hash_table_unref);
         g_clear_pointer (&self->filter_words, g_strfreev);
         g_clear_pointer (&self->language, g_free);
 
@@ -307,6 +396,7 @@ cc_language_chooser_class_init (CcLanguageChooserClass *klass)
         gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, language_filter_entry);
         gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, language_listbox);
         gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, more_row);
+        gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, scrolled_window);
         gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, search_bar);
         gtk_widget_class_bind_template_child (widget_class, CcLanguageChooser, select_button);
 
@@ -19,9 +19,6 @@
 #include "cc-language-row.h"
 #include "cc-common-resources.h"
 
-#define GNOME_DESKTOP_USE_UNSTABLE_API
-#include <libgnome-desktop/gnome-languages.h>
-
 struct _CcLanguageRow {
   GtkListBoxRow parent_instance;
 
@@ -29,57 +26,18 @@ struct _CcLanguageRow {
   GtkLabel *country_label;
   GtkLabel *language_label;
 
-  gchar *locale_id;
-  gchar *language;
-  gchar *language_local;
-  gchar *country;
-  gchar *country_local;
+  const CcLocaleEntry *entry;
 
   gboolean is_extra;
 };
 
 G_DEFINE_TYPE (CcLanguageRow, cc_language_row, GTK_TYPE_LIST_BOX_ROW)
 
-static gchar *
-get_language_label (const gchar *language_code,
-                    const gchar *modifier,
-                    const gchar *locale_id)
-{
-  g_autofree gchar *language = NULL;
-
-  language = gnome_get_language_from_code (language_code, locale_id);
-
-  if (modifier == NULL)
-    return g_steal_pointer (&language);
-  else
-    {
-      g_autofree gchar *t_mod = gnome_get_translated_modifier (modifier, locale_id);
-      return g_strdup_printf ("%s — %s", language, t_mod);
-    }
-}
-
-static void
-cc_language_row_dispose (GObject *object)
-{
-  CcLanguageRow *self = CC_LANGUAGE_ROW (object);
-
-  g_clear_pointer (&self->locale_id, g_free);
-  g_clear_pointer (&self->country, g_free);
-  g_clear_pointer (&self->country_local, g_free);
-  g_clear_pointer (&self->language, g_free);
-  g_clear_pointer (&self->language_local, g_free);
-
-  G_OBJECT_CLASS (cc_language_row_parent_class)->dispose (object);
-}
-
 void
 cc_language_row_class_init (CcLanguageRowClass *klass)
 {
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
-  object_class->dispose = cc_language_row_dispose;
-
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/common/cc-language-row.ui");
 
   gtk_widget_class_bind_template_child (widget_class, CcLanguageRow, check_image);
@@ -95,63 +53,61 @@ cc_language_row_init (CcLanguageRow *self)
   gtk_widget_init_template (GTK_WIDGET (self));
 }
 
+/* The entry must outlive the row, like those of cc_locale_index_get_default() */
 CcLanguageRow *
-cc_language_row_new (const gchar *locale_id)
+cc_language_row_new (const CcLocaleEntry *entry)
 {
   CcLanguageRow *self;
-  g_autofree gchar *language_code = NULL;
-  g_autofree gchar *country_code = NULL;
-  g_autofree gchar *modifier = NULL;
 
   self = CC_LANGUAGE_ROW (g_object_new (CC_TYPE_LANGUAGE_ROW, NULL));
-  self->locale_id = g_strdup (locale_id);
-
-  gnome_parse_locale (locale_id, &language_code, &country_code, NULL, &modifier);
-
-  self->language = get_language_label (language_code, modifier, locale_id);
-  self->language_local = get_language_label (language_code, modifier, NULL);
-  gtk_label_set_label (self->language_label, self->language);
+  self->entry = entry;
 
-  self->country = gnome_get_country_from_code (country_code, locale_id);
-  self->country_local = gnome_get_country_from_code (country_code, NULL);
-  gtk_label_set_label (self->country_label, self->country);
+  gtk_label_set_label (self->language_label, entry->language);
+  gtk_label_set_label (self->country_label, entry->country);
 
   return self;
 }
 
+const CcLocaleEntry *
+cc_language_row_get_entry (CcLanguageRow *self)
+{
+  g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
+  return self->entry;
+}
+
 const gchar *
 cc_language_row_get_locale_id (CcLanguageRow *self)
 {
   g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
-  return self->locale_id;
+  return self->entry->locale_id;
 }
 
 const gchar *
 cc_language_row_get_language (CcLanguageRow *self)
 {
   g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
-  return self->language;
+  return self->entry->language;
 }
 
 const gchar *
 cc_language_row_get_language_local (CcLanguageRow *self)
 {
   g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
-  return self->language_local;
+  return self->entry->language_local;
 }
 
 const gchar *
 cc_language_row_get_country (CcLanguageRow *self)
 {
   g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
-  return self->country;
+  return self->entry->country;
 }
 
 const gchar *
 cc_language_row_get_country_local (CcLanguageRow *self)
 {
   g_return_val_if_fail (CC_IS_LANGUAGE_ROW (self), NULL);
-  return self->country_local;
+  return self->entry->country_local;
 }
 
 void
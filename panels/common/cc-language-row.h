@@ -20,12 +20,16 @@
 
 #include <gtk/gtk.h>
 
+#include "cc-locale-index.h"
+
 G_BEGIN_DECLS
 
 #define CC_TYPE_LANGUAGE_ROW (cc_language_row_get_type ())
 G_DECLARE_FINAL_TYPE (CcLanguageRow, cc_language_row, CC, LANGUAGE_ROW, GtkListBoxRow)
 
-CcLanguageRow *cc_language_row_new                (const gchar *locale_id);
+CcLanguageRow *cc_language_row_new                (const CcLocaleEntry *entry);
+
+const CcLocaleEntry *cc_language_row_get_entry    (CcLanguageRow *row);
 
 const gchar   *cc_language_row_get_locale_id      (CcLanguageRow *row);
 
@@ -0,0 +1,401 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "cc-common-language.h"
+#include "cc-locale-index.h"
+#include "cc-util.h"
+
+#define GNOME_DESKTOP_USE_UNSTABLE_API
+#include <libgnome-desktop/gnome-languages.h>
+
+/*
+ * The translated names of every locale, worked out once and shared by the
+ * language and format choosers.  Each entry also carries the names already
+ * normalized for searching and collated for sorting, so that filtering and
+ * sorting the rows doesn't allocate anything.  Entries are never freed
+ * while the index is alive, rows may point at them.
+ *
+ * The default index is built in a worker thread the first time a chooser
+ * asks for it, and kept for the lifetime of the process.
+ */
+
+struct _CcLocaleIndex
+{
+  /* the installed locales, and the others added since */
+  GPtrArray  *entries;
+  GPtrArray  *ensured;
+  GHashTable *by_id;
+
+  /* the installed locales, in display order */
+  GPtrArray  *by_language;
+  GPtrArray  *by_region;
+};
+
+static CcLocaleIndex *default_index = NULL;
+static GList *default_index_waiting = NULL;
+
+static gchar *
+get_language_label (const gchar *language_code,
+                    const gchar *modifier,
+                    const gchar *locale_id)
+{
+  g_autofree gchar *language = NULL;
+
+  language = gnome_get_language_from_code (language_code, locale_id);
+
+  if (modifier == NULL)
+    return g_steal_pointer (&language);
+  else
+    {
+      g_autofree gchar *t_mod = gnome_get_translated_modifier (modifier, locale_id);
+      return g_strdup_printf ("%s — %s", language, t_mod);
+    }
+}
+
+static gchar *
+collate_key (const gchar *str)
+{
+  return str != NULL ? g_utf8_collate_key (str, -1) : NULL;
+}
+
+static CcLocaleEntry *
+locale_entry_new (const gchar *locale_id)
+{
+  CcLocaleEntry *entry;
+  g_autofree gchar *language_code = NULL;
+  g_autofree gchar *country_code = NULL;
+  g_autofree gchar *modifier = NULL;
+
+  entry = g_new0 (CcLocaleEntry, 1);
+  entry->locale_id = g_strdup (locale_id);
+
+  gnome_parse_locale (locale_id, &language_code, &country_code, NULL, &modifier);
+
+  entry->language = get_language_label (language_code, modifier, locale_id);
+  entry->language_local = get_language_label (language_code, modifier, NULL);
+  entry->country = gnome_get_country_from_code (country_code, locale_id);
+  entry->country_local = gnome_get_country_from_code (country_code, NULL);
+
+  entry->region = gnome_get_country_from_locale (locale_id, locale_id);
+  if (entry->region != NULL)
+    {
+      entry->region_local = gnome_get_country_from_locale (locale_id, NULL);
+      entry->region_untranslated = gnome_get_country_from_locale (locale_id, "C");
+    }
+
+  entry->language_search_key = cc_util_normalize_casefold_and_unaccent (entry->language);
+  entry->language_local_search_key = cc_util_normalize_casefold_and_unaccent (entry->language_local);
+  entry->country_search_key = cc_util_normalize_casefold_and_unaccent (entry->country);
+  entry->country_local_search_key = cc_util_normalize_casefold_and_unaccent (entry->country_local);
+  entry->region_search_key = cc_util_normalize_casefold_and_unaccent (entry->region);
+  entry->region_local_search_key = cc_util_normalize_casefold_and_unaccent (entry->region_local);
+  entry->region_untranslated_search_key = cc_util_normalize_casefold_and_unaccent (entry->region_untranslated);
+
+  entry->language_collate_key = collate_key (entry->language);
+  entry->country_collate_key = collate_key (entry->country);
+  entry->region_collate_key = collate_key (entry->region);
+
+  entry->has_font = cc_common_language_has_font (locale_id);
+
+  return entry;
+}
+
+static void
+locale_entry_free (CcLocaleEntry *entry)
+{
+  g_free (entry->locale_id);
+  g_free (entry->language);
+  g_free (entry->language_local);
+  g_free (entry->country);
+  g_free (entry->country_local);
+  g_free (entry->region);
+  g_free (entry->region_local);
+  g_free (entry->region_untranslated);
+  g_free (entry->language_search_key);
+  g_free (entry->language_local_search_key);
+  g_free (entry->country_search_key);
+  g_free (entry->country_local_search_key);
+  g_free (entry->region_search_key);
+  g_free (entry->region_local_search_key);
+  g_free (entry->region_untranslated_search_key);
+  g_free (entry->language_collate_key);
+  g_free (entry->country_collate_key);
+  g_free (entry->region_collate_key);
+  g_free (entry);
+}
+
+static gint
+compare_language_cb (gconstpointer a,
+                     gconstpointer b)
+{
+  return cc_locale_entry_compare_language (*(const CcLocaleEntry **) a,
+                                           *(const CcLocaleEntry **) b);
+}
+
+static gint
+compare_region_cb (gconstpointer a,
+                   gconstpointer b)
+{
+  return cc_locale_entry_compare_region (*(const CcLocaleEntry **) a,
+                                         *(const CcLocaleEntry **) b);
+}
+
+static CcLocaleEntry *
+locale_index_add (CcLocaleIndex *index,
+                  GPtrArray     *entries,
+                  const gchar   *locale_id)
+{
+  CcLocaleEntry *entry;
+
+  entry = locale_entry_new (locale_id);
+  g_ptr_array_add (entries, entry);
+  g_hash_table_insert (index->by_id, entry->locale_id, entry);
+
+  return entry;
+}
+
+static CcLocaleIndex *
+locale_index_new_for_ids (gchar **locale_ids)
+{
+  CcLocaleIndex *index;
+  guint i;
+
+  index = g_new0 (CcLocaleIndex, 1);
+  index->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) locale_entry_free);
+  index->ensured = g_ptr_array_new_with_free_func ((GDestroyNotify) locale_entry_free);
+  index->by_id = g_hash_table_new (g_str_hash, g_str_equal);
+  index->by_language = g_ptr_array_new ();
+  index->by_region = g_ptr_array_new ();
+
+  for (i = 0; locale_ids[i] != NULL; i++)
+    {
+      const CcLocaleEntry *entry;
+
+      if (g_hash_table_contains (index->by_id, locale_ids[i]))
+        continue;
+
+      entry = locale_index_add (index, index->entries, locale_ids[i]);
+
+      g_ptr_array_add (index->by_language, (gpointer) entry);
+      if (entry->region != NULL)
+        g_ptr_array_add (index->by_region, (gpointer) entry);
+    }
+
+  g_ptr_array_sort (index->by_language, compare_language_cb);
+  g_ptr_array_sort (index->by_region, compare_region_cb);
+
+  return index;
+}
+
+/* Indexes all of gnome_get_all_locales() */
+CcLocaleIndex *
+cc_locale_index_new (void)
+{
+  g_auto(GStrv) locale_ids = NULL;
+
+  locale_ids = gnome_get_all_locales ();
+  return locale_index_new_for_ids (locale_ids);
+}
+
+void
+cc_locale_index_free (CcLocaleIndex *index)
+{
+  g_ptr_array_unref (index->by_region);
+  g_ptr_array_unref (index->by_language);
+  g_hash_table_unref (index->by_id);
+  g_ptr_array_unref (index->ensured);
+  g_ptr_array_unref (index->entries);
+  g_free (index);
+}
+
+static void
+build_default_index_thread (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  g_task_return_pointer (task, locale_index_new_for_ids (task_data), NULL);
+}
+
+static void
+build_default_index_cb (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  g_autoptr(GList) waiting = NULL;
+  GList *l;
+
+  default_index = g_task_propagate_pointer (G_TASK (res), NULL);
+
+  waiting = g_steal_pointer (&default_index_waiting);
+  for (l = waiting; l != NULL; l = l->next)
+    {
+      g_autoptr(GTask) task = l->data;
+
+      g_task_return_pointer (task, default_index, NULL);
+    }
+}
+
+/*
+ * Gets the index the choosers share, building it the first time.  It
+ * belongs to the process, and is only to be used from the main thread.
+ */
+void
+cc_locale_index_get_default (GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) build_task = NULL;
+  gchar **locale_ids;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_locale_index_get_default);
+
+  if (default_index != NULL)
+    {
+      g_task_return_pointer (task, default_index, NULL);
+      return;
+    }
+
+  default_index_waiting = g_list_prepend (default_index_waiting, g_steal_pointer (&task));
+  if (default_index_waiting->next != NULL)
+    return;
+
+  /* gnome-desktop fills in its tables on first use, and doesn't
+   * lock them, so get that done here before the thread uses them */
+  locale_ids = gnome_get_all_locales ();
+  g_free (gnome_get_language_from_code ("en", NULL));
+  g_free (gnome_get_country_from_code ("US", NULL));
+
+  build_task = g_task_new (NULL, NULL, build_default_index_cb, NULL);
+  g_task_set_source_tag (build_task, build_default_index_thread);
+  g_task_set_task_data (build_task, locale_ids, (GDestroyNotify) g_strfreev);
+  g_task_run_in_thread (build_task, build_default_index_thread);
+}
+
+CcLocaleIndex *
+cc_locale_index_get_default_finish (GAsyncResult  *result,
+                                    GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_locale_index_get_default, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+const CcLocaleEntry *
+cc_locale_index_lookup (CcLocaleIndex *index,
+                        const gchar   *locale_id)
+{
+  return g_hash_table_lookup (index->by_id, locale_id);
+}
+
+/* Adds locales that aren't installed, like some of the initial ones.
+ * Those can be looked up, but aren't listed by any of the getters. */
+const CcLocaleEntry *
+cc_locale_index_ensure (CcLocaleIndex *index,
+                        const gchar   *locale_id)
+{
+  CcLocaleEntry *entry;
+
+  entry = g_hash_table_lookup (index->by_id, locale_id);
+  if (entry != NULL)
+    return entry;
+
+  return locale_index_add (index, index->ensured, locale_id);
+}
+
+/* Returns the CcLocaleEntry array of the installed locales, in no
+ * particular order, owned by the index */
+GPtrArray *
+cc_locale_index_get_entries (CcLocaleIndex *index)
+{
+  return index->entries;
+}
+
+/* The installed locales, sorted for the language chooser */
+GPtrArray *
+cc_locale_index_get_by_language (CcLocaleIndex *index)
+{
+  return index->by_language;
+}
+
+/* The installed locales that have a region, sorted for the format chooser */
+GPtrArray *
+cc_locale_index_get_by_region (CcLocaleIndex *index)
+{
+  return index->by_region;
+}
+
+static gboolean
+match_all (gchar       **words,
+           const gchar  *str)
+{
+  gchar **w;
+
+  if (str == NULL)
+    return FALSE;
+
+  for (w = words; *w; ++w)
+    if (!strstr (str, *w))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* words are normalized with cc_util_normalize_casefold_and_unaccent(),
+ * they all have to be found in one of the names */
+gboolean
+cc_locale_entry_match_language (const CcLocaleEntry  *entry,
+                                gchar               **words)
+{
+  return match_all (words, entry->language_search_key) ||
+         match_all (words, entry->country_search_key) ||
+         match_all (words, entry->language_local_search_key) ||
+         match_all (words, entry->country_local_search_key);
+}
+
+gboolean
+cc_locale_entry_match_region (const CcLocaleEntry  *entry,
+                              gchar               **words)
+{
+  return match_all (words, entry->region_search_key) ||
+         match_all (words, entry->region_local_search_key) ||
+         match_all (words, entry->region_untranslated_search_key);
+}
+
+gint
+cc_locale_entry_compare_language (const CcLocaleEntry *a,
+                                  const CcLocaleEntry *b)
+{
+  gint d;
+
+  d = g_strcmp0 (a->language_collate_key, b->language_collate_key);
+  if (d != 0)
+    return d;
+
+  return g_strcmp0 (a->country_collate_key, b->country_collate_key);
+}
+
+gint
+cc_locale_entry_compare_region (const CcLocaleEntry *a,
+                                const CcLocaleEntry *b)
+{
+  return g_strcmp0 (a->region_collate_key, b->region_collate_key);
+}
@@ -0,0 +1,88 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Names of a locale as the choosers show and search them.  "Local" names
+ * are in the current language, the others in the locale's own language. */
+typedef struct
+{
+  gchar *locale_id;
+
+  /* whether some font can show the language */
+  gboolean has_font;
+
+  /* language chooser: language and country */
+  gchar *language;
+  gchar *language_local;
+  gchar *country;
+  gchar *country_local;
+
+  /* format chooser: country with language, NULL if the locale has none */
+  gchar *region;
+  gchar *region_local;
+  gchar *region_untranslated;
+
+  /* cc_util_normalize_casefold_and_unaccent() of the names above */
+  gchar *language_search_key;
+  gchar *language_local_search_key;
+  gchar *country_search_key;
+  gchar *country_local_search_key;
+  gchar *region_search_key;
+  gchar *region_local_search_key;
+  gchar *region_untranslated_search_key;
+
+  /* g_utf8_collate_key() of the names in the locale's own language */
+  gchar *language_collate_key;
+  gchar *country_collate_key;
+  gchar *region_collate_key;
+} CcLocaleEntry;
+
+typedef struct _CcLocaleIndex CcLocaleIndex;
+
+void                 cc_locale_index_get_default          (GCancellable         *cancellable,
+                                                           GAsyncReadyCallback   callback,
+                                                           gpointer              user_data);
+CcLocaleIndex       *cc_locale_index_get_default_finish   (GAsyncResult         *result,
+                                                           GError              **error);
+
+CcLocaleIndex       *cc_locale_index_new                  (void);
+void                 cc_locale_index_free                 (CcLocaleIndex  *index);
+
+const CcLocaleEntry *cc_locale_index_ensure               (CcLocaleIndex  *index,
+                                                           const gchar    *locale_id);
+const CcLocaleEntry *cc_locale_index_lookup               (CcLocaleIndex  *index,
+                                                           const gchar    *locale_id);
+GPtrArray           *cc_locale_index_get_entries          (CcLocaleIndex  *index);
+GPtrArray           *cc_locale_index_get_by_language      (CcLocaleIndex  *index);
+GPtrArray           *cc_locale_index_get_by_region        (CcLocaleIndex  *index);
+
+gboolean             cc_locale_entry_match_language       (const CcLocaleEntry  *entry,
+                                                           gchar               **words);
+gboolean             cc_locale_entry_match_region         (const CcLocaleEntry  *entry,
+                                                           gchar               **words);
+gint                 cc_locale_entry_compare_language     (const CcLocaleEntry  *a,
+                                                           const CcLocaleEntry  *b);
+gint                 cc_locale_entry_compare_region       (const CcLocaleEntry  *a,
+                                                           const CcLocaleEntry  *b);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcLocaleIndex, cc_locale_index_free)
+
+G_END_DECLS
@@ -0,0 +1,394 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cc-city-index.h"
+
+#include <string.h>
+
+/*
+ * Search index over the cities offered by the timezone dialog.
+ *
+ * Names are folded once, when they are added: case folded, stripped of
+ * accents and punctuation, and split into words.  The words of all cities
+ * live in a single array sorted by word, so that every word starting with
+ * what the user typed is found in one contiguous run by a binary search.
+ */
+
+/* Shorter query words only match at the start of a word */
+#define MIN_SUBSTRING_LENGTH 2
+
+/* Ordered from best to worst */
+typedef enum
+{
+  MATCH_NAME_PREFIX,
+  MATCH_PREFIX,
+  MATCH_SUBSTRING,
+  MATCH_NONE = G_MAXUINT8
+} MatchKind;
+
+typedef struct
+{
+  gchar *name;
+  gchar *zone;
+  gchar *folded_name;
+  gchar *collate_key;
+} City;
+
+typedef struct
+{
+  const gchar *word;
+  guint        city;
+  gboolean     in_name;
+} Posting;
+
+typedef struct
+{
+  guint id;
+  guint rank;
+} Result;
+
+struct _CcCityIndex
+{
+  GArray       *cities;
+  GArray       *postings;
+  GStringChunk *words;
+  gboolean      sorted;
+};
+
+static void
+city_clear (City *city)
+{
+  g_free (city->name);
+  g_free (city->zone);
+  g_free (city->folded_name);
+  g_free (city->collate_key);
+}
+
+CcCityIndex *
+cc_city_index_new (void)
+{
+  CcCityIndex *index;
+
+  index = g_new0 (CcCityIndex, 1);
+  index->cities = g_array_new (FALSE, FALSE, sizeof (City));
+  g_array_set_clear_func (index->cities, (GDestroyNotify) city_clear);
+  index->postings = g_array_new (FALSE, FALSE, sizeof (Posting));
+  index->words = g_string_chunk_new (4096);
+
+  return index;
+}
+
+void
+cc_city_index_free (CcCityIndex *index)
+{
+  g_array_unref (index->cities);
+  g_array_unref (index->postings);
+  g_string_chunk_free (index->words);
+  g_free (index);
+}
+
+/*
+ * Returns the words of text, case folded and without accents, separated
+ * by single spaces.
+ */
+gchar *
+cc_city_index_fold (const gchar *text)
+{
+  g_autofree gchar *casefolded = NULL;
+  g_autofree gchar *decomposed = NULL;
+  GString          *folded;
+  const gchar      *p;
+  gboolean          separator = FALSE;
+
+  folded = g_string_new (NULL);
+
+  casefolded = g_utf8_casefold (text, -1);
+  decomposed = g_utf8_normalize (casefolded, -1, G_NORMALIZE_NFKD);
+  if (decomposed == NULL)
+    return g_string_free (folded, FALSE);
+
+  for (p = decomposed; *p != '\0'; p = g_utf8_next_char (p))
+    {
+      gunichar c = g_utf8_get_char (p);
+
+      switch (g_unichar_type (c))
+        {
+        case G_UNICODE_NON_SPACING_MARK:
+        case G_UNICODE_SPACING_MARK:
+        case G_UNICODE_ENCLOSING_MARK:
+          continue;
+
+        default:
+          break;
+        }
+
+      /* "N'Djamena" is a single word */
+      if (c == '\'' || c == 0x2019)
+        continue;
+
+      if (!g_unichar_isalnum (c))
+        {
+          separator = folded->len > 0;
+          continue;
+        }
+
+      if (separator)
+        g_string_append_c (folded, ' ');
+      separator = FALSE;
+
+      g_string_append_unichar (folded, c);
+    }
+
+  return g_string_free (folded, FALSE);
+}
+
+static void
+add_words (CcCityIndex *index,
+           guint        id,
+           const gchar *folded,
+           gboolean     in_name)
+{
+  g_auto(GStrv) words = NULL;
+  guint         i;
+
+  words = g_strsplit (folded, " ", -1);
+  for (i = 0; words[i] != NULL; i++)
+    {
+      Posting posting;
+
+      if (*words[i] == '\0')
+        continue;
+
+      posting.word = g_string_chunk_insert_const (index->words, words[i]);
+      posting.city = id;
+      posting.in_name = in_name;
+      g_array_append_val (index->postings, posting);
+    }
+}
+
+/*
+ * Adds a city shown as name, matched by the words of name and of
+ * keywords, to the index.  Returns the identifier of the city, as
+ * returned by cc_city_index_search().
+ */
+guint
+cc_city_index_add (CcCityIndex *index,
+                   const gchar *name,
+                   const gchar *zone,
+                   const gchar *keywords)
+{
+  City  city;
+  guint id;
+
+  id = index->cities->len;
+
+  city.name = g_strdup (name);
+  city.zone = g_strdup (zone);
+  city.folded_name = cc_city_index_fold (name);
+  city.collate_key = g_utf8_collate_key (name, -1);
+  g_array_append_val (index->cities, city);
+
+  add_words (index, id, city.folded_name, TRUE);
+  if (keywords != NULL)
+    {
+      g_autofree gchar *folded_keywords = cc_city_index_fold (keywords);
+
+      add_words (index, id, folded_keywords, FALSE);
+    }
+
+  index->sorted = FALSE;
+
+  return id;
+}
+
+static gint
+compare_postings (gconstpointer a,
+                  gconstpointer b)
+{
+  const Posting *posting_a = a;
+  const Posting *posting_b = b;
+  gint           result;
+
+  /* Words are interned */
+  if (posting_a->word != posting_b->word)
+    {
+      result = strcmp (posting_a->word, posting_b->word);
+      if (result != 0)
+        return result;
+    }
+
+  return (gint) posting_a->city - (gint) posting_b->city;
+}
+
+static void
+match_word (CcCityIndex *index,
+            const gchar *word,
+            guint8      *matches)
+{
+  const Posting *postings = (const Posting *) index->postings->data;
+  const gchar   *previous = NULL;
+  gboolean       previous_matched = FALSE;
+  gsize          length;
+  guint          n_postings = index->postings->len;
+  guint          lower = 0;
+  guint          upper = n_postings;
+  guint          i;
+
+  length = strlen (word);
+
+  while (lower < upper)
+    {
+      guint middle = lower + (upper - lower) / 2;
+
+      if (strcmp (postings[middle].word, word) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  for (i = lower; i < n_postings && strncmp (postings[i].word, word, length) == 0; i++)
+    {
+      MatchKind kind = postings[i].in_name ? MATCH_NAME_PREFIX : MATCH_PREFIX;
+
+      matches[postings[i].city] = MIN (matches[postings[i].city], kind);
+    }
+
+  if (g_utf8_strlen (word, -1) < MIN_SUBSTRING_LENGTH)
+    return;
+
+  for (i = 0; i < n_postings; i++)
+    {
+      if (postings[i].word != previous)
+        {
+          previous = postings[i].word;
+          previous_matched = strstr (previous, word) != NULL;
+        }
+
+      if (previous_matched)
+        matches[postings[i].city] = MIN (matches[postings[i].city], MATCH_SUBSTRING);
+    }
+}
+
+static gint
+compare_results (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  const Result *result_a = a;
+  const Result *result_b = b;
+  GArray       *cities = user_data;
+
+  if (result_a->rank != result_b->rank)
+    return result_a->rank < result_b->rank ? -1 : 1;
+
+  return strcmp (g_array_index (cities, City, result_a->id).collate_key,
+                 g_array_index (cities, City, result_b->id).collate_key);
+}
+
+/*
+ * Returns the identifiers of the cities matching every word of query,
+ * best matches first: names starting with the query, then cities where
+ * every query word starts a word of the name, then of the keywords, and
+ * finally those matched in the middle of a word.  Cities that match
+ * equally well are sorted by name.  A max_results of 0 returns all of
+ * them.
+ */
+GArray *
+cc_city_index_search (CcCityIndex *index,
+                      const gchar *query,
+                      guint        max_results)
+{
+  g_autofree gchar  *folded_query = NULL;
+  g_auto(GStrv)      query_words = NULL;
+  g_autofree guint8 *worst = NULL;
+  g_autofree guint8 *current = NULL;
+  g_autoptr(GArray)  results = NULL;
+  GArray            *ids;
+  guint              n_cities;
+  guint              i, j;
+
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  folded_query = cc_city_index_fold (query);
+  n_cities = index->cities->len;
+  if (*folded_query == '\0' || n_cities == 0)
+    return ids;
+
+  if (!index->sorted)
+    {
+      g_array_sort (index->postings, compare_postings);
+      index->sorted = TRUE;
+    }
+
+  /* A city is only as good a match as its worst matching query word */
+  worst = g_new0 (guint8, n_cities);
+  current = g_new (guint8, n_cities);
+
+  query_words = g_strsplit (folded_query, " ", -1);
+  for (i = 0; query_words[i] != NULL; i++)
+    {
+      memset (current, MATCH_NONE, n_cities);
+      match_word (index, query_words[i], current);
+
+      for (j = 0; j < n_cities; j++)
+        worst[j] = MAX (worst[j], current[j]);
+    }
+
+  results = g_array_new (FALSE, FALSE, sizeof (Result));
+  for (j = 0; j < n_cities; j++)
+    {
+      City  *city = &g_array_index (index->cities, City, j);
+      Result result;
+
+      if (worst[j] == MATCH_NONE)
+        continue;
+
+      result.id = j;
+      if (g_str_has_prefix (city->folded_name, folded_query))
+        result.rank = 0;
+      else
+        result.rank = 1 + worst[j];
+      g_array_append_val (results, result);
+    }
+
+  g_array_sort_with_data (results, compare_results, index->cities);
+
+  if (max_results > 0 && results->len > max_results)
+    g_array_set_size (results, max_results);
+
+  for (i = 0; i < results->len; i++)
+    g_array_append_val (ids, g_array_index (results, Result, i).id);
+
+  return ids;
+}
+
+const gchar *
+cc_city_index_get_name (CcCityIndex *index,
+                        guint        id)
+{
+  g_return_val_if_fail (id < index->cities->len, NULL);
+
+  return g_array_index (index->cities, City, id).name;
+}
+
+const gchar *
+cc_city_index_get_zone (CcCityIndex *index,
+                        guint        id)
+{
+  g_return_val_if_fail (id < index->cities->len, NULL);
+
+  return g_array_index (index->cities, City, id).zone;
+}
@@ -0,0 +1,46 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcCityIndex CcCityIndex;
+
+CcCityIndex *cc_city_index_new      (void);
+void         cc_city_index_free     (CcCityIndex *index);
+
+guint        cc_city_index_add      (CcCityIndex *index,
+                                     const gchar *name,
+                                     const gchar *zone,
+                                     const gchar *keywords);
+
+GArray      *cc_city_index_search   (CcCityIndex *index,
+                                     const gchar *query,
+                                     guint        max_results);
+
+const gchar *cc_city_index_get_name (CcCityIndex *index,
+                                     guint        id);
+const gchar *cc_city_index_get_zone (CcCityIndex *index,
+                                     guint        id);
+
+gchar       *cc_city_index_fold     (const gchar *text);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcCityIndex, cc_city_index_free)
+
+G_END_DECLS
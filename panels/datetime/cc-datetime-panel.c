@@ -20,6 +20,7 @@
  */
 
 #include "config.h"
+#include "cc-city-index.h"
 #include "cc-time-editor.h"
 #include "cc-datetime-panel.h"
 #include "cc-datetime-resources.h"
@@ -46,6 +47,9 @@
 #define DEFAULT_TZ "Europe/London"
 #define GETTEXT_PACKAGE_TIMEZONES GETTEXT_PACKAGE "-timezones"
 
+/* Number of cities offered while searching */
+#define MAX_CITY_RESULTS 50
+
 enum {
   CITY_COL_CITY_HUMAN_READABLE,
   CITY_COL_ZONE,
@@ -78,6 +82,7 @@ struct _CcDateTimePanel
   TzLocation *current_location;
 
   GtkTreeModelFilter *city_filter;
+  CcCityIndex *city_index;
 
   GDateTime *date;
 
@@ -90,7 +95,6 @@ struct _CcDateTimePanel
   GtkWidget *auto_timezone_row;
   GtkWidget *auto_timezone_switch;
   GtkListStore *city_liststore;
-  GtkTreeModelSort *city_modelsort;
   GtkWidget *date_grid;
   GtkWidget *datetime_button;
   GtkWidget *datetime_dialog;
@@ -159,6 +163,7 @@ cc_date_time_panel_dispose (GObject *object)
   g_clear_object (&panel->filechooser_settings);
 
   g_clear_pointer (&panel->date, g_date_time_unref);
+  g_clear_pointer (&panel->city_index, cc_city_index_free);
 
   g_clear_pointer (&panel->listboxes, g_list_free);
   g_clear_pointer (&panel->listboxes_reverse, g_list_free);
@@ -547,25 +552,74 @@ get_initial_timezone (CcDateTimePanel *self)
 }
 
 static void
-load_cities (TzLocation   *loc,
-             GtkListStore *city_store)
+load_cities (TzLocation  *loc,
+             CcCityIndex *index)
 {
   g_autofree gchar *human_readable = NULL;
+  g_autofree gchar *country = NULL;
+  g_autofree gchar *keywords = NULL;
 
   human_readable = translated_city_name (loc);
-  gtk_list_store_insert_with_values (city_store, NULL, 0,
-                                     CITY_COL_CITY_HUMAN_READABLE, human_readable,
-                                     CITY_COL_ZONE, loc->zone,
-                                     -1);
+
+  /* Also match the untranslated names, and the region of the zone */
+  country = gnome_get_country_from_code (loc->country, "C");
+  keywords = g_strjoin (" ",
+                        loc->zone,
+                        dgettext (GETTEXT_PACKAGE_TIMEZONES, loc->zone),
+                        country ? country : "",
+                        NULL);
+
+  cc_city_index_add (index, human_readable, loc->zone, keywords);
 }
 
-static void
-load_regions_model (GtkListStore *cities)
+static CcCityIndex *
+load_city_index (void)
 {
   g_autoptr(TzDB) db = NULL;
+  CcCityIndex *index;
+
+  index = cc_city_index_new ();
 
   db = tz_load_db ();
-  g_ptr_array_foreach (db->locations, (GFunc) load_cities, cities);
+  g_ptr_array_foreach (db->locations, (GFunc) load_cities, index);
+
+  return index;
+}
+
+static void
+timezone_search_changed_cb (CcDateTimePanel *self)
+{
+  g_autoptr(GArray) matches = NULL;
+  const gchar *text;
+  guint i;
+
+  gtk_list_store_clear (self->city_liststore);
+
+  if (self->city_index == NULL)
+    return;
+
+  text = gtk_entry_get_text (GTK_ENTRY (self->timezone_searchentry));
+  matches = cc_city_index_search (self->city_index, text, MAX_CITY_RESULTS);
+
+  for (i = 0; i < matches->len; i++)
+    {
+      guint id = g_array_index (matches, guint, i);
+
+      gtk_list_store_insert_with_values (self->city_liststore, NULL, -1,
+                                         CITY_COL_CITY_HUMAN_READABLE, cc_city_index_get_name (self->city_index, id),
+                                         CITY_COL_ZONE, cc_city_index_get_zone (self->city_index, id),
+                                         -1);
+    }
+}
+
+static gboolean
+city_match_func (GtkEntryCompletion *completion,
+                 const gchar        *key,
+                 GtkTreeIter        *iter,
+                 gpointer            user_data)
+{
+  /* The store only ever holds the matches of the current text */
+  return TRUE;
 }
 
 static void
@@ -888,11 +942,17 @@ setup_timezone_dialog (CcDateTimePanel *self)
   gtk_container_add (GTK_CONTAINER (self->aspectmap),
                      self->map);
 
+  /* Fill the store with the matches before the completion looks at it,
+   * which it does from its own handler of the same signal */
+  g_signal_connect_object (self->timezone_searchentry, "changed",
+                           G_CALLBACK (timezone_search_changed_cb), self, G_CONNECT_SWAPPED);
+
   /* Create the completion object */
   completion = gtk_entry_completion_new ();
   gtk_entry_set_completion (GTK_ENTRY (self->timezone_searchentry), completion);
 
-  gtk_entry_completion_set_model (completion, GTK_TREE_MODEL (self->city_modelsort));
+  gtk_entry_completion_set_model (completion, GTK_TREE_MODEL (self->city_liststore));
+  gtk_entry_completion_set_match_func (completion, city_match_func, NULL, NULL);
 
   gtk_entry_completion_set_text_column (completion, CITY_COL_CITY_HUMAN_READABLE);
 }
@@ -1005,7 +1065,6 @@ cc_date_time_panel_class_init (CcDateTimePanelClass *klass)
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, auto_timezone_row);
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, auto_timezone_switch);
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, city_liststore);
-  gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, city_modelsort);
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, date_box);
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, datetime_button);
   gtk_widget_class_bind_template_child (widget_class, CcDateTimePanel, datetime_dialog);
@@ -1138,13 +1197,8 @@ cc_date_time_panel_init (CcDateTimePanel *self)
 
   update_time (self);
 
-  load_regions_model (GTK_LIST_STORE (self->city_liststore));
-
-  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (self->city_modelsort), CITY_COL_CITY_HUMAN_READABLE,
-                                        GTK_SORT_ASCENDING);
+  self->city_index = load_city_index ();
 
-  /* After the initial setup, so we can be sure that
-   * the model is filled up */
   get_initial_timezone (self);
 
   g_signal_connect_object (gtk_entry_get_completion (GTK_ENTRY (self->timezone_searchentry)),
@@ -20,9 +20,12 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "cc-display-arrangement.h"
 #include "cc-display-config.h"
 
+typedef struct _SnapIndex SnapIndex;
+
 struct _CcDisplayArrangement
 {
   GtkDrawingArea    object;
@@ -40,6 +43,13 @@ struct _CcDisplayArrangement
   gdouble           drag_anchor_y;
 
   guint             major_snap_distance;
+
+  /* Edges of the outputs that are not moving during a drag */
+  SnapIndex        *snap_index;
+
+  /* All outputs but the selected one, as drawn with cached_to_widget */
+  cairo_surface_t  *cached_surface;
+  cairo_matrix_t    cached_to_widget;
 };
 
 typedef struct _CcDisplayArrangement CcDisplayArrangement;
@@ -68,6 +78,29 @@ typedef struct {
   SnapDirection      snapped;
 } SnapData;
 
+typedef enum {
+  SNAP_EDGE_LEFT,
+  SNAP_EDGE_RIGHT,
+  SNAP_EDGE_TOP,
+  SNAP_EDGE_BOTTOM,
+  N_SNAP_EDGES
+} SnapEdgeType;
+
+typedef struct {
+  gint x1, y1, x2, y2;
+} SnapRect;
+
+typedef struct {
+  gint  pos;
+  guint rect;
+} SnapEdge;
+
+struct _SnapIndex {
+  GArray *rects;                /* SnapRect, in monitor list order */
+  GArray *edges[N_SNAP_EDGES];  /* SnapEdge, sorted by position */
+  GArray *candidates;           /* guint, scratch space */
+};
+
 #define MARGIN_PX  0
 #define MARGIN_MON  0.66
 #define MAJOR_SNAP_DISTANCE 25
@@ -326,13 +359,113 @@ maybe_update_snap (SnapData       *snap_data,
     }
 }
 
+#define OVERLAP(_s1, _s2, _t1, _t2) ((_s1) <= (_t2) && (_t1) <= (_s2))
+
+/* Snaps the output at x1, y1 of size w × h to the output at _x1, _y1, _x2, _y2 */
+static void
+snap_to_rect (SnapData *snap_data,
+              gint      x1,
+              gint      y1,
+              gint      w,
+              gint      h,
+              gint      _x1,
+              gint      _y1,
+              gint      _x2,
+              gint      _y2)
+{
+  gint x2 = x1 + w;
+  gint y2 = y1 + h;
+  gint bottom_snap_pos;
+  gint top_snap_pos;
+  gint left_snap_pos;
+  gint right_snap_pos;
+  gdouble dist_x, dist_y;
+  gdouble tmp;
+
+  top_snap_pos = _y1 - h;
+  bottom_snap_pos = _y2;
+  left_snap_pos = _x1 - w;
+  right_snap_pos = _x2;
+
+  dist_y = 9999;
+  /* overlap on the X axis */
+  if (OVERLAP (x1, x2, _x1, _x2))
+    {
+      get_snap_distance (snap_data, x1, y1, x1, top_snap_pos, NULL, &dist_y);
+      get_snap_distance (snap_data, x1, y1, x1, bottom_snap_pos, NULL, &tmp);
+      dist_y = MIN(dist_y, tmp);
+    }
+
+  dist_x = 9999;
+  /* overlap on the Y axis */
+  if (OVERLAP (y1, y2, _y1, _y2))
+    {
+      get_snap_distance (snap_data, x1, y1, left_snap_pos, y1, &dist_x, NULL);
+      get_snap_distance (snap_data, x1, y1, right_snap_pos, y1, &tmp, NULL);
+      dist_x = MIN(dist_x, tmp);
+    }
+
+  /* We only snap horizontally or vertically to an edge of the same monitor */
+  if (dist_y < dist_x)
+    {
+      maybe_update_snap (snap_data, x1, y1, x1, top_snap_pos, SNAP_DIR_Y, SNAP_DIR_Y, 0);
+      maybe_update_snap (snap_data, x1, y1, x1, bottom_snap_pos, SNAP_DIR_Y, SNAP_DIR_Y, 0);
+    }
+  else if (dist_x < 9999)
+    {
+      maybe_update_snap (snap_data, x1, y1, left_snap_pos, y1, SNAP_DIR_X, SNAP_DIR_X, 0);
+      maybe_update_snap (snap_data, x1, y1, right_snap_pos, y1, SNAP_DIR_X, SNAP_DIR_X, 0);
+    }
+
+  /* Left/right edge identical on the top */
+  maybe_update_snap (snap_data, x1, y1, _x1, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+  maybe_update_snap (snap_data, x1, y1, _x2 - w, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+
+  /* Left/right edge identical on the bottom */
+  maybe_update_snap (snap_data, x1, y1, _x1, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+  maybe_update_snap (snap_data, x1, y1, _x2 - w, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+
+  /* Top/bottom edge identical on the left */
+  maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y1, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
+  maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y2 - h, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
+
+  /* Top/bottom edge identical on the right */
+  maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y1, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
+  maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y2 - h, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
+
+  /* If snapping is infinite, then add snapping points with minimal overlap
+   * to prevent detachment.
+   * This is similar to the above but simply re-defines the snapping pos
+   * to have only minimal overlap */
+  if (snap_data->major_snap_distance == G_MAXUINT)
+    {
+      /* Hanging over the left/right edge on the top */
+      maybe_update_snap (snap_data, x1, y1, _x1 - w + MIN_OVERLAP, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 1);
+      maybe_update_snap (snap_data, x1, y1, _x2 - MIN_OVERLAP, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, -1);
+
+      /* Left/right edge identical on the bottom */
+      maybe_update_snap (snap_data, x1, y1, _x1 - w + MIN_OVERLAP, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 1);
+      maybe_update_snap (snap_data, x1, y1, _x2 - MIN_OVERLAP, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, -1);
+
+      /* Top/bottom edge identical on the left */
+      maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y1 - h + MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, 1);
+      maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y2 - MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, -1);
+
+      /* Top/bottom edge identical on the right */
+      maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y1 - h + MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, 1);
+      maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y2 - MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, -1);
+    }
+}
+
+#undef OVERLAP
+
 static void
 find_best_snapping (CcDisplayConfig   *config,
                     CcDisplayMonitor  *snap_output,
                     SnapData          *snap_data)
 {
   GList *outputs, *l;
-  gint x1, y1, x2, y2;
+  gint x1, y1;
   gint w, h;
   double max_scale;
 
@@ -340,23 +473,12 @@ find_best_snapping (CcDisplayConfig   *config,
 
   max_scale = cc_display_config_get_maximum_scaling (config);
   get_scaled_geometry (config, snap_output, max_scale, &x1, &y1, &w, &h);
-  x2 = x1 + w;
-  y2 = y1 + h;
-
-#define OVERLAP(_s1, _s2, _t1, _t2) ((_s1) <= (_t2) && (_t1) <= (_s2))
 
   outputs = cc_display_config_get_monitors (config);
   for (l = outputs; l; l = l->next)
     {
       CcDisplayMonitor *output = l->data;
-      gint _x1, _y1, _x2, _y2, _h, _w;
-      gint bottom_snap_pos;
-      gint top_snap_pos;
-      gint left_snap_pos;
-      gint right_snap_pos;
-      gdouble dist_x, dist_y;
-      gdouble max_scale;
-      gdouble tmp;
+      gint _x1, _y1, _h, _w;
 
       if (output == snap_output)
         continue;
@@ -364,87 +486,179 @@ find_best_snapping (CcDisplayConfig   *config,
       if (!cc_display_monitor_is_useful (output))
         continue;
 
-      max_scale = cc_display_config_get_maximum_scaling (config);
       get_scaled_geometry (config, output, max_scale, &_x1, &_y1, &_w, &_h);
-      _x2 = _x1 + _w;
-      _y2 = _y1 + _h;
 
-      top_snap_pos = _y1 - h;
-      bottom_snap_pos = _y2;
-      left_snap_pos = _x1 - w;
-      right_snap_pos = _x2;
+      snap_to_rect (snap_data, x1, y1, w, h, _x1, _y1, _x1 + _w, _y1 + _h);
+    }
+}
 
-      dist_y = 9999;
-      /* overlap on the X axis */
-      if (OVERLAP (x1, x2, _x1, _x2))
-        {
-          get_snap_distance (snap_data, x1, y1, x1, top_snap_pos, NULL, &dist_y);
-          get_snap_distance (snap_data, x1, y1, x1, bottom_snap_pos, NULL, &tmp);
-          dist_y = MIN(dist_y, tmp);
-        }
+static gint
+compare_snap_edges (gconstpointer a,
+                    gconstpointer b)
+{
+  const SnapEdge *edge_a = a;
+  const SnapEdge *edge_b = b;
 
-      dist_x = 9999;
-      /* overlap on the Y axis */
-      if (OVERLAP (y1, y2, _y1, _y2))
-        {
-          get_snap_distance (snap_data, x1, y1, left_snap_pos, y1, &dist_x, NULL);
-          get_snap_distance (snap_data, x1, y1, right_snap_pos, y1, &tmp, NULL);
-          dist_x = MIN(dist_x, tmp);
-        }
+  if (edge_a->pos != edge_b->pos)
+    return edge_a->pos < edge_b->pos ? -1 : 1;
 
-      /* We only snap horizontally or vertically to an edge of the same monitor */
-      if (dist_y < dist_x)
-        {
-          maybe_update_snap (snap_data, x1, y1, x1, top_snap_pos, SNAP_DIR_Y, SNAP_DIR_Y, 0);
-          maybe_update_snap (snap_data, x1, y1, x1, bottom_snap_pos, SNAP_DIR_Y, SNAP_DIR_Y, 0);
-        }
-      else if (dist_x < 9999)
-        {
-          maybe_update_snap (snap_data, x1, y1, left_snap_pos, y1, SNAP_DIR_X, SNAP_DIR_X, 0);
-          maybe_update_snap (snap_data, x1, y1, right_snap_pos, y1, SNAP_DIR_X, SNAP_DIR_X, 0);
-        }
+  return (gint) edge_a->rect - (gint) edge_b->rect;
+}
 
-      /* Left/right edge identical on the top */
-      maybe_update_snap (snap_data, x1, y1, _x1, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
-      maybe_update_snap (snap_data, x1, y1, _x2 - w, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+static gint
+compare_candidates (gconstpointer a,
+                    gconstpointer b)
+{
+  return (gint) *(const guint *) a - (gint) *(const guint *) b;
+}
 
-      /* Left/right edge identical on the bottom */
-      maybe_update_snap (snap_data, x1, y1, _x1, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
-      maybe_update_snap (snap_data, x1, y1, _x2 - w, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 0);
+static void
+snap_index_free (SnapIndex *snap_index)
+{
+  guint i;
 
-      /* Top/bottom edge identical on the left */
-      maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y1, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
-      maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y2 - h, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
+  g_array_unref (snap_index->rects);
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    g_array_unref (snap_index->edges[i]);
+  g_array_unref (snap_index->candidates);
+  g_free (snap_index);
+}
 
-      /* Top/bottom edge identical on the right */
-      maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y1, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
-      maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y2 - h, SNAP_DIR_BOTH, SNAP_DIR_X, 0);
-
-      /* If snapping is infinite, then add snapping points with minimal overlap
-       * to prevent detachment.
-       * This is similar to the above but simply re-defines the snapping pos
-       * to have only minimal overlap */
-      if (snap_data->major_snap_distance == G_MAXUINT)
-        {
-          /* Hanging over the left/right edge on the top */
-          maybe_update_snap (snap_data, x1, y1, _x1 - w + MIN_OVERLAP, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 1);
-          maybe_update_snap (snap_data, x1, y1, _x2 - MIN_OVERLAP, top_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, -1);
+/* The outputs other than snap_output don't move while dragging it, so
+ * their edges only need to be sorted once per drag. */
+static SnapIndex *
+snap_index_new (CcDisplayConfig  *config,
+                CcDisplayMonitor *snap_output)
+{
+  SnapIndex *snap_index;
+  GList *outputs, *l;
+  double max_scale;
+  guint i;
 
-          /* Left/right edge identical on the bottom */
-          maybe_update_snap (snap_data, x1, y1, _x1 - w + MIN_OVERLAP, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, 1);
-          maybe_update_snap (snap_data, x1, y1, _x2 - MIN_OVERLAP, bottom_snap_pos, SNAP_DIR_BOTH, SNAP_DIR_Y, -1);
+  snap_index = g_new0 (SnapIndex, 1);
+  snap_index->rects = g_array_new (FALSE, FALSE, sizeof (SnapRect));
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    snap_index->edges[i] = g_array_new (FALSE, FALSE, sizeof (SnapEdge));
+  snap_index->candidates = g_array_new (FALSE, FALSE, sizeof (guint));
 
-          /* Top/bottom edge identical on the left */
-          maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y1 - h + MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, 1);
-          maybe_update_snap (snap_data, x1, y1, left_snap_pos, _y2 - MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, -1);
+  max_scale = cc_display_config_get_maximum_scaling (config);
 
-          /* Top/bottom edge identical on the right */
-          maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y1 - h + MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, 1);
-          maybe_update_snap (snap_data, x1, y1, right_snap_pos, _y2 - MIN_OVERLAP, SNAP_DIR_BOTH, SNAP_DIR_X, -1);
-        }
+  outputs = cc_display_config_get_monitors (config);
+  for (l = outputs; l; l = l->next)
+    {
+      CcDisplayMonitor *output = l->data;
+      SnapEdge edge;
+      SnapRect rect;
+      gint w, h;
+
+      if (output == snap_output)
+        continue;
+
+      if (!cc_display_monitor_is_useful (output))
+        continue;
+
+      get_scaled_geometry (config, output, max_scale, &rect.x1, &rect.y1, &w, &h);
+      rect.x2 = rect.x1 + w;
+      rect.y2 = rect.y1 + h;
+
+      edge.rect = snap_index->rects->len;
+      g_array_append_val (snap_index->rects, rect);
+
+      edge.pos = rect.x1;
+      g_array_append_val (snap_index->edges[SNAP_EDGE_LEFT], edge);
+      edge.pos = rect.x2;
+      g_array_append_val (snap_index->edges[SNAP_EDGE_RIGHT], edge);
+      edge.pos = rect.y1;
+      g_array_append_val (snap_index->edges[SNAP_EDGE_TOP], edge);
+      edge.pos = rect.y2;
+      g_array_append_val (snap_index->edges[SNAP_EDGE_BOTTOM], edge);
     }
 
-#undef OVERLAP
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    g_array_sort (snap_index->edges[i], compare_snap_edges);
+
+  return snap_index;
+}
+
+/* Adds the outputs with an edge of the given type within [from, to] */
+static void
+snap_index_collect (SnapIndex    *snap_index,
+                    SnapEdgeType  type,
+                    gint          from,
+                    gint          to)
+{
+  GArray *edges = snap_index->edges[type];
+  guint lo = 0;
+  guint hi = edges->len;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (g_array_index (edges, SnapEdge, mid).pos < from)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  for (; lo < edges->len && g_array_index (edges, SnapEdge, lo).pos <= to; lo++)
+    g_array_append_val (snap_index->candidates, g_array_index (edges, SnapEdge, lo).rect);
+}
+
+static void
+find_best_snapping_indexed (SnapIndex         *snap_index,
+                            CcDisplayConfig   *config,
+                            CcDisplayMonitor  *snap_output,
+                            SnapData          *snap_data)
+{
+  gint x1, y1, x2, y2;
+  gint w, h;
+  gint reach;
+  guint prev = G_MAXUINT;
+  guint i;
+
+  g_assert (snap_data != NULL);
+
+  get_scaled_geometry (config, snap_output, cc_display_config_get_maximum_scaling (config),
+                       &x1, &y1, &w, &h);
+  x2 = x1 + w;
+  y2 = y1 + h;
+
+  g_array_set_size (snap_index->candidates, 0);
+
+  /* Only an output with an edge within the major snap distance of the
+   * opposite edge can be snapped to. to_widget only scales and
+   * translates, so the distance converts back with its scale factor. */
+  if (snap_data->major_snap_distance == G_MAXUINT || snap_data->to_widget.xx <= 0)
+    {
+      for (i = 0; i < snap_index->rects->len; i++)
+        g_array_append_val (snap_index->candidates, i);
+    }
+  else
+    {
+      reach = MIN (ceil (snap_data->major_snap_distance / snap_data->to_widget.xx), G_MAXINT / 4) + 1;
+
+      snap_index_collect (snap_index, SNAP_EDGE_LEFT, x2 - reach, x2 + reach);
+      snap_index_collect (snap_index, SNAP_EDGE_RIGHT, x1 - reach, x1 + reach);
+      snap_index_collect (snap_index, SNAP_EDGE_TOP, y2 - reach, y2 + reach);
+      snap_index_collect (snap_index, SNAP_EDGE_BOTTOM, y1 - reach, y1 + reach);
+
+      /* Keep the order of the monitor list, ties are resolved by it */
+      g_array_sort (snap_index->candidates, compare_candidates);
+    }
+
+  for (i = 0; i < snap_index->candidates->len; i++)
+    {
+      guint candidate = g_array_index (snap_index->candidates, guint, i);
+      SnapRect *rect;
+
+      if (candidate == prev)
+        continue;
+      prev = candidate;
+
+      rect = &g_array_index (snap_index->rects, SnapRect, candidate);
+      snap_to_rect (snap_data, x1, y1, w, h, rect->x1, rect->y1, rect->x2, rect->y2);
+    }
 }
 
 static void
@@ -525,6 +739,12 @@ cc_display_arrangement_update_cursor (CcDisplayArrangement *self,
     gdk_window_set_cursor (window, cursor);
 }
 
+static void
+cc_display_arrangement_invalidate_cache (CcDisplayArrangement *self)
+{
+  g_clear_pointer (&self->cached_surface, cairo_surface_destroy);
+}
+
 static void
 on_output_changed_cb (CcDisplayArrangement *self,
                       CcDisplayMonitor     *output)
@@ -534,136 +754,174 @@ on_output_changed_cb (CcDisplayArrangement *self,
   else
     self->major_snap_distance = G_MAXUINT;
 
+  /* The dragged output is not cached, and the motion handler takes
+   * care of redrawing the area it moved over */
+  if (self->drag_active && output == self->selected_output)
+    return;
+
+  cc_display_arrangement_invalidate_cache (self);
   gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
-static gboolean
-cc_display_arrangement_draw (GtkWidget *widget,
-                             cairo_t   *cr)
+static void
+cc_display_arrangement_draw_output (CcDisplayArrangement *self,
+                                    cairo_t              *cr,
+                                    CcDisplayMonitor     *output)
 {
-  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
-  GtkStyleContext *context = gtk_widget_get_style_context (widget);
-  g_autoptr(GList) outputs = NULL;
-  GList *l;
+  GtkStyleContext *context = gtk_widget_get_style_context (GTK_WIDGET (self));
+  GtkStateFlags state = GTK_STATE_FLAG_NORMAL;
+  GtkBorder border, padding, margin;
+  gint x1, y1, x2, y2;
+  gint w, h;
+  gint num;
 
-  if (!self->config)
-    return FALSE;
+  gtk_style_context_save (context);
+  cairo_save (cr);
 
-  cc_display_arrangement_update_matrices (self);
+  gtk_style_context_add_class (context, "monitor");
 
-  gtk_style_context_save (context);
-  gtk_style_context_add_class (context, "display-arrangement");
+  if (output == self->selected_output)
+    state |= GTK_STATE_FLAG_SELECTED;
+  if (output == self->prelit_output)
+    state |= GTK_STATE_FLAG_PRELIGHT;
 
-  /* Draw in reverse order so that hit detection matches visual. Also pull
-   * the selected output to the back. */
-  outputs = g_list_copy (cc_display_config_get_monitors (self->config));
-  outputs = g_list_remove (outputs, self->selected_output);
-  if (self->selected_output != NULL)
-    outputs = g_list_prepend (outputs, self->selected_output);
-  outputs = g_list_reverse (outputs);
+  gtk_style_context_set_state (context, state);
+  if (cc_display_monitor_is_primary (output) || cc_display_config_is_cloning (self->config))
+    gtk_style_context_add_class (context, "primary");
 
-  for (l = outputs; l; l = l->next)
-    {
-      CcDisplayMonitor *output = l->data;
-      GtkStateFlags state = GTK_STATE_FLAG_NORMAL;
-      GtkBorder border, padding, margin;
-      gint x1, y1, x2, y2;
-      gint w, h;
-      gint num;
+  /* Set in cc-display-panel.c */
+  num = cc_display_monitor_get_ui_number (output);
 
-      if (!cc_display_monitor_is_useful (output))
-        continue;
+  monitor_get_drawing_rect (self, output, &x1, &y1, &x2, &y2);
+  w = x2 - x1;
+  h = y2 - y1;
 
-      gtk_style_context_save (context);
-      cairo_save (cr);
+  cairo_translate (cr, x1, y1);
 
-      gtk_style_context_add_class (context, "monitor");
+  gtk_style_context_get_margin (context, state, &margin);
 
-      if (output == self->selected_output)
-        state |= GTK_STATE_FLAG_SELECTED;
-      if (output == self->prelit_output)
-        state |= GTK_STATE_FLAG_PRELIGHT;
+  cairo_translate (cr, margin.left, margin.top);
 
-      gtk_style_context_set_state (context, state);
-      if (cc_display_monitor_is_primary (output) || cc_display_config_is_cloning (self->config))
-        gtk_style_context_add_class (context, "primary");
+  w -= margin.left + margin.right;
+  h -= margin.top + margin.bottom;
 
-      /* Set in cc-display-panel.c */
-      num = cc_display_monitor_get_ui_number (output);
+  gtk_render_background (context, cr, 0, 0, w, h);
+  gtk_render_frame (context, cr, 0, 0, w, h);
 
-      monitor_get_drawing_rect (self, output, &x1, &y1, &x2, &y2);
-      w = x2 - x1;
-      h = y2 - y1;
+  gtk_style_context_get_border (context, state, &border);
+  gtk_style_context_get_padding (context, state, &padding);
+
+  w -= border.left + border.right + padding.left + padding.right;
+  h -= border.top + border.bottom + padding.top + padding.bottom;
+
+  cairo_translate (cr, border.left + padding.left, border.top + padding.top);
 
-      cairo_translate (cr, x1, y1);
+  if (num > 0)
+    {
+      PangoLayout *layout;
+      PangoFontDescription *font = NULL;
+      g_autofree gchar *number_str = NULL;
+      PangoRectangle extents;
+      GdkRGBA color;
+      gdouble text_width, text_padding;
+
+      gtk_style_context_add_class (context, "monitor-label");
+      gtk_style_context_remove_class (context, "monitor");
 
+      gtk_style_context_get_border (context, state, &border);
+      gtk_style_context_get_padding (context, state, &padding);
       gtk_style_context_get_margin (context, state, &margin);
 
       cairo_translate (cr, margin.left, margin.top);
 
-      w -= margin.left + margin.right;
-      h -= margin.top + margin.bottom;
+      number_str = g_strdup_printf ("%d", num);
+      gtk_style_context_get (context, state, "font", &font, NULL);
+      layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), number_str);
+      pango_layout_set_font_description (layout, font);
+      pango_layout_get_extents (layout, NULL, &extents);
 
-      gtk_render_background (context, cr, 0, 0, w, h);
-      gtk_render_frame (context, cr, 0, 0, w, h);
+      h = (extents.height - extents.y) / PANGO_SCALE;
+      text_width = (extents.width - extents.x) / PANGO_SCALE;
+      w = MAX (text_width, h - padding.left - padding.right);
+      text_padding = w - text_width;
 
-      gtk_style_context_get_border (context, state, &border);
-      gtk_style_context_get_padding (context, state, &padding);
+      w += border.left + border.right + padding.left + padding.right;
+      h += border.top + border.bottom + padding.top + padding.bottom;
 
-      w -= border.left + border.right + padding.left + padding.right;
-      h -= border.top + border.bottom + padding.top + padding.bottom;
+      gtk_render_background (context, cr, 0, 0, w, h);
+      gtk_render_frame (context, cr, 0, 0, w, h);
 
       cairo_translate (cr, border.left + padding.left, border.top + padding.top);
+      cairo_translate (cr, extents.x + text_padding / 2, 0);
 
-      if (num > 0)
-        {
-          PangoLayout *layout;
-          PangoFontDescription *font = NULL;
-          g_autofree gchar *number_str = NULL;
-          PangoRectangle extents;
-          GdkRGBA color;
-          gdouble text_width, text_padding;
+      gtk_style_context_get_color (context, state, &color);
+      gdk_cairo_set_source_rgba (cr, &color);
 
-          gtk_style_context_add_class (context, "monitor-label");
-          gtk_style_context_remove_class (context, "monitor");
+      gtk_render_layout (context, cr, 0, 0, layout);
+      g_object_unref (layout);
+    }
 
-          gtk_style_context_get_border (context, state, &border);
-          gtk_style_context_get_padding (context, state, &padding);
-          gtk_style_context_get_margin (context, state, &margin);
+  gtk_style_context_restore (context);
+  cairo_restore (cr);
+}
 
-          cairo_translate (cr, margin.left, margin.top);
+static gboolean
+cc_display_arrangement_draw (GtkWidget *widget,
+                             cairo_t   *cr)
+{
+  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
+  GtkStyleContext *context = gtk_widget_get_style_context (widget);
 
-          number_str = g_strdup_printf ("%d", num);
-          gtk_style_context_get (context, state, "font", &font, NULL);
-          layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), number_str);
-          pango_layout_set_font_description (layout, font);
-          pango_layout_get_extents (layout, NULL, &extents);
+  if (!self->config)
+    return FALSE;
 
-          h = (extents.height - extents.y) / PANGO_SCALE;
-          text_width = (extents.width - extents.x) / PANGO_SCALE;
-          w = MAX (text_width, h - padding.left - padding.right);
-          text_padding = w - text_width;
+  cc_display_arrangement_update_matrices (self);
 
-          w += border.left + border.right + padding.left + padding.right;
-          h += border.top + border.bottom + padding.top + padding.bottom;
+  gtk_style_context_save (context);
+  gtk_style_context_add_class (context, "display-arrangement");
 
-          gtk_render_background (context, cr, 0, 0, w, h);
-          gtk_render_frame (context, cr, 0, 0, w, h);
+  if (self->cached_surface != NULL &&
+      memcmp (&self->cached_to_widget, &self->to_widget, sizeof (cairo_matrix_t)) != 0)
+    cc_display_arrangement_invalidate_cache (self);
 
-          cairo_translate (cr, border.left + padding.left, border.top + padding.top);
-          cairo_translate (cr, extents.x + text_padding / 2, 0);
+  if (self->cached_surface == NULL)
+    {
+      g_autoptr(GList) outputs = NULL;
+      GList *l;
+      cairo_t *cache_cr;
+
+      self->cached_surface = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                                CAIRO_CONTENT_COLOR_ALPHA,
+                                                                gtk_widget_get_allocated_width (widget),
+                                                                gtk_widget_get_allocated_height (widget));
+      self->cached_to_widget = self->to_widget;
+
+      /* Draw in reverse order so that hit detection matches visual. The
+       * selected output is drawn on top of the cached ones. */
+      outputs = g_list_copy (cc_display_config_get_monitors (self->config));
+      outputs = g_list_reverse (outputs);
+
+      cache_cr = cairo_create (self->cached_surface);
+      for (l = outputs; l; l = l->next)
+        {
+          CcDisplayMonitor *output = l->data;
 
-          gtk_style_context_get_color (context, state, &color);
-          gdk_cairo_set_source_rgba (cr, &color);
+          if (output == self->selected_output || !cc_display_monitor_is_useful (output))
+            continue;
 
-          gtk_render_layout (context, cr, 0, 0, layout);
-          g_object_unref (layout);
+          cc_display_arrangement_draw_output (self, cache_cr, output);
         }
-
-      gtk_style_context_restore (context);
-      cairo_restore (cr);
+      cairo_destroy (cache_cr);
     }
 
+  cairo_save (cr);
+  cairo_set_source_surface (cr, self->cached_surface, 0, 0);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+  if (self->selected_output != NULL && cc_display_monitor_is_useful (self->selected_output))
+    cc_display_arrangement_draw_output (self, cr, self->selected_output);
+
   gtk_style_context_restore (context);
 
   return TRUE;
@@ -704,6 +962,9 @@ cc_display_arrangement_button_press_event (GtkWidget      *widget,
       self->drag_active = TRUE;
       self->drag_anchor_x = event_x - mon_x;
       self->drag_anchor_y = event_y - mon_y;
+
+      g_clear_pointer (&self->snap_index, snap_index_free);
+      self->snap_index = snap_index_new (self->config, output);
     }
 
   return TRUE;
@@ -727,6 +988,7 @@ cc_display_arrangement_button_release_event (GtkWidget      *widget,
     return FALSE;
 
   self->drag_active = FALSE;
+  g_clear_pointer (&self->snap_index, snap_index_free);
 
   output = cc_display_arrangement_find_monitor_at (self, event->x, event->y);
   cc_display_arrangement_update_cursor (self, output != NULL);
@@ -746,6 +1008,8 @@ cc_display_arrangement_motion_notify_event (GtkWidget      *widget,
   CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
   gdouble event_x, event_y;
   gint mon_x, mon_y;
+  gint old_x1, old_y1, old_x2, old_y2;
+  gint x1, y1, x2, y2;
   SnapData snap_data;
 
   if (!self->config)
@@ -761,7 +1025,10 @@ cc_display_arrangement_motion_notify_event (GtkWidget      *widget,
 
       cc_display_arrangement_update_cursor (self, output != NULL);
       if (self->prelit_output != output)
-        gtk_widget_queue_draw (widget);
+        {
+          cc_display_arrangement_invalidate_cache (self);
+          gtk_widget_queue_draw (widget);
+        }
 
       self->prelit_output = output;
 
@@ -787,12 +1054,26 @@ cc_display_arrangement_motion_notify_event (GtkWidget      *widget,
   snap_data.to_widget = self->to_widget;
   snap_data.major_snap_distance = self->major_snap_distance;
 
+  monitor_get_drawing_rect (self, self->selected_output, &old_x1, &old_y1, &old_x2, &old_y2);
+
   cc_display_monitor_set_position (self->selected_output, mon_x, mon_y);
 
-  find_best_snapping (self->config, self->selected_output, &snap_data);
+  if (self->snap_index)
+    find_best_snapping_indexed (self->snap_index, self->config, self->selected_output, &snap_data);
+  else
+    find_best_snapping (self->config, self->selected_output, &snap_data);
 
   cc_display_monitor_set_position (self->selected_output, snap_data.mon_x, snap_data.mon_y);
 
+  /* Only the area the output moved over needs to be redrawn, the other
+   * outputs come from the cached surface */
+  monitor_get_drawing_rect (self, self->selected_output, &x1, &y1, &x2, &y2);
+  x1 = MIN (x1, old_x1) - 1;
+  y1 = MIN (y1, old_y1) - 1;
+  x2 = MAX (x2, old_x2) + 1;
+  y2 = MAX (y2, old_y2) + 1;
+  gtk_widget_queue_draw_area (widget, x1, y1, x2 - x1, y2 - y1);
+
   return TRUE;
 }
 
@@ -848,10 +1129,39 @@ cc_display_arrangement_finalize (GObject *object)
   CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (object);
 
   g_clear_object (&self->config);
+  g_clear_pointer (&self->snap_index, snap_index_free);
+  g_clear_pointer (&self->cached_surface, cairo_surface_destroy);
 
   G_OBJECT_CLASS (cc_display_arrangement_parent_class)->finalize (object);
 }
 
+static void
+cc_display_arrangement_size_allocate (GtkWidget     *widget,
+                                      GtkAllocation *allocation)
+{
+  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
+
+  cc_display_arrangement_invalidate_cache (self);
+
+  GTK_WIDGET_CLASS (cc_display_arrangement_parent_class)->size_allocate (widget, allocation);
+}
+
+static void
+cc_display_arrangement_style_updated (GtkWidget *widget)
+{
+  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
+
+  cc_display_arrangement_invalidate_cache (self);
+
+  GTK_WIDGET_CLASS (cc_display_arrangement_parent_class)->style_updated (widget);
+}
+
+static void
+on_scale_factor_changed_cb (CcDisplayArrangement *self)
+{
+  cc_display_arrangement_invalidate_cache (self);
+}
+
 static void
 cc_display_arrangement_class_init (CcDisplayArrangementClass *klass)
 {
@@ -866,6 +1176,8 @@ cc_display_arrangement_class_init (CcDisplayArrangementClass *klass)
   widget_class->button_press_event = cc_display_arrangement_button_press_event;
   widget_class->button_release_event = cc_display_arrangement_button_release_event;
   widget_class->motion_notify_event = cc_display_arrangement_motion_notify_event;
+  widget_class->size_allocate = cc_display_arrangement_size_allocate;
+  widget_class->style_updated = cc_display_arrangement_style_updated;
 
   props[PROP_CONFIG] = g_param_spec_object ("config", "Display Config",
                                             "The display configuration to work with",
@@ -896,6 +1208,8 @@ cc_display_arrangement_init (CcDisplayArrangement *self)
                          GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK);
 
   self->major_snap_distance = MAJOR_SNAP_DISTANCE;
+
+  g_signal_connect (self, "notify::scale-factor", G_CALLBACK (on_scale_factor_changed_cb), NULL);
 }
 
 CcDisplayArrangement*
@@ -931,6 +1245,8 @@ cc_display_arrangement_set_config (CcDisplayArrangement *self,
   g_clear_object (&self->config);
 
   self->drag_active = FALSE;
+  g_clear_pointer (&self->snap_index, snap_index_free);
+  cc_display_arrangement_invalidate_cache (self);
 
   /* Listen to all the signals */
   if (config)
@@ -967,6 +1283,7 @@ cc_display_arrangement_set_selected_output (CcDisplayArrangement *self,
   /* XXX: Could check that it actually belongs to the right config object. */
   self->selected_output = output;
 
+  cc_display_arrangement_invalidate_cache (self);
   gtk_widget_queue_draw (GTK_WIDGET (self));
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_SELECTED_OUTPUT]);
@@ -27,6 +27,8 @@
 #include <glib/gi18n-lib.h>
 
 #include "cc-keyboard-item.h"
+#include "cc-util.h"
+#include "keyboard-shortcuts.h"
 
 #define CUSTOM_KEYS_SCHEMA "org.gnome.settings-daemon.plugins.media-keys.custom-keybinding"
 
@@ -57,6 +59,10 @@ struct _CcKeyboardItem
   char *schema;
   char *key;
   GSettings *settings;
+
+  /* Search */
+  char *search_name;
+  GPtrArray *search_combos;
 };
 
 enum
@@ -147,6 +153,9 @@ _set_description (CcKeyboardItem *item,
 {
   g_free (item->description);
   item->description = g_strdup (value);
+
+  g_free (item->search_name);
+  item->search_name = cc_util_normalize_casefold_and_unaccent (value);
 }
 
 const char *
@@ -339,6 +348,8 @@ cc_keyboard_item_finalize (GObject *object)
   g_free (item->key);
   g_list_free_full (item->key_combos, g_free);
   g_list_free_full (item->default_combos, g_free);
+  g_free (item->search_name);
+  g_clear_pointer (&item->search_combos, g_ptr_array_unref);
 
   G_OBJECT_CLASS (cc_keyboard_item_parent_class)->finalize (object);
 }
@@ -506,6 +517,7 @@ binding_changed (CcKeyboardItem *item,
 {
   g_list_free_full (item->key_combos, g_free);
   item->key_combos = settings_get_key_combos (item->settings, item->key, FALSE);
+  g_clear_pointer (&item->search_combos, g_ptr_array_unref);
 
   item->editable = g_settings_is_writable (item->settings, item->key);
 
@@ -544,6 +556,7 @@ cc_keyboard_item_load_from_gsettings_path (CcKeyboardItem *item,
 
   g_list_free_full (item->key_combos, g_free);
   item->key_combos = settings_get_key_combos (item->settings, item->key, FALSE);
+  g_clear_pointer (&item->search_combos, g_ptr_array_unref);
 
   g_signal_connect_object (G_OBJECT (item->settings), "changed::binding",
                            G_CALLBACK (binding_changed), item, G_CONNECT_SWAPPED);
@@ -562,13 +575,14 @@ cc_keyboard_item_load_from_gsettings (CcKeyboardItem *item,
 
   item->schema = g_strdup (schema);
   item->key = g_strdup (key);
-  item->description = g_strdup (description);
+  _set_description (item, description);
 
   item->settings = g_settings_new (item->schema);
   item->editable = g_settings_is_writable (item->settings, item->key);
 
   g_list_free_full (item->key_combos, g_free);
   item->key_combos = settings_get_key_combos (item->settings, item->key, FALSE);
+  g_clear_pointer (&item->search_combos, g_ptr_array_unref);
 
   g_list_free_full (item->default_combos, g_free);
   item->default_combos = settings_get_key_combos (item->settings, item->key, TRUE);
@@ -745,6 +759,114 @@ cc_keyboard_item_can_set_multiple (CcKeyboardItem *item)
   return item->can_set_multiple;
 }
 
+/**
+ * cc_keyboard_item_get_search_name:
+ * @self: a #CcKeyboardItem
+ *
+ * Returns: the description, normalized for searching.
+ */
+const gchar *
+cc_keyboard_item_get_search_name (CcKeyboardItem *self)
+{
+  g_return_val_if_fail (CC_IS_KEYBOARD_ITEM (self), NULL);
+  return self->search_name;
+}
+
+static GStrv
+combo_get_search_tokens (const CcKeyCombo *combo)
+{
+  const struct {
+    const gchar *key;
+    const gchar *untranslated;
+    const gchar *synonym;
+  } key_aliases[] =
+    {
+      { "ctrl",   "Ctrl",  "ctrl" },
+      { "win",    "Super", "super" },
+      { "option",  NULL,   "alt" },
+      { "command", NULL,   "super" },
+      { "apple",   NULL,   "super" },
+    };
+  g_autofree gchar *accel = NULL;
+  g_autofree gchar *normalized_accel = NULL;
+  g_auto(GStrv) split = NULL;
+  GPtrArray *tokens;
+
+  accel = convert_keysym_state_to_string (combo);
+  normalized_accel = cc_util_normalize_casefold_and_unaccent (accel);
+  split = g_strsplit_set (normalized_accel, SHORTCUT_DELIMITERS, -1);
+
+  tokens = g_ptr_array_new ();
+
+  for (guint i = 0; split[i]; i++)
+    {
+      if (*split[i] != '\0')
+        g_ptr_array_add (tokens, g_strdup (split[i]));
+    }
+
+  /* If a translation or synonym of a key is in the accelerator, the key
+   * itself is a token too, so typing "ctrl" finds "Strg+C" */
+  for (guint i = 0; i < G_N_ELEMENTS (key_aliases); i++)
+    {
+      g_autofree gchar *alias = NULL;
+      const gchar *synonym;
+
+      if (key_aliases[i].untranslated)
+        {
+          const gchar *translated_label;
+
+          /* Steal GTK+'s translation */
+          translated_label = g_dpgettext2 ("gtk30", "keyboard label", key_aliases[i].untranslated);
+          alias = g_utf8_strdown (translated_label, -1);
+        }
+
+      synonym = key_aliases[i].synonym;
+
+      if ((alias && g_strv_contains ((const gchar * const *) split, alias)) ||
+          (synonym && g_strv_contains ((const gchar * const *) split, synonym)))
+        {
+          g_ptr_array_add (tokens, g_strdup (key_aliases[i].key));
+        }
+    }
+
+  g_ptr_array_add (tokens, NULL);
+
+  return (GStrv) g_ptr_array_free (tokens, FALSE);
+}
+
+/**
+ * cc_keyboard_item_get_search_combos:
+ * @self: a #CcKeyboardItem
+ *
+ * Gets the normalized tokens of every enabled key combo, including the
+ * modifier aliases they match. They are computed on first use and kept
+ * until the binding changes.
+ *
+ * Returns: (transfer none) (element-type GStrv): the search tokens
+ */
+GPtrArray *
+cc_keyboard_item_get_search_combos (CcKeyboardItem *self)
+{
+  g_return_val_if_fail (CC_IS_KEYBOARD_ITEM (self), NULL);
+
+  if (self->search_combos != NULL)
+    return self->search_combos;
+
+  self->search_combos = g_ptr_array_new_with_free_func ((GDestroyNotify) g_strfreev);
+
+  for (GList *l = self->key_combos; l != NULL; l = l->next)
+    {
+      CcKeyCombo *combo = l->data;
+
+      if (is_empty_binding (combo))
+        continue;
+
+      g_ptr_array_add (self->search_combos, combo_get_search_tokens (combo));
+    }
+
+  return self->search_combos;
+}
+
 static gchar*
 combo_get_accelerator (CcKeyCombo *combo)
 {
@@ -62,6 +62,10 @@ gboolean           cc_keyboard_item_load_from_gsettings      (CcKeyboardItem
 
 const char*        cc_keyboard_item_get_description          (CcKeyboardItem     *item);
 
+const gchar*       cc_keyboard_item_get_search_name          (CcKeyboardItem     *self);
+
+GPtrArray*         cc_keyboard_item_get_search_combos        (CcKeyboardItem     *self);
+
 gboolean           cc_keyboard_item_get_desc_editable        (CcKeyboardItem     *item);
 
 const char*        cc_keyboard_item_get_command              (CcKeyboardItem     *item);
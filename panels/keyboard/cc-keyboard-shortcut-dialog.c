@@ -37,8 +37,6 @@
 #include "list-box-helper.h"
 #include "keyboard-shortcuts.h"
 
-#define SHORTCUT_DELIMITERS "+ "
-
 typedef struct {
   gchar          *section_title;
   gchar          *section_id;
@@ -76,6 +74,10 @@ struct _CcKeyboardShortcutDialog
   CcKeyboardManager  *manager;
   GtkWidget          *shortcut_editor;
   GHashTable         *sections;
+
+  /* Normalized search terms, and the keys typed in each of them */
+  GStrv               search_terms;
+  GPtrArray          *search_term_keys;
  };
 
 G_DEFINE_TYPE (CcKeyboardShortcutDialog, cc_keyboard_shortcut_dialog, GTK_TYPE_DIALOG)
@@ -452,10 +454,57 @@ reset_all_clicked_cb (CcKeyboardShortcutDialog *self)
   update_modified_counts (self);
 }
 
+static void
+update_search_terms (CcKeyboardShortcutDialog *self)
+{
+  g_autofree gchar *search = NULL;
+  g_auto(GStrv) terms = NULL;
+  GPtrArray *search_terms;
+
+  search = cc_util_normalize_casefold_and_unaccent (gtk_entry_get_text (GTK_ENTRY (self->search_entry)));
+  terms = g_strsplit (search, " ", -1);
+
+  search_terms = g_ptr_array_new ();
+  g_ptr_array_set_size (self->search_term_keys, 0);
+
+  for (guint i = 0; terms[i] != NULL; i++)
+    {
+      g_auto(GStrv) split = NULL;
+      GPtrArray *keys;
+
+      if (*terms[i] == '\0')
+        continue;
+
+      keys = g_ptr_array_new ();
+      split = g_strsplit_set (terms[i], SHORTCUT_DELIMITERS, -1);
+      for (guint j = 0; split[j] != NULL; j++)
+        {
+          /* Strip leading and trailing whitespaces */
+          g_strstrip (split[j]);
+
+          if (*split[j] != '\0')
+            g_ptr_array_add (keys, g_strdup (split[j]));
+        }
+      g_ptr_array_add (keys, NULL);
+
+      g_ptr_array_add (search_terms, g_strdup (terms[i]));
+      g_ptr_array_add (self->search_term_keys, g_ptr_array_free (keys, FALSE));
+    }
+
+  g_ptr_array_add (search_terms, NULL);
+
+  g_strfreev (self->search_terms);
+  self->search_terms = (GStrv) g_ptr_array_free (search_terms, FALSE);
+}
+
 static void
 search_entry_cb (CcKeyboardShortcutDialog *self)
 {
-  gboolean is_shortcut = is_matched_shortcut_present (self->shortcut_listbox, self);
+  gboolean is_shortcut;
+
+  update_search_terms (self);
+
+  is_shortcut = is_matched_shortcut_present (self->shortcut_listbox, self);
   if (!is_shortcut)
       gtk_stack_set_visible_child (self->stack, self->empty_search_placeholder);
   else if (gtk_entry_get_text_length (GTK_ENTRY (self->search_entry)) == 0 && self->section_row == NULL)
@@ -474,100 +523,32 @@ key_press_cb (CcKeyboardShortcutDialog *self, GdkEvent *event)
 }
 
 static gboolean
-strv_contains_prefix_or_match (gchar       **strv,
-                               const gchar  *prefix)
-{
-  const struct {
-    const gchar *key;
-    const gchar *untranslated;
-    const gchar *synonym;
-  } key_aliases[] =
-    {
-      { "ctrl",   "Ctrl",  "ctrl" },
-      { "win",    "Super", "super" },
-      { "option",  NULL,   "alt" },
-      { "command", NULL,   "super" },
-      { "apple",   NULL,   "super" },
-    };
-
+strv_contains_prefix (const gchar * const *strv,
+                      const gchar         *prefix)
+{
   for (guint i = 0; strv[i]; i++)
     {
       if (g_str_has_prefix (strv[i], prefix))
         return TRUE;
     }
 
-  for (guint i = 0; i < G_N_ELEMENTS (key_aliases); i++)
-    {
-      g_autofree gchar *alias = NULL;
-      const gchar *synonym;
-
-      if (!g_str_has_prefix (key_aliases[i].key, prefix))
-        continue;
-
-      if (key_aliases[i].untranslated)
-        {
-          const gchar *translated_label;
-
-          /* Steal GTK+'s translation */
-          translated_label = g_dpgettext2 ("gtk30", "keyboard label", key_aliases[i].untranslated);
-          alias = g_utf8_strdown (translated_label, -1);
-        }
-
-      synonym = key_aliases[i].synonym;
-
-      /* If a translation or synonym of the key is in the accelerator, and we typed
-       * the key, also consider that a prefix */
-      if ((alias && g_strv_contains ((const gchar * const *) strv, alias)) ||
-          (synonym && g_strv_contains ((const gchar * const *) strv, synonym)))
-        {
-          return TRUE;
-        }
-    }
-
   return FALSE;
 }
 
 static gboolean
-search_match_shortcut (CcKeyboardItem *item,
-                       const gchar    *search)
-{
-  g_auto(GStrv) shortcut_tokens = NULL, search_tokens = NULL;
-  g_autofree gchar *normalized_accel = NULL;
-  g_autofree gchar *accel = NULL;
-  gboolean match;
-  GList *key_combos;
-  CcKeyCombo *combo;
-
-  key_combos = cc_keyboard_item_get_key_combos (item);
-  for (GList *l = key_combos; l != NULL; l = l->next)
-    {
-      combo = l->data;
-
-      if (is_empty_binding (combo))
-        continue;
-
-      match = TRUE;
-      accel = convert_keysym_state_to_string (combo);
-      normalized_accel = cc_util_normalize_casefold_and_unaccent (accel);
-
-      shortcut_tokens = g_strsplit_set (normalized_accel, SHORTCUT_DELIMITERS, -1);
-      search_tokens = g_strsplit_set (search, SHORTCUT_DELIMITERS, -1);
-
-      for (guint i = 0; search_tokens[i] != NULL; i++)
-        {
-          const gchar *token;
-
-          /* Strip leading and trailing whitespaces */
-          token = g_strstrip (search_tokens[i]);
-
-          if (g_utf8_strlen (token, -1) == 0)
-            continue;
+search_match_shortcut (CcKeyboardItem       *item,
+                       const gchar * const  *keys)
+{
+  GPtrArray *search_combos;
 
-          match = match && strv_contains_prefix_or_match (shortcut_tokens, token);
+  search_combos = cc_keyboard_item_get_search_combos (item);
+  for (guint i = 0; i < search_combos->len; i++)
+    {
+      const gchar * const *shortcut_tokens = g_ptr_array_index (search_combos, i);
+      gboolean match = TRUE;
 
-          if (!match)
-            break;
-        }
+      for (guint j = 0; match && keys[j] != NULL; j++)
+        match = strv_contains_prefix (shortcut_tokens, keys[j]);
 
       if (match)
         return TRUE;
@@ -626,10 +607,7 @@ shortcut_filter_function (GtkListBoxRow *row,
   SectionRowData  *section_data;
   ShortcutRowData *data;
   CcKeyboardItem *item;
-  gboolean retval;
-  g_autofree gchar *search = NULL;
-  g_autofree gchar *name = NULL;
-  g_auto(GStrv) terms = NULL;
+  const gchar *name;
   gboolean is_custom_shortcuts = FALSE;
 
   if (self->section_row != NULL)
@@ -648,20 +626,21 @@ shortcut_filter_function (GtkListBoxRow *row,
   if (gtk_entry_get_text_length (GTK_ENTRY (self->search_entry)) == 0)
     return TRUE;
 
+  if (self->search_terms == NULL)
+    return TRUE;
+
   data = g_object_get_data (G_OBJECT (row), "data");
   item = data->item;
-  name = cc_util_normalize_casefold_and_unaccent (cc_keyboard_item_get_description (item));
-  search = cc_util_normalize_casefold_and_unaccent (gtk_entry_get_text (GTK_ENTRY (self->search_entry)));
-  terms = g_strsplit (search, " ", -1);
+  name = cc_keyboard_item_get_search_name (item);
 
-  for (guint i = 0; terms && terms[i]; i++)
+  for (guint i = 0; self->search_terms[i]; i++)
     {
-      retval = strstr (name, terms[i]) || search_match_shortcut (item, terms[i]);
-      if (!retval)
-        break;
+      if ((name == NULL || strstr (name, self->search_terms[i]) == NULL) &&
+          !search_match_shortcut (item, g_ptr_array_index (self->search_term_keys, i)))
+        return FALSE;
     }
 
-  return retval;
+  return TRUE;
 }
 
 static gboolean
@@ -772,6 +751,8 @@ cc_keyboard_shortcut_dialog_finalize (GObject *object)
   g_clear_object (&self->manager);
   g_clear_pointer (&self->sections, g_hash_table_destroy);
   g_clear_pointer (&self->shortcut_editor, gtk_widget_destroy);
+  g_clear_pointer (&self->search_terms, g_strfreev);
+  g_clear_pointer (&self->search_term_keys, g_ptr_array_unref);
 }
 
 static void
@@ -819,6 +800,7 @@ cc_keyboard_shortcut_dialog_init (CcKeyboardShortcutDialog *self)
 
   self->sections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   self->section_row = NULL;
+  self->search_term_keys = g_ptr_array_new_with_free_func ((GDestroyNotify) g_strfreev);
 
   g_signal_connect_object (self->manager,
                            "shortcut-added",
@@ -23,6 +23,9 @@
 
 #include "cc-keyboard-item.h"
 
+/* Separators between the keys of an accelerator label, and of a search term */
+#define SHORTCUT_DELIMITERS "+ "
+
 typedef struct {
   /* The untranslated name, combine with ->package to translate */
   char *name;
@@ -41,25 +41,47 @@
  * Generate a QR image from a given text.
  */
 
+/* Number of rendered surfaces kept around, e.g. for both scales when
+ * moving a window between a regular and a HiDPI monitor */
+#define MAX_CACHED_SURFACES 4
+
+typedef struct
+{
+  gint             size;
+  gint             scale;
+  cairo_surface_t *surface;
+} CachedSurface;
+
 struct _CcQrCode
 {
   GObject          parent_instance;
 
   gchar           *text;
-  cairo_surface_t *surface;
-  gint             size;
-  gint             scale;
+
+  /* Encoded matrix for @text, NULL until first needed */
+  uint8_t         *qr_code;
+
+  /* CachedSurface, most recently used last */
+  GPtrArray       *surfaces;
 };
 
 G_DEFINE_TYPE (CcQrCode, cc_qr_code, G_TYPE_OBJECT)
 
 
+static void
+cached_surface_free (CachedSurface *cached)
+{
+  cairo_surface_destroy (cached->surface);
+  g_free (cached);
+}
+
 static void
 cc_qr_code_finalize (GObject *object)
 {
   CcQrCode *self = (CcQrCode *)object;
 
-  g_clear_pointer (&self->surface, cairo_surface_destroy);
+  g_clear_pointer (&self->surfaces, g_ptr_array_unref);
+  g_clear_pointer (&self->qr_code, g_free);
   g_clear_pointer (&self->text, g_free);
 
   G_OBJECT_CLASS (cc_qr_code_parent_class)->finalize (object);
@@ -76,6 +98,7 @@ cc_qr_code_class_init (CcQrCodeClass *klass)
 static void
 cc_qr_code_init (CcQrCode *self)
 {
+  self->surfaces = g_ptr_array_new_with_free_func ((GDestroyNotify) cached_surface_free);
 }
 
 CcQrCode *
@@ -94,81 +117,61 @@ cc_qr_code_set_text (CcQrCode    *self,
   if (g_strcmp0 (text, self->text) == 0)
     return FALSE;
 
-  /* Clear cairo surface that is cached */
-  g_clear_pointer (&self->surface, cairo_surface_destroy);
+  /* Clear the encoded matrix and cairo surfaces that are cached */
+  g_ptr_array_set_size (self->surfaces, 0);
+  g_clear_pointer (&self->qr_code, g_free);
   g_free (self->text);
   self->text = g_strdup (text);
 
   return TRUE;
 }
 
-static void
-cc_cairo_fill_pixel (cairo_t *cr,
-                     int      x,
-                     int      y,
-                     int      padding,
-                     int      scale)
-{
-  cairo_rectangle (cr,
-                   x * scale + padding,
-                   y * scale + padding,
-                   scale, scale);
-  cairo_fill (cr);
-}
-
-cairo_surface_t *
-cc_qr_code_get_surface (CcQrCode *self,
-                        gint      size,
-                        gint      scale)
+static const uint8_t *
+cc_qr_code_get_matrix (CcQrCode *self)
 {
-  uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
   uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
-  cairo_t *cr;
-  gint pixel_size, padding, qr_size;
-  gboolean success = FALSE;
+  g_autofree uint8_t *qr_code = NULL;
 
-  g_return_val_if_fail (CC_IS_QR_CODE (self), NULL);
-  g_return_val_if_fail (size > 0, NULL);
-  g_return_val_if_fail (scale > 0, NULL);
+  if (self->qr_code)
+    return self->qr_code;
 
-  if (!self->text || !*self->text)
-    {
-      g_warn_if_reached ();
-      cc_qr_code_set_text (self, "invalid text");
-    }
+  qr_code = g_malloc (qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX));
 
-  if (self->surface &&
-      self->size == size &&
-      self->scale == scale)
-    return self->surface;
-
-  self->size  = size;
-  self->scale = scale;
-  g_clear_pointer (&self->surface, cairo_surface_destroy);
-
-  success = qrcodegen_encodeText (self->text,
-                                  temp_buf,
-                                  qr_code,
-                                  qrcodegen_Ecc_LOW,
-                                  qrcodegen_VERSION_MIN,
-                                  qrcodegen_VERSION_MAX,
-                                  qrcodegen_Mask_AUTO,
-                                  FALSE);
-
-  if (!success)
+  if (!qrcodegen_encodeText (self->text,
+                             temp_buf,
+                             qr_code,
+                             qrcodegen_Ecc_LOW,
+                             qrcodegen_VERSION_MIN,
+                             qrcodegen_VERSION_MAX,
+                             qrcodegen_Mask_AUTO,
+                             FALSE))
     return NULL;
 
-  self->surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, size * scale, size * scale);
-  cairo_surface_set_device_scale (self->surface, scale, scale);
-  cr = cairo_create (self->surface);
-  cairo_set_antialias (cr, CAIRO_ANTIALIAS_NONE);
+  self->qr_code = g_steal_pointer (&qr_code);
+
+  return self->qr_code;
+}
+
+/* Writes the modules straight into the pixel buffer, one module row at
+ * a time, which is then copied over the rows it covers. The result is
+ * identical to filling each module with cairo without antialiasing. */
+static cairo_surface_t *
+render_surface (const uint8_t *qr_code,
+                gint           size,
+                gint           scale)
+{
+  cairo_surface_t *surface;
+  g_autofree guint32 *row = NULL;
+  guchar *data;
+  gint pixel_size, padding, qr_size;
+  gint width, stride;
 
-  /* Draw white background */
-  cairo_set_source_rgba (cr, 1, 1, 1, 1);
-  cairo_rectangle (cr, 0, 0, size * scale, size * scale);
-  cairo_fill (cr);
+  width = size * scale;
 
-  qr_size = qrcodegen_getSize(qr_code);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, width);
+  cairo_surface_set_device_scale (surface, scale, scale);
+
+  qr_size = qrcodegen_getSize (qr_code);
   pixel_size = MAX (1, size / (qr_size));
   padding = (size - qr_size * pixel_size) / 2;
 
@@ -180,18 +183,100 @@ cc_qr_code_get_surface (CcQrCode *self,
       padding = (size - qr_size * pixel_size) / 2;
     }
 
-  /* Now draw the black QR code pixels */
-  cairo_set_source_rgba (cr, 0, 0, 0, 1);
-  for (int row = 0; row < qr_size; row++)
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  row = g_new (guint32, width);
+
+  for (gint y = 0; y < width; y++)
+    {
+      guint32 *line = (guint32 *) (data + y * stride);
+
+      for (gint x = 0; x < width; x++)
+        line[x] = 0xffffffff;
+    }
+
+  for (gint module_row = 0; module_row < qr_size; module_row++)
+    {
+      gint top, bottom;
+
+      top = CLAMP ((module_row * pixel_size + padding) * scale, 0, width);
+      bottom = CLAMP ((module_row * pixel_size + padding + pixel_size) * scale, 0, width);
+      if (top == bottom)
+        continue;
+
+      for (gint x = 0; x < width; x++)
+        row[x] = 0xffffffff;
+
+      for (gint column = 0; column < qr_size; column++)
+        {
+          gint left, right;
+
+          /* Rows and columns are swapped, as they always were */
+          if (!qrcodegen_getModule (qr_code, module_row, column))
+            continue;
+
+          left = CLAMP ((column * pixel_size + padding) * scale, 0, width);
+          right = CLAMP ((column * pixel_size + padding + pixel_size) * scale, 0, width);
+
+          for (gint x = left; x < right; x++)
+            row[x] = 0xff000000;
+        }
+
+      for (gint y = top; y < bottom; y++)
+        memcpy (data + y * stride, row, width * sizeof (guint32));
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+cairo_surface_t *
+cc_qr_code_get_surface (CcQrCode *self,
+                        gint      size,
+                        gint      scale)
+{
+  const uint8_t *qr_code;
+  CachedSurface *cached;
+
+  g_return_val_if_fail (CC_IS_QR_CODE (self), NULL);
+  g_return_val_if_fail (size > 0, NULL);
+  g_return_val_if_fail (scale > 0, NULL);
+
+  if (!self->text || !*self->text)
+    {
+      g_warn_if_reached ();
+      cc_qr_code_set_text (self, "invalid text");
+    }
+
+  for (guint i = 0; i < self->surfaces->len; i++)
     {
-      for (int column = 0; column < qr_size; column++)
+      cached = g_ptr_array_index (self->surfaces, i);
+
+      if (cached->size == size && cached->scale == scale)
         {
-          if (qrcodegen_getModule (qr_code, row, column))
-            cc_cairo_fill_pixel (cr, column, row, padding, pixel_size);
+          /* Move to the end, so it is the last to be evicted */
+          memmove (&self->surfaces->pdata[i], &self->surfaces->pdata[i + 1],
+                   (self->surfaces->len - i - 1) * sizeof (gpointer));
+          self->surfaces->pdata[self->surfaces->len - 1] = cached;
+          return cached->surface;
         }
     }
 
-  cairo_destroy (cr);
+  qr_code = cc_qr_code_get_matrix (self);
+  if (!qr_code)
+    return NULL;
+
+  if (self->surfaces->len >= MAX_CACHED_SURFACES)
+    g_ptr_array_remove_index (self->surfaces, 0);
+
+  cached = g_new0 (CachedSurface, 1);
+  cached->size = size;
+  cached->scale = scale;
+  cached->surface = render_surface (qr_code, size, scale);
+  g_ptr_array_add (self->surfaces, cached);
 
-  return self->surface;
+  return cached->surface;
 }
@@ -0,0 +1,237 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gio/gdesktopappinfo.h>
+
+#include "cc-notifications-apps.h"
+
+#define APP_SCHEMA "org.gnome.desktop.notifications.application"
+#define APP_PREFIX "/org/gnome/desktop/notifications/application/"
+
+void
+cc_notifications_app_free (CcNotificationsApp *app)
+{
+  g_free (app->canonical_app_id);
+  g_object_unref (app->app_info);
+  g_free (app);
+}
+
+static CcNotificationsApp *
+notifications_app_new (const gchar *canonical_app_id,
+                       GAppInfo    *app_info)
+{
+  CcNotificationsApp *app;
+
+  app = g_new0 (CcNotificationsApp, 1);
+  app->canonical_app_id = g_strdup (canonical_app_id);
+  app->app_info = g_object_ref (app_info);
+
+  return app;
+}
+
+static char *
+app_info_get_id (GAppInfo *app_info)
+{
+  const char *desktop_id;
+  g_autofree gchar *ret = NULL;
+  const char *filename;
+
+  desktop_id = g_app_info_get_id (app_info);
+  if (desktop_id != NULL)
+    {
+      ret = g_strdup (desktop_id);
+    }
+  else
+    {
+      filename = g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (app_info));
+      ret = g_path_get_basename (filename);
+    }
+
+  if (G_UNLIKELY (g_str_has_suffix (ret, ".desktop") == FALSE))
+    return NULL;
+
+  *(ret + strlen (ret) - strlen (".desktop")) = '\0';
+  return g_steal_pointer (&ret);
+}
+
+/* The ID the shell stores the settings of the application under */
+gchar *
+cc_notifications_app_canonicalize_id (GAppInfo *app_info)
+{
+  gchar *app_id;
+  guint i;
+
+  app_id = app_info_get_id (app_info);
+  if (app_id == NULL)
+    return NULL;
+
+  g_strcanon (app_id,
+              "0123456789"
+              "abcdefghijklmnopqrstuvwxyz"
+              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+              "-",
+              '-');
+  for (i = 0; app_id[i] != '\0'; i++)
+    app_id[i] = g_ascii_tolower (app_id[i]);
+
+  return app_id;
+}
+
+GSettings *
+cc_notifications_app_settings_new (const gchar *canonical_app_id)
+{
+  g_autofree gchar *path = NULL;
+
+  path = g_strconcat (APP_PREFIX, canonical_app_id, "/", NULL);
+  return g_settings_new_with_path (APP_SCHEMA, path);
+}
+
+/* For the children whose desktop ID doesn't match their canonical ID */
+static GAppInfo *
+lookup_child_app_info (const gchar *canonical_app_id)
+{
+  g_autoptr(GSettings) settings = NULL;
+  g_autofree gchar *full_app_id = NULL;
+
+  settings = cc_notifications_app_settings_new (canonical_app_id);
+  full_app_id = g_settings_get_string (settings, "application-id");
+  if (*full_app_id == '\0')
+    return NULL;
+
+  return G_APP_INFO (g_desktop_app_info_new (full_app_id));
+}
+
+static void
+discover_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+  g_autoptr(GHashTable) app_infos = NULL;
+  g_autoptr(GHashTable) added = NULL;
+  g_autoptr(GPtrArray) apps = NULL;
+  gchar **children = task_data;
+  g_autolist(GAppInfo) all = NULL;
+  GList *l;
+  guint i;
+
+  /* canonical ID → GAppInfo, for every application */
+  app_infos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  all = g_app_info_get_all ();
+  for (l = all; l != NULL; l = l->next)
+    {
+      gchar *canonical_app_id = cc_notifications_app_canonicalize_id (l->data);
+
+      if (canonical_app_id == NULL || g_hash_table_contains (app_infos, canonical_app_id))
+        {
+          g_free (canonical_app_id);
+          continue;
+        }
+      g_hash_table_insert (app_infos, canonical_app_id, g_object_ref (l->data));
+    }
+
+  apps = g_ptr_array_new_with_free_func ((GDestroyNotify) cc_notifications_app_free);
+  added = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Applications that sent notifications before */
+  for (i = 0; children[i] != NULL; i++)
+    {
+      g_autoptr(GAppInfo) app_info = NULL;
+      CcNotificationsApp *app;
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      if (*children[i] == '\0' || g_hash_table_contains (added, children[i]))
+        continue;
+
+      app_info = g_hash_table_lookup (app_infos, children[i]);
+      if (app_info != NULL)
+        g_object_ref (app_info);
+      else
+        app_info = lookup_child_app_info (children[i]);
+
+      if (app_info == NULL)
+        {
+          /* The application cannot be found, probably it was uninstalled */
+          g_debug ("Not adding application with canonical app ID %s", children[i]);
+          continue;
+        }
+
+      app = notifications_app_new (children[i], app_info);
+      g_ptr_array_add (apps, app);
+      g_hash_table_add (added, app->canonical_app_id);
+    }
+
+  /* Applications that statically declare to show notifications */
+  for (l = all; l != NULL; l = l->next)
+    {
+      GAppInfo *app_info = l->data;
+      g_autofree gchar *canonical_app_id = NULL;
+      CcNotificationsApp *app;
+
+      if (!g_desktop_app_info_get_boolean (G_DESKTOP_APP_INFO (app_info), "X-GNOME-UsesNotifications"))
+        continue;
+
+      canonical_app_id = cc_notifications_app_canonicalize_id (app_info);
+
+      /* Ignore compatibility desktops (lp: #1716267) */
+      if (g_strcmp0 (canonical_app_id, "file-roller") == 0 ||
+          g_strcmp0 (canonical_app_id, "nautilus") == 0)
+        continue;
+
+      if (g_hash_table_contains (added, canonical_app_id))
+        continue;
+
+      app = notifications_app_new (canonical_app_id, app_info);
+      g_ptr_array_add (apps, app);
+      g_hash_table_add (added, app->canonical_app_id);
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&apps), (GDestroyNotify) g_ptr_array_unref);
+}
+
+/*
+ * Finds the applications to list in a worker thread: the children of the
+ * notification settings that are still installed, and the ones declaring
+ * X-GNOME-UsesNotifications.  Settings are only read for the children
+ * whose application can't be found from their ID.
+ */
+void
+cc_notifications_apps_discover (const gchar * const *children,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_notifications_apps_discover);
+  g_task_set_task_data (task, g_strdupv ((gchar **) children), (GDestroyNotify) g_strfreev);
+  g_task_run_in_thread (task, discover_thread);
+}
+
+/* Returns a GPtrArray of CcNotificationsApp, each canonical ID only once */
+GPtrArray *
+cc_notifications_apps_discover_finish (GAsyncResult  *result,
+                                       GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_notifications_apps_discover, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
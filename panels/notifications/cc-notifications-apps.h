@@ -0,0 +1,43 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar    *canonical_app_id;
+  GAppInfo *app_info;
+} CcNotificationsApp;
+
+void       cc_notifications_app_free              (CcNotificationsApp   *app);
+
+gchar     *cc_notifications_app_canonicalize_id   (GAppInfo             *app_info);
+GSettings *cc_notifications_app_settings_new      (const gchar          *canonical_app_id);
+
+void       cc_notifications_apps_discover         (const gchar * const  *children,
+                                                   GCancellable         *cancellable,
+                                                   GAsyncReadyCallback   callback,
+                                                   gpointer              user_data);
+GPtrArray *cc_notifications_apps_discover_finish  (GAsyncResult         *result,
+                                                   GError              **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcNotificationsApp, cc_notifications_app_free)
+
+G_END_DECLS
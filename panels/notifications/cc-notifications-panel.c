@@ -27,13 +27,15 @@
 
 #include "cc-list-row.h"
 #include "list-box-helper.h"
+#include "cc-notifications-apps.h"
 #include "cc-notifications-panel.h"
 #include "cc-notifications-resources.h"
 #include "cc-app-notifications-dialog.h"
 
 #define MASTER_SCHEMA "org.gnome.desktop.notifications"
-#define APP_SCHEMA MASTER_SCHEMA ".application"
-#define APP_PREFIX "/org/gnome/desktop/notifications/application/"
+
+/* How many rows get their settings per idle callback */
+#define SETTINGS_PER_IDLE 10
 
 struct _CcNotificationsPanel {
   CcPanel            parent_instance;
@@ -51,7 +53,16 @@ struct _CcNotificationsPanel {
 
   GCancellable      *cancellable;
 
-  GHashTable        *known_applications;
+  GAppInfoMonitor   *app_monitor;
+  gboolean           discovering;
+  gboolean           discover_again;
+
+  /* canonical app ID → GtkListBoxRow */
+  GHashTable        *app_rows;
+
+  /* rows whose "enable" setting isn't shown yet */
+  GQueue             settings_queue;
+  guint              settings_idle_id;
 
   GList             *sections;
   GList             *sections_reverse;
@@ -66,11 +77,10 @@ struct _CcNotificationsPanelClass {
 typedef struct {
   char *canonical_app_id;
   GAppInfo *app_info;
-  GSettings *settings;
 
-  /* Temporary pointer, to pass from the loading thread
-     to the app */
-  CcNotificationsPanel *panel;
+  /* Created when first needed */
+  GSettings *settings;
+  GtkWidget *enable_label;
 } Application;
 
 static void build_app_store (CcNotificationsPanel *panel);
@@ -84,8 +94,13 @@ cc_notifications_panel_dispose (GObject *object)
 {
   CcNotificationsPanel *panel = CC_NOTIFICATIONS_PANEL (object);
 
+  g_clear_handle_id (&panel->settings_idle_id, g_source_remove);
+  g_queue_foreach (&panel->settings_queue, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&panel->settings_queue);
+
+  g_clear_object (&panel->app_monitor);
   g_clear_object (&panel->master_settings);
-  g_clear_pointer (&panel->known_applications, g_hash_table_unref);
+  g_clear_pointer (&panel->app_rows, g_hash_table_unref);
   g_clear_pointer (&panel->sections, g_list_free);
   g_clear_pointer (&panel->sections_reverse, g_list_free);
 
@@ -171,8 +186,8 @@ cc_notifications_panel_init (CcNotificationsPanel *panel)
 
   gtk_widget_init_template (GTK_WIDGET (panel));
 
-  panel->known_applications = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                     NULL, g_free);
+  panel->app_rows = g_hash_table_new (g_str_hash, g_str_equal);
+  g_queue_init (&panel->settings_queue);
 
   panel->master_settings = g_settings_new (MASTER_SCHEMA);
 
@@ -273,13 +288,60 @@ application_free (Application *app)
 {
   g_free (app->canonical_app_id);
   g_object_unref (app->app_info);
-  g_object_unref (app->settings);
+  g_clear_object (&app->settings);
 
   g_slice_free (Application, app);
 }
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (Application, application_free)
 
+static GSettings *
+application_ensure_settings (Application *app)
+{
+  if (app->settings != NULL)
+    return app->settings;
+
+  app->settings = cc_notifications_app_settings_new (app->canonical_app_id);
+  g_settings_bind_with_mapping (app->settings, "enable",
+                                app->enable_label, "label",
+                                G_SETTINGS_BIND_GET |
+                                G_SETTINGS_BIND_NO_SENSITIVITY,
+                                on_off_label_mapping_get,
+                                NULL,
+                                NULL,
+                                NULL);
+
+  return app->settings;
+}
+
+static gboolean
+settings_idle_cb (gpointer user_data)
+{
+  CcNotificationsPanel *panel = user_data;
+  guint i;
+
+  for (i = 0; i < SETTINGS_PER_IDLE; i++)
+    {
+      g_autoptr(GtkWidget) row = g_queue_pop_head (&panel->settings_queue);
+      Application *app;
+
+      if (row == NULL)
+        {
+          panel->settings_idle_id = 0;
+          return G_SOURCE_REMOVE;
+        }
+
+      /* Removed in the meantime */
+      if (gtk_widget_get_parent (row) == NULL)
+        continue;
+
+      app = g_object_get_qdata (G_OBJECT (row), application_quark ());
+      application_ensure_settings (app);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
 static void
 add_application (CcNotificationsPanel *panel,
                  Application          *app)
@@ -291,7 +353,10 @@ add_application (CcNotificationsPanel *panel,
 
   app_name = g_app_info_get_name (app->app_info);
   if (app_name == NULL || *app_name == '\0')
-    return;
+    {
+      application_free (app);
+      return;
+    }
 
   icon = g_app_info_get_icon (app->app_info);
   if (icon == NULL)
@@ -327,183 +392,124 @@ add_application (CcNotificationsPanel *panel,
 
   w = gtk_label_new ("");
   gtk_widget_show (w);
-  g_settings_bind_with_mapping (app->settings, "enable",
-                                w, "label",
-                                G_SETTINGS_BIND_GET |
-                                G_SETTINGS_BIND_NO_SENSITIVITY,
-                                on_off_label_mapping_get,
-                                NULL,
-                                NULL,
-                                NULL);
   gtk_widget_set_margin_end (w, 12);
   gtk_widget_set_valign (w, GTK_ALIGN_CENTER);
   gtk_box_pack_end (GTK_BOX (box), w, FALSE, FALSE, 0);
+  app->enable_label = w;
 
-  g_hash_table_add (panel->known_applications, g_strdup (app->canonical_app_id));
-}
-
-static void
-maybe_add_app_id (CcNotificationsPanel *panel,
-                  const char *canonical_app_id)
-{
-  Application *app;
-  g_autofree gchar *path = NULL;
-  g_autofree gchar *full_app_id = NULL;
-  g_autoptr(GSettings) settings = NULL;
-  g_autoptr(GAppInfo) app_info = NULL;
-
-  if (*canonical_app_id == '\0')
-    return;
-
-  if (g_hash_table_contains (panel->known_applications,
-                             canonical_app_id))
-    return;
-
-  path = g_strconcat (APP_PREFIX, canonical_app_id, "/", NULL);
-  settings = g_settings_new_with_path (APP_SCHEMA, path);
+  g_hash_table_insert (panel->app_rows, app->canonical_app_id, row);
 
-  full_app_id = g_settings_get_string (settings, "application-id");
-  app_info = G_APP_INFO (g_desktop_app_info_new (full_app_id));
-
-  if (app_info == NULL) {
-    g_debug ("Not adding application '%s' (canonical app ID: %s)",
-             full_app_id, canonical_app_id);
-    /* The application cannot be found, probably it was uninstalled */
-    return;
-  }
-
-  app = g_slice_new (Application);
-  app->canonical_app_id = g_strdup (canonical_app_id);
-  app->settings = g_object_ref (settings);
-  app->app_info = g_object_ref (app_info);
-
-  g_debug ("Adding application '%s' (canonical app ID: %s)",
-           full_app_id, canonical_app_id);
-
-  add_application (panel, app);
+  /* Each GSettings watches its path in dconf, so only create them
+   * a few at a time once the list is shown */
+  g_queue_push_tail (&panel->settings_queue, g_object_ref (row));
+  if (panel->settings_idle_id == 0)
+    panel->settings_idle_id = g_idle_add_full (G_PRIORITY_LOW, settings_idle_cb, panel, NULL);
 }
 
-static char *
-app_info_get_id (GAppInfo *app_info)
-{
-  const char *desktop_id;
-  g_autofree gchar *ret = NULL;
-  const char *filename;
-  int l;
-
-  desktop_id = g_app_info_get_id (app_info);
-  if (desktop_id != NULL)
-    {
-      ret = g_strdup (desktop_id);
-    }
-  else
-    {
-      filename = g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (app_info));
-      ret = g_path_get_basename (filename);
-    }
-
-  if (G_UNLIKELY (g_str_has_suffix (ret, ".desktop") == FALSE))
-    return NULL;
-
-  l = strlen (desktop_id);
-  *(ret + l - strlen(".desktop")) = '\0';
-  return g_steal_pointer (&ret);
-}
+static void discover_apps (CcNotificationsPanel *panel);
 
 static void
-process_app_info (CcNotificationsPanel *panel,
-                  GAppInfo             *app_info)
+discover_apps_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
 {
-  Application *app;
-  g_autofree gchar *app_id = NULL;
-  g_autofree gchar *path = NULL;
-  g_autoptr(GSettings) settings = NULL;
+  CcNotificationsPanel *panel;
+  g_autoptr(GHashTable) found = NULL;
+  g_autoptr(GPtrArray) apps = NULL;
+  g_autoptr(GError) error = NULL;
+  GHashTableIter iter;
+  gpointer row;
   guint i;
 
-  app_id = app_info_get_id (app_info);
+  apps = cc_notifications_apps_discover_finish (res, &error);
+  if (apps == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to list the applications: %s", error->message);
+      return;
+    }
 
-  /* Ignore compatibility desktops (lp: #1716267) */
-  if (g_strcmp0 (app_id, "file-roller") == 0)
-    return;
+  panel = CC_NOTIFICATIONS_PANEL (user_data);
+  panel->discovering = FALSE;
 
-  if (g_strcmp0 (app_id, "nautilus") == 0)
-    return;
+  found = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < apps->len; i++)
+    {
+      CcNotificationsApp *found_app = g_ptr_array_index (apps, i);
+      Application *app;
 
-  g_strcanon (app_id,
-              "0123456789"
-              "abcdefghijklmnopqrstuvwxyz"
-              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-              "-",
-              '-');
-  for (i = 0; app_id[i] != '\0'; i++)
-    app_id[i] = g_ascii_tolower (app_id[i]);
+      g_hash_table_add (found, found_app->canonical_app_id);
+      if (g_hash_table_contains (panel->app_rows, found_app->canonical_app_id))
+        continue;
 
-  path = g_strconcat (APP_PREFIX, app_id, "/", NULL);
-  settings = g_settings_new_with_path (APP_SCHEMA, path);
+      g_debug ("Adding application %s", found_app->canonical_app_id);
 
-  app = g_slice_new (Application);
-  app->canonical_app_id = g_steal_pointer (&app_id);
-  app->settings = g_object_ref (settings);
-  app->app_info = g_object_ref (app_info);
-  app->panel = g_object_ref (panel);
+      app = g_slice_new0 (Application);
+      app->canonical_app_id = g_strdup (found_app->canonical_app_id);
+      app->app_info = g_object_ref (found_app->app_info);
+      add_application (panel, app);
+    }
 
-  if (g_hash_table_contains (panel->known_applications,
-                             app->canonical_app_id))
-    return;
+  /* Uninstalled ones */
+  g_hash_table_iter_init (&iter, panel->app_rows);
+  while (g_hash_table_iter_next (&iter, NULL, &row))
+    {
+      Application *app = g_object_get_qdata (G_OBJECT (row), application_quark ());
 
-  g_debug ("Processing queued application %s", app->canonical_app_id);
+      if (g_hash_table_contains (found, app->canonical_app_id))
+        continue;
 
-  add_application (panel, app);
-}
+      g_debug ("Removing application %s", app->canonical_app_id);
 
-static void
-load_apps (CcNotificationsPanel *panel)
-{
-  GList *iter, *apps;
-
-  apps = g_app_info_get_all ();
+      g_hash_table_iter_remove (&iter);
+      gtk_widget_destroy (GTK_WIDGET (row));
+    }
 
-  for (iter = apps; iter; iter = iter->next)
+  if (panel->discover_again)
     {
-      GDesktopAppInfo *app;
-
-      app = iter->data;
-      if (g_desktop_app_info_get_boolean (app, "X-GNOME-UsesNotifications")) {
-        process_app_info (panel, G_APP_INFO (app));
-        g_debug ("Processing app '%s'", g_app_info_get_id (G_APP_INFO (app)));
-      } else {
-        g_debug ("Skipped app '%s', doesn't use notifications", g_app_info_get_id (G_APP_INFO (app)));
-      }
+      panel->discover_again = FALSE;
+      discover_apps (panel);
     }
-
-  g_list_free_full (apps, g_object_unref);
 }
 
 static void
-children_changed (CcNotificationsPanel *panel,
-                  const char           *key)
+discover_apps (CcNotificationsPanel *panel)
 {
-  int i;
-  g_auto (GStrv) new_app_ids = NULL;
+  g_auto(GStrv) children = NULL;
+
+  /* Changes while it runs are picked up by running it again */
+  if (panel->discovering)
+    {
+      panel->discover_again = TRUE;
+      return;
+    }
 
   g_settings_get (panel->master_settings,
                   "application-children",
-                  "^as", &new_app_ids);
-  for (i = 0; new_app_ids[i]; i++)
-    maybe_add_app_id (panel, new_app_ids[i]);
+                  "^as", &children);
+
+  panel->discovering = TRUE;
+  cc_notifications_apps_discover ((const gchar * const *) children,
+                                  cc_panel_get_cancellable (CC_PANEL (panel)),
+                                  discover_apps_cb,
+                                  panel);
 }
 
 static void
 build_app_store (CcNotificationsPanel *panel)
 {
-  /* Build application entries for known applications */
-  children_changed (panel, NULL);
+  /* Known applications, and those that statically declare to show
+   * notifications, kept up to date as either changes */
   g_signal_connect_object (panel->master_settings,
                            "changed::application-children",
-                           G_CALLBACK (children_changed), panel, G_CONNECT_SWAPPED);
+                           G_CALLBACK (discover_apps), panel, G_CONNECT_SWAPPED);
+
+  panel->app_monitor = g_app_info_monitor_get ();
+  g_signal_connect_object (panel->app_monitor,
+                           "changed",
+                           G_CALLBACK (discover_apps), panel, G_CONNECT_SWAPPED);
 
-  /* Scan applications that statically declare to show notifications */
-  load_apps (panel);
+  discover_apps (panel);
 }
 
 static void
@@ -520,7 +526,7 @@ select_app (CcNotificationsPanel *panel,
   if (g_str_has_suffix (app_id, ".desktop"))
     app_id[strlen (app_id) - strlen (".desktop")] = '\0';
 
-  dialog = cc_app_notifications_dialog_new (app_id, g_app_info_get_name (app->app_info), app->settings, panel->master_settings, panel->perm_store);
+  dialog = cc_app_notifications_dialog_new (app_id, g_app_info_get_name (app->app_info), application_ensure_settings (app), panel->master_settings, panel->perm_store);
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (panel))));
   gtk_widget_show (GTK_WIDGET (dialog));
 }
@@ -221,35 +221,30 @@ kind_to_description (UpDeviceKind kind)
   g_assert_not_reached ();
 }
 
-CcBatteryRow*
-cc_battery_row_new (UpDevice *device,
-                    gboolean  primary)
+/* Shows the current state of the device, which must be the one the row
+ * was made for */
+void
+cc_battery_row_update (CcBatteryRow *self,
+                       UpDevice     *device)
 {
   g_autofree gchar *details = NULL;
   gdouble percentage;
-  UpDeviceKind kind;
   UpDeviceState state;
   g_autofree gchar *s = NULL;
   g_autofree gchar *icon_name = NULL;
+  g_autofree gchar *model = NULL;
   const gchar *name;
-  CcBatteryRow *self;
   guint64 time_empty, time_full, time;
-  gdouble energy_full, energy_rate;
   gboolean is_kind_battery;
   UpDeviceLevel battery_level;
 
-  self = g_object_new (CC_TYPE_BATTERY_ROW, NULL);
-
   g_object_get (device,
-                "kind", &kind,
                 "state", &state,
-                "model", &name,
+                "model", &model,
                 "percentage", &percentage,
                 "icon-name", &icon_name,
                 "time-to-empty", &time_empty,
                 "time-to-full", &time_full,
-                "energy-full", &energy_full,
-                "energy-rate", &energy_rate,
                 "battery-level", &battery_level,
                 NULL);
   if (state == UP_DEVICE_STATE_DISCHARGING)
@@ -257,7 +252,7 @@ cc_battery_row_new (UpDevice *device,
   else
     time = time_full;
 
-  is_kind_battery = (kind == UP_DEVICE_KIND_BATTERY || kind == UP_DEVICE_KIND_UPS);
+  is_kind_battery = (self->kind == UP_DEVICE_KIND_BATTERY || self->kind == UP_DEVICE_KIND_UPS);
 
   /* Name label */
   if (is_kind_battery)
@@ -267,9 +262,13 @@ cc_battery_row_new (UpDevice *device,
       else
         name = C_("Battery name", "Extra");
     }
-  else if (name == NULL || name[0] == '\0')
+  else if (model == NULL || model[0] == '\0')
+    {
+      name = _(kind_to_description (self->kind));
+    }
+  else
     {
-      name = _(kind_to_description (kind));
+      name = model;
     }
   gtk_label_set_text (self->name_label, name);
 
@@ -291,6 +290,22 @@ cc_battery_row_new (UpDevice *device,
   /* Details label (primary only) */
   details = get_details_string (percentage, state, time);
   gtk_label_set_text (self->details_label, details);
+}
+
+CcBatteryRow*
+cc_battery_row_new (UpDevice *device,
+                    gboolean  primary)
+{
+  CcBatteryRow *self;
+  UpDeviceKind kind;
+
+  self = g_object_new (CC_TYPE_BATTERY_ROW, NULL);
+
+  g_object_get (device, "kind", &kind, NULL);
+  self->kind = kind;
+  self->primary = primary;
+
+  cc_battery_row_update (self, device);
 
   /* Handle "primary" row differently */
   gtk_widget_set_visible (GTK_WIDGET (self->battery_box), !primary);
@@ -301,9 +316,6 @@ cc_battery_row_new (UpDevice *device,
                                gtk_widget_get_accessible (GTK_WIDGET (primary ? self->primary_percentage_label
                                                                               : self->percentage_label)));
 
-  self->kind = kind;
-  self->primary = primary;
-
   return self;
 }
 
@@ -31,6 +31,9 @@ G_DECLARE_FINAL_TYPE (CcBatteryRow, cc_battery_row, CC, BATTERY_ROW, GtkListBoxR
 CcBatteryRow* cc_battery_row_new                    (UpDevice *device,
                                                      gboolean  primary);
 
+void          cc_battery_row_update                  (CcBatteryRow *row,
+                                                      UpDevice     *device);
+
 void          cc_battery_row_set_level_sizegroup     (CcBatteryRow *row,
                                                       GtkSizeGroup *sizegroup);
 
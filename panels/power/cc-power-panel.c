@@ -36,6 +36,7 @@
 #include "cc-brightness-scale.h"
 #include "cc-power-profile-row.h"
 #include "cc-power-panel.h"
+#include "cc-power-probes.h"
 #include "cc-power-resources.h"
 #include "cc-util.h"
 
@@ -119,8 +120,16 @@ struct _CcPowerPanel
   GSettings     *interface_settings;
   UpClient      *up_client;
   GPtrArray     *devices;
+  UpDevice      *composite;
+  GHashTable    *battery_rows;
+  GHashTable    *pending_updates;
+  gboolean       rebuild_pending;
+  guint          update_tick_id;
   gboolean       has_batteries;
   char          *chassis_type;
+  gboolean       can_suspend;
+  gboolean       can_hibernate;
+  guint          general_probes_pending;
 
   GList         *boxes;
   GList         *boxes_reverse;
@@ -161,11 +170,18 @@ cc_power_panel_dispose (GObject *object)
   g_clear_object (&self->session_settings);
   g_clear_object (&self->interface_settings);
   g_clear_pointer ((GtkWidget **) &self->automatic_suspend_dialog, gtk_widget_destroy);
+  if (self->update_tick_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->update_tick_id);
+  self->update_tick_id = 0;
+  g_clear_pointer (&self->pending_updates, g_hash_table_unref);
+  g_clear_pointer (&self->battery_rows, g_hash_table_unref);
   g_clear_pointer (&self->devices, g_ptr_array_unref);
+  g_clear_object (&self->composite);
   g_clear_object (&self->up_client);
   g_clear_object (&self->bt_rfkill);
   g_clear_object (&self->bt_properties);
   g_clear_object (&self->iio_proxy);
+  g_clear_object (&self->power_profiles_proxy);
 #ifdef HAVE_NETWORK_MANAGER
   g_clear_object (&self->nm_client);
 #endif
@@ -184,48 +200,6 @@ cc_power_panel_get_help_uri (CcPanel *panel)
   return "help:gnome-help/power";
 }
 
-static char *
-get_chassis_type (GCancellable *cancellable)
-{
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GVariant) inner = NULL;
-  g_autoptr(GVariant) variant = NULL;
-  g_autoptr(GDBusConnection) connection = NULL;
-
-  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM,
-                               cancellable,
-                               &error);
-  if (!connection)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("system bus not available: %s", error->message);
-      return NULL;
-    }
-
-  variant = g_dbus_connection_call_sync (connection,
-                                         "org.freedesktop.hostname1",
-                                         "/org/freedesktop/hostname1",
-                                         "org.freedesktop.DBus.Properties",
-                                         "Get",
-                                         g_variant_new ("(ss)",
-                                                        "org.freedesktop.hostname1",
-                                                        "Chassis"),
-                                         NULL,
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1,
-                                         cancellable,
-                                         &error);
-  if (!variant)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_debug ("Failed to get property '%s': %s", "Chassis", error->message);
-      return NULL;
-    }
-
-  g_variant_get (variant, "(v)", &inner);
-  return g_variant_dup_string (inner, NULL);
-}
-
 static void
 load_custom_css (CcPowerPanel *self,
                  const char   *path)
@@ -244,6 +218,12 @@ static void
 add_battery (CcPowerPanel *panel, UpDevice *device, gboolean primary)
 {
   CcBatteryRow *row = cc_battery_row_new (device, primary);
+  const gchar *object_path = up_device_get_object_path (device);
+
+  /* the fake test devices aren't on the bus, and never change */
+  if (object_path != NULL)
+    g_hash_table_insert (panel->battery_rows, g_strdup (object_path), row);
+
   cc_battery_row_set_level_sizegroup (row, panel->level_sizegroup);
   cc_battery_row_set_row_sizegroup (row, panel->battery_row_sizegroup);
   cc_battery_row_set_charge_sizegroup (row, panel->charge_sizegroup);
@@ -257,6 +237,11 @@ static void
 add_device (CcPowerPanel *self, UpDevice *device)
 {
   CcBatteryRow *row = cc_battery_row_new (device, FALSE);
+  const gchar *object_path = up_device_get_object_path (device);
+
+  if (object_path != NULL)
+    g_hash_table_insert (self->battery_rows, g_strdup (object_path), row);
+
   cc_battery_row_set_level_sizegroup (row, self->level_sizegroup);
   cc_battery_row_set_row_sizegroup (row, self->row_sizegroup);
   cc_battery_row_set_charge_sizegroup (row, self->charge_sizegroup);
@@ -266,8 +251,9 @@ add_device (CcPowerPanel *self, UpDevice *device)
   gtk_widget_set_visible (GTK_WIDGET (self->device_section), TRUE);
 }
 
+/* Puts every device back in the right list, the rows are made again */
 static void
-up_client_changed (CcPowerPanel *self)
+rebuild_battery_rows (CcPowerPanel *self)
 {
   g_autoptr(GList) battery_children = NULL;
   g_autoptr(GList) device_children = NULL;
@@ -276,9 +262,13 @@ up_client_changed (CcPowerPanel *self)
   UpDeviceKind kind;
   guint n_batteries;
   gboolean on_ups;
-  g_autoptr(UpDevice) composite = NULL;
+  UpDevice *composite;
   g_autofree gchar *s = NULL;
 
+  g_hash_table_remove_all (self->battery_rows);
+  g_hash_table_remove_all (self->pending_updates);
+  self->rebuild_pending = FALSE;
+
   battery_children = gtk_container_get_children (GTK_CONTAINER (self->battery_listbox));
   for (l = battery_children; l != NULL; l = l->next)
     gtk_container_remove (GTK_CONTAINER (self->battery_listbox), l->data);
@@ -375,7 +365,7 @@ up_client_changed (CcPowerPanel *self)
 
   on_ups = FALSE;
   n_batteries = 0;
-  composite = up_client_get_display_device (self->up_client);
+  composite = self->composite;
   g_object_get (composite, "kind", &kind, NULL);
   if (kind == UP_DEVICE_KIND_UPS)
     {
@@ -447,6 +437,90 @@ up_client_changed (CcPowerPanel *self)
     }
 }
 
+static gboolean
+update_battery_rows_cb (GtkWidget     *widget,
+                        GdkFrameClock *frame_clock,
+                        gpointer       user_data)
+{
+  CcPowerPanel *self = CC_POWER_PANEL (widget);
+  GHashTableIter iter;
+  UpDevice *device;
+
+  self->update_tick_id = 0;
+
+  if (self->rebuild_pending)
+    {
+      rebuild_battery_rows (self);
+      return G_SOURCE_REMOVE;
+    }
+
+  g_hash_table_iter_init (&iter, self->pending_updates);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &device, NULL))
+    {
+      CcBatteryRow *row;
+
+      row = g_hash_table_lookup (self->battery_rows, up_device_get_object_path (device));
+      if (row != NULL)
+        cc_battery_row_update (row, device);
+    }
+  g_hash_table_remove_all (self->pending_updates);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Changes are applied once per frame, however many there were */
+static void
+queue_battery_rows_update (CcPowerPanel *self)
+{
+  if (self->update_tick_id == 0)
+    self->update_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                         update_battery_rows_cb,
+                                                         NULL, NULL);
+}
+
+static void
+queue_battery_rows_rebuild (CcPowerPanel *self)
+{
+  self->rebuild_pending = TRUE;
+  queue_battery_rows_update (self);
+}
+
+static void
+device_notify_cb (UpDevice     *device,
+                  GParamSpec   *pspec,
+                  CcPowerPanel *self)
+{
+  const gchar *name = g_param_spec_get_name (pspec);
+
+  /* these decide which list the device goes in, and how it's shown */
+  if (g_str_equal (name, "kind") || g_str_equal (name, "power-supply"))
+    {
+      queue_battery_rows_rebuild (self);
+      return;
+    }
+
+  /* only what the rows show, UPower updates the energy figures all the time */
+  if (g_str_equal (name, "state") ||
+      g_str_equal (name, "model") ||
+      g_str_equal (name, "percentage") ||
+      g_str_equal (name, "icon-name") ||
+      g_str_equal (name, "time-to-empty") ||
+      g_str_equal (name, "time-to-full") ||
+      g_str_equal (name, "battery-level"))
+    {
+      g_hash_table_add (self->pending_updates, g_object_ref (device));
+      queue_battery_rows_update (self);
+    }
+}
+
+static void
+watch_device (CcPowerPanel *self,
+              UpDevice     *device)
+{
+  g_signal_connect_object (device, "notify",
+                           G_CALLBACK (device_notify_cb), self, 0);
+}
+
 static void
 up_client_device_removed (CcPowerPanel *self,
                           const char   *object_path)
@@ -462,12 +536,13 @@ up_client_device_removed (CcPowerPanel *self,
 
       if (g_strcmp0 (object_path, up_device_get_object_path (device)) == 0)
         {
+          g_signal_handlers_disconnect_by_data (device, self);
           g_ptr_array_remove_index (self->devices, i);
           break;
         }
     }
 
-  up_client_changed (self);
+  queue_battery_rows_rebuild (self);
 }
 
 static void
@@ -475,9 +550,8 @@ up_client_device_added (CcPowerPanel *self,
                         UpDevice     *device)
 {
   g_ptr_array_add (self->devices, g_object_ref (device));
-  g_signal_connect_object (G_OBJECT (device), "notify",
-                           G_CALLBACK (up_client_changed), self, G_CONNECT_SWAPPED);
-  up_client_changed (self);
+  watch_device (self, device);
+  queue_battery_rows_rebuild (self);
 }
 
 static void
@@ -499,11 +573,7 @@ als_enabled_state_changed (CcPowerPanel *self)
   has_brightness = cc_brightness_scale_get_has_brightness (self->brightness_scale);
 
   if (self->iio_proxy != NULL)
-    {
-      g_autoptr(GVariant) v = g_dbus_proxy_get_cached_property (self->iio_proxy, "HasAmbientLight");
-      if (v != NULL)
-        visible = g_variant_get_boolean (v);
-    }
+    visible = cc_power_probe_get_ambient_light (self->iio_proxy);
 
   enabled = g_settings_get_boolean (self->gsd_settings, "ambient-enabled");
   g_debug ("ALS enabled: %s", enabled ? "on" : "off");
@@ -590,19 +660,15 @@ static void
 set_ac_battery_ui_mode (CcPowerPanel *self)
 {
   gboolean has_batteries = FALSE;
-  GPtrArray *devices;
   guint i;
 
-  devices = up_client_get_devices2 (self->up_client);
-  g_debug ("got %d devices from upower\n", devices ? devices->len : 0);
-
-  for (i = 0; devices != NULL && i < devices->len; i++)
+  for (i = 0; i < self->devices->len; i++)
     {
       UpDevice *device;
       gboolean is_power_supply;
       UpDeviceKind kind;
 
-      device = g_ptr_array_index (devices, i);
+      device = g_ptr_array_index (self->devices, i);
       g_object_get (device,
                     "kind", &kind,
                     "power-supply", &is_power_supply,
@@ -614,7 +680,6 @@ set_ac_battery_ui_mode (CcPowerPanel *self)
           break;
         }
     }
-  g_clear_pointer (&devices, g_ptr_array_unref);
 
 #ifdef TEST_NO_BATTERIES
   g_print ("forcing no batteries\n");
@@ -637,6 +702,9 @@ static void
 bt_set_powered (CcPowerPanel *self,
                 gboolean      powered)
 {
+  if (!self->bt_properties)
+    return;
+
   g_dbus_proxy_call (self->bt_properties,
 		     "Set",
 		     g_variant_new_parsed ("('org.gnome.SettingsDaemon.Rfkill', 'BluetoothAirplaneMode', %v)",
@@ -662,23 +730,15 @@ bt_switch_changed_cb (CcPowerPanel *self)
 static void
 bt_powered_state_changed (CcPowerPanel *self)
 {
-  gboolean powered, has_airplane_mode;
-  g_autoptr(GVariant) v1 = NULL;
-  g_autoptr(GVariant) v2 = NULL;
-
-  v1 = g_dbus_proxy_get_cached_property (self->bt_rfkill, "BluetoothHasAirplaneMode");
-  has_airplane_mode = g_variant_get_boolean (v1);
+  gboolean powered;
 
-  if (!has_airplane_mode)
+  if (!cc_power_probe_get_bluetooth (self->bt_rfkill, &powered))
     {
       g_debug ("BluetoothHasAirplaneMode is false, hiding Bluetooth power row");
       gtk_widget_hide (GTK_WIDGET (self->bt_row));
       return;
     }
 
-  v2 = g_dbus_proxy_get_cached_property (self->bt_rfkill, "BluetoothAirplaneMode");
-  powered = !g_variant_get_boolean (v2);
-
   g_debug ("bt powered state changed to %s", powered ? "on" : "off");
 
   gtk_widget_show (GTK_WIDGET (self->bt_row));
@@ -688,6 +748,55 @@ bt_powered_state_changed (CcPowerPanel *self)
   g_signal_handlers_unblock_by_func (self->bt_switch, bt_switch_changed_cb, self);
 }
 
+#ifdef HAVE_BLUETOOTH
+static void
+bt_rfkill_proxy_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  CcPowerPanel *self;
+  g_autoptr(GError) error = NULL;
+  GDBusProxy *proxy;
+
+  proxy = cc_object_storage_create_dbus_proxy_finish (res, &error);
+  if (!proxy)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not create Rfkill proxy: %s", error->message);
+      return;
+    }
+
+  self = CC_POWER_PANEL (user_data);
+  self->bt_rfkill = proxy;
+
+  g_signal_connect_object (self->bt_rfkill, "g-properties-changed",
+                           G_CALLBACK (bt_powered_state_changed), self, G_CONNECT_SWAPPED);
+
+  bt_powered_state_changed (self);
+}
+
+static void
+bt_properties_proxy_cb (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  CcPowerPanel *self;
+  g_autoptr(GError) error = NULL;
+  GDBusProxy *proxy;
+
+  proxy = cc_object_storage_create_dbus_proxy_finish (res, &error);
+  if (!proxy)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not create Rfkill properties proxy: %s", error->message);
+      return;
+    }
+
+  self = CC_POWER_PANEL (user_data);
+  self->bt_properties = proxy;
+}
+#endif
+
 #ifdef HAVE_NETWORK_MANAGER
 static gboolean
 has_wifi_devices (NMClient *client)
@@ -978,34 +1087,51 @@ als_enabled_setting_changed (CcPowerPanel *self)
 }
 
 static void
-iio_proxy_appeared_cb (GDBusConnection *connection,
-                       const gchar *name,
-                       const gchar *name_owner,
-                       gpointer user_data)
+iio_proxy_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
 {
-  CcPowerPanel *self = CC_POWER_PANEL (user_data);
+  CcPowerPanel *self;
   g_autoptr(GError) error = NULL;
+  GDBusProxy *proxy;
 
-  self->iio_proxy =
-    cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SYSTEM,
-                                              G_DBUS_PROXY_FLAGS_NONE,
-                                              "net.hadess.SensorProxy",
-                                              "/net/hadess/SensorProxy",
-                                              "net.hadess.SensorProxy",
-                                              NULL, &error);
-  if (error != NULL)
+  proxy = cc_object_storage_create_dbus_proxy_finish (res, &error);
+  if (!proxy)
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         g_warning ("Could not create IIO sensor proxy: %s", error->message);
       return;
     }
 
+  self = CC_POWER_PANEL (user_data);
+
+  g_clear_object (&self->iio_proxy);
+  self->iio_proxy = proxy;
+
   g_signal_connect_object (G_OBJECT (self->iio_proxy), "g-properties-changed",
                            G_CALLBACK (als_enabled_state_changed), self,
                            G_CONNECT_SWAPPED);
   als_enabled_state_changed (self);
 }
 
+static void
+iio_proxy_appeared_cb (GDBusConnection *connection,
+                       const gchar *name,
+                       const gchar *name_owner,
+                       gpointer user_data)
+{
+  CcPowerPanel *self = CC_POWER_PANEL (user_data);
+
+  cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SYSTEM,
+                                       G_DBUS_PROXY_FLAGS_NONE,
+                                       "net.hadess.SensorProxy",
+                                       "/net/hadess/SensorProxy",
+                                       "net.hadess.SensorProxy",
+                                       cc_panel_get_cancellable (CC_PANEL (self)),
+                                       iio_proxy_cb,
+                                       self);
+}
+
 static void
 iio_proxy_vanished_cb (GDBusConnection *connection,
                        const gchar *name,
@@ -1160,48 +1286,6 @@ on_suspend_settings_changed (CcPowerPanel *self,
     }
 }
 
-static gboolean
-can_suspend_or_hibernate (CcPowerPanel *self,
-                          const char   *method_name)
-{
-  g_autoptr(GDBusConnection) connection = NULL;
-  g_autoptr(GVariant) variant = NULL;
-  g_autoptr(GError) error = NULL;
-  const char *s;
-
-  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM,
-                               cc_panel_get_cancellable (CC_PANEL (self)),
-                               &error);
-  if (!connection)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("system bus not available: %s", error->message);
-      return FALSE;
-    }
-
-  variant = g_dbus_connection_call_sync (connection,
-                                         "org.freedesktop.login1",
-                                         "/org/freedesktop/login1",
-                                         "org.freedesktop.login1.Manager",
-                                         method_name,
-                                         NULL,
-                                         NULL,
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1,
-                                         cc_panel_get_cancellable (CC_PANEL (self)),
-                                         &error);
-
-  if (!variant)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_debug ("Failed to call %s(): %s", method_name, error->message);
-      return FALSE;
-    }
-
-  g_variant_get (variant, "(&s)", &s);
-  return g_strcmp0 (s, "yes") == 0;
-}
-
 static void
 has_brightness_cb (CcPowerPanel *self)
 {
@@ -1228,6 +1312,46 @@ has_kbd_brightness_cb (CcPowerPanel *self,
   gtk_widget_set_visible (GTK_WIDGET (self->kbd_brightness_row), has_brightness);
 }
 
+static void
+setup_automatic_suspend (CcPowerPanel *self)
+{
+  int value;
+
+  gtk_widget_show (GTK_WIDGET (self->automatic_suspend_row));
+  atk_object_set_name (ATK_OBJECT (gtk_widget_get_accessible (GTK_WIDGET (self->automatic_suspend_row))), _("Automatic suspend"));
+
+  g_signal_connect (self->automatic_suspend_dialog, "delete-event", G_CALLBACK (gtk_widget_hide_on_delete), NULL);
+  g_signal_connect_object (self->gsd_settings, "changed", G_CALLBACK (on_suspend_settings_changed), self, G_CONNECT_SWAPPED);
+
+  g_settings_bind_with_mapping (self->gsd_settings, "sleep-inactive-battery-type",
+                                self->suspend_on_battery_switch, "active",
+                                G_SETTINGS_BIND_DEFAULT,
+                                get_sleep_type, set_sleep_type, NULL, NULL);
+
+  g_object_set_data (G_OBJECT (self->suspend_on_battery_delay_combo), "_gsettings_key", "sleep-inactive-battery-timeout");
+  value = g_settings_get_int (self->gsd_settings, "sleep-inactive-battery-timeout");
+  set_value_for_combo (self->suspend_on_battery_delay_combo, value);
+  g_signal_connect_object (self->suspend_on_battery_delay_combo, "changed",
+                           G_CALLBACK (combo_time_changed_cb), self, G_CONNECT_SWAPPED);
+  g_object_bind_property (self->suspend_on_battery_switch, "active", self->suspend_on_battery_delay_combo, "sensitive",
+                          G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
+
+  g_settings_bind_with_mapping (self->gsd_settings, "sleep-inactive-ac-type",
+                                self->suspend_on_ac_switch, "active",
+                                G_SETTINGS_BIND_DEFAULT,
+                                get_sleep_type, set_sleep_type, NULL, NULL);
+
+  g_object_set_data (G_OBJECT (self->suspend_on_ac_delay_combo), "_gsettings_key", "sleep-inactive-ac-timeout");
+  value = g_settings_get_int (self->gsd_settings, "sleep-inactive-ac-timeout");
+  set_value_for_combo (self->suspend_on_ac_delay_combo, value);
+  g_signal_connect_object (self->suspend_on_ac_delay_combo, "changed",
+                           G_CALLBACK (combo_time_changed_cb), self, G_CONNECT_SWAPPED);
+  g_object_bind_property (self->suspend_on_ac_switch, "active", self->suspend_on_ac_delay_combo, "sensitive",
+                          G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
+
+  update_automatic_suspend_label (self);
+}
+
 static void
 setup_power_saving (CcPowerPanel *self)
 {
@@ -1270,45 +1394,6 @@ setup_power_saving (CcPowerPanel *self)
       g_settings_set_int (self->gsd_settings, "sleep-inactive-battery-timeout", 1800);
     }
 
-  /* Automatic suspend row */
-  if (can_suspend_or_hibernate (self, "CanSuspend"))
-    {
-      gtk_widget_show (GTK_WIDGET (self->automatic_suspend_row));
-      atk_object_set_name (ATK_OBJECT (gtk_widget_get_accessible (GTK_WIDGET (self->automatic_suspend_row))), _("Automatic suspend"));
-
-      g_signal_connect (self->automatic_suspend_dialog, "delete-event", G_CALLBACK (gtk_widget_hide_on_delete), NULL);
-      g_signal_connect_object (self->gsd_settings, "changed", G_CALLBACK (on_suspend_settings_changed), self, G_CONNECT_SWAPPED);
-
-      g_settings_bind_with_mapping (self->gsd_settings, "sleep-inactive-battery-type",
-                                    self->suspend_on_battery_switch, "active",
-                                    G_SETTINGS_BIND_DEFAULT,
-                                    get_sleep_type, set_sleep_type, NULL, NULL);
-
-      g_object_set_data (G_OBJECT (self->suspend_on_battery_delay_combo), "_gsettings_key", "sleep-inactive-battery-timeout");
-      value = g_settings_get_int (self->gsd_settings, "sleep-inactive-battery-timeout");
-      set_value_for_combo (self->suspend_on_battery_delay_combo, value);
-      g_signal_connect_object (self->suspend_on_battery_delay_combo, "changed",
-                               G_CALLBACK (combo_time_changed_cb), self, G_CONNECT_SWAPPED);
-      g_object_bind_property (self->suspend_on_battery_switch, "active", self->suspend_on_battery_delay_combo, "sensitive",
-                              G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
-
-      g_settings_bind_with_mapping (self->gsd_settings, "sleep-inactive-ac-type",
-                                    self->suspend_on_ac_switch, "active",
-                                    G_SETTINGS_BIND_DEFAULT,
-                                    get_sleep_type, set_sleep_type, NULL, NULL);
-
-      g_object_set_data (G_OBJECT (self->suspend_on_ac_delay_combo), "_gsettings_key", "sleep-inactive-ac-timeout");
-      value = g_settings_get_int (self->gsd_settings, "sleep-inactive-ac-timeout");
-      set_value_for_combo (self->suspend_on_ac_delay_combo, value);
-      g_signal_connect_object (self->suspend_on_ac_delay_combo, "changed",
-                               G_CALLBACK (combo_time_changed_cb), self, G_CONNECT_SWAPPED);
-      g_object_bind_property (self->suspend_on_ac_switch, "active", self->suspend_on_ac_delay_combo, "sensitive",
-                              G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
-
-      set_ac_battery_ui_mode (self);
-      update_automatic_suspend_label (self);
-    }
-
 #ifdef HAVE_NETWORK_MANAGER
   /* Create and store a NMClient instance if it doesn't exist yet */
   if (cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
@@ -1318,29 +1403,22 @@ setup_power_saving (CcPowerPanel *self)
 #endif
 
 #ifdef HAVE_BLUETOOTH
-  self->bt_rfkill = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SESSION,
-                                                              G_DBUS_PROXY_FLAGS_NONE,
-                                                              "org.gnome.SettingsDaemon.Rfkill",
-                                                              "/org/gnome/SettingsDaemon/Rfkill",
-                                                              "org.gnome.SettingsDaemon.Rfkill",
-                                                              NULL,
-                                                              NULL);
-
-  if (self->bt_rfkill)
-    {
-      self->bt_properties = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SESSION,
-                                                                      G_DBUS_PROXY_FLAGS_NONE,
-                                                                      "org.gnome.SettingsDaemon.Rfkill",
-                                                                      "/org/gnome/SettingsDaemon/Rfkill",
-                                                                      "org.freedesktop.DBus.Properties",
-                                                                      NULL,
-                                                                      NULL);
-    }
-
-  g_signal_connect_object (self->bt_rfkill, "g-properties-changed",
-                           G_CALLBACK (bt_powered_state_changed), self, G_CONNECT_SWAPPED);
-
-  bt_powered_state_changed (self);
+  cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SESSION,
+                                       G_DBUS_PROXY_FLAGS_NONE,
+                                       "org.gnome.SettingsDaemon.Rfkill",
+                                       "/org/gnome/SettingsDaemon/Rfkill",
+                                       "org.gnome.SettingsDaemon.Rfkill",
+                                       cc_panel_get_cancellable (CC_PANEL (self)),
+                                       bt_rfkill_proxy_cb,
+                                       self);
+  cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SESSION,
+                                       G_DBUS_PROXY_FLAGS_NONE,
+                                       "org.gnome.SettingsDaemon.Rfkill",
+                                       "/org/gnome/SettingsDaemon/Rfkill",
+                                       "org.freedesktop.DBus.Properties",
+                                       cc_panel_get_cancellable (CC_PANEL (self)),
+                                       bt_properties_proxy_cb,
+                                       self);
 #endif
 }
 
@@ -1395,18 +1473,6 @@ perf_profile_list_box_sort (GtkListBoxRow *row1,
   return 0;
 }
 
-static const char *
-variant_lookup_string (GVariant   *dict,
-                       const char *key)
-{
-  GVariant *variant;
-
-  variant = g_variant_lookup_value (dict, key, G_VARIANT_TYPE_STRING);
-  if (!variant)
-    return NULL;
-  return g_variant_get_string (variant, NULL);
-}
-
 static void
 power_profiles_properties_changed_cb (CcPowerPanel *self,
                                       GVariant   *changed_properties,
@@ -1461,8 +1527,6 @@ power_profile_button_toggled_cb (CcPowerProfileRow *row,
 {
   CcPowerPanel *self = user_data;
   CcPowerProfile profile;
-  g_autoptr(GDBusConnection) connection = NULL;
-  g_autoptr(GError) error = NULL;
 
   if (!cc_power_profile_row_get_active (row))
     return;
@@ -1471,17 +1535,7 @@ power_profile_button_toggled_cb (CcPowerProfileRow *row,
 
   profile = cc_power_profile_row_get_profile (row);
 
-  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM,
-                               cc_panel_get_cancellable (CC_PANEL (self)),
-                               &error);
-  if (!connection)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("system bus not available: %s", error->message);
-      return;
-    }
-
-  g_dbus_connection_call (connection,
+  g_dbus_connection_call (g_dbus_proxy_get_connection (self->power_profiles_proxy),
                           "net.hadess.PowerProfiles",
                           "/net/hadess/PowerProfiles",
                           "org.freedesktop.DBus.Properties",
@@ -1499,95 +1553,58 @@ power_profile_button_toggled_cb (CcPowerProfileRow *row,
 }
 
 static void
-setup_power_profiles (CcPowerPanel *self)
+power_profiles_proxy_cb (GObject      *source_object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
 {
-  g_autoptr(GDBusConnection) connection = NULL;
-  g_autoptr(GVariant) variant = NULL;
-  g_autoptr(GVariant) props = NULL;
-  guint i, num_children;
+  CcPowerPanel *self;
+  g_autoptr(GDBusProxy) proxy = NULL;
   g_autoptr(GError) error = NULL;
+  g_auto(GStrv) profiles = NULL;
+  guint i;
   const char *performance_inhibited;
   const char *active_profile;
-  g_autoptr(GVariant) profiles = NULL;
+  g_autoptr(GVariant) performance_inhibited_variant = NULL;
+  g_autoptr(GVariant) active_profile_variant = NULL;
   GtkRadioButton *last_button;
 
-  self->power_profiles_proxy = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SYSTEM,
-                                                                         G_DBUS_PROXY_FLAGS_NONE,
-                                                                         "net.hadess.PowerProfiles",
-                                                                         "/net/hadess/PowerProfiles",
-                                                                         "net.hadess.PowerProfiles",
-                                                                         NULL,
-                                                                         &error);
-
-  if (!self->power_profiles_proxy)
-    {
-      g_debug ("Could not create Power Profiles proxy: %s", error->message);
-      return;
-    }
-
-  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM,
-                               cc_panel_get_cancellable (CC_PANEL (self)),
-                               &error);
-  if (!connection)
+  proxy = cc_object_storage_create_dbus_proxy_finish (res, &error);
+  if (!proxy)
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("system bus not available: %s", error->message);
+        g_debug ("Could not create Power Profiles proxy: %s", error->message);
       return;
     }
 
-  variant = g_dbus_connection_call_sync (connection,
-                                         "net.hadess.PowerProfiles",
-                                         "/net/hadess/PowerProfiles",
-                                         "org.freedesktop.DBus.Properties",
-                                         "GetAll",
-                                         g_variant_new ("(s)",
-                                                        "net.hadess.PowerProfiles"),
-                                         NULL,
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1,
-                                         NULL,
-                                         &error);
+  self = CC_POWER_PANEL (user_data);
 
-  if (!variant)
+  profiles = cc_power_probe_get_power_profiles (proxy);
+  if (!profiles)
     {
-      g_debug ("Failed to get properties for Power Profiles: %s",
-               error->message);
-      g_clear_object (&self->power_profiles_proxy);
+      g_debug ("Power Profiles daemon is not available");
       return;
     }
 
-  gtk_widget_show (GTK_WIDGET (self->power_profile_section));
+  self->power_profiles_proxy = g_steal_pointer (&proxy);
 
-  self->boxes_reverse = g_list_prepend (self->boxes_reverse, self->power_profile_listbox);
+  gtk_widget_show (GTK_WIDGET (self->power_profile_section));
 
-  props = g_variant_get_child_value (variant, 0);
-  performance_inhibited = variant_lookup_string (props, "PerformanceInhibited");
-  active_profile = variant_lookup_string (props, "ActiveProfile");
+  performance_inhibited_variant = g_dbus_proxy_get_cached_property (self->power_profiles_proxy, "PerformanceInhibited");
+  performance_inhibited = performance_inhibited_variant ? g_variant_get_string (performance_inhibited_variant, NULL) : NULL;
+  active_profile_variant = g_dbus_proxy_get_cached_property (self->power_profiles_proxy, "ActiveProfile");
+  active_profile = active_profile_variant ? g_variant_get_string (active_profile_variant, NULL) : NULL;
 
   last_button = NULL;
-  profiles = g_variant_lookup_value (props, "Profiles", NULL);
-  num_children = g_variant_n_children (profiles);
-  for (i = 0; i < num_children; i++)
+  for (i = 0; profiles[i] != NULL; i++)
     {
-      g_autoptr(GVariant) profile_variant;
-      const char *name;
       GtkRadioButton *button;
       CcPowerProfile profile;
       CcPowerProfileRow *row;
 
-      profile_variant = g_variant_get_child_value (profiles, i);
-      if (!profile_variant ||
-          !g_variant_is_of_type (profile_variant, G_VARIANT_TYPE ("a{sv}")))
-        continue;
+      g_debug ("Adding row for profile '%s'", profiles[i]);
 
-      name = variant_lookup_string (profile_variant, "Profile");
-      if (!name)
-        continue;
-      g_debug ("Adding row for profile '%s' (driver: %s)",
-               name, variant_lookup_string (profile_variant, "Driver"));
-
-      profile = cc_power_profile_from_str (name);
-      row = cc_power_profile_row_new (cc_power_profile_from_str (name));
+      profile = cc_power_profile_from_str (profiles[i]);
+      row = cc_power_profile_row_new (profile);
       cc_power_profile_row_set_performance_inhibited (row, performance_inhibited);
       g_signal_connect_object (G_OBJECT (row), "button-toggled",
                                G_CALLBACK (power_profile_button_toggled_cb), self,
@@ -1612,28 +1629,126 @@ setup_power_profiles (CcPowerPanel *self)
 }
 
 static void
-setup_general_section (CcPowerPanel *self)
+setup_power_profiles (CcPowerPanel *self)
+{
+  cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SYSTEM,
+                                       G_DBUS_PROXY_FLAGS_NONE,
+                                       "net.hadess.PowerProfiles",
+                                       "/net/hadess/PowerProfiles",
+                                       "net.hadess.PowerProfiles",
+                                       cc_panel_get_cancellable (CC_PANEL (self)),
+                                       power_profiles_proxy_cb,
+                                       self);
+}
+
+static void
+setup_power_button (CcPowerPanel *self)
+{
+  if ((!self->can_hibernate && !self->can_suspend) ||
+      g_strcmp0 (self->chassis_type, "vm") == 0 ||
+      g_strcmp0 (self->chassis_type, "tablet") == 0 ||
+      g_strcmp0 (self->chassis_type, "handset") == 0)
+    return;
+
+  gtk_widget_show (GTK_WIDGET (self->power_button_row));
+
+  populate_power_button_model (GTK_TREE_MODEL (self->power_button_liststore), self->can_suspend, self->can_hibernate);
+  g_signal_handlers_block_by_func (self->power_button_combo, power_button_combo_changed_cb, self);
+  set_value_for_combo (self->power_button_combo, g_settings_get_enum (self->gsd_settings, "power-button-action"));
+  g_signal_handlers_unblock_by_func (self->power_button_combo, power_button_combo_changed_cb, self);
+
+  gtk_widget_show (GTK_WIDGET (self->general_section));
+}
+
+/* The power button row needs all of the chassis type, CanSuspend
+ * and CanHibernate, whichever order they come back in */
+static void
+general_probe_done (CcPowerPanel *self)
+{
+  g_assert (self->general_probes_pending > 0);
+
+  if (--self->general_probes_pending == 0)
+    setup_power_button (self);
+}
+
+static void
+chassis_type_cb (GObject      *source_object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
 {
-  gboolean can_suspend, can_hibernate, show_section = FALSE;
+  CcPowerPanel *self;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *chassis_type = NULL;
 
-  can_suspend = can_suspend_or_hibernate (self, "CanSuspend");
-  can_hibernate = can_suspend_or_hibernate (self, "CanHibernate");
+  chassis_type = cc_power_probe_chassis_type_finish (res, &error);
+  if (error != NULL)
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_debug ("Failed to get property '%s': %s", "Chassis", error->message);
+    }
+
+  /* Only cast the parameters after making sure it wasn't cancelled */
+  self = CC_POWER_PANEL (user_data);
+  self->chassis_type = g_steal_pointer (&chassis_type);
+
+  general_probe_done (self);
+}
+
+static void
+can_suspend_cb (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  CcPowerPanel *self;
+  g_autoptr(GError) error = NULL;
+  gboolean can_suspend;
 
-  if ((can_hibernate || can_suspend) &&
-      g_strcmp0 (self->chassis_type, "vm") != 0 &&
-      g_strcmp0 (self->chassis_type, "tablet") != 0 &&
-      g_strcmp0 (self->chassis_type, "handset") != 0)
+  can_suspend = cc_power_probe_logind_can_finish (res, &error);
+  if (error != NULL)
     {
-      gtk_widget_show (GTK_WIDGET (self->power_button_row));
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_debug ("Failed to call %s(): %s", "CanSuspend", error->message);
+    }
+
+  self = CC_POWER_PANEL (user_data);
+  self->can_suspend = can_suspend;
 
-      populate_power_button_model (GTK_TREE_MODEL (self->power_button_liststore), can_suspend, can_hibernate);
-      g_signal_handlers_block_by_func (self->power_button_combo, power_button_combo_changed_cb, self);
-      set_value_for_combo (self->power_button_combo, g_settings_get_enum (self->gsd_settings, "power-button-action"));
-      g_signal_handlers_unblock_by_func (self->power_button_combo, power_button_combo_changed_cb, self);
+  if (can_suspend)
+    setup_automatic_suspend (self);
 
-      show_section = TRUE;
+  general_probe_done (self);
+}
+
+static void
+can_hibernate_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  CcPowerPanel *self;
+  g_autoptr(GError) error = NULL;
+  gboolean can_hibernate;
+
+  can_hibernate = cc_power_probe_logind_can_finish (res, &error);
+  if (error != NULL)
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_debug ("Failed to call %s(): %s", "CanHibernate", error->message);
     }
 
+  self = CC_POWER_PANEL (user_data);
+  self->can_hibernate = can_hibernate;
+
+  general_probe_done (self);
+}
+
+static void
+setup_general_section (CcPowerPanel *self)
+{
+  GCancellable *cancellable = cc_panel_get_cancellable (CC_PANEL (self));
+
   if (self->has_batteries)
     {
       gtk_widget_show (GTK_WIDGET (self->battery_percentage_row));
@@ -1641,11 +1756,15 @@ setup_general_section (CcPowerPanel *self)
       g_settings_bind (self->interface_settings, "show-battery-percentage",
                        self->battery_percentage_switch, "active",
                        G_SETTINGS_BIND_DEFAULT);
-
-      show_section = TRUE;
     }
 
-  gtk_widget_set_visible (GTK_WIDGET (self->general_section), show_section);
+  /* The power button row shows the section later on if needed */
+  gtk_widget_set_visible (GTK_WIDGET (self->general_section), self->has_batteries);
+
+  self->general_probes_pending = 3;
+  cc_power_probe_chassis_type (cancellable, chassis_type_cb, self);
+  cc_power_probe_logind_can ("CanSuspend", cancellable, can_suspend_cb, self);
+  cc_power_probe_logind_can ("CanHibernate", cancellable, can_hibernate_cb, self);
 }
 
 static gint
@@ -1768,9 +1887,16 @@ cc_power_panel_init (CcPowerPanel *self)
   load_custom_css (self, "/org/gnome/control-center/power/battery-levels.css");
   load_custom_css (self, "/org/gnome/control-center/power/power-profiles.css");
 
-  self->chassis_type = get_chassis_type (cc_panel_get_cancellable (CC_PANEL (self)));
-
   self->up_client = up_client_new ();
+  self->battery_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->pending_updates = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  self->composite = up_client_get_display_device (self->up_client);
+  self->devices = up_client_get_devices2 (self->up_client);
+  if (self->devices == NULL)
+    self->devices = g_ptr_array_new_with_free_func (g_object_unref);
+  g_debug ("got %d devices from upower\n", self->devices->len);
+  set_ac_battery_ui_mode (self);
 
   self->gsd_settings = g_settings_new ("org.gnome.settings-daemon.plugins.power");
   self->session_settings = g_settings_new ("org.gnome.desktop.session");
@@ -1804,6 +1930,7 @@ cc_power_panel_init (CcPowerPanel *self)
   gtk_list_box_set_header_func (self->power_profile_listbox,
                                 cc_list_box_update_header_func,
                                 NULL, NULL);
+  self->boxes_reverse = g_list_prepend (self->boxes_reverse, self->power_profile_listbox);
   setup_power_profiles (self);
 
   power_saving_label = g_strdup_printf ("<b>%s</b>", _("Power Saving"));
@@ -1829,13 +1956,10 @@ cc_power_panel_init (CcPowerPanel *self)
   g_signal_connect_object (self->up_client, "device-added", G_CALLBACK (up_client_device_added), self, G_CONNECT_SWAPPED);
   g_signal_connect_object (self->up_client, "device-removed", G_CALLBACK (up_client_device_removed), self, G_CONNECT_SWAPPED);
 
-  self->devices = up_client_get_devices2 (self->up_client);
-  for (i = 0; self->devices != NULL && i < self->devices->len; i++) {
-    UpDevice *device = g_ptr_array_index (self->devices, i);
-    g_signal_connect_object (G_OBJECT (device), "notify",
-                             G_CALLBACK (up_client_changed), self, G_CONNECT_SWAPPED);
-  }
-  up_client_changed (self);
+  watch_device (self, self->composite);
+  for (i = 0; i < self->devices->len; i++)
+    watch_device (self, g_ptr_array_index (self->devices, i));
+  rebuild_battery_rows (self);
 
   self->focus_adjustment = gtk_scrolled_window_get_vadjustment (self->main_scroll);
   gtk_container_set_focus_vadjustment (GTK_CONTAINER (self->main_box), self->focus_adjustment);
@@ -0,0 +1,284 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-power-probes.h"
+
+/*
+ * One-shot queries against system services the panel uses to decide which
+ * rows to show.  None of them block: each gets the system bus and makes a
+ * single call, so the panel can issue them all at once and reveal sections
+ * as the answers come in.
+ *
+ * The services the panel keeps a proxy for are read from the properties
+ * the proxy cached when it was created instead, see the getters at the
+ * end.
+ */
+
+typedef struct
+{
+  gchar              *name;
+  gchar              *path;
+  gchar              *interface;
+  gchar              *method;
+  GVariant           *parameters;
+  const GVariantType *reply_type;
+} ProbeCall;
+
+static void
+probe_call_free (ProbeCall *call)
+{
+  g_free (call->name);
+  g_free (call->path);
+  g_free (call->interface);
+  g_free (call->method);
+  g_clear_pointer (&call->parameters, g_variant_unref);
+  g_free (call);
+}
+
+static void
+probe_call_cb (GObject      *source,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GVariant) variant = NULL;
+  GError *error = NULL;
+
+  variant = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+  if (variant == NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, g_steal_pointer (&variant), (GDestroyNotify) g_variant_unref);
+}
+
+static void
+probe_bus_get_cb (GObject      *source,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GDBusConnection) connection = NULL;
+  ProbeCall *call;
+  GError *error = NULL;
+
+  connection = g_bus_get_finish (res, &error);
+  if (connection == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  call = g_task_get_task_data (task);
+  g_dbus_connection_call (connection,
+                          call->name,
+                          call->path,
+                          call->interface,
+                          call->method,
+                          g_steal_pointer (&call->parameters),
+                          call->reply_type,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          g_task_get_cancellable (task),
+                          probe_call_cb,
+                          g_object_ref (task));
+}
+
+static void
+probe_call (gpointer             source_tag,
+            const gchar         *name,
+            const gchar         *path,
+            const gchar         *interface,
+            const gchar         *method,
+            GVariant            *parameters,
+            const GVariantType  *reply_type,
+            GCancellable        *cancellable,
+            GAsyncReadyCallback  callback,
+            gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  ProbeCall *call;
+
+  call = g_new0 (ProbeCall, 1);
+  call->name = g_strdup (name);
+  call->path = g_strdup (path);
+  call->interface = g_strdup (interface);
+  call->method = g_strdup (method);
+  call->parameters = parameters ? g_variant_ref_sink (parameters) : NULL;
+  call->reply_type = reply_type;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+  g_task_set_task_data (task, call, (GDestroyNotify) probe_call_free);
+
+  g_bus_get (G_BUS_TYPE_SYSTEM, cancellable, probe_bus_get_cb, g_steal_pointer (&task));
+}
+
+void
+cc_power_probe_chassis_type (GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data)
+{
+  probe_call (cc_power_probe_chassis_type,
+              "org.freedesktop.hostname1",
+              "/org/freedesktop/hostname1",
+              "org.freedesktop.DBus.Properties",
+              "Get",
+              g_variant_new ("(ss)", "org.freedesktop.hostname1", "Chassis"),
+              G_VARIANT_TYPE ("(v)"),
+              cancellable,
+              callback,
+              user_data);
+}
+
+/* Returns the chassis type hostnamed reports, which may be empty */
+gchar *
+cc_power_probe_chassis_type_finish (GAsyncResult  *result,
+                                    GError       **error)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) inner = NULL;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_power_probe_chassis_type, NULL);
+
+  variant = g_task_propagate_pointer (G_TASK (result), error);
+  if (variant == NULL)
+    return NULL;
+
+  g_variant_get (variant, "(v)", &inner);
+  if (!g_variant_is_of_type (inner, G_VARIANT_TYPE_STRING))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Unexpected type '%s' for property 'Chassis'",
+                   g_variant_get_type_string (inner));
+      return NULL;
+    }
+
+  return g_variant_dup_string (inner, NULL);
+}
+
+/* method_name is one of logind's Can* methods, e.g. "CanSuspend" */
+void
+cc_power_probe_logind_can (const gchar         *method_name,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+  probe_call (cc_power_probe_logind_can,
+              "org.freedesktop.login1",
+              "/org/freedesktop/login1",
+              "org.freedesktop.login1.Manager",
+              method_name,
+              NULL,
+              G_VARIANT_TYPE ("(s)"),
+              cancellable,
+              callback,
+              user_data);
+}
+
+/* Returns TRUE only if logind answered "yes", not "challenge" or "na" */
+gboolean
+cc_power_probe_logind_can_finish (GAsyncResult  *result,
+                                  GError       **error)
+{
+  g_autoptr(GVariant) variant = NULL;
+  const gchar *s;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_power_probe_logind_can, FALSE);
+
+  variant = g_task_propagate_pointer (G_TASK (result), error);
+  if (variant == NULL)
+    return FALSE;
+
+  g_variant_get (variant, "(&s)", &s);
+  return g_strcmp0 (s, "yes") == 0;
+}
+
+/* Returns the names of the profiles power-profiles-daemon offers, or NULL
+ * if the daemon isn't running */
+gchar **
+cc_power_probe_get_power_profiles (GDBusProxy *proxy)
+{
+  g_autoptr(GVariant) profiles = NULL;
+  g_autofree gchar *name_owner = NULL;
+  g_autoptr(GPtrArray) names = NULL;
+  GVariantIter iter;
+  GVariant *profile;
+
+  g_return_val_if_fail (G_IS_DBUS_PROXY (proxy), NULL);
+
+  /* The proxy fetched the properties when it was created, the daemon
+   * is missing if nobody owns the name by now */
+  name_owner = g_dbus_proxy_get_name_owner (proxy);
+  profiles = g_dbus_proxy_get_cached_property (proxy, "Profiles");
+  if (!name_owner || !profiles ||
+      !g_variant_is_of_type (profiles, G_VARIANT_TYPE ("aa{sv}")))
+    return NULL;
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  g_variant_iter_init (&iter, profiles);
+  while ((profile = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      const gchar *name = NULL;
+      const gchar *driver = NULL;
+
+      if (g_variant_lookup (profile, "Profile", "&s", &name))
+        {
+          g_variant_lookup (profile, "Driver", "&s", &driver);
+          g_debug ("Found profile '%s' (driver: %s)", name, driver);
+          g_ptr_array_add (names, g_strdup (name));
+        }
+      g_variant_unref (profile);
+    }
+  g_ptr_array_add (names, NULL);
+
+  return (gchar **) g_ptr_array_free (g_steal_pointer (&names), FALSE);
+}
+
+/* Returns TRUE if gsd-rfkill can turn Bluetooth off, and whether it is
+ * currently on in powered */
+gboolean
+cc_power_probe_get_bluetooth (GDBusProxy *proxy,
+                              gboolean   *powered)
+{
+  g_autoptr(GVariant) has_airplane_mode = NULL;
+  g_autoptr(GVariant) airplane_mode = NULL;
+
+  g_return_val_if_fail (G_IS_DBUS_PROXY (proxy), FALSE);
+
+  has_airplane_mode = g_dbus_proxy_get_cached_property (proxy, "BluetoothHasAirplaneMode");
+  if (has_airplane_mode == NULL || !g_variant_get_boolean (has_airplane_mode))
+    return FALSE;
+
+  airplane_mode = g_dbus_proxy_get_cached_property (proxy, "BluetoothAirplaneMode");
+  if (powered != NULL)
+    *powered = airplane_mode != NULL && !g_variant_get_boolean (airplane_mode);
+
+  return TRUE;
+}
+
+/* Returns TRUE if iio-sensor-proxy has an ambient light sensor */
+gboolean
+cc_power_probe_get_ambient_light (GDBusProxy *proxy)
+{
+  g_autoptr(GVariant) has_ambient_light = NULL;
+
+  g_return_val_if_fail (G_IS_DBUS_PROXY (proxy), FALSE);
+
+  has_ambient_light = g_dbus_proxy_get_cached_property (proxy, "HasAmbientLight");
+  return has_ambient_light != NULL && g_variant_get_boolean (has_ambient_light);
+}
@@ -0,0 +1,41 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void      cc_power_probe_chassis_type        (GCancellable         *cancellable,
+                                              GAsyncReadyCallback   callback,
+                                              gpointer              user_data);
+gchar    *cc_power_probe_chassis_type_finish (GAsyncResult         *result,
+                                              GError              **error);
+
+void      cc_power_probe_logind_can          (const gchar          *method_name,
+                                              GCancellable         *cancellable,
+                                              GAsyncReadyCallback   callback,
+                                              gpointer              user_data);
+gboolean  cc_power_probe_logind_can_finish   (GAsyncResult         *result,
+                                              GError              **error);
+
+gchar   **cc_power_probe_get_power_profiles  (GDBusProxy           *proxy);
+gboolean  cc_power_probe_get_bluetooth       (GDBusProxy           *proxy,
+                                              gboolean             *powered);
+gboolean  cc_power_probe_get_ambient_light   (GDBusProxy           *proxy);
+
+G_END_DECLS
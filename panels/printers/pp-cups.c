@@ -69,7 +69,7 @@ _pp_cups_get_dests_thread (GTask        *task,
   PpCupsDests *dests;
 
   dests = g_new0 (PpCupsDests, 1);
-  dests->num_of_dests = cupsGetDests (&dests->dests);
+  dests->num_of_dests = cupsGetDests2 (get_cups_connection (), &dests->dests);
 
   if (g_task_set_return_on_cancel (task, FALSE))
     {
@@ -91,7 +91,7 @@ pp_cups_get_dests_async (PpCups              *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, (GTaskThreadFunc) _pp_cups_get_dests_thread);
+  cups_task_run_in_pool (task, (GTaskThreadFunc) _pp_cups_get_dests_thread);
 }
 
 PpCupsDests *
@@ -136,7 +136,7 @@ pp_cups_connection_test_async (PpCups              *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, connection_test_thread);
+  cups_task_run_in_pool (task, connection_test_thread);
 }
 
 gboolean
@@ -169,7 +169,7 @@ cancel_subscription_thread (GTask        *task,
                     "requesting-user-name", NULL, cupsUser ());
       ippAddInteger (request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
                      "notify-subscription-id", id);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
     }
 
   g_task_return_boolean (task, response != NULL && ippGetStatusCode (response) <= IPP_OK);
@@ -187,7 +187,7 @@ pp_cups_cancel_subscription_async (PpCups              *self,
 
   task = g_task_new (self, NULL, callback, user_data);
   g_task_set_task_data (task, GINT_TO_POINTER (subscription_id), NULL);
-  g_task_run_in_thread (task, cancel_subscription_thread);
+  cups_task_run_in_pool (task, cancel_subscription_thread);
 }
 
 gboolean
@@ -238,7 +238,7 @@ renew_subscription_thread (GTask        *task,
                     "notify-subscription-id", subscription_data->id);
       ippAddInteger (request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
                     "notify-lease-duration", subscription_data->lease_duration);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
       if (response != NULL && ippGetStatusCode (response) <= IPP_OK_CONFLICT)
         {
           if ((attr = ippFindAttribute (response, "notify-lease-duration", IPP_TAG_INTEGER)) == NULL)
@@ -264,7 +264,7 @@ renew_subscription_thread (GTask        *task,
                    "notify-recipient-uri", NULL, "dbus://");
       ippAddInteger (request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
                     "notify-lease-duration", subscription_data->lease_duration);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
 
       if (response != NULL && ippGetStatusCode (response) <= IPP_OK_CONFLICT)
         {
@@ -299,7 +299,7 @@ pp_cups_renew_subscription_async  (PpCups               *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, subscription_data, (GDestroyNotify) crs_data_free);
-  g_task_run_in_thread (task, renew_subscription_thread);
+  cups_task_run_in_pool (task, renew_subscription_thread);
 }
 
 /* Returns id of renewed subscription or new id */
@@ -80,6 +80,13 @@ pp_job_new (gint id, const gchar *title, gint state, GStrv auth_info_required)
    return job;
 }
 
+gint
+pp_job_get_id (PpJob *self)
+{
+   g_return_val_if_fail (PP_IS_JOB(self), -1);
+   return self->id;
+}
+
 const gchar *
 pp_job_get_title (PpJob *self)
 {
@@ -101,6 +108,31 @@ pp_job_get_auth_info_required (PpJob *self)
    return self->auth_info_required;
 }
 
+/* Whether the two jobs would be displayed the same */
+gboolean
+pp_job_equal (PpJob *self,
+              PpJob *other)
+{
+   guint i;
+
+   g_return_val_if_fail (PP_IS_JOB(self), FALSE);
+   g_return_val_if_fail (PP_IS_JOB(other), FALSE);
+
+   if (self->id != other->id ||
+       self->state != other->state ||
+       g_strcmp0 (self->title, other->title) != 0)
+     return FALSE;
+
+   if (self->auth_info_required == NULL || other->auth_info_required == NULL)
+     return self->auth_info_required == other->auth_info_required;
+
+   for (i = 0; self->auth_info_required[i] != NULL; i++)
+     if (g_strcmp0 (self->auth_info_required[i], other->auth_info_required[i]) != 0)
+       return FALSE;
+
+   return other->auth_info_required[i] == NULL;
+}
+
 void
 pp_job_cancel_purge_async (PpJob        *self,
                            gboolean      job_purge)
@@ -226,7 +258,7 @@ _pp_job_get_attributes_thread (GTask        *task,
                     "requesting-user-name", NULL, cupsUser ());
       ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
                      "requested-attributes", length, NULL, (const char **) attributes_names);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
     }
 
   if (response != NULL)
@@ -320,7 +352,7 @@ pp_job_get_attributes_async (PpJob                *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, g_strdupv (attributes_names), (GDestroyNotify) g_strfreev);
-  g_task_run_in_thread (task, _pp_job_get_attributes_thread);
+  cups_task_run_in_pool (task, _pp_job_get_attributes_thread);
 }
 
 GVariant *
@@ -359,7 +391,7 @@ _pp_job_authenticate_thread (GTask        *task,
                     "requesting-user-name", NULL, cupsUser ());
       ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_TEXT,
                      "auth-info", length, NULL, (const char **) auth_info);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
 
       result = response != NULL && ippGetStatusCode (response) <= IPP_OK;
 
@@ -381,7 +413,7 @@ pp_job_authenticate_async (PpJob                *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, g_strdupv (auth_info), (GDestroyNotify) g_strfreev);
-  g_task_run_in_thread (task, _pp_job_authenticate_thread);
+  cups_task_run_in_pool (task, _pp_job_authenticate_thread);
 }
 
 gboolean
@@ -34,12 +34,17 @@ PpJob         *pp_job_new                        (gint                  id,
                                                   gint                  state,
                                                   GStrv                 auth_info_required);
 
+gint           pp_job_get_id                     (PpJob                *job);
+
 const gchar   *pp_job_get_title                  (PpJob                *job);
 
 gint           pp_job_get_state                  (PpJob                *job);
 
 GStrv          pp_job_get_auth_info_required     (PpJob                *job);
 
+gboolean       pp_job_equal                      (PpJob                *job,
+                                                  PpJob                *other);
+
 void           pp_job_set_hold_until_async       (PpJob                *job,
                                                   const gchar          *job_hold_until);
 
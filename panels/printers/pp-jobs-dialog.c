@@ -44,6 +44,10 @@
 #define CLOCK_SCHEMA "org.gnome.desktop.interface"
 #define CLOCK_FORMAT_KEY "clock-format"
 
+/* Notifications tend to come in bursts, e.g. one per job when
+ * authenticating all of them, so they are handled together */
+#define JOBS_UPDATE_DELAY 100 /* ms */
+
 struct _PpJobsDialog {
   GtkDialog   parent_instance;
 
@@ -72,6 +76,8 @@ struct _PpJobsDialog {
   gboolean   pop_up_authentication_popup;
 
   GCancellable *get_jobs_cancellable;
+  guint         update_timeout_id;
+  gboolean      update_pending;
 };
 
 G_DEFINE_TYPE (PpJobsDialog, pp_jobs_dialog, GTK_TYPE_DIALOG)
@@ -189,6 +195,76 @@ pop_up_authentication_popup (PpJobsDialog *self)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (self->authenticate_jobs_button), TRUE);
 }
 
+/* Updates the store to match jobs, only touching the rows of the jobs
+ * that were added, removed, changed or moved */
+static void
+update_store (PpJobsDialog *self,
+              GPtrArray    *jobs)
+{
+  GListModel          *model = G_LIST_MODEL (self->store);
+  g_autoptr(GHashTable) ids = NULL;
+  guint                n_items;
+  guint                i, j;
+
+  ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < jobs->len; i++)
+    g_hash_table_add (ids, GINT_TO_POINTER (pp_job_get_id (g_ptr_array_index (jobs, i))));
+
+  /* Remove the jobs that are gone, a run of them at a time */
+  i = g_list_model_get_n_items (model);
+  while (i > 0)
+    {
+      guint end = i;
+
+      while (i > 0)
+        {
+          g_autoptr(PpJob) job = g_list_model_get_item (model, i - 1);
+
+          if (g_hash_table_contains (ids, GINT_TO_POINTER (pp_job_get_id (job))))
+            break;
+          i--;
+        }
+
+      if (i < end)
+        g_list_store_splice (self->store, i, end - i, NULL, 0);
+      else
+        i--;
+    }
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      PpJob            *job = g_ptr_array_index (jobs, i);
+      g_autoptr(PpJob)  current = NULL;
+
+      n_items = g_list_model_get_n_items (model);
+      if (i < n_items)
+        current = g_list_model_get_item (model, i);
+
+      if (current != NULL && pp_job_get_id (current) == pp_job_get_id (job))
+        {
+          if (!pp_job_equal (current, job))
+            g_list_store_splice (self->store, i, 1, (gpointer *) &job, 1);
+          continue;
+        }
+
+      /* Either a new job, or one that moved up in the queue */
+      for (j = i + 1; j < n_items; j++)
+        {
+          g_autoptr(PpJob) other = g_list_model_get_item (model, j);
+
+          if (pp_job_get_id (other) == pp_job_get_id (job))
+            {
+              g_list_store_remove (self->store, j);
+              break;
+            }
+        }
+
+      g_list_store_insert (self->store, i, job);
+    }
+}
+
+static void update_jobs_list (PpJobsDialog *self);
+
 static void
 update_jobs_list_cb (GObject      *source_object,
                      GAsyncResult *result,
@@ -197,24 +273,39 @@ update_jobs_list_cb (GObject      *source_object,
   PpJobsDialog        *self = user_data;
   PpPrinter           *printer = PP_PRINTER (source_object);
   g_autoptr(GError)    error = NULL;
-  g_autoptr(GPtrArray) jobs;
+  g_autoptr(GPtrArray) jobs = NULL;
   PpJob               *job;
   gint                 num_of_auth_jobs = 0;
   guint                i;
 
-  g_list_store_remove_all (self->store);
-
   jobs = pp_printer_get_jobs_finish (printer, result, &error);
   if (error != NULL)
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+      g_warning ("Could not get jobs: %s", error->message);
+      g_clear_object (&self->get_jobs_cancellable);
+
+      if (self->update_pending)
         {
-          g_warning ("Could not get jobs: %s", error->message);
+          self->update_pending = FALSE;
+          update_jobs_list (self);
         }
 
       return;
     }
 
+  g_clear_object (&self->get_jobs_cancellable);
+
+  /* The jobs changed again meanwhile, skip straight to the next query */
+  if (self->update_pending)
+    {
+      self->update_pending = FALSE;
+      update_jobs_list (self);
+      return;
+    }
+
   if (jobs->len > 0)
     {
       gtk_widget_set_sensitive (GTK_WIDGET (self->jobs_clear_all_button), TRUE);
@@ -226,12 +317,12 @@ update_jobs_list_cb (GObject      *source_object,
       gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->no_jobs_page));
     }
 
+  update_store (self, jobs);
+
   for (i = 0; i < jobs->len; i++)
     {
       job = PP_JOB (g_ptr_array_index (jobs, i));
 
-      g_list_store_append (self->store, g_object_ref (job));
-
       if (pp_job_get_auth_info_required (job) != NULL)
         {
           num_of_auth_jobs++;
@@ -258,8 +349,6 @@ update_jobs_list_cb (GObject      *source_object,
 
   authenticate_popover_update (self);
 
-  g_clear_object (&self->get_jobs_cancellable);
-
   if (!self->jobs_filled)
     {
       if (self->pop_up_authentication_popup)
@@ -277,21 +366,36 @@ update_jobs_list (PpJobsDialog *self)
 {
   g_autoptr(PpPrinter) printer = NULL;
 
-  if (self->printer_name != NULL)
+  if (self->printer_name == NULL)
+    return;
+
+  /* Let the running query finish, and query again afterwards */
+  if (self->get_jobs_cancellable != NULL)
     {
-      g_cancellable_cancel (self->get_jobs_cancellable);
-      g_clear_object (&self->get_jobs_cancellable);
+      self->update_pending = TRUE;
+      return;
+    }
 
-      self->get_jobs_cancellable = g_cancellable_new ();
+  self->get_jobs_cancellable = g_cancellable_new ();
 
-      printer = pp_printer_new (self->printer_name);
-      pp_printer_get_jobs_async (printer,
-                                 TRUE,
-                                 CUPS_WHICHJOBS_ACTIVE,
-                                 self->get_jobs_cancellable,
-                                 update_jobs_list_cb,
-                                 self);
-    }
+  printer = pp_printer_new (self->printer_name);
+  pp_printer_get_jobs_async (printer,
+                             TRUE,
+                             CUPS_WHICHJOBS_ACTIVE,
+                             self->get_jobs_cancellable,
+                             update_jobs_list_cb,
+                             self);
+}
+
+static gboolean
+update_timeout_cb (gpointer user_data)
+{
+  PpJobsDialog *self = user_data;
+
+  self->update_timeout_id = 0;
+  update_jobs_list (self);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -419,7 +523,8 @@ pp_jobs_dialog_new (const gchar *printer_name)
 void
 pp_jobs_dialog_update (PpJobsDialog *self)
 {
-  update_jobs_list (self);
+  if (self->update_timeout_id == 0)
+    self->update_timeout_id = g_timeout_add (JOBS_UPDATE_DELAY, update_timeout_cb, self);
 }
 
 void
@@ -444,6 +549,7 @@ pp_jobs_dialog_dispose (GObject *object)
 
   g_cancellable_cancel (self->get_jobs_cancellable);
   g_clear_object (&self->get_jobs_cancellable);
+  g_clear_handle_id (&self->update_timeout_id, g_source_remove);
   g_clear_pointer (&self->actual_auth_info_required, g_strfreev);
   g_clear_pointer (&self->printer_name, g_free);
 
@@ -236,7 +236,7 @@ _pp_maintenance_command_execute_thread (GTask        *task,
           fprintf (file, "\n");
           fclose (file);
 
-          response = cupsDoFileRequest (CUPS_HTTP_DEFAULT, request, "/", file_name);
+          response = cupsDoFileRequest (get_cups_connection (), request, "/", file_name);
           g_unlink (file_name);
 
           if (response != NULL)
@@ -276,7 +276,7 @@ pp_maintenance_command_execute_async (PpMaintenanceCommand *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_check_cancellable (task, TRUE);
-  g_task_run_in_thread (task, _pp_maintenance_command_execute_thread);
+  cups_task_run_in_pool (task, _pp_maintenance_command_execute_thread);
 }
 
 gboolean
@@ -309,7 +309,7 @@ _pp_maintenance_command_is_supported (const gchar *printer_name,
                 "printer-uri", NULL, printer_uri);
   ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
                 "requested-attributes", NULL, "printer-commands");
-  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+  response = cupsDoRequest (get_cups_connection (), request, "/");
   if (response != NULL)
     {
       if (ippGetStatusCode (response) <= IPP_OK_CONFLICT)
@@ -376,7 +376,7 @@ pp_maintenance_command_is_supported_async  (PpMaintenanceCommand *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_check_cancellable (task, TRUE);
-  g_task_run_in_thread (task, _pp_maintenance_command_is_supported_thread);
+  cups_task_run_in_pool (task, _pp_maintenance_command_is_supported_thread);
 }
 
 gboolean
@@ -33,6 +33,9 @@
 
 #define SUPPLY_BAR_HEIGHT 8
 
+/* CUPS notifications about the same queue tend to come in bursts */
+#define JOBS_UPDATE_DELAY 100 /* ms */
+
 typedef struct
 {
   gchar *marker_names;
@@ -80,6 +83,7 @@ struct _PpPrinterEntry
   PpJobsDialog    *pp_jobs_dialog;
 
   GCancellable *get_jobs_cancellable;
+  guint         update_jobs_count_id;
 };
 
 struct _PpPrinterEntryClass
@@ -539,8 +543,8 @@ get_jobs_cb (GObject      *source_object,
   g_clear_object (&self->get_jobs_cancellable);
 }
 
-void
-pp_printer_entry_update_jobs_count (PpPrinterEntry *self)
+static void
+update_jobs_count (PpPrinterEntry *self)
 {
   g_autoptr(PpPrinter) printer = NULL;
 
@@ -558,6 +562,24 @@ pp_printer_entry_update_jobs_count (PpPrinterEntry *self)
                              self);
 }
 
+static gboolean
+update_jobs_count_timeout_cb (gpointer user_data)
+{
+  PpPrinterEntry *self = user_data;
+
+  self->update_jobs_count_id = 0;
+  update_jobs_count (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+pp_printer_entry_update_jobs_count (PpPrinterEntry *self)
+{
+  if (self->update_jobs_count_id == 0)
+    self->update_jobs_count_id = g_timeout_add (JOBS_UPDATE_DELAY, update_jobs_count_timeout_cb, self);
+}
+
 static void
 jobs_dialog_response_cb (GtkDialog  *dialog,
                          gint        response_id,
@@ -941,6 +963,7 @@ pp_printer_entry_dispose (GObject *object)
 
   g_cancellable_cancel (self->get_jobs_cancellable);
   g_cancellable_cancel (self->check_clean_heads_cancellable);
+  g_clear_handle_id (&self->update_jobs_count_id, g_source_remove);
 
   g_clear_pointer (&self->printer_name, g_free);
   g_clear_pointer (&self->printer_location, g_free);
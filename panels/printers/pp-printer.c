@@ -138,7 +138,7 @@ printer_rename_dbus_cb (GObject      *source_object,
         {
           g_warning ("Update cups-pk-helper to at least 0.2.6 please to be able to use PrinterRename method.");
 
-          g_task_run_in_thread (task, printer_rename_thread);
+          cups_task_run_in_pool (task, printer_rename_thread);
         }
       else
         {
@@ -220,97 +220,138 @@ typedef struct
   gint      which_jobs;
 } GetJobsData;
 
+static gchar **
+get_auth_info_required (PpPrinter *self)
+{
+  static const gchar *printer_attributes[] = { "auth-info-required" };
+  g_autofree gchar   *printer_uri = NULL;
+  ipp_attribute_t    *attr;
+  ipp_t              *printer_request;
+  ipp_t              *printer_response;
+  gchar             **auth_info_required = NULL;
+  gint                i;
+
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", self->printer_name);
+
+  printer_request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
+  ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, printer_uri);
+  ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddStrings (printer_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (printer_attributes), NULL, printer_attributes);
+  printer_response = cupsDoRequest (get_cups_connection (), printer_request, "/");
+
+  if (printer_response != NULL)
+    {
+      attr = ippFindAttribute (printer_response, "auth-info-required", IPP_TAG_ZERO);
+      if (attr != NULL)
+        {
+          auth_info_required = g_new0 (gchar *, ippGetCount (attr) + 1);
+          for (i = 0; i < ippGetCount (attr); i++)
+            auth_info_required[i] = g_strdup (ippGetString (attr, i, NULL));
+        }
+
+      ippDelete (printer_response);
+    }
+
+  return auth_info_required;
+}
+
 static void
 get_jobs_thread (GTask        *task,
                  gpointer      source_object,
                  gpointer      task_data,
                  GCancellable *cancellable)
 {
-  ipp_attribute_t  *attr = NULL;
-  static gchar     *printer_attributes[] = { "auth-info-required" };
+  /* Only what the jobs dialog and the printer entries show, job-hold-until
+   * tells whether a held job waits for authentication */
+  static const gchar *job_attributes[] = { "job-id", "job-name", "job-state", "job-hold-until" };
+  ipp_attribute_t  *attr;
   GetJobsData      *get_jobs_data = task_data;
-  cups_job_t       *jobs = NULL;
   PpPrinter        *self = PP_PRINTER (source_object);
-  gboolean          auth_info_is_required;
-  PpJob            *job;
-  ipp_t            *job_request;
-  ipp_t            *job_response;
-  ipp_t            *printer_request;
-  ipp_t            *printer_response;
+  ipp_t            *request;
+  ipp_t            *response;
   gchar           **auth_info_required = NULL;
-  g_autofree gchar *printer_name = NULL;
+  gboolean          auth_info_fetched = FALSE;
+  g_autofree gchar *printer_uri = NULL;
   g_autoptr(GPtrArray) array = NULL;
-  gint              num_jobs;
-  gint              i, j;
 
-  num_jobs = cupsGetJobs (&jobs,
-                          self->printer_name,
-                          get_jobs_data->myjobs ? 1 : 0,
-                          get_jobs_data->which_jobs);
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", self->printer_name);
+
+  request = ippNewRequest (IPP_GET_JOBS);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, printer_uri);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (job_attributes), NULL, job_attributes);
+  if (get_jobs_data->myjobs)
+    ippAddBoolean (request, IPP_TAG_OPERATION, "my-jobs", 1);
+  if (get_jobs_data->which_jobs == CUPS_WHICHJOBS_COMPLETED)
+    ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                  "which-jobs", NULL, "completed");
+  else if (get_jobs_data->which_jobs == CUPS_WHICHJOBS_ALL)
+    ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                  "which-jobs", NULL, "all");
+
+  response = cupsDoRequest (get_cups_connection (), request, "/");
 
   array = g_ptr_array_new_with_free_func (g_object_unref);
-  for (i = 0; i < num_jobs; i++)
+
+  if (response != NULL)
     {
-      auth_info_is_required = FALSE;
-      if (jobs[i].state == IPP_JOB_HELD)
+      for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
         {
-          g_autofree gchar *job_uri = g_strdup_printf ("ipp://localhost/jobs/%d", jobs[i].id);
-
-          job_request = ippNewRequest (IPP_GET_JOB_ATTRIBUTES);
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                        "job-uri", NULL, job_uri);
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                        "requesting-user-name", NULL, cupsUser ());
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                        "requested-attributes", NULL, "job-hold-until");
-          job_response = cupsDoRequest (CUPS_HTTP_DEFAULT, job_request, "/");
-
-          if (job_response != NULL)
+          const gchar *title = NULL;
+          gboolean     auth_info_is_required = FALSE;
+          gint         id = 0;
+          gint         state = IPP_JOB_PENDING;
+
+          while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_JOB)
+            attr = ippNextAttribute (response);
+
+          if (attr == NULL)
+            break;
+
+          for (; attr != NULL && ippGetGroupTag (attr) == IPP_TAG_JOB; attr = ippNextAttribute (response))
             {
-              attr = ippFindAttribute (job_response, "job-hold-until", IPP_TAG_ZERO);
-              if (attr != NULL && g_strcmp0 (ippGetString (attr, 0, NULL), "auth-info-required") == 0)
+              const gchar *name = ippGetName (attr);
+
+              if (name == NULL)
+                continue;
+
+              if (g_str_equal (name, "job-id") && ippGetValueTag (attr) == IPP_TAG_INTEGER)
+                id = ippGetInteger (attr, 0);
+              else if (g_str_equal (name, "job-name"))
+                title = ippGetString (attr, 0, NULL);
+              else if (g_str_equal (name, "job-state") && ippGetValueTag (attr) == IPP_TAG_ENUM)
+                state = ippGetInteger (attr, 0);
+              else if (g_str_equal (name, "job-hold-until"))
+                auth_info_is_required = g_strcmp0 (ippGetString (attr, 0, NULL), "auth-info-required") == 0;
+            }
+
+          if (id > 0)
+            {
+              auth_info_is_required = auth_info_is_required && state == IPP_JOB_HELD;
+
+              if (auth_info_is_required && !auth_info_fetched)
                 {
-                  auth_info_is_required = TRUE;
-
-                  if (auth_info_required == NULL)
-                    {
-                      g_autofree gchar *printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", self->printer_name);
-
-                      printer_request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
-                      ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                                    "printer-uri", NULL, printer_uri);
-                      ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                                    "requesting-user-name", NULL, cupsUser ());
-                      ippAddStrings (printer_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                                     "requested-attributes", 1, NULL, (const char **) printer_attributes);
-                      printer_response = cupsDoRequest (CUPS_HTTP_DEFAULT, printer_request, "/");
-
-                      if (printer_response != NULL)
-                        {
-                          attr = ippFindAttribute (printer_response, "auth-info-required", IPP_TAG_ZERO);
-                          if (attr != NULL)
-                            {
-                              auth_info_required = g_new0 (gchar *, ippGetCount (attr) + 1);
-                              for (j = 0; j < ippGetCount (attr); j++)
-                                auth_info_required[j] = g_strdup (ippGetString (attr, j, NULL));
-                            }
-
-                          ippDelete (printer_response);
-                        }
-                    }
+                  auth_info_required = get_auth_info_required (self);
+                  auth_info_fetched = TRUE;
                 }
 
-              ippDelete (job_response);
+              g_ptr_array_add (array, pp_job_new (id, title, state, auth_info_is_required ? auth_info_required : NULL));
             }
-        }
 
-      job = pp_job_new (jobs[i].id, jobs[i].title, jobs[i].state, auth_info_is_required ? auth_info_required : NULL);
+          if (attr == NULL)
+            break;
+        }
 
-      g_ptr_array_add (array, job);
+      ippDelete (response);
     }
 
   g_strfreev (auth_info_required);
-  cupsFreeJobs (num_jobs, jobs);
 
   if (g_task_set_return_on_cancel (task, FALSE))
     {
@@ -336,7 +377,7 @@ pp_printer_get_jobs_async (PpPrinter           *self,
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
   g_task_set_task_data (task, get_jobs_data, g_free);
   g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, get_jobs_thread);
+  cups_task_run_in_pool (task, get_jobs_thread);
 }
 
 GPtrArray *
@@ -479,7 +520,7 @@ print_file_thread (GTask        *task,
   ipp_t            *response = NULL;
   ipp_t            *request;
 
-  dest = cupsGetNamedDest (CUPS_HTTP_DEFAULT, self->printer_name, NULL);
+  dest = cupsGetNamedDest (get_cups_connection (), self->printer_name, NULL);
   if (dest != NULL)
     {
       printer_type = cupsGetOption ("printer-type",
@@ -511,7 +552,7 @@ print_file_thread (GTask        *task,
                 "requesting-user-name", NULL, cupsUser ());
   ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
                 "job-name", NULL, print_file_data->job_name);
-  response = cupsDoFileRequest (CUPS_HTTP_DEFAULT, request, resource, print_file_data->filename);
+  response = cupsDoFileRequest (get_cups_connection (), request, resource, print_file_data->filename);
 
   if (response != NULL)
     {
@@ -549,7 +590,7 @@ pp_printer_print_file_async (PpPrinter           *self,
   g_task_set_return_on_cancel (task, TRUE);
   g_task_set_task_data (task, print_file_data, (GDestroyNotify) print_file_data_free);
 
-  g_task_run_in_thread (task, print_file_thread);
+  cups_task_run_in_pool (task, print_file_thread);
 }
 
 gboolean
@@ -75,6 +75,121 @@ ippNextAttribute (ipp_t *ipp)
 #define HTTP_URI_STATUS_OK HTTP_URI_OK
 #endif
 
+/*
+ * Blocking requests to the local CUPS server are run by a single pool of
+ * at most CUPS_WORKERS_MAX threads, each of which keeps its connection to
+ * the server open between requests.  Queued requests are ordered by the
+ * priority of their task so that what the user is looking at gets answered
+ * before background work like listing all installed drivers.
+ */
+typedef struct
+{
+  GTask           *task;
+  GTaskThreadFunc  task_func;
+  guint            sequence;
+} CupsWork;
+
+static GPrivate cups_connection = G_PRIVATE_INIT ((GDestroyNotify) httpClose);
+
+static gint
+cups_work_compare (gconstpointer a,
+                   gconstpointer b,
+                   gpointer      user_data)
+{
+  const CupsWork *work_a = a;
+  const CupsWork *work_b = b;
+  gint            priority_a = g_task_get_priority (work_a->task);
+  gint            priority_b = g_task_get_priority (work_b->task);
+
+  if (priority_a != priority_b)
+    return priority_a < priority_b ? -1 : 1;
+
+  /* First come, first served within the same priority */
+  return (gint) (work_a->sequence - work_b->sequence);
+}
+
+static void
+cups_work_run (gpointer data,
+               gpointer user_data)
+{
+  CupsWork *work = data;
+
+  if (!g_task_return_error_if_cancelled (work->task))
+    work->task_func (work->task,
+                     g_task_get_source_object (work->task),
+                     g_task_get_task_data (work->task),
+                     g_task_get_cancellable (work->task));
+
+  g_object_unref (work->task);
+  g_free (work);
+}
+
+static GThreadPool *
+get_cups_pool (void)
+{
+  static gsize        initialized = 0;
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&initialized))
+    {
+      pool = g_thread_pool_new (cups_work_run, NULL, CUPS_WORKERS_MAX, FALSE, NULL);
+      g_thread_pool_set_sort_function (pool, cups_work_compare, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+/*
+ * Runs task_func for the task in the CUPS worker pool.  The pool is ordered
+ * by g_task_get_priority() and a task that is cancelled before its turn comes
+ * returns G_IO_ERROR_CANCELLED without task_func being called.
+ */
+void
+cups_task_run_in_pool (GTask           *task,
+                       GTaskThreadFunc  task_func)
+{
+  static gint  sequence = 0;
+  CupsWork    *work;
+
+  work = g_new0 (CupsWork, 1);
+  work->task = g_object_ref (task);
+  work->task_func = task_func;
+  work->sequence = (guint) g_atomic_int_add (&sequence, 1);
+
+  g_thread_pool_push (get_cups_pool (), work, NULL);
+}
+
+/*
+ * Returns the connection of the calling worker to the CUPS server, opening
+ * it on first use.  Only call this from a function run by
+ * cups_task_run_in_pool().  Falls back to CUPS_HTTP_DEFAULT if the server
+ * can not be reached so that the result can always be passed to CUPS.
+ */
+http_t *
+get_cups_connection (void)
+{
+  http_t *http;
+
+  http = g_private_get (&cups_connection);
+  if (http == NULL)
+    {
+#ifdef HAVE_CUPS_HTTPCONNECT2
+      http = httpConnect2 (cupsServer (), ippPort (), NULL, AF_UNSPEC,
+                           cupsEncryption (), 1, 30000, NULL);
+#else
+      http = httpConnectEncrypt (cupsServer (), ippPort (), cupsEncryption ());
+#endif
+      if (http == NULL)
+        return CUPS_HTTP_DEFAULT;
+
+      g_private_set (&cups_connection, http);
+    }
+
+  return http;
+}
+
 gchar *
 get_tag_value (const gchar *tag_string, const gchar *tag_name)
 {
@@ -1176,7 +1291,6 @@ typedef struct
   GHashTable   *result;
   GIACallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } GIAData;
 
 static GIAData *
@@ -1189,7 +1303,6 @@ gia_data_new (const gchar *printer_name, gchar **attributes_names, GIACallback c
   data->attributes_names = g_strdupv (attributes_names);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -1202,33 +1315,19 @@ gia_data_free (GIAData *data)
     g_strfreev (data->attributes_names);
   if (data->result)
     g_hash_table_unref (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-get_ipp_attributes_idle_cb (gpointer user_data)
-{
-  GIAData *data = (GIAData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
 static void
-get_ipp_attributes_cb (gpointer user_data)
+get_ipp_attributes_cb (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
 {
-  GIAData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  GIAData               *data = g_task_get_task_data (G_TASK (res));
+  g_autoptr(GHashTable)  result = NULL;
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_ipp_attributes_idle_cb,
-                         data,
-                         (GDestroyNotify) gia_data_free);
-  g_source_attach (idle_source, data->context);
+  result = g_task_propagate_pointer (G_TASK (res), NULL);
+  data->callback (result, data->user_data);
 }
 
 static void
@@ -1238,11 +1337,14 @@ ipp_attribute_free2 (gpointer attr)
   ipp_attribute_free (attribute);
 }
 
-static gpointer
-get_ipp_attributes_func (gpointer user_data)
+static void
+get_ipp_attributes_func (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
 {
   ipp_attribute_t  *attr = NULL;
-  GIAData          *data = user_data;
+  GIAData          *data = task_data;
   ipp_t            *request;
   ipp_t            *response = NULL;
   g_autofree gchar *printer_uri = NULL;
@@ -1264,7 +1366,7 @@ get_ipp_attributes_func (gpointer user_data)
                     "printer-uri", NULL, printer_uri);
       ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
                      "requested-attributes", length, NULL, (const char **) requested_attrs);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (get_cups_connection (), request, "/");
     }
 
   if (response)
@@ -1337,9 +1439,7 @@ get_ipp_attributes_func (gpointer user_data)
     g_free (requested_attrs[i]);
   g_free (requested_attrs);
 
-  get_ipp_attributes_cb (data);
-
-  return NULL;
+  g_task_return_pointer (task, g_steal_pointer (&data->result), (GDestroyNotify) g_hash_table_unref);
 }
 
 void
@@ -1348,24 +1448,13 @@ get_ipp_attributes_async (const gchar  *printer_name,
                           GIACallback   callback,
                           gpointer      user_data)
 {
-  GIAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
-  data = gia_data_new (printer_name, attributes_names, callback, user_data);
+  g_autoptr(GTask) task = NULL;
 
-  thread = g_thread_try_new ("get-ipp-attributes",
-                             get_ipp_attributes_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gia_data_free (data);
-    }
+  task = g_task_new (NULL, NULL, get_ipp_attributes_cb, NULL);
+  g_task_set_task_data (task,
+                        gia_data_new (printer_name, attributes_names, callback, user_data),
+                        (GDestroyNotify) gia_data_free);
+  cups_task_run_in_pool (task, get_ipp_attributes_func);
 }
 
 IPPAttribute *
@@ -1632,7 +1721,6 @@ typedef struct
   gchar        **result;
   GPACallback    callback;
   gpointer       user_data;
-  GMainContext  *context;
 } GPAData;
 
 static GPAData *
@@ -1645,7 +1733,6 @@ gpa_data_new (gchar **ppds_names, gchar *attribute_name, GPACallback callback, g
   data->attribute_name = g_strdup (attribute_name);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -1657,47 +1744,36 @@ gpa_data_free (GPAData *data)
   g_strfreev (data->ppds_names);
   if (data->result != NULL)
     g_strfreev (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-get_ppds_attribute_idle_cb (gpointer user_data)
-{
-  GPAData *data = (GPAData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
 static void
-get_ppds_attribute_cb (gpointer user_data)
+get_ppds_attribute_cb (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
 {
-  GPAData *data = (GPAData *) user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  GPAData       *data = g_task_get_task_data (G_TASK (res));
+  g_auto(GStrv)  result = NULL;
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_ppds_attribute_idle_cb,
-                         data,
-                         (GDestroyNotify) gpa_data_free);
-  g_source_attach (idle_source, data->context);
+  result = g_task_propagate_pointer (G_TASK (res), NULL);
+  data->callback (result, data->user_data);
 }
 
-static gpointer
-get_ppds_attribute_func (gpointer user_data)
+static void
+get_ppds_attribute_func (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
 {
   ppd_file_t  *ppd_file;
   ppd_attr_t  *ppd_attr;
-  GPAData     *data = user_data;
+  GPAData     *data = task_data;
   gint         i;
 
   data->result = g_new0 (gchar *, g_strv_length (data->ppds_names) + 1);
   for (i = 0; data->ppds_names[i]; i++)
     {
-      g_autofree gchar *ppd_filename = g_strdup (cupsGetServerPPD (CUPS_HTTP_DEFAULT, data->ppds_names[i]));
+      g_autofree gchar *ppd_filename = g_strdup (cupsGetServerPPD (get_cups_connection (), data->ppds_names[i]));
       if (ppd_filename)
         {
           ppd_file = ppdOpenFile (ppd_filename);
@@ -1714,9 +1790,7 @@ get_ppds_attribute_func (gpointer user_data)
         }
     }
 
-  get_ppds_attribute_cb (data);
-
-  return NULL;
+  g_task_return_pointer (task, g_steal_pointer (&data->result), (GDestroyNotify) g_strfreev);
 }
 
 /*
@@ -1728,9 +1802,7 @@ get_ppds_attribute_async (gchar       **ppds_names,
                           GPACallback   callback,
                           gpointer      user_data)
 {
-  GPAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
+  g_autoptr(GTask) task = NULL;
 
   if (!ppds_names || !attribute_name)
     {
@@ -1738,20 +1810,13 @@ get_ppds_attribute_async (gchar       **ppds_names,
       return;
     }
 
-  data = gpa_data_new (ppds_names, attribute_name, callback, user_data);
-
-  thread = g_thread_try_new ("get-ppds-attribute",
-                             get_ppds_attribute_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gpa_data_free (data);
-    }
+  /* Opening every candidate PPD is slow, let other requests go first */
+  task = g_task_new (NULL, NULL, get_ppds_attribute_cb, NULL);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+  g_task_set_task_data (task,
+                        gpa_data_new (ppds_names, attribute_name, callback, user_data),
+                        (GDestroyNotify) gpa_data_free);
+  cups_task_run_in_pool (task, get_ppds_attribute_func);
 }
 
 
@@ -2362,7 +2427,6 @@ typedef struct
   GCancellable *cancellable;
   GAPCallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } GAPData;
 
 static GAPData *
@@ -2375,7 +2439,6 @@ gap_data_new (GCancellable *cancellable, GAPCallback callback, gpointer user_dat
     data->cancellable = g_object_ref (cancellable);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -2386,34 +2449,26 @@ gap_data_free (GAPData *data)
   if (data->result != NULL)
     ppd_list_free (data->result);
   g_clear_object (&data->cancellable);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-get_all_ppds_idle_cb (gpointer user_data)
+static void
+get_all_ppds_cb (GObject      *source_object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
 {
-  GAPData *data = user_data;
-
-  if (!g_cancellable_is_cancelled (data->cancellable))
-    data->callback (data->result, data->user_data);
+  GAPData           *data = g_task_get_task_data (G_TASK (res));
+  PPDList           *result;
+  g_autoptr(GError)  error = NULL;
 
-  return FALSE;
-}
+  result = g_task_propagate_pointer (G_TASK (res), &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
 
-static void
-get_all_ppds_cb (gpointer user_data)
-{
-  GAPData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  data->callback (result, data->user_data);
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_all_ppds_idle_cb,
-                         data,
-                         (GDestroyNotify) gap_data_free);
-  g_source_attach (idle_source, data->context);
+  if (result != NULL)
+    ppd_list_free (result);
 }
 
 static const struct {
@@ -2492,13 +2547,16 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
-static gpointer
-get_all_ppds_func (gpointer user_data)
+static void
+get_all_ppds_func (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
 {
   ipp_attribute_t *attr;
   GHashTable      *ppds_hash = NULL;
   GHashTable      *manufacturers_hash = NULL;
-  GAPData         *data = user_data;
+  GAPData         *data = task_data;
   PPDName         *item;
   ipp_t           *request;
   ipp_t           *response;
@@ -2507,7 +2565,7 @@ get_all_ppds_func (gpointer user_data)
   gint             i, j;
 
   request = ippNewRequest (CUPS_GET_PPDS);
-  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+  response = cupsDoRequest (get_cups_connection (), request, "/");
 
   if (response &&
       ippGetStatusCode (response) <= IPP_OK_CONFLICT)
@@ -2706,9 +2764,7 @@ get_all_ppds_func (gpointer user_data)
       g_hash_table_destroy (manufacturers_hash);
     }
 
-  get_all_ppds_cb (data);
-
-  return NULL;
+  g_task_return_pointer (task, g_steal_pointer (&data->result), (GDestroyNotify) ppd_list_free);
 }
 
 /*
@@ -2719,24 +2775,15 @@ get_all_ppds_async (GCancellable *cancellable,
                     GAPCallback   callback,
                     gpointer      user_data)
 {
-  GAPData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError)  error = NULL;
-
-  data = gap_data_new (cancellable, callback, user_data);
-
-  thread = g_thread_try_new ("get-all-ppds",
-                             get_all_ppds_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
+  g_autoptr(GTask) task = NULL;
 
-      gap_data_free (data);
-    }
+  /* The list is only needed once the user starts looking for a driver */
+  task = g_task_new (NULL, cancellable, get_all_ppds_cb, NULL);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+  g_task_set_task_data (task,
+                        gap_data_new (cancellable, callback, user_data),
+                        (GDestroyNotify) gap_data_free);
+  cups_task_run_in_pool (task, get_all_ppds_func);
 }
 
 PPDList *
@@ -2839,7 +2886,6 @@ typedef struct
   gchar        *result;
   PGPCallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } PGPData;
 
 static PGPData *
@@ -2853,7 +2899,6 @@ pgp_data_new (const gchar *printer_name, const gchar *host_name, gint port, PGPC
   data->port = port;
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -2864,39 +2909,28 @@ pgp_data_free (PGPData *data)
   g_free (data->printer_name);
   g_free (data->host_name);
   g_free (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-printer_get_ppd_idle_cb (gpointer user_data)
-{
-  PGPData *data = user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
 static void
-printer_get_ppd_cb (gpointer user_data)
+printer_get_ppd_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
 {
-  PGPData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  PGPData          *data = g_task_get_task_data (G_TASK (res));
+  g_autofree gchar *result = NULL;
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         printer_get_ppd_idle_cb,
-                         data,
-                         (GDestroyNotify) pgp_data_free);
-  g_source_attach (idle_source, data->context);
+  result = g_task_propagate_pointer (G_TASK (res), NULL);
+  data->callback (result, data->user_data);
 }
 
-static gpointer
-printer_get_ppd_func (gpointer user_data)
+static void
+printer_get_ppd_func (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
 {
-  PGPData *data = user_data;
+  PGPData *data = task_data;
 
   if (data->host_name)
     {
@@ -2916,12 +2950,10 @@ printer_get_ppd_func (gpointer user_data)
     }
   else
     {
-      data->result = g_strdup (cupsGetPPD (data->printer_name));
+      data->result = g_strdup (cupsGetPPD2 (get_cups_connection (), data->printer_name));
     }
 
-  printer_get_ppd_cb (data);
-
-  return NULL;
+  g_task_return_pointer (task, g_steal_pointer (&data->result), g_free);
 }
 
 void
@@ -2931,33 +2963,20 @@ printer_get_ppd_async (const gchar *printer_name,
                        PGPCallback  callback,
                        gpointer     user_data)
 {
-  PGPData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
-  data = pgp_data_new (printer_name, host_name, port, callback, user_data);
-
-  thread = g_thread_try_new ("printer-get-ppd",
-                             printer_get_ppd_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
+  g_autoptr(GTask) task = NULL;
 
-      pgp_data_free (data);
-    }
+  task = g_task_new (NULL, NULL, printer_get_ppd_cb, NULL);
+  g_task_set_task_data (task,
+                        pgp_data_new (printer_name, host_name, port, callback, user_data),
+                        (GDestroyNotify) pgp_data_free);
+  cups_task_run_in_pool (task, printer_get_ppd_func);
 }
 
 typedef struct
 {
   gchar        *printer_name;
-  cups_dest_t  *result;
   GNDCallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } GNDData;
 
 static GNDData *
@@ -2969,7 +2988,6 @@ gnd_data_new (const gchar *printer_name, GNDCallback callback, gpointer user_dat
   data->printer_name = g_strdup (printer_name);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -2978,45 +2996,36 @@ static void
 gnd_data_free (GNDData *data)
 {
   g_free (data->printer_name);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-get_named_dest_idle_cb (gpointer user_data)
+static void
+free_dest (cups_dest_t *dest)
 {
-  GNDData *data = user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
+  cupsFreeDests (1, dest);
 }
 
 static void
-get_named_dest_cb (gpointer user_data)
+get_named_dest_cb (GObject      *source_object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
 {
-  GNDData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  GNDData *data = g_task_get_task_data (G_TASK (res));
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_named_dest_idle_cb,
-                         data,
-                         (GDestroyNotify) gnd_data_free);
-  g_source_attach (idle_source, data->context);
+  data->callback (g_task_propagate_pointer (G_TASK (res), NULL), data->user_data);
 }
 
-static gpointer
-get_named_dest_func (gpointer user_data)
+static void
+get_named_dest_func (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
 {
-  GNDData *data = user_data;
-
-  data->result = cupsGetNamedDest (CUPS_HTTP_DEFAULT, data->printer_name, NULL);
+  GNDData *data = task_data;
 
-  get_named_dest_cb (data);
-
-  return NULL;
+  g_task_return_pointer (task,
+                         cupsGetNamedDest (get_cups_connection (), data->printer_name, NULL),
+                         (GDestroyNotify) free_dest);
 }
 
 void
@@ -3024,24 +3033,13 @@ get_named_dest_async (const gchar *printer_name,
                       GNDCallback  callback,
                       gpointer     user_data)
 {
-  GNDData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
-  data = gnd_data_new (printer_name, callback, user_data);
-
-  thread = g_thread_try_new ("get-named-dest",
-                             get_named_dest_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
+  g_autoptr(GTask) task = NULL;
 
-      gnd_data_free (data);
-    }
+  task = g_task_new (NULL, NULL, get_named_dest_cb, NULL);
+  g_task_set_task_data (task,
+                        gnd_data_new (printer_name, callback, user_data),
+                        (GDestroyNotify) gnd_data_free);
+  cups_task_run_in_pool (task, get_named_dest_func);
 }
 
 typedef struct
@@ -36,6 +36,16 @@ G_BEGIN_DECLS
 
 typedef void (*UserResponseCallback) (GtkDialog *dialog, gint response_id, gpointer user_data);
 
+/*
+ * Maximum number of concurrent requests to the CUPS server.
+ */
+#define CUPS_WORKERS_MAX 4
+
+void        cups_task_run_in_pool (GTask           *task,
+                                   GTaskThreadFunc  task_func);
+
+http_t     *get_cups_connection (void);
+
 /*
  * Match level of PPD driver.
  */
@@ -32,11 +32,18 @@
 #include "list-box-helper.h"
 #include "cc-common-language.h"
 #include "cc-format-preview.h"
+#include "cc-locale-index.h"
 #include "cc-util.h"
 
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 #include <libgnome-desktop/gnome-languages.h>
 
+/* How many more rows to create once the list is scrolled near its end */
+#define ROWS_PER_BATCH 50
+
+/* How many rows on each side of the focused one to load the preview of */
+#define PREFETCH_ROWS 8
+
 struct _CcFormatChooser {
         GtkDialog parent_instance;
 
@@ -55,6 +62,12 @@ struct _CcFormatChooser {
         GtkWidget *region_title;
         GtkWidget *region_listbox;
         CcFormatPreview *format_preview;
+        GCancellable *cancellable;
+        CcLocaleIndex *index;
+        /* CcLocaleEntry → row, for the rows of region_listbox created so far */
+        GHashTable *region_rows;
+        /* position in the sorted entries the next batch starts from */
+        guint n_sorted_done;
         gboolean adding;
         gboolean showing_extra;
         gboolean no_results;
@@ -65,6 +78,8 @@ struct _CcFormatChooser {
 
 G_DEFINE_TYPE (CcFormatChooser, cc_format_chooser, GTK_TYPE_DIALOG)
 
+static void filter_changed (CcFormatChooser *chooser);
+
 static void
 update_check_button_for_list (GtkWidget   *list_box,
                               const gchar *locale_id)
@@ -107,18 +122,18 @@ sort_regions (gconstpointer a,
               gconstpointer b,
               gpointer      data)
 {
-        const gchar *la;
-        const gchar *lb;
+        const CcLocaleEntry *la;
+        const CcLocaleEntry *lb;
+
+        la = g_object_get_data (G_OBJECT (a), "locale-entry");
+        lb = g_object_get_data (G_OBJECT (b), "locale-entry");
 
-        if (g_object_get_data (G_OBJECT (a), "locale-id") == NULL)
+        if (la == NULL)
                 return 1;
-        if (g_object_get_data (G_OBJECT (b), "locale-id") == NULL)
+        if (lb == NULL)
                 return -1;
 
-        la = g_object_get_data (G_OBJECT (a), "locale-name");
-        lb = g_object_get_data (G_OBJECT (b), "locale-name");
-
-        return g_strcmp0 (la, lb);
+        return cc_locale_entry_compare_region (la, lb);
 }
 
 static GtkWidget *
@@ -198,7 +213,7 @@ preview_button_clicked_cb (CcFormatChooser *self,
                            GtkWidget       *button)
 {
   GtkWidget *row;
-  const gchar *region, *locale_name;
+  const CcLocaleEntry *entry;
 
   g_assert (CC_IS_FORMAT_CHOOSER (self));
   g_assert (GTK_IS_WIDGET (button));
@@ -206,38 +221,29 @@ preview_button_clicked_cb (CcFormatChooser *self,
   row = gtk_widget_get_ancestor (button, GTK_TYPE_LIST_BOX_ROW);
   g_assert (row);
 
-  region = g_object_get_data (G_OBJECT (row), "locale-id");
-  locale_name = g_object_get_data (G_OBJECT (row), "locale-name");
-  cc_format_preview_set_region (self->format_preview, region);
+  entry = g_object_get_data (G_OBJECT (row), "locale-entry");
+  cc_format_preview_set_region (self->format_preview, entry->locale_id);
 
   hdy_leaflet_set_visible_child_name (HDY_LEAFLET (self->main_leaflet), "preview");
   gtk_stack_set_visible_child (GTK_STACK (self->title_buttons), self->back_button);
   gtk_widget_hide (self->done_button);
 
-  if (locale_name)
-    gtk_header_bar_set_title (GTK_HEADER_BAR (self->title_bar), locale_name);
+  gtk_header_bar_set_title (GTK_HEADER_BAR (self->title_bar), entry->region);
 }
 
 static GtkWidget *
-region_widget_new (CcFormatChooser *self,
-                   const gchar     *locale_id)
+region_widget_new (CcFormatChooser     *self,
+                   const CcLocaleEntry *entry)
 {
-        gchar *locale_name;
-        gchar *locale_current_name;
-        gchar *locale_untranslated_name;
         GtkWidget *row, *box, *button;
         GtkWidget *check;
 
-        locale_name = gnome_get_country_from_locale (locale_id, locale_id);
-        if (!locale_name)
+        if (!entry->region)
           return NULL;
 
-        locale_current_name = gnome_get_country_from_locale (locale_id, NULL);
-        locale_untranslated_name = gnome_get_country_from_locale (locale_id, "C");
-
         row = gtk_list_box_row_new ();
         gtk_widget_show (row);
-        box = padded_label_new (locale_name);
+        box = padded_label_new (entry->region);
         gtk_widget_show (box);
         gtk_container_add (GTK_CONTAINER (row), box);
 
@@ -250,38 +256,41 @@ region_widget_new (CcFormatChooser *self,
         check = gtk_image_new ();
         gtk_widget_show (check);
         gtk_image_set_from_icon_name (GTK_IMAGE (check), "object-select-symbolic", GTK_ICON_SIZE_MENU);
-        gtk_widget_set_opacity (check, 0.0);
+        gtk_widget_set_opacity (check, g_strcmp0 (entry->locale_id, self->region) == 0 ? 1.0 : 0.0);
         g_object_set (check, "icon-size", GTK_ICON_SIZE_MENU, NULL);
         gtk_container_add (GTK_CONTAINER (box), check);
 
         g_object_set_data (G_OBJECT (row), "check", check);
         g_object_set_data (G_OBJECT (row), "preview-button", button);
-        g_object_set_data_full (G_OBJECT (row), "locale-id", g_strdup (locale_id), g_free);
-        g_object_set_data_full (G_OBJECT (row), "locale-name", locale_name, g_free);
-        g_object_set_data_full (G_OBJECT (row), "locale-current-name", locale_current_name, g_free);
-        g_object_set_data_full (G_OBJECT (row), "locale-untranslated-name", locale_untranslated_name, g_free);
+        g_object_set_data (G_OBJECT (row), "locale-id", entry->locale_id);
+        g_object_set_data (G_OBJECT (row), "locale-entry", (gpointer) entry);
+
+        cc_format_chooser_preview_button_set_visible (GTK_LIST_BOX_ROW (row),
+                                                      GINT_TO_POINTER (hdy_leaflet_get_folded (HDY_LEAFLET (self->main_leaflet))));
 
         return row;
 }
 
 static void
-add_regions (CcFormatChooser *chooser,
-             gchar          **locale_ids,
-             GHashTable      *initial)
+add_common_regions (CcFormatChooser *chooser)
 {
+        g_autoptr(GHashTable) initial = NULL;
         g_autoptr(GList) initial_locales = NULL;
         GtkWidget *widget;
         GList *l;
 
-        chooser->adding = TRUE;
+        initial = cc_common_language_get_initial_languages ();
         initial_locales = g_hash_table_get_keys (initial);
 
-        /* Populate Common Locales */
+        chooser->adding = TRUE;
+
         for (l = initial_locales; l != NULL; l = l->next) {
-                if (!cc_common_language_has_font (l->data))
+                const CcLocaleEntry *entry = cc_locale_index_ensure (chooser->index, l->data);
+
+                if (!entry->has_font)
                         continue;
 
-                widget = region_widget_new (chooser, l->data);
+                widget = region_widget_new (chooser, entry);
                 if (!widget)
                         continue;
 
@@ -289,49 +298,81 @@ add_regions (CcFormatChooser *chooser,
                 gtk_container_add (GTK_CONTAINER (chooser->common_region_listbox), widget);
           }
 
-        /* Populate All locales */
-        while (*locale_ids) {
-                gchar *locale_id;
+        chooser->adding = FALSE;
+}
 
-                locale_id = *locale_ids;
-                locale_ids ++;
+/* Creates up to n_rows more rows of the full list, following the sort order */
+static void
+add_more_regions (CcFormatChooser *chooser,
+                  guint            n_rows)
+{
+        GPtrArray *sorted;
 
-                if (!cc_common_language_has_font (locale_id))
-                        continue;
+        /* not loaded yet, or disposed */
+        if (chooser->index == NULL || chooser->region_rows == NULL)
+                return;
 
-                widget = region_widget_new (chooser, locale_id);
-                if (!widget)
-                  continue;
+        chooser->adding = TRUE;
 
-                gtk_widget_show (widget);
+        sorted = cc_locale_index_get_by_region (chooser->index);
+        while (chooser->n_sorted_done < sorted->len && n_rows > 0) {
+                const CcLocaleEntry *entry = g_ptr_array_index (sorted, chooser->n_sorted_done++);
+                GtkWidget *widget;
+
+                if (!entry->has_font || g_hash_table_contains (chooser->region_rows, entry))
+                        continue;
+
+                widget = region_widget_new (chooser, entry);
                 gtk_container_add (GTK_CONTAINER (chooser->region_listbox), widget);
+                g_hash_table_insert (chooser->region_rows, (gpointer) entry, widget);
+                n_rows--;
         }
 
         chooser->adding = FALSE;
 }
 
 static void
-add_all_regions (CcFormatChooser *chooser)
+region_vadjustment_changed_cb (CcFormatChooser *chooser,
+                               GtkAdjustment   *adjustment)
 {
-        g_auto(GStrv) locale_ids = NULL;
-        g_autoptr(GHashTable) initial = NULL;
+        gdouble value, page_size, upper;
 
-        locale_ids = gnome_get_all_locales ();
-        initial = cc_common_language_get_initial_languages ();
-        add_regions (chooser, locale_ids, initial);
+        if (chooser->filter_words)
+                return;
+
+        /* Adding rows changes the upper bound, which gets us here again
+         * until a page's worth of rows is past the visible ones */
+        value = gtk_adjustment_get_value (adjustment);
+        page_size = gtk_adjustment_get_page_size (adjustment);
+        upper = gtk_adjustment_get_upper (adjustment);
+        if (value + 2 * page_size >= upper)
+                add_more_regions (chooser, ROWS_PER_BATCH);
 }
 
-static gboolean
-match_all (gchar       **words,
-           const gchar  *str)
+static void
+locale_index_ready_cb (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
 {
-        gchar **w;
+        CcFormatChooser *chooser;
+        g_autoptr(GError) error = NULL;
+        CcLocaleIndex *index;
+
+        index = cc_locale_index_get_default_finish (res, &error);
+        if (index == NULL) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Failed to load the formats: %s", error->message);
+                return;
+        }
+
+        chooser = CC_FORMAT_CHOOSER (user_data);
+        chooser->index = index;
 
-        for (w = words; *w; ++w)
-                if (!strstr (str, *w))
-                        return FALSE;
+        add_common_regions (chooser);
+        add_more_regions (chooser, chooser->filter_words ? G_MAXUINT : ROWS_PER_BATCH);
 
-        return TRUE;
+        if (chooser->filter_words)
+                filter_changed (chooser);
 }
 
 static gboolean
@@ -339,30 +380,14 @@ region_visible (GtkListBoxRow *row,
                 gpointer   user_data)
 {
         CcFormatChooser *chooser = user_data;
-        g_autofree gchar *locale_name = NULL;
-        g_autofree gchar *locale_current_name = NULL;
-        g_autofree gchar *locale_untranslated_name = NULL;
+        const CcLocaleEntry *entry;
         gboolean match = TRUE;
 
-        if (!chooser->filter_words)
-          goto end;
-
-        locale_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-name"));
-        if (match_all (chooser->filter_words, locale_name))
-          goto end;
-
-        locale_current_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-current-name"));
-        if (match_all (chooser->filter_words, locale_current_name))
-          goto end;
-
-        locale_untranslated_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-untranslated-name"));
-
-        match = match_all (chooser->filter_words, locale_untranslated_name);
+        if (chooser->filter_words) {
+                entry = g_object_get_data (G_OBJECT (row), "locale-entry");
+                match = cc_locale_entry_match_region (entry, chooser->filter_words);
+        }
 
- end:
         if (match)
           chooser->no_results = FALSE;
         return match;
@@ -394,6 +419,9 @@ filter_changed (CcFormatChooser *chooser)
                 return;
         }
         chooser->filter_words = g_strsplit_set (g_strstrip (filter_contents), " ", 0);
+
+        /* matches can be anywhere in the list */
+        add_more_regions (chooser, G_MAXUINT);
         gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->region_listbox));
 
         if (chooser->no_results)
@@ -404,6 +432,43 @@ filter_changed (CcFormatChooser *chooser)
                                        GTK_WIDGET (chooser->region_list));
 }
 
+static void
+listbox_set_focus_child_cb (CcFormatChooser *chooser,
+                            GtkWidget       *child,
+                            GtkListBox      *list_box)
+{
+        g_autoptr(GPtrArray) regions = NULL;
+        gint index, i;
+
+        if (child == NULL || !GTK_IS_LIST_BOX_ROW (child))
+                return;
+
+        /* Keyboard navigation goes to the rows next to the focused one,
+         * so load those first */
+        regions = g_ptr_array_new ();
+        index = gtk_list_box_row_get_index (GTK_LIST_BOX_ROW (child));
+        for (i = 0; i <= 2 * PREFETCH_ROWS; i++) {
+                gint offset = (i % 2 == 0) ? -(i / 2) : (i + 1) / 2;
+                GtkListBoxRow *row;
+                const gchar *locale_id;
+
+                if (index + offset < 0)
+                        continue;
+
+                row = gtk_list_box_get_row_at_index (list_box, index + offset);
+                if (row == NULL || !gtk_widget_get_child_visible (GTK_WIDGET (row)))
+                        continue;
+
+                locale_id = g_object_get_data (G_OBJECT (row), "locale-id");
+                if (locale_id != NULL)
+                        g_ptr_array_add (regions, (gpointer) locale_id);
+        }
+        g_ptr_array_add (regions, NULL);
+
+        cc_format_preview_prefetch_regions (chooser->format_preview,
+                                            (const gchar * const *) regions->pdata);
+}
+
 static void
 row_activated (CcFormatChooser *chooser,
                GtkListBoxRow   *row)
@@ -446,6 +511,10 @@ cc_format_chooser_dispose (GObject *object)
 {
         CcFormatChooser *chooser = CC_FORMAT_CHOOSER (object);
 
+        g_cancellable_cancel (chooser->cancellable);
+        g_clear_object (&chooser->cancellable);
+        chooser->index = NULL;
+        g_clear_pointer (&chooser->region_rows, g_hash_table_unref);
         g_clear_pointer (&chooser->filter_words, g_strfreev);
         g_clear_pointer (&chooser->region, g_free);
 
@@ -489,6 +558,8 @@ cc_format_chooser_class_init (CcFormatChooserClass *klass)
 void
 cc_format_chooser_init (CcFormatChooser *chooser)
 {
+        GtkAdjustment *adjustment;
+
         gtk_widget_init_template (GTK_WIDGET (chooser));
 
         gtk_list_box_set_sort_func (GTK_LIST_BOX (chooser->common_region_listbox),
@@ -502,10 +573,24 @@ cc_format_chooser_init (CcFormatChooser *chooser)
         gtk_list_box_set_header_func (GTK_LIST_BOX (chooser->common_region_listbox),
                                       cc_list_box_update_header_func, NULL, NULL);
 
-        add_all_regions (chooser);
-        gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->region_listbox));
+        chooser->region_rows = g_hash_table_new (NULL, NULL);
+        chooser->cancellable = g_cancellable_new ();
+
+        adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->region_list));
+        g_signal_connect_object (adjustment, "changed",
+                                 G_CALLBACK (region_vadjustment_changed_cb), chooser, G_CONNECT_SWAPPED);
+        g_signal_connect_object (adjustment, "value-changed",
+                                 G_CALLBACK (region_vadjustment_changed_cb), chooser, G_CONNECT_SWAPPED);
+
+        g_signal_connect_object (chooser->common_region_listbox, "set-focus-child",
+                                 G_CALLBACK (listbox_set_focus_child_cb), chooser, G_CONNECT_SWAPPED);
+        g_signal_connect_object (chooser->region_listbox, "set-focus-child",
+                                 G_CALLBACK (listbox_set_focus_child_cb), chooser, G_CONNECT_SWAPPED);
+
         format_chooser_leaflet_fold_changed_cb (chooser);
 
+        cc_locale_index_get_default (chooser->cancellable, locale_index_ready_cb, chooser);
+
         g_signal_connect_object (chooser, "activate-default",
                                  G_CALLBACK (activate_default), chooser, G_CONNECT_SWAPPED);
 }
@@ -0,0 +1,314 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-format-examples.h"
+
+#include <errno.h>
+#include <langinfo.h>
+#include <gtk/gtk.h>
+
+/*
+ * Loading a locale is what makes the format preview slow, so the locales of
+ * the last few regions are kept loaded, along with the examples that don't
+ * depend on the time.  The cache itself is only touched from the main
+ * thread; prefetching loads the locales in a worker thread, then adds them
+ * to the cache once back in the main thread.
+ */
+
+struct _CcFormatExamplesCache
+{
+  guint         max_entries;
+
+  /* CcFormatExamples, most recently used first */
+  GQueue        entries;
+  /* region → GList link in entries */
+  GHashTable   *links;
+
+  GCancellable *cancellable;
+  gboolean      prefetching;
+  GStrv         pending_regions;
+};
+
+static int
+format_examples_mask (void)
+{
+  int mask = LC_TIME_MASK | LC_NUMERIC_MASK;
+
+#ifdef LC_MEASUREMENT
+  mask |= LC_MEASUREMENT_MASK;
+#endif
+#ifdef LC_PAPER
+  mask |= LC_PAPER_MASK;
+#endif
+
+  return mask;
+}
+
+/* Safe to call from any thread */
+static CcFormatExamples *
+format_examples_new (const gchar *region)
+{
+  CcFormatExamples *examples;
+  locale_t old_locale = (locale_t) 0;
+#ifdef LC_MEASUREMENT
+  const gchar *fmt;
+#endif
+#ifdef LC_PAPER
+  g_autoptr(GtkPaperSize) paper = NULL;
+#endif
+
+  examples = g_new0 (CcFormatExamples, 1);
+  examples->region = g_strdup (region);
+
+  examples->locale = newlocale (format_examples_mask (), region, (locale_t) 0);
+  if (examples->locale == (locale_t) 0)
+    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
+  else
+    old_locale = uselocale (examples->locale);
+
+  examples->number = g_strdup_printf ("%'.2f", 123456789.00);
+
+#ifdef LC_MEASUREMENT
+  fmt = nl_langinfo (_NL_MEASUREMENT_MEASUREMENT);
+  examples->imperial = fmt && *fmt == 2;
+#endif
+
+#ifdef LC_PAPER
+  paper = gtk_paper_size_new (gtk_paper_size_get_default ());
+  examples->paper = g_strdup (gtk_paper_size_get_display_name (paper));
+#endif
+
+  if (examples->locale != (locale_t) 0)
+    uselocale (old_locale);
+
+  return examples;
+}
+
+static void
+format_examples_free (CcFormatExamples *examples)
+{
+  if (examples->locale != (locale_t) 0)
+    freelocale (examples->locale);
+  g_free (examples->region);
+  g_free (examples->number);
+  g_free (examples->paper);
+  g_free (examples);
+}
+
+CcFormatExamplesCache *
+cc_format_examples_cache_new (guint max_entries)
+{
+  CcFormatExamplesCache *cache;
+
+  g_return_val_if_fail (max_entries > 0, NULL);
+
+  cache = g_new0 (CcFormatExamplesCache, 1);
+  cache->max_entries = max_entries;
+  g_queue_init (&cache->entries);
+  cache->links = g_hash_table_new (g_str_hash, g_str_equal);
+  cache->cancellable = g_cancellable_new ();
+
+  return cache;
+}
+
+void
+cc_format_examples_cache_free (CcFormatExamplesCache *cache)
+{
+  g_cancellable_cancel (cache->cancellable);
+  g_object_unref (cache->cancellable);
+  g_strfreev (cache->pending_regions);
+  g_hash_table_unref (cache->links);
+  g_queue_foreach (&cache->entries, (GFunc) format_examples_free, NULL);
+  g_queue_clear (&cache->entries);
+  g_free (cache);
+}
+
+static void
+cache_insert (CcFormatExamplesCache *cache,
+              CcFormatExamples      *examples)
+{
+  g_queue_push_head (&cache->entries, examples);
+  g_hash_table_insert (cache->links, examples->region, cache->entries.head);
+
+  while (cache->entries.length > cache->max_entries)
+    {
+      CcFormatExamples *oldest = g_queue_pop_tail (&cache->entries);
+
+      g_hash_table_remove (cache->links, oldest->region);
+      format_examples_free (oldest);
+    }
+}
+
+/* Like cc_format_examples_cache_lookup(), without loading the locale */
+const CcFormatExamples *
+cc_format_examples_cache_peek (CcFormatExamplesCache *cache,
+                               const gchar           *region)
+{
+  GList *link;
+
+  link = g_hash_table_lookup (cache->links, region);
+  if (link == NULL)
+    return NULL;
+
+  g_queue_unlink (&cache->entries, link);
+  g_queue_push_head_link (&cache->entries, link);
+
+  return link->data;
+}
+
+/*
+ * Returns the examples of the region, loading its locale if it's not
+ * cached.  They're valid until the cache is next used.
+ */
+const CcFormatExamples *
+cc_format_examples_cache_lookup (CcFormatExamplesCache *cache,
+                                 const gchar           *region)
+{
+  const CcFormatExamples *examples;
+  CcFormatExamples *new_examples;
+
+  examples = cc_format_examples_cache_peek (cache, region);
+  if (examples != NULL)
+    return examples;
+
+  new_examples = format_examples_new (region);
+  cache_insert (cache, new_examples);
+
+  return new_examples;
+}
+
+static void
+prefetch_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+  g_autoptr(GPtrArray) loaded = NULL;
+  gchar **regions = task_data;
+  guint i;
+
+  loaded = g_ptr_array_new_with_free_func ((GDestroyNotify) format_examples_free);
+  for (i = 0; regions[i] != NULL; i++)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+      g_ptr_array_add (loaded, format_examples_new (regions[i]));
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&loaded), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void start_prefetch (CcFormatExamplesCache *cache,
+                            GStrv                  regions);
+
+static void
+prefetch_cb (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  CcFormatExamplesCache *cache;
+  g_autoptr(GPtrArray) loaded = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  loaded = g_task_propagate_pointer (G_TASK (res), &error);
+  if (loaded == NULL)
+    return;
+
+  cache = user_data;
+  cache->prefetching = FALSE;
+
+  g_ptr_array_set_free_func (loaded, NULL);
+  for (i = 0; i < loaded->len; i++)
+    {
+      CcFormatExamples *examples = g_ptr_array_index (loaded, i);
+
+      /* The ones looked up in the meantime are already there */
+      if (g_hash_table_contains (cache->links, examples->region))
+        format_examples_free (examples);
+      else
+        cache_insert (cache, examples);
+    }
+
+  if (cache->pending_regions != NULL)
+    start_prefetch (cache, g_steal_pointer (&cache->pending_regions));
+}
+
+static void
+start_prefetch (CcFormatExamplesCache *cache,
+                GStrv                  regions)
+{
+  g_autoptr(GPtrArray) missing = NULL;
+  g_autoptr(GTask) task = NULL;
+  guint i;
+
+  missing = g_ptr_array_new ();
+  for (i = 0; regions[i] != NULL; i++)
+    {
+      if (!g_hash_table_contains (cache->links, regions[i]))
+        g_ptr_array_add (missing, g_strdup (regions[i]));
+    }
+  g_strfreev (regions);
+
+  if (missing->len == 0)
+    return;
+  g_ptr_array_add (missing, NULL);
+
+  cache->prefetching = TRUE;
+
+  task = g_task_new (NULL, cache->cancellable, prefetch_cb, cache);
+  g_task_set_source_tag (task, cc_format_examples_cache_prefetch);
+  g_task_set_task_data (task, g_ptr_array_free (g_steal_pointer (&missing), FALSE), (GDestroyNotify) g_strfreev);
+  g_task_run_in_thread (task, prefetch_thread);
+}
+
+/*
+ * Loads the locales of the regions that aren't cached in a worker thread.
+ * While one batch is being loaded, only the latest request is kept.
+ */
+void
+cc_format_examples_cache_prefetch (CcFormatExamplesCache *cache,
+                                   const gchar * const   *regions)
+{
+  if (cache->prefetching)
+    {
+      g_strfreev (cache->pending_regions);
+      cache->pending_regions = g_strdupv ((gchar **) regions);
+      return;
+    }
+
+  start_prefetch (cache, g_strdupv ((gchar **) regions));
+}
+
+/* Formats the time in the locale of the region, returning it stripped */
+gchar *
+cc_format_examples_format_date (const CcFormatExamples *examples,
+                                GDateTime              *dt,
+                                const gchar            *format)
+{
+  locale_t old_locale = (locale_t) 0;
+  gchar *s;
+
+  if (examples->locale != (locale_t) 0)
+    old_locale = uselocale (examples->locale);
+
+  s = g_date_time_format (dt, format);
+
+  if (examples->locale != (locale_t) 0)
+    uselocale (old_locale);
+
+  return g_strstrip (s);
+}
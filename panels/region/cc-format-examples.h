@@ -0,0 +1,54 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <locale.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar    *region;
+
+  /* (locale_t) 0 if the locale couldn't be loaded */
+  locale_t  locale;
+
+  gchar    *number;
+  gboolean  imperial;
+  gchar    *paper;
+} CcFormatExamples;
+
+typedef struct _CcFormatExamplesCache CcFormatExamplesCache;
+
+CcFormatExamplesCache  *cc_format_examples_cache_new      (guint                   max_entries);
+void                    cc_format_examples_cache_free     (CcFormatExamplesCache  *cache);
+
+const CcFormatExamples *cc_format_examples_cache_lookup   (CcFormatExamplesCache  *cache,
+                                                           const gchar            *region);
+const CcFormatExamples *cc_format_examples_cache_peek     (CcFormatExamplesCache  *cache,
+                                                           const gchar            *region);
+void                    cc_format_examples_cache_prefetch (CcFormatExamplesCache  *cache,
+                                                           const gchar * const    *regions);
+
+gchar                  *cc_format_examples_format_date    (const CcFormatExamples *examples,
+                                                           GDateTime              *dt,
+                                                           const gchar            *format);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcFormatExamplesCache, cc_format_examples_cache_free)
+
+G_END_DECLS
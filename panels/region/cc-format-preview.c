@@ -23,14 +23,16 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+#include "cc-format-examples.h"
 #include "cc-format-preview.h"
 
-#include <errno.h>
 #include <locale.h>
-#include <langinfo.h>
 #include <string.h>
 #include <glib/gi18n.h>
 
+/* Enough for the rows around the focused one to stay loaded */
+#define MAX_CACHED_REGIONS 32
+
 struct _CcFormatPreview {
   GtkDialog  parent_instance;
 
@@ -42,6 +44,7 @@ struct _CcFormatPreview {
   GtkWidget *time_format_label;
 
   gchar     *region;
+  CcFormatExamplesCache *examples;
 };
 
 enum
@@ -53,111 +56,43 @@ enum
 G_DEFINE_TYPE (CcFormatPreview, cc_format_preview, GTK_TYPE_BOX)
 
 static void
-display_date (GtkWidget *label, GDateTime *dt, const gchar *format)
+display_date (GtkWidget              *label,
+              const CcFormatExamples *examples,
+              GDateTime              *dt,
+              const gchar            *format)
 {
-  g_autofree gchar *s = g_date_time_format (dt, format);
-  gtk_label_set_text (GTK_LABEL (label), g_strstrip (s));
+  g_autofree gchar *s = cc_format_examples_format_date (examples, dt, format);
+  gtk_label_set_text (GTK_LABEL (label), s);
 }
 
 static void
 update_format_examples (CcFormatPreview *self)
 {
   const gchar *region = self->region;
-  locale_t locale;
-  locale_t old_locale;
+  const CcFormatExamples *examples;
   g_autoptr(GDateTime) dt = NULL;
-  g_autofree gchar *s = NULL;
-  const gchar *fmt;
-  g_autoptr(GtkPaperSize) paper = NULL;
 
   if (region == NULL || region[0] == '\0')
     return;
 
-  locale = newlocale (LC_TIME_MASK, region, (locale_t) 0);
-  if (locale == (locale_t) 0)
-    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
-  else
-    old_locale = uselocale (locale);
+  examples = cc_format_examples_cache_lookup (self->examples, region);
 
   dt = g_date_time_new_now_local ();
-  display_date (self->date_format_label, dt, "%x");
-  display_date (self->time_format_label, dt, "%X");
-  display_date (self->date_time_format_label, dt, "%c");
-
-  if (locale != (locale_t) 0)
-    {
-      uselocale (old_locale);
-      freelocale (locale);
-    }
-
-  locale = newlocale (LC_NUMERIC_MASK, region, (locale_t) 0);
-  if (locale == (locale_t) 0)
-    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
-  else
-    old_locale = uselocale (locale);
+  display_date (self->date_format_label, examples, dt, "%x");
+  display_date (self->time_format_label, examples, dt, "%X");
+  display_date (self->date_time_format_label, examples, dt, "%c");
 
-  s = g_strdup_printf ("%'.2f", 123456789.00);
-  gtk_label_set_text (GTK_LABEL (self->number_format_label), s);
-
-  if (locale != (locale_t) 0)
-    {
-      uselocale (old_locale);
-      freelocale (locale);
-    }
-
-#if 0
-  locale = newlocale (LC_MONETARY_MASK, region, (locale_t) 0);
-  if (locale == (locale_t) 0)
-    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
-  else
-    old_locale = uselocale (locale);
-
-  num_info = localeconv ();
-  if (num_info != NULL)
-    gtk_label_set_text (GTK_LABEL (self->currency_format_label), num_info->currency_symbol);
-
-  if (locale != (locale_t) 0)
-    {
-      uselocale (old_locale);
-      freelocale (locale);
-    }
-#endif
+  gtk_label_set_text (GTK_LABEL (self->number_format_label), examples->number);
 
 #ifdef LC_MEASUREMENT
-  locale = newlocale (LC_MEASUREMENT_MASK, region, (locale_t) 0);
-  if (locale == (locale_t) 0)
-    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
-  else
-    old_locale = uselocale (locale);
-
-  fmt = nl_langinfo (_NL_MEASUREMENT_MEASUREMENT);
-  if (fmt && *fmt == 2)
+  if (examples->imperial)
     gtk_label_set_text (GTK_LABEL (self->measurement_format_label), C_("measurement format", "Imperial"));
   else
     gtk_label_set_text (GTK_LABEL (self->measurement_format_label), C_("measurement format", "Metric"));
-
-  if (locale != (locale_t) 0)
-    {
-      uselocale (old_locale);
-      freelocale (locale);
-    }
 #endif
 
 #ifdef LC_PAPER
-  locale = newlocale (LC_PAPER_MASK, region, (locale_t) 0);
-  if (locale == (locale_t) 0)
-    g_warning ("Failed to create locale %s: %s", region, g_strerror (errno));
-  else
-    old_locale = uselocale (locale);
-
-  paper = gtk_paper_size_new (gtk_paper_size_get_default ());
-  gtk_label_set_text (GTK_LABEL (self->paper_format_label), gtk_paper_size_get_display_name (paper));
-
-  if (locale != (locale_t) 0)
-    {
-      uselocale (old_locale);
-      freelocale (locale);
-    }
+  gtk_label_set_text (GTK_LABEL (self->paper_format_label), examples->paper);
 #endif
 }
 
@@ -207,6 +142,7 @@ cc_format_preview_finalize (GObject *object)
   CcFormatPreview *self = CC_FORMAT_PREVIEW (object);
 
   g_clear_pointer (&self->region, g_free);
+  g_clear_pointer (&self->examples, cc_format_examples_cache_free);
 
   G_OBJECT_CLASS (cc_format_preview_parent_class)->finalize (object);
 }
@@ -243,6 +179,8 @@ void
 cc_format_preview_init (CcFormatPreview *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  self->examples = cc_format_examples_cache_new (MAX_CACHED_REGIONS);
 }
 
 void
@@ -253,3 +191,13 @@ cc_format_preview_set_region (CcFormatPreview *preview,
   preview->region = g_strdup (region);
   update_format_examples (preview);
 }
+
+/* Loads the regions likely to be previewed next in the background */
+void
+cc_format_preview_prefetch_regions (CcFormatPreview     *preview,
+                                    const gchar * const *regions)
+{
+  g_return_if_fail (CC_IS_FORMAT_PREVIEW (preview));
+
+  cc_format_examples_cache_prefetch (preview->examples, regions);
+}
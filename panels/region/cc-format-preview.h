@@ -32,7 +32,9 @@ G_BEGIN_DECLS
 #define CC_TYPE_FORMAT_PREVIEW (cc_format_preview_get_type())
 G_DECLARE_FINAL_TYPE (CcFormatPreview, cc_format_preview, CC, FORMAT_PREVIEW, GtkBox)
 
-void cc_format_preview_set_region (CcFormatPreview *preview,
-                                   const gchar     *region);
+void cc_format_preview_set_region       (CcFormatPreview     *preview,
+                                         const gchar         *region);
+void cc_format_preview_prefetch_regions (CcFormatPreview     *preview,
+                                         const gchar * const *regions);
 
 G_END_DECLS
@@ -17,6 +17,7 @@
  */
 
 #include "cc-level-bar.h"
+#include "cc-level-meter.h"
 #include "cc-sound-enums.h"
 #include "gvc-mixer-stream-private.h"
 
@@ -26,9 +27,19 @@ struct _CcLevelBar
 
   CcStreamType          type;
   pa_stream            *level_stream;
-  gdouble               last_input_peak;
 
-  gdouble               value;
+  CcLevelMeter          meter;
+
+  guint                 tick_id;
+  gint64                last_frame_time;
+
+  /* LED strips pre-rendered at the current size */
+  cairo_surface_t      *inactive_surface;
+  cairo_surface_t      *active_surface;
+  gint                  surface_width;
+  gint                  surface_height;
+  gint                  surface_scale;
+  CcStreamType          surface_type;
 };
 
 G_DEFINE_TYPE (CcLevelBar, cc_level_bar, GTK_TYPE_WIDGET)
@@ -37,24 +48,60 @@ G_DEFINE_TYPE (CcLevelBar, cc_level_bar, GTK_TYPE_WIDGET)
 #define LED_HEIGHT  3
 #define LED_SPACING 4
 
-#define DECAY_STEP .15
+/* The peak detect stream delivers one sample per 1 / LEVEL_RATE seconds,
+ * batched into fragments of LEVEL_FRAGMENT_SAMPLES samples, so the read
+ * callback runs 25 times a second. */
+#define LEVEL_RATE             200
+#define LEVEL_FRAGMENT_SAMPLES 8
+
+static const GdkRGBA inactive_color = { 192 / 255.0, 192 / 255.0, 192 / 255.0, 1.0 };
+static const GdkRGBA output_color = { 74 / 255.0, 144 / 255.0, 217 / 255.0, 1.0 };
+static const GdkRGBA input_color = { 1.0, 0.0, 0.0, 1.0 };
 
 static void
-set_peak (CcLevelBar *self,
-          gdouble     value)
+clear_surfaces (CcLevelBar *self)
 {
-  if (value < 0)
-     value = 0;
-  if (value > 1)
-     value = 1;
+  g_clear_pointer (&self->inactive_surface, cairo_surface_destroy);
+  g_clear_pointer (&self->active_surface, cairo_surface_destroy);
+}
 
-  if (self->last_input_peak >= DECAY_STEP &&
-      value < self->last_input_peak - DECAY_STEP)
-    value = self->last_input_peak - DECAY_STEP;
-  self->last_input_peak = value;
+static void
+reset_levels (CcLevelBar *self)
+{
+  cc_level_meter_reset (&self->meter);
+  self->last_frame_time = 0;
+}
 
-  self->value = value;
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+static gboolean
+tick_cb (GtkWidget     *widget,
+         GdkFrameClock *frame_clock,
+         gpointer       user_data)
+{
+  CcLevelBar *self = CC_LEVEL_BAR (widget);
+  gint64 frame_time;
+  gdouble elapsed;
+  gint resolution;
+
+  frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+  if (self->last_frame_time == 0)
+    elapsed = 1.0 / LEVEL_RATE;
+  else
+    elapsed = CLAMP ((frame_time - self->last_frame_time) / (gdouble) G_USEC_PER_SEC, 0.0, 0.1);
+  self->last_frame_time = frame_time;
+
+  /* Only redraw once the levels move by at least a device pixel */
+  resolution = gtk_widget_get_allocated_width (widget) * gtk_widget_get_scale_factor (widget);
+  if (cc_level_meter_update (&self->meter, elapsed, resolution))
+    gtk_widget_queue_draw (widget);
+
+  /* Stop ticking once silent; the next fragment starts it again */
+  if (cc_level_meter_is_silent (&self->meter))
+    {
+      reset_levels (self);
+      self->tick_id = 0;
+    }
+
+  return self->tick_id != 0 ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
 }
 
 static void
@@ -63,29 +110,39 @@ read_cb (pa_stream *stream,
          void      *userdata)
 {
   CcLevelBar *self = userdata;
-  const void *data;
-  gdouble value;
 
-  if (pa_stream_peek (stream, &data, &length) < 0)
+  while (pa_stream_readable_size (stream) > 0)
     {
-      g_warning ("Failed to read data from stream");
-      return;
-    }
+      const void *data;
 
-  if (!data)
-    {
-      pa_stream_drop (stream);
-      return;
-    }
+      if (pa_stream_peek (stream, &data, &length) < 0)
+        {
+          g_warning ("Failed to read data from stream");
+          return;
+        }
 
-  assert (length > 0);
-  assert (length % sizeof (float) == 0);
+      /* Empty buffer or hole */
+      if (length == 0)
+        break;
+      if (data == NULL)
+        {
+          pa_stream_drop (stream);
+          continue;
+        }
 
-  value = ((const float *) data)[length / sizeof (float) -1];
+      assert (length % sizeof (float) == 0);
 
-  pa_stream_drop (stream);
+      cc_level_meter_add_samples (&self->meter, data, length / sizeof (float));
 
-  set_peak (self, value);
+      pa_stream_drop (stream);
+    }
+
+  /* Levels are folded into the display at the frame rate, not per fragment */
+  if (self->tick_id == 0 && !cc_level_meter_is_silent (&self->meter))
+    {
+      self->last_frame_time = 0;
+      self->tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self), tick_cb, NULL, NULL);
+    }
 }
 
 static void
@@ -97,7 +154,7 @@ suspended_cb (pa_stream *stream,
   if (pa_stream_is_suspended (stream))
     {
       g_debug ("Stream suspended");
-      self->value = 0.0;
+      reset_levels (self);
       gtk_widget_queue_draw (GTK_WIDGET (self));
     }
 }
@@ -110,13 +167,118 @@ cc_level_bar_get_preferred_height (GtkWidget *widget,
   *minimum = *natural = LED_HEIGHT;
 }
 
+static gint
+get_n_leds (gint width)
+{
+  return width / (LED_WIDTH + LED_SPACING);
+}
+
+static gdouble
+get_led_spacing (gint width)
+{
+  gint n_leds = get_n_leds (width);
+
+  if (n_leds < 2)
+    return 0.0;
+
+  return (gdouble) (width - (n_leds * LED_WIDTH)) / (n_leds - 1);
+}
+
+static cairo_surface_t *
+render_leds (cairo_t       *cr,
+             gint           width,
+             gint           height,
+             const GdkRGBA *color)
+{
+  cairo_surface_t *surface;
+  cairo_t *surface_cr;
+  gdouble spacing, x_offset = 0.0;
+  gint i, n_leds;
+
+  surface = cairo_surface_create_similar (cairo_get_target (cr),
+                                          CAIRO_CONTENT_COLOR_ALPHA,
+                                          width, height);
+  surface_cr = cairo_create (surface);
+
+  n_leds = get_n_leds (width);
+  spacing = get_led_spacing (width);
+
+  gdk_cairo_set_source_rgba (surface_cr, color);
+  for (i = 0; i < n_leds; i++)
+    {
+      cairo_rectangle (surface_cr, x_offset, 0, LED_WIDTH, height);
+      x_offset += LED_WIDTH + spacing;
+    }
+  cairo_fill (surface_cr);
+
+  cairo_destroy (surface_cr);
+
+  return surface;
+}
+
 static void
-set_source_blend (cairo_t *cr, GdkRGBA *a, GdkRGBA *b, gdouble f)
+ensure_surfaces (CcLevelBar *self,
+                 cairo_t    *cr,
+                 gint        width,
+                 gint        height)
 {
-  cairo_set_source_rgb (cr,
-                        (1.0 - f) * a->red   + f * b->red,
-                        (1.0 - f) * a->green + f * b->green,
-                        (1.0 - f) * a->blue  + f * b->blue);
+  gint scale = gtk_widget_get_scale_factor (GTK_WIDGET (self));
+
+  if (self->inactive_surface != NULL &&
+      self->surface_width == width &&
+      self->surface_height == height &&
+      self->surface_scale == scale &&
+      self->surface_type == self->type)
+    return;
+
+  clear_surfaces (self);
+
+  self->inactive_surface = render_leds (cr, width, height, &inactive_color);
+  self->active_surface = render_leds (cr, width, height,
+                                      self->type == CC_STREAM_TYPE_INPUT ? &input_color : &output_color);
+  self->surface_width = width;
+  self->surface_height = height;
+  self->surface_scale = scale;
+  self->surface_type = self->type;
+}
+
+/* Lights the LEDs up to @level, the last one partially, blending the
+ * active strip over the inactive one by @alpha. */
+static void
+paint_level (CcLevelBar *self,
+             cairo_t    *cr,
+             gdouble     level,
+             gdouble     alpha)
+{
+  gint n_leds, n_full;
+  gdouble spacing, led_x;
+
+  n_leds = get_n_leds (self->surface_width);
+  spacing = get_led_spacing (self->surface_width);
+
+  level = CLAMP (level, 0.0, 1.0) * n_leds;
+  n_full = (gint) level;
+  led_x = n_full * (LED_WIDTH + spacing);
+
+  cairo_set_source_surface (cr, self->active_surface, 0, 0);
+
+  if (n_full > 0)
+    {
+      cairo_save (cr);
+      cairo_rectangle (cr, 0, 0, led_x, self->surface_height);
+      cairo_clip (cr);
+      cairo_paint_with_alpha (cr, alpha);
+      cairo_restore (cr);
+    }
+
+  if (n_full < n_leds && level > n_full)
+    {
+      cairo_save (cr);
+      cairo_rectangle (cr, led_x, 0, LED_WIDTH, self->surface_height);
+      cairo_clip (cr);
+      cairo_paint_with_alpha (cr, alpha * (level - n_full));
+      cairo_restore (cr);
+    }
 }
 
 static gboolean
@@ -124,51 +286,37 @@ cc_level_bar_draw (GtkWidget *widget,
                    cairo_t   *cr)
 {
   CcLevelBar *self = CC_LEVEL_BAR (widget);
-  GtkAllocation allocation;
-  GdkRGBA inactive_color, active_color;
-  int i, n_leds;
-  double level;
-  double spacing, x_offset = 0.0;
-
-  gtk_widget_get_allocation (widget, &allocation);
-
-  n_leds = allocation.width / (LED_WIDTH + LED_SPACING);
-  spacing = (double) (allocation.width - (n_leds * LED_WIDTH)) / (n_leds - 1);
-  level = self->value * n_leds;
-
-  gdk_rgba_parse (&inactive_color, "#C0C0C0");
-  switch (self->type)
-  {
-  default:
-  case CC_STREAM_TYPE_OUTPUT:
-    gdk_rgba_parse (&active_color, "#4a90d9");
-    break;
-  case CC_STREAM_TYPE_INPUT:
-    gdk_rgba_parse (&active_color, "#ff0000");
-    break;
-  }
+  gint width, height;
 
-  for (i = 0; i < n_leds; i++)
-  {
-    double led_level;
-
-    led_level = level - i;
-    if (led_level < 0.0)
-      led_level = 0.0;
-    else if (led_level > 1.0)
-      led_level = 1.0;
-
-    cairo_rectangle (cr,
-                     x_offset, 0,
-                     LED_WIDTH, allocation.height);
-    set_source_blend (cr, &inactive_color, &active_color, led_level);
-    cairo_fill (cr);
-    x_offset += LED_WIDTH + spacing;
-  }
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+  if (get_n_leds (width) == 0 || height <= 0)
+    return FALSE;
+
+  ensure_surfaces (self, cr, width, height);
+
+  cairo_set_source_surface (cr, self->inactive_surface, 0, 0);
+  cairo_paint (cr);
+
+  /* Solid up to the RMS level, dimmed from there up to the peak */
+  if (self->meter.peak > self->meter.rms)
+    paint_level (self, cr, self->meter.peak, 0.5);
+  paint_level (self, cr, self->meter.rms, 1.0);
 
   return FALSE;
 }
 
+static void
+cc_level_bar_style_updated (GtkWidget *widget)
+{
+  CcLevelBar *self = CC_LEVEL_BAR (widget);
+
+  GTK_WIDGET_CLASS (cc_level_bar_parent_class)->style_updated (widget);
+
+  clear_surfaces (self);
+  gtk_widget_queue_draw (widget);
+}
+
 static void
 close_stream (pa_stream *stream)
 {
@@ -191,6 +339,13 @@ cc_level_bar_dispose (GObject *object)
   close_stream (self->level_stream);
   g_clear_pointer (&self->level_stream, pa_stream_unref);
 
+  if (self->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->tick_id);
+      self->tick_id = 0;
+    }
+  clear_surfaces (self);
+
   G_OBJECT_CLASS (cc_level_bar_parent_class)->dispose (object);
 }
 
@@ -204,6 +359,7 @@ cc_level_bar_class_init (CcLevelBarClass *klass)
 
   widget_class->get_preferred_height = cc_level_bar_get_preferred_height;
   widget_class->draw = cc_level_bar_draw;
+  widget_class->style_updated = cc_level_bar_style_updated;
 }
 
 void
@@ -228,6 +384,13 @@ cc_level_bar_set_stream (CcLevelBar     *self,
   close_stream (self->level_stream);
   g_clear_pointer (&self->level_stream, pa_stream_unref);
 
+  if (self->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->tick_id);
+      self->tick_id = 0;
+    }
+  reset_levels (self);
+
   self->type = type;
 
   if (stream == NULL)
@@ -246,7 +409,7 @@ cc_level_bar_set_stream (CcLevelBar     *self,
 
   sample_spec.channels = 1;
   sample_spec.format = PA_SAMPLE_FLOAT32;
-  sample_spec.rate = 25;
+  sample_spec.rate = LEVEL_RATE;
 
   proplist = pa_proplist_new ();
   pa_proplist_sets (proplist, PA_PROP_APPLICATION_ID, "org.gnome.VolumeControl");
@@ -262,7 +425,7 @@ cc_level_bar_set_stream (CcLevelBar     *self,
   pa_stream_set_suspended_callback (self->level_stream, suspended_cb, self);
 
   memset (&attr, 0, sizeof (attr));
-  attr.fragsize = sizeof (float);
+  attr.fragsize = sizeof (float) * LEVEL_FRAGMENT_SAMPLES;
   attr.maxlength = (uint32_t) -1;
   device = g_strdup_printf ("%u", gvc_mixer_stream_get_index (stream));
   if (pa_stream_connect_record (self->level_stream,
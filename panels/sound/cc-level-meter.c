@@ -0,0 +1,132 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "cc-level-meter.h"
+
+static void
+smooth (gdouble *value,
+        gdouble  target,
+        gdouble  time_constant,
+        gdouble  elapsed)
+{
+  *value += (target - *value) * elapsed / (time_constant + elapsed);
+}
+
+void
+cc_level_meter_reset (CcLevelMeter *meter)
+{
+  memset (meter, 0, sizeof (CcLevelMeter));
+}
+
+/* Folds a batch of samples into the pending peak and sum of squares */
+void
+cc_level_meter_add_samples (CcLevelMeter *meter,
+                            const gfloat *samples,
+                            gsize         n_samples)
+{
+  gsize i;
+
+  for (i = 0; i < n_samples; i++)
+    {
+      gdouble value = CLAMP (samples[i], 0.0, 1.0);
+
+      meter->pending_peak = MAX (meter->pending_peak, value);
+      meter->pending_sum_squares += value * value;
+    }
+  meter->pending_samples += n_samples;
+}
+
+/**
+ * cc_level_meter_update:
+ * @meter: a #CcLevelMeter
+ * @elapsed: seconds since the previous update
+ * @resolution: the number of distinct levels the meter can show
+ *
+ * Takes in the samples added since the previous update and moves the
+ * displayed levels @elapsed seconds further.  Once no samples have come
+ * in for %CC_LEVEL_METER_STALL_TIME, the levels fall to silence.
+ *
+ * Returns: %TRUE if the displayed levels changed at @resolution
+ */
+gboolean
+cc_level_meter_update (CcLevelMeter *meter,
+                       gdouble       elapsed,
+                       gint          resolution)
+{
+  gint drawn_peak, drawn_rms;
+
+  if (meter->pending_samples > 0)
+    {
+      meter->target_peak = meter->pending_peak;
+      meter->target_rms = sqrt (meter->pending_sum_squares / meter->pending_samples);
+
+      meter->pending_peak = 0.0;
+      meter->pending_sum_squares = 0.0;
+      meter->pending_samples = 0;
+      meter->since_batch = 0.0;
+    }
+  else
+    {
+      meter->since_batch += elapsed;
+
+      /* Corked or stuck streams don't say so, let the levels go */
+      if (meter->since_batch > CC_LEVEL_METER_STALL_TIME)
+        {
+          meter->target_peak = 0.0;
+          meter->target_rms = 0.0;
+        }
+    }
+
+  if (meter->target_peak >= meter->peak)
+    meter->peak = meter->target_peak;
+  else
+    meter->peak = MAX (meter->target_peak,
+                       meter->peak - CC_LEVEL_METER_PEAK_DECAY_RATE * elapsed);
+
+  smooth (&meter->rms, meter->target_rms,
+          meter->target_rms > meter->rms ? CC_LEVEL_METER_RMS_ATTACK_TIME : CC_LEVEL_METER_RMS_RELEASE_TIME,
+          elapsed);
+  meter->rms = MIN (meter->rms, meter->peak);
+
+  if (cc_level_meter_is_silent (meter))
+    {
+      meter->peak = 0.0;
+      meter->rms = 0.0;
+    }
+
+  drawn_peak = (gint) round (meter->peak * resolution);
+  drawn_rms = (gint) round (meter->rms * resolution);
+  if (drawn_peak == meter->drawn_peak && drawn_rms == meter->drawn_rms)
+    return FALSE;
+
+  meter->drawn_peak = drawn_peak;
+  meter->drawn_rms = drawn_rms;
+
+  return TRUE;
+}
+
+/* Whether there is nothing left to show, nor coming */
+gboolean
+cc_level_meter_is_silent (CcLevelMeter *meter)
+{
+  return meter->pending_peak < CC_LEVEL_METER_SILENCE &&
+         meter->target_peak < CC_LEVEL_METER_SILENCE &&
+         meter->peak < CC_LEVEL_METER_SILENCE &&
+         meter->rms < CC_LEVEL_METER_SILENCE;
+}
@@ -0,0 +1,71 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Ballistics: peaks attack instantly and fall at PEAK_DECAY_RATE full
+ * scales per second, the RMS level is smoothed with separate attack and
+ * release time constants (in seconds). */
+#define CC_LEVEL_METER_PEAK_DECAY_RATE  3.0
+#define CC_LEVEL_METER_RMS_ATTACK_TIME  0.05
+#define CC_LEVEL_METER_RMS_RELEASE_TIME 0.3
+
+#define CC_LEVEL_METER_SILENCE 0.001
+
+/* Without new samples for this long (in seconds), a bit over two
+ * fragments at the rate the level bar reads at, the stream is taken to
+ * have stalled and the levels fall to silence */
+#define CC_LEVEL_METER_STALL_TIME 0.1
+
+/* Turns batches of peak samples into the levels a meter shows */
+typedef struct
+{
+  /* Samples folded since the last update */
+  gdouble pending_peak;
+  gdouble pending_sum_squares;
+  guint   pending_samples;
+
+  /* What the latest batch measured, which the displayed levels
+   * move towards until the next one comes in */
+  gdouble target_peak;
+  gdouble target_rms;
+
+  /* Seconds since the latest batch came in */
+  gdouble since_batch;
+
+  /* Displayed levels, after ballistics */
+  gdouble peak;
+  gdouble rms;
+
+  /* The displayed levels at the resolution they were last drawn at */
+  gint    drawn_peak;
+  gint    drawn_rms;
+} CcLevelMeter;
+
+void     cc_level_meter_reset       (CcLevelMeter *meter);
+void     cc_level_meter_add_samples (CcLevelMeter *meter,
+                                     const gfloat *samples,
+                                     gsize         n_samples);
+gboolean cc_level_meter_update      (CcLevelMeter *meter,
+                                     gdouble       elapsed,
+                                     gint          resolution);
+gboolean cc_level_meter_is_silent   (CcLevelMeter *meter);
+
+G_END_DECLS
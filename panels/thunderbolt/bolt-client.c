@@ -333,6 +333,191 @@ bolt_client_list_devices (BoltClient   *client,
   return g_steal_pointer (&devices);
 }
 
+typedef struct
+{
+  GPtrArray      *devices;
+  guint           pending;
+  BoltDeviceFunc  device_ready;
+  gpointer        user_data;
+
+  /* object paths of the devices whose proxy is being created,
+   * those removed in the meantime are dropped */
+  GHashTable     *loading;
+  gulong          removed_id;
+} ListDevicesData;
+
+static void
+list_devices_data_free (ListDevicesData *data)
+{
+  g_ptr_array_unref (data->devices);
+  g_hash_table_unref (data->loading);
+  g_free (data);
+}
+
+static void
+list_devices_device_removed (BoltClient      *client,
+                             const char      *path,
+                             ListDevicesData *data)
+{
+  g_hash_table_remove (data->loading, path);
+}
+
+/* whether the device is still there: it wasn't removed while its
+ * proxy was being created, and the proxy got its properties */
+static gboolean
+list_devices_finish_loading (ListDevicesData *data,
+                             BoltDevice      *dev)
+{
+  const char *path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (dev));
+
+  return g_hash_table_remove (data->loading, path) &&
+         bolt_device_is_loaded (dev);
+}
+
+static void
+list_devices_return (GTask *task)
+{
+  ListDevicesData *data = g_task_get_task_data (task);
+
+  if (data->removed_id != 0)
+    {
+      g_signal_handler_disconnect (g_task_get_source_object (task), data->removed_id);
+      data->removed_id = 0;
+    }
+
+  g_task_return_pointer (task,
+                         g_ptr_array_ref (data->devices),
+                         (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+list_devices_got_device (GObject      *source,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) err = NULL;
+  ListDevicesData *data;
+  BoltDevice *dev;
+
+  data = g_task_get_task_data (task);
+  dev = bolt_device_new_for_object_path_finish (res, &err);
+
+  /* one broken device doesn't take the others down with it */
+  if (dev == NULL)
+    {
+      if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not create device proxy: %s", err->message);
+    }
+  else if (!list_devices_finish_loading (data, dev))
+    {
+      g_object_unref (dev);
+    }
+  else
+    {
+      g_ptr_array_add (data->devices, dev);
+
+      if (data->device_ready != NULL &&
+          !g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+        data->device_ready (g_task_get_source_object (task), dev, data->user_data);
+    }
+
+  data->pending--;
+  if (data->pending == 0)
+    list_devices_return (task);
+}
+
+static void
+list_devices_got_paths (GObject      *source,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GVariant) val = NULL;
+  g_autoptr(GVariantIter) iter = NULL;
+  ListDevicesData *data;
+  GDBusConnection *bus;
+  GError *err = NULL;
+  const char *d;
+
+  val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &err);
+  if (val == NULL)
+    {
+      g_task_return_error (task, err);
+      return;
+    }
+
+  data = g_task_get_task_data (task);
+  bus = g_dbus_proxy_get_connection (G_DBUS_PROXY (source));
+
+  /* all the proxies load their properties at the same time */
+  g_variant_get (val, "(ao)", &iter);
+  while (g_variant_iter_loop (iter, "&o", &d))
+    {
+      g_hash_table_add (data->loading, g_strdup (d));
+      data->pending++;
+      bolt_device_new_for_object_path_async (bus, d,
+                                             g_task_get_cancellable (task),
+                                             list_devices_got_device,
+                                             g_object_ref (task));
+    }
+
+  if (data->pending == 0)
+    list_devices_return (task);
+  else
+    data->removed_id = g_signal_connect (source, "device-removed",
+                                         G_CALLBACK (list_devices_device_removed),
+                                         data);
+}
+
+/* device_ready, if not NULL, is called with user_data for each device as
+ * soon as its proxy is ready, before the listing completes.  Devices whose
+ * proxy can't be created, or that are removed while it is, are left out. */
+void
+bolt_client_list_devices_async (BoltClient         *client,
+                                GCancellable       *cancellable,
+                                BoltDeviceFunc      device_ready,
+                                GAsyncReadyCallback callback,
+                                gpointer            user_data)
+{
+  ListDevicesData *data;
+  GTask *task;
+
+  g_return_if_fail (BOLT_IS_CLIENT (client));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  data = g_new0 (ListDevicesData, 1);
+  data->devices = g_ptr_array_new_with_free_func (g_object_unref);
+  data->loading = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  data->device_ready = device_ready;
+  data->user_data = user_data;
+
+  task = g_task_new (client, cancellable, callback, user_data);
+  g_task_set_source_tag (task, bolt_client_list_devices_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) list_devices_data_free);
+
+  g_dbus_proxy_call (G_DBUS_PROXY (client),
+                     "ListDevices",
+                     NULL,
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     cancellable,
+                     list_devices_got_paths,
+                     task);
+}
+
+/* The devices are in no particular order */
+GPtrArray *
+bolt_client_list_devices_finish (BoltClient   *client,
+                                 GAsyncResult *res,
+                                 GError      **error)
+{
+  g_return_val_if_fail (BOLT_IS_CLIENT (client), NULL);
+  g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
 BoltDevice *
 bolt_client_get_device (BoltClient   *client,
                         const char   *uid,
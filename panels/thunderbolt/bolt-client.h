@@ -41,6 +41,20 @@ GPtrArray *     bolt_client_list_devices (BoltClient   *client,
                                           GCancellable *cancellable,
                                           GError      **error);
 
+typedef void (*BoltDeviceFunc) (BoltClient *client,
+                                BoltDevice *device,
+                                gpointer    user_data);
+
+void            bolt_client_list_devices_async (BoltClient         *client,
+                                                GCancellable       *cancellable,
+                                                BoltDeviceFunc      device_ready,
+                                                GAsyncReadyCallback callback,
+                                                gpointer            user_data);
+
+GPtrArray *     bolt_client_list_devices_finish (BoltClient   *client,
+                                                 GAsyncResult *res,
+                                                 GError      **error);
+
 BoltDevice *    bolt_client_get_device (BoltClient   *client,
                                         const char   *uid,
                                         GCancellable *cancellable,
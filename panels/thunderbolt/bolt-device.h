@@ -33,6 +33,15 @@ BoltDevice *  bolt_device_new_for_object_path (GDBusConnection *bus,
                                                GCancellable    *cancellable,
                                                GError         **error);
 
+void          bolt_device_new_for_object_path_async (GDBusConnection    *bus,
+                                                     const char         *path,
+                                                     GCancellable       *cancellable,
+                                                     GAsyncReadyCallback callback,
+                                                     gpointer            user_data);
+
+BoltDevice *  bolt_device_new_for_object_path_finish (GAsyncResult *res,
+                                                      GError      **error);
+
 gboolean      bolt_device_authorize (BoltDevice   *dev,
                                      BoltAuthCtrl  flags,
                                      GCancellable *cancellable,
@@ -48,6 +57,8 @@ gboolean      bolt_device_authorize_finish (BoltDevice   *dev,
                                             GAsyncResult *res,
                                             GError      **error);
 
+gboolean      bolt_device_is_loaded (BoltDevice *dev);
+
 /* getter */
 const char *      bolt_device_get_uid (BoltDevice *dev);
 
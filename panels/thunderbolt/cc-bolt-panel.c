@@ -64,6 +64,15 @@ struct _CcBoltPanel
   /* device list */
   GHashTable         *devices;
 
+  /* entries from before a device list refresh; those
+   * missing from the new list are removed once it is in */
+  GHashTable         *stale_devices;
+  GCancellable       *sync_cancel;
+
+  /* paths of the added devices whose proxy is being created;
+   * those removed in the meantime are dropped */
+  GHashTable         *loading;
+
   GtkStack           *devices_stack;
   GtkBox             *devices_box;
   GtkBox             *pending_box;
@@ -271,42 +280,110 @@ devices_table_clear_entries (GHashTable  *table,
     }
 }
 
+/* Only called while the listing hasn't been cancelled, and not
+ * for the devices removed while their proxy was being created */
 static void
-devices_table_synchronize (CcBoltPanel *panel)
+devices_table_synchronize_device (BoltClient *client,
+                                  BoltDevice *dev,
+                                  gpointer    user_data)
+{
+  CcBoltPanel *panel = CC_BOLT_PANEL (user_data);
+  const char *path;
+  gboolean found;
+
+  path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (dev));
+
+  /* added while the list was fetched */
+  if (g_hash_table_contains (panel->devices, path))
+    return;
+
+  found = devices_table_transfer_entry (panel->stale_devices, panel->devices, path);
+
+  if (!found)
+    cc_bolt_panel_add_device (panel, dev);
+
+  gtk_stack_set_visible_child_name (panel->container, "devices-listing");
+}
+
+static void
+devices_table_synchronize_done (GObject      *source,
+                                GAsyncResult *res,
+                                gpointer      user_data)
 {
   g_autoptr(GHashTable) old = NULL;
   g_autoptr(GPtrArray) devices = NULL;
   g_autoptr(GError) err = NULL;
-  guint i;
+  CcBoltPanel *panel;
 
-  devices = bolt_client_list_devices (panel->client, cc_panel_get_cancellable (CC_PANEL (panel)), &err);
+  devices = bolt_client_list_devices_finish (BOLT_CLIENT (source), res, &err);
 
   if (!devices)
     {
+      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
       g_warning ("Could not list devices: %s", err->message);
-      devices = g_ptr_array_new_with_free_func (g_object_unref);
     }
 
-  old = panel->devices;
-  panel->devices = g_hash_table_new (g_str_hash, g_str_equal);
+  /* Only cast the parameters after making sure it wasn't cancelled */
+  panel = CC_BOLT_PANEL (user_data);
+  g_clear_object (&panel->sync_cancel);
 
-  for (i = 0; i < devices->len; i++)
-    {
-      BoltDevice *dev = g_ptr_array_index (devices, i);
-      const char *path;
-      gboolean found;
+  /* the rows were updated as the devices came in, whatever
+   * is left over is gone */
+  old = g_steal_pointer (&panel->stale_devices);
+  devices_table_clear_entries (old, panel);
+  gtk_stack_set_visible_child_name (panel->container, "devices-listing");
+}
+
+static void
+devices_table_cancel_synchronize (CcBoltPanel *panel)
+{
+  g_cancellable_cancel (panel->sync_cancel);
+  g_clear_object (&panel->sync_cancel);
+
+  if (panel->stale_devices == NULL)
+    return;
 
-      path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (dev));
-      found = devices_table_transfer_entry (old, panel->devices, path);
+  devices_table_clear_entries (panel->stale_devices, panel);
+  g_clear_pointer (&panel->stale_devices, g_hash_table_unref);
+}
+
+static void
+devices_table_synchronize (CcBoltPanel *panel)
+{
+  GHashTableIter iter;
+  gpointer key, value;
 
-      if (found)
-        continue;
+  g_cancellable_cancel (panel->sync_cancel);
+  g_clear_object (&panel->sync_cancel);
 
-      cc_bolt_panel_add_device (panel, dev);
+  /* the device proxies are created concurrently, each row is
+   * updated as soon as its device is ready and the stale ones
+   * are removed once they all are */
+  if (panel->stale_devices == NULL)
+    {
+      panel->stale_devices = g_steal_pointer (&panel->devices);
+    }
+  else
+    {
+      g_hash_table_iter_init (&iter, panel->devices);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          g_hash_table_iter_steal (&iter);
+          g_hash_table_insert (panel->stale_devices, key, value);
+        }
+      g_clear_pointer (&panel->devices, g_hash_table_unref);
     }
 
-  devices_table_clear_entries (old, panel);
-  gtk_stack_set_visible_child_name (panel->container, "devices-listing");
+  panel->devices = g_hash_table_new (g_str_hash, g_str_equal);
+
+  panel->sync_cancel = g_cancellable_new ();
+  bolt_client_list_devices_async (panel->client,
+                                  panel->sync_cancel,
+                                  devices_table_synchronize_device,
+                                  devices_table_synchronize_done,
+                                  panel);
 }
 
 static gboolean
@@ -489,6 +566,7 @@ cc_bolt_panel_name_owner_changed (CcBoltPanel *panel)
   if (name_owner == NULL)
     {
       cc_bolt_panel_set_no_thunderbolt (panel, NULL);
+      devices_table_cancel_synchronize (panel);
       devices_table_clear_entries (panel->devices, panel);
       gtk_widget_hide (GTK_WIDGET (panel->headerbar_box));
       return;
@@ -549,14 +627,45 @@ on_bolt_name_owner_changed_cb (GObject    *object,
   cc_bolt_panel_name_owner_changed (CC_BOLT_PANEL (user_data));
 }
 
+static void
+on_bolt_device_ready (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  g_autoptr(GError) err = NULL;
+  g_autoptr(BoltDevice) dev = NULL;
+  CcBoltPanel *panel;
+  const char *path;
+
+  dev = bolt_device_new_for_object_path_finish (res, &err);
+
+  if (!dev)
+    {
+      if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not create device proxy: %s", err->message);
+      return;
+    }
+
+  panel = CC_BOLT_PANEL (user_data);
+  path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (dev));
+
+  /* removed while its proxy was being created */
+  if (!g_hash_table_remove (panel->loading, path) ||
+      !bolt_device_is_loaded (dev))
+    return;
+
+  if (g_hash_table_contains (panel->devices, path))
+    return;
+
+  cc_bolt_panel_add_device (panel, dev);
+}
+
 static void
 on_bolt_device_added_cb (BoltClient  *cli,
                          const char  *path,
                          CcBoltPanel *panel)
 {
-  g_autoptr(GError) err = NULL;
   GDBusConnection *bus;
-  BoltDevice *dev;
   gboolean found;
 
   found = g_hash_table_contains (panel->devices, path);
@@ -564,16 +673,18 @@ on_bolt_device_added_cb (BoltClient  *cli,
   if (found)
     return;
 
-  bus = g_dbus_proxy_get_connection (G_DBUS_PROXY (panel->client));
-  dev = bolt_device_new_for_object_path (bus, path, cc_panel_get_cancellable (CC_PANEL (panel)), &err);
+  /* still shown from before the device list refresh */
+  if (panel->stale_devices != NULL &&
+      devices_table_transfer_entry (panel->stale_devices, panel->devices, path))
+    return;
 
-  if (!dev)
-    {
-      g_warning ("Could not create proxy for %s", path);
-      return;
-    }
+  g_hash_table_add (panel->loading, g_strdup (path));
 
-  cc_bolt_panel_add_device (panel, dev);
+  bus = g_dbus_proxy_get_connection (G_DBUS_PROXY (panel->client));
+  bolt_device_new_for_object_path_async (bus, path,
+                                         cc_panel_get_cancellable (CC_PANEL (panel)),
+                                         on_bolt_device_ready,
+                                         panel);
 }
 
 static void
@@ -582,14 +693,23 @@ on_bolt_device_removed_cb (BoltClient  *cli,
                            CcBoltPanel *panel)
 {
   CcBoltDeviceEntry *entry;
+  GHashTable *table = panel->devices;
 
-  entry = g_hash_table_lookup (panel->devices, path);
+  g_hash_table_remove (panel->loading, path);
+
+  entry = g_hash_table_lookup (table, path);
+
+  if (!entry && panel->stale_devices != NULL)
+    {
+      table = panel->stale_devices;
+      entry = g_hash_table_lookup (table, path);
+    }
 
   if (!entry)
     return;
 
   cc_bolt_panel_del_device_entry (panel, entry);
-  g_hash_table_remove (panel->devices, path);
+  g_hash_table_remove (table, path);
 }
 
 static void
@@ -887,6 +1007,8 @@ cc_bolt_panel_finalize (GObject *object)
 
   g_clear_object (&panel->client);
   g_clear_pointer (&panel->devices, g_hash_table_unref);
+  g_clear_pointer (&panel->stale_devices, g_hash_table_unref);
+  g_clear_pointer (&panel->loading, g_hash_table_unref);
   g_clear_object (&panel->permission);
 
   G_OBJECT_CLASS (cc_bolt_panel_parent_class)->finalize (object);
@@ -897,6 +1019,9 @@ cc_bolt_panel_dispose (GObject *object)
 {
   CcBoltPanel *panel = CC_BOLT_PANEL (object);
 
+  g_cancellable_cancel (panel->sync_cancel);
+  g_clear_object (&panel->sync_cancel);
+
   /* Must be destroyed in dispose, not finalize. */
   g_clear_pointer ((GtkWidget **) &panel->device_dialog, gtk_widget_destroy);
 
@@ -982,6 +1107,7 @@ cc_bolt_panel_init (CcBoltPanel *panel)
                               NULL);
 
   panel->devices = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, NULL);
+  panel->loading = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   panel->device_dialog = cc_bolt_device_dialog_new ();
   g_signal_connect_object (panel->device_dialog,
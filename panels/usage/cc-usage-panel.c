@@ -20,6 +20,7 @@
 
 #include "list-box-helper.h"
 #include "cc-usage-panel.h"
+#include "cc-usage-purge.h"
 #include "cc-usage-resources.h"
 #include "cc-util.h"
 
@@ -31,6 +32,7 @@ struct _CcUsagePanel
   CcPanel     parent_instance;
 
   GSettings  *privacy_settings;
+  GCancellable *purge_cancellable;
 
   GtkListBox  *usage_list_box;
   GtkSwitch   *recently_used_switch;
@@ -42,6 +44,7 @@ struct _CcUsagePanel
   GtkComboBox *purge_after_combo;
   GtkButton   *purge_temp_button;
   GtkButton   *purge_trash_button;
+  GtkProgressBar *purge_progress_bar;
 };
 
 CC_PANEL_REGISTER (CcUsagePanel, cc_usage_panel)
@@ -145,19 +148,65 @@ run_warning (CcUsagePanel *self,
 }
 
 static void
-empty_trash (CcUsagePanel *self)
+purge_progress_cb (guint64  files_done,
+                   guint64  files_total,
+                   guint64  bytes_done,
+                   guint64  bytes_total,
+                   gpointer user_data)
+{
+  CcUsagePanel *self = user_data;
+  g_autofree gchar *done = NULL;
+  g_autofree gchar *total = NULL;
+  g_autofree gchar *text = NULL;
+
+  if (bytes_total > 0)
+    gtk_progress_bar_set_fraction (self->purge_progress_bar, (gdouble) bytes_done / bytes_total);
+  else if (files_total > 0)
+    gtk_progress_bar_set_fraction (self->purge_progress_bar, (gdouble) files_done / files_total);
+  else
+    gtk_progress_bar_set_fraction (self->purge_progress_bar, 0.0);
+
+  done = g_format_size (bytes_done);
+  total = g_format_size (bytes_total);
+  /* Translators: The first two are amounts of data, e.g. "1.2 MB of 3.4 MB deleted" */
+  text = g_strdup_printf (_("%s of %s deleted"), done, total);
+  gtk_progress_bar_set_text (self->purge_progress_bar, text);
+}
+
+static void
+set_purge_running (CcUsagePanel *self,
+                   gboolean      running)
+{
+  gtk_widget_set_sensitive (GTK_WIDGET (self->purge_trash_button), !running);
+  gtk_widget_set_sensitive (GTK_WIDGET (self->purge_temp_button), !running);
+  gtk_progress_bar_set_fraction (self->purge_progress_bar, 0.0);
+  gtk_progress_bar_set_text (self->purge_progress_bar, NULL);
+  gtk_widget_set_visible (GTK_WIDGET (self->purge_progress_bar), running);
+}
+
+static void
+purge_trash_done_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
 {
+  CcUsagePanel *self = user_data;
   g_autoptr(GDBusConnection) bus = NULL;
-  gboolean result;
+  g_autoptr(GError) error = NULL;
 
-  result = run_warning (self,
-                        _("Empty all items from Trash?"),
-                        _("All items in the Trash will be permanently deleted."),
-                        _("_Empty Trash"));
+  if (!cc_usage_purge_finish (result, NULL, NULL, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_warning ("Failed to empty the trash: %s", error->message);
+          set_purge_running (self, FALSE);
+        }
+      return;
+    }
 
-  if (!result)
-    return;
+  set_purge_running (self, FALSE);
 
+  /* The home trash is empty by now, let the housekeeping plugin take
+   * care of the trash directories on other volumes */
   bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
   g_dbus_connection_call (bus,
                           "org.gnome.SettingsDaemon.Housekeeping",
@@ -167,11 +216,69 @@ empty_trash (CcUsagePanel *self)
                           NULL, NULL, 0, -1, NULL, NULL, NULL);
 }
 
+static void
+empty_trash (CcUsagePanel *self)
+{
+  g_autofree gchar *trash_dir = NULL;
+  g_autofree gchar *files_dir = NULL;
+  g_autofree gchar *info_dir = NULL;
+  g_autofree gchar *expunged_dir = NULL;
+  const gchar *directories[4];
+  gboolean result;
+
+  result = run_warning (self,
+                        _("Empty all items from Trash?"),
+                        _("All items in the Trash will be permanently deleted."),
+                        _("_Empty Trash"));
+
+  if (!result)
+    return;
+
+  trash_dir = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+  files_dir = g_build_filename (trash_dir, "files", NULL);
+  info_dir = g_build_filename (trash_dir, "info", NULL);
+  expunged_dir = g_build_filename (trash_dir, "expunged", NULL);
+  directories[0] = files_dir;
+  directories[1] = info_dir;
+  directories[2] = expunged_dir;
+  directories[3] = NULL;
+
+  set_purge_running (self, TRUE);
+  cc_usage_purge_async (directories,
+                        0,
+                        0,
+                        self->purge_cancellable,
+                        purge_progress_cb,
+                        self,
+                        purge_trash_done_cb,
+                        self);
+}
+
+static void
+purge_temp_done_cb (GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  CcUsagePanel *self = user_data;
+  g_autoptr(GError) error = NULL;
+
+  if (!cc_usage_purge_finish (result, NULL, NULL, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_warning ("Failed to delete temporary files: %s", error->message);
+    }
+
+  set_purge_running (self, FALSE);
+}
+
 static void
 purge_temp (CcUsagePanel *self)
 {
-  g_autoptr(GDBusConnection) bus = NULL;
+  const gchar *directories[2];
+  GTimeSpan min_age;
   gboolean result;
+  guint days;
 
   result = run_warning (self,
                         _("Delete all the temporary files?"),
@@ -181,13 +288,23 @@ purge_temp (CcUsagePanel *self)
   if (!result)
     return;
 
-  bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
-  g_dbus_connection_call (bus,
-                          "org.gnome.SettingsDaemon.Housekeeping",
-                          "/org/gnome/SettingsDaemon/Housekeeping",
-                          "org.gnome.SettingsDaemon.Housekeeping",
-                          "RemoveTempFiles",
-                          NULL, NULL, 0, -1, NULL, NULL, NULL);
+  /* Files still in use are unlikely to be older than the automatic
+   * purge period; zero stands for an hour there */
+  g_settings_get (self->privacy_settings, "old-files-age", "u", &days);
+  min_age = days > 0 ? days * G_TIME_SPAN_DAY : G_TIME_SPAN_HOUR;
+
+  directories[0] = g_get_tmp_dir ();
+  directories[1] = NULL;
+
+  set_purge_running (self, TRUE);
+  cc_usage_purge_async (directories,
+                        min_age,
+                        0,
+                        self->purge_cancellable,
+                        purge_progress_cb,
+                        self,
+                        purge_temp_done_cb,
+                        self);
 }
 
 static void
@@ -195,6 +312,8 @@ cc_usage_panel_finalize (GObject *object)
 {
   CcUsagePanel *self = CC_USAGE_PANEL (object);
 
+  g_cancellable_cancel (self->purge_cancellable);
+  g_clear_object (&self->purge_cancellable);
   g_clear_object (&self->privacy_settings);
 
   G_OBJECT_CLASS (cc_usage_panel_parent_class)->finalize (object);
@@ -273,6 +392,7 @@ cc_usage_panel_init (CcUsagePanel *self)
                                 NULL, NULL);
 
   self->privacy_settings = g_settings_new ("org.gnome.desktop.privacy");
+  self->purge_cancellable = g_cancellable_new ();
 
   g_settings_bind (self->privacy_settings,
                    "remember-recent-files",
@@ -336,6 +456,7 @@ cc_usage_panel_class_init (CcUsagePanelClass *klass)
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, purge_trash_button);
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, purge_trash_switch);
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, purge_temp_button);
+  gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, purge_progress_bar);
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, recently_used_switch);
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, retain_history_combo);
   gtk_widget_class_bind_template_child (widget_class, CcUsagePanel, trash_list_box);
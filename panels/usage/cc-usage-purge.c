@@ -0,0 +1,469 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-usage-purge.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Deletion happens in two phases: the directories are first walked to
+ * find and size everything that has to go, then the files are unlinked
+ * by a bounded pool of workers, a chunk of a directory at a time, and
+ * finally the emptied directories are removed, deepest first. */
+
+#define MAX_WORKERS       8
+#define FILES_PER_CHUNK   4096
+#define FLUSH_INTERVAL    256
+#define PROGRESS_INTERVAL 100 /* ms */
+
+typedef struct
+{
+  gchar     *path;
+  gboolean   remove;  /* FALSE for the directories we were given */
+  GPtrArray *names;   /* files to unlink */
+  GArray    *sizes;   /* guint64, matching names */
+} PurgeDir;
+
+typedef struct
+{
+  PurgeDir *dir;
+  guint     start;
+  guint     end;
+} PurgeChunk;
+
+typedef struct
+{
+  gint                      ref_count;
+
+  gchar                   **directories;
+  gint64                    cutoff;
+  guint                     max_workers;
+  GCancellable             *cancellable;
+
+  CcUsagePurgeProgressFunc  progress_func;
+  gpointer                  progress_data;
+  GSource                  *progress_source;
+
+  /* Written by the scan, read-only during deletion; PurgeDir */
+  GPtrArray                *dirs;
+
+  GMutex                    lock;
+  guint64                   files_done;
+  guint64                   files_total;
+  guint64                   bytes_done;
+  guint64                   bytes_total;
+} PurgeData;
+
+static void
+purge_dir_free (PurgeDir *dir)
+{
+  g_free (dir->path);
+  g_ptr_array_unref (dir->names);
+  g_array_unref (dir->sizes);
+  g_free (dir);
+}
+
+static PurgeDir *
+purge_dir_new (gchar    *path,
+               gboolean  remove)
+{
+  PurgeDir *dir;
+
+  dir = g_new0 (PurgeDir, 1);
+  dir->path = path;
+  dir->remove = remove;
+  dir->names = g_ptr_array_new_with_free_func (g_free);
+  dir->sizes = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+  return dir;
+}
+
+static PurgeData *
+purge_data_ref (PurgeData *data)
+{
+  g_atomic_int_inc (&data->ref_count);
+  return data;
+}
+
+static void
+purge_data_unref (PurgeData *data)
+{
+  if (!g_atomic_int_dec_and_test (&data->ref_count))
+    return;
+
+  g_strfreev (data->directories);
+  g_clear_object (&data->cancellable);
+  g_clear_pointer (&data->dirs, g_ptr_array_unref);
+  g_mutex_clear (&data->lock);
+  g_free (data);
+}
+
+static void
+scan_directory (PurgeData *data,
+                PurgeDir  *dir,
+                dev_t      device)
+{
+  struct dirent *entry;
+  guint64 bytes = 0;
+  uid_t uid;
+  DIR *dp;
+  int fd;
+
+  fd = open (dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  dp = fdopendir (fd);
+  if (dp == NULL)
+    {
+      close (fd);
+      return;
+    }
+
+  uid = getuid ();
+
+  while ((entry = readdir (dp)) != NULL)
+    {
+      struct stat st;
+
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      if (fstatat (fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+        continue;
+
+      /* Only ever touch what belongs to the user */
+      if (st.st_uid != uid)
+        continue;
+
+      if (S_ISDIR (st.st_mode))
+        {
+          /* Don't cross into other file systems */
+          if (st.st_dev != device)
+            continue;
+
+          g_ptr_array_add (data->dirs,
+                           purge_dir_new (g_build_filename (dir->path, entry->d_name, NULL),
+                                          st.st_mtime <= data->cutoff));
+        }
+      else if (st.st_mtime <= data->cutoff)
+        {
+          guint64 size = st.st_size;
+
+          g_ptr_array_add (dir->names, g_strdup (entry->d_name));
+          g_array_append_val (dir->sizes, size);
+          bytes += size;
+        }
+    }
+
+  closedir (dp);
+
+  g_mutex_lock (&data->lock);
+  data->files_total += dir->names->len;
+  data->bytes_total += bytes;
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+purge_chunk_func (gpointer item,
+                  gpointer user_data)
+{
+  g_autofree PurgeChunk *chunk = item;
+  PurgeData *data = user_data;
+  guint64 files = 0;
+  guint64 bytes = 0;
+  guint i;
+  int fd;
+
+  if (g_cancellable_is_cancelled (data->cancellable))
+    return;
+
+  fd = open (chunk->dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  for (i = chunk->start; i < chunk->end; i++)
+    {
+      if (unlinkat (fd, g_ptr_array_index (chunk->dir->names, i), 0) == 0)
+        {
+          files++;
+          bytes += g_array_index (chunk->dir->sizes, guint64, i);
+        }
+
+      if ((i - chunk->start + 1) % FLUSH_INTERVAL == 0)
+        {
+          g_mutex_lock (&data->lock);
+          data->files_done += files;
+          data->bytes_done += bytes;
+          g_mutex_unlock (&data->lock);
+          files = bytes = 0;
+
+          if (g_cancellable_is_cancelled (data->cancellable))
+            break;
+        }
+    }
+
+  close (fd);
+
+  g_mutex_lock (&data->lock);
+  data->files_done += files;
+  data->bytes_done += bytes;
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+purge_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  PurgeData *data = task_data;
+  g_autoptr(GError) error = NULL;
+  GThreadPool *pool;
+  guint i;
+
+  /* Size everything first, so that progress is against a known total.
+   * Sub-directories get appended while walking, after their parent. */
+  for (i = 0; data->directories[i] != NULL; i++)
+    {
+      struct stat st;
+      guint j;
+
+      if (lstat (data->directories[i], &st) < 0 || !S_ISDIR (st.st_mode))
+        continue;
+
+      j = data->dirs->len;
+      g_ptr_array_add (data->dirs, purge_dir_new (g_strdup (data->directories[i]), FALSE));
+
+      for (; j < data->dirs->len; j++)
+        {
+          if (g_task_return_error_if_cancelled (task))
+            return;
+
+          scan_directory (data, g_ptr_array_index (data->dirs, j), st.st_dev);
+        }
+    }
+
+  pool = g_thread_pool_new (purge_chunk_func, data, data->max_workers, FALSE, &error);
+  if (pool == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  for (i = 0; i < data->dirs->len; i++)
+    {
+      PurgeDir *dir = g_ptr_array_index (data->dirs, i);
+      guint start;
+
+      for (start = 0; start < dir->names->len; start += FILES_PER_CHUNK)
+        {
+          PurgeChunk *chunk;
+
+          chunk = g_new0 (PurgeChunk, 1);
+          chunk->dir = dir;
+          chunk->start = start;
+          chunk->end = MIN (start + FILES_PER_CHUNK, dir->names->len);
+          g_thread_pool_push (pool, chunk, NULL);
+        }
+    }
+
+  /* Wait for the queued chunks; they bail out early once cancelled */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  /* Children always come after their parent */
+  for (i = data->dirs->len; i > 0; i--)
+    {
+      PurgeDir *dir = g_ptr_array_index (data->dirs, i - 1);
+
+      /* Fails with ENOTEMPTY if recent files were kept */
+      if (dir->remove)
+        unlinkat (AT_FDCWD, dir->path, AT_REMOVEDIR);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+report_progress (PurgeData *data)
+{
+  guint64 files_done, files_total, bytes_done, bytes_total;
+
+  g_mutex_lock (&data->lock);
+  files_done = data->files_done;
+  files_total = data->files_total;
+  bytes_done = data->bytes_done;
+  bytes_total = data->bytes_total;
+  g_mutex_unlock (&data->lock);
+
+  data->progress_func (files_done, files_total, bytes_done, bytes_total, data->progress_data);
+}
+
+static gboolean
+progress_timeout_cb (gpointer user_data)
+{
+  PurgeData *data = user_data;
+
+  /* The receiver may be gone once cancelled */
+  if (!g_cancellable_is_cancelled (data->cancellable))
+    report_progress (data);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+purge_thread_done_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  PurgeData *data = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  if (data->progress_source != NULL)
+    {
+      g_source_destroy (data->progress_source);
+      g_clear_pointer (&data->progress_source, g_source_unref);
+    }
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (data->progress_func != NULL)
+    report_progress (data);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * cc_usage_purge_async:
+ * @directories: %NULL-terminated list of directories to empty
+ * @min_age: only delete files last modified at least this long ago, or
+ *   everything if zero or negative
+ * @max_workers: maximum number of deletion threads, or 0 for a default
+ * @cancellable: (nullable): a #GCancellable
+ * @progress_func: (nullable): function to report progress with
+ * @progress_data: data for @progress_func
+ * @callback: callback to call when done
+ * @user_data: data for @callback
+ *
+ * Deletes the contents of @directories, but not the directories
+ * themselves. Only files and directories owned by the user are
+ * deleted, symbolic links are never followed and other file systems
+ * mounted below @directories are left alone. Directories are only
+ * removed if they are older than @min_age and end up empty.
+ *
+ * @progress_func will not be called anymore once @cancellable is
+ * cancelled.
+ */
+void
+cc_usage_purge_async (const gchar * const      *directories,
+                      GTimeSpan                 min_age,
+                      guint                     max_workers,
+                      GCancellable             *cancellable,
+                      CcUsagePurgeProgressFunc  progress_func,
+                      gpointer                  progress_data,
+                      GAsyncReadyCallback       callback,
+                      gpointer                  user_data)
+{
+  g_autoptr(GTask) thread_task = NULL;
+  PurgeData *data;
+  GTask *task;
+
+  g_return_if_fail (directories != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  data = g_new0 (PurgeData, 1);
+  data->ref_count = 1;
+  data->directories = g_strdupv ((gchar **) directories);
+  if (min_age > 0)
+    data->cutoff = g_get_real_time () / G_USEC_PER_SEC - min_age / G_TIME_SPAN_SECOND;
+  else
+    data->cutoff = G_MAXINT64;
+  if (max_workers == 0)
+    max_workers = CLAMP (g_get_num_processors (), 1, MAX_WORKERS);
+  data->max_workers = max_workers;
+  data->cancellable = cancellable ? g_object_ref (cancellable) : g_cancellable_new ();
+  data->progress_func = progress_func;
+  data->progress_data = progress_data;
+  data->dirs = g_ptr_array_new_with_free_func ((GDestroyNotify) purge_dir_free);
+  g_mutex_init (&data->lock);
+
+  task = g_task_new (NULL, data->cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_usage_purge_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) purge_data_unref);
+
+  if (progress_func != NULL)
+    {
+      data->progress_source = g_timeout_source_new (PROGRESS_INTERVAL);
+      g_source_set_callback (data->progress_source,
+                             progress_timeout_cb,
+                             purge_data_ref (data),
+                             (GDestroyNotify) purge_data_unref);
+      g_source_attach (data->progress_source, g_task_get_context (task));
+    }
+
+  thread_task = g_task_new (NULL, data->cancellable, purge_thread_done_cb, task);
+  g_task_set_task_data (thread_task, purge_data_ref (data), (GDestroyNotify) purge_data_unref);
+  g_task_run_in_thread (thread_task, purge_thread);
+}
+
+/**
+ * cc_usage_purge_finish:
+ * @result: a #GAsyncResult
+ * @n_files: (out) (optional): return location for the number of deleted files
+ * @n_bytes: (out) (optional): return location for the size of the deleted files
+ * @error: return location for a #GError
+ *
+ * Files that could not be deleted are skipped, and do not cause an error.
+ *
+ * Returns: %TRUE on success, %FALSE if cancelled
+ */
+gboolean
+cc_usage_purge_finish (GAsyncResult  *result,
+                       guint64       *n_files,
+                       guint64       *n_bytes,
+                       GError       **error)
+{
+  PurgeData *data;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_usage_purge_async, FALSE);
+
+  if (!g_task_propagate_boolean (G_TASK (result), error))
+    return FALSE;
+
+  data = g_task_get_task_data (G_TASK (result));
+
+  g_mutex_lock (&data->lock);
+  if (n_files != NULL)
+    *n_files = data->files_done;
+  if (n_bytes != NULL)
+    *n_bytes = data->bytes_done;
+  g_mutex_unlock (&data->lock);
+
+  return TRUE;
+}
@@ -0,0 +1,54 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CcUsagePurgeProgressFunc:
+ * @files_done: number of files deleted so far
+ * @files_total: number of files found to delete so far
+ * @bytes_done: size of the files deleted so far
+ * @bytes_total: size of the files found to delete so far
+ * @user_data: user data passed to cc_usage_purge_async()
+ *
+ * Called periodically on the thread-default main context of the caller
+ * of cc_usage_purge_async(). The totals keep growing while the
+ * directories are being sized, and are final once deletion starts.
+ */
+typedef void (*CcUsagePurgeProgressFunc) (guint64  files_done,
+                                          guint64  files_total,
+                                          guint64  bytes_done,
+                                          guint64  bytes_total,
+                                          gpointer user_data);
+
+void     cc_usage_purge_async  (const gchar * const      *directories,
+                                GTimeSpan                 min_age,
+                                guint                     max_workers,
+                                GCancellable             *cancellable,
+                                CcUsagePurgeProgressFunc  progress_func,
+                                gpointer                  progress_data,
+                                GAsyncReadyCallback       callback,
+                                gpointer                  user_data);
+gboolean cc_usage_purge_finish (GAsyncResult             *result,
+                                guint64                  *n_files,
+                                guint64                  *n_bytes,
+                                GError                  **error);
+
+G_END_DECLS
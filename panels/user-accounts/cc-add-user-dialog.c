@@ -94,6 +94,7 @@ struct _CcAddUserDialog {
         gint                local_username_timeout_id;
         ActUserPasswordMode local_password_mode;
         gint                local_password_timeout_id;
+        PwChecker          *local_pw_checker;
         gboolean            local_valid_username;
 
         guint               realmd_watch;
@@ -244,7 +245,7 @@ static gint
 update_password_strength (CcAddUserDialog *self)
 {
         const gchar *password;
-        const gchar *username;
+        g_autofree gchar *username = NULL;
         const gchar *hint;
         const gchar *verify;
         gint strength_level;
@@ -252,7 +253,10 @@ update_password_strength (CcAddUserDialog *self)
         password = gtk_entry_get_text (self->local_password_entry);
         username = gtk_combo_box_text_get_active_text (self->local_username_combo);
 
-        pw_strength (password, NULL, username, &hint, &strength_level);
+        /* Evaluated off the main thread, see local_password_strength_cb() */
+        if (!pw_checker_lookup (self->local_pw_checker, password, NULL, username,
+                                &strength_level, &hint))
+                return 0;
 
         gtk_label_set_label (self->local_hint_label, hint);
         gtk_level_bar_set_value (self->local_strength_indicator, strength_level);
@@ -681,6 +685,20 @@ local_password_entry_icon_press_cb (CcAddUserDialog *self)
         gtk_widget_set_sensitive (GTK_WIDGET (self->local_verify_entry), TRUE);
 }
 
+static void
+local_password_strength_cb (gint         strength_level,
+                            const gchar *hint,
+                            gpointer     user_data)
+{
+        CcAddUserDialog *self = CC_ADD_USER_DIALOG (user_data);
+
+        /* Don't enable the Add button while a newer input is being debounced */
+        if (self->local_password_timeout_id != 0)
+                return;
+
+        dialog_validate (self);
+}
+
 static gboolean
 local_password_timeout (CcAddUserDialog *self)
 {
@@ -1504,6 +1522,7 @@ cc_add_user_dialog_init (CcAddUserDialog *self)
         gtk_widget_init_template (GTK_WIDGET (self));
 
         self->cancellable = g_cancellable_new ();
+        self->local_pw_checker = pw_checker_new (local_password_strength_cb, self);
 
         self->local_password_mode = ACT_USER_PASSWORD_MODE_SET_AT_LOGIN;
         dialog_validate (self);
@@ -1592,6 +1611,7 @@ cc_add_user_dialog_dispose (GObject *obj)
                 g_source_remove (self->local_password_timeout_id);
                 self->local_password_timeout_id = 0;
         }
+        g_clear_pointer (&self->local_pw_checker, pw_checker_free);
 
         if (self->local_name_timeout_id != 0) {
                 g_source_remove (self->local_name_timeout_id);
@@ -288,39 +288,209 @@ cc_carousel_goto_next_page (GtkWidget *button,
         cc_carousel_select_item_at_index (self, self->visible_page * ITEMS_PER_PAGE);
 }
 
+/* Repacks the items from @first_page onwards into fresh page boxes. Items
+ * are moved, not recreated, so their contents survive the relayout. */
 static void
-cc_carousel_add (GtkContainer *container,
-                 GtkWidget    *widget)
+cc_carousel_relayout_from (CcCarousel *self,
+                           gint        first_page)
 {
-        CcCarousel *self = CC_CAROUSEL (container);
-        gboolean last_box_is_full;
+        g_autoptr(GList) boxes = NULL;
+        GList *l;
+        gint index;
 
-        if (!CC_IS_CAROUSEL_ITEM (widget)) {
-                GTK_CONTAINER_CLASS (cc_carousel_parent_class)->add (container, widget);
-                return;
+        boxes = gtk_container_get_children (GTK_CONTAINER (self->stack));
+        index = first_page * ITEMS_PER_PAGE;
+
+        for (l = g_list_nth (self->children, index); l != NULL; l = l->next) {
+                GtkWidget *item = l->data;
+                GtkWidget *parent = gtk_widget_get_parent (item);
+
+                g_object_ref (item);
+                if (parent != NULL)
+                        gtk_container_remove (GTK_CONTAINER (parent), item);
         }
 
+        for (l = g_list_nth (boxes, first_page); l != NULL; l = l->next)
+                gtk_widget_destroy (l->data);
+
+        self->last_box = first_page > 0 ? g_list_nth_data (boxes, first_page - 1) : NULL;
+
+        for (l = g_list_nth (self->children, index); l != NULL; l = l->next, index++) {
+                CcCarouselItem *item = l->data;
+
+                if (index % ITEMS_PER_PAGE == 0) {
+                        self->last_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+                        gtk_widget_show (self->last_box);
+                        gtk_widget_set_valign (self->last_box, GTK_ALIGN_CENTER);
+                        gtk_container_add (GTK_CONTAINER (self->stack), self->last_box);
+                }
+
+                item->page = index / ITEMS_PER_PAGE;
+                gtk_box_pack_start (GTK_BOX (self->last_box), GTK_WIDGET (item), TRUE, FALSE, 10);
+                g_object_unref (item);
+        }
+
+        /* Stay on the page of the selected item, its box may have been replaced */
+        if (self->selected_item != NULL) {
+                g_autoptr(GList) pages = gtk_container_get_children (GTK_CONTAINER (self->stack));
+
+                self->visible_page = self->selected_item->page;
+                gtk_stack_set_visible_child (self->stack, g_list_nth_data (pages, self->visible_page));
+        }
+
+        update_buttons_visibility (self);
+}
+
+static void
+cc_carousel_setup_item (CcCarousel     *self,
+                        CcCarouselItem *item)
+{
+        GtkWidget *widget = GTK_WIDGET (item);
+
         gtk_style_context_add_class (gtk_widget_get_style_context (widget), "menu");
         gtk_button_set_relief (GTK_BUTTON (widget), GTK_RELIEF_NONE);
 
-        self->children = g_list_append (self->children, widget);
-        CC_CAROUSEL_ITEM (widget)->page = get_last_page_number (self);
         if (self->selected_item != NULL)
                 gtk_radio_button_join_group (GTK_RADIO_BUTTON (widget), GTK_RADIO_BUTTON (self->selected_item));
         g_signal_connect_object (widget, "button-press-event", G_CALLBACK (on_item_toggled), self, G_CONNECT_SWAPPED);
 
-        last_box_is_full = ((g_list_length (self->children) - 1) % ITEMS_PER_PAGE == 0);
-        if (last_box_is_full) {
-                self->last_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-                gtk_widget_show (self->last_box);
-                gtk_widget_set_valign (self->last_box, GTK_ALIGN_CENTER);
-                gtk_container_add (GTK_CONTAINER (self->stack), self->last_box);
+        gtk_widget_show_all (widget);
+}
+
+/**
+ * cc_carousel_insert_item:
+ * @self: a #CcCarousel
+ * @item: a #CcCarouselItem
+ * @position: the position to insert @item at, or -1 to append it
+ *
+ * Inserts @item without rebuilding the items before it.
+ */
+void
+cc_carousel_insert_item (CcCarousel     *self,
+                         CcCarouselItem *item,
+                         gint            position)
+{
+        gint index;
+
+        g_return_if_fail (CC_IS_CAROUSEL (self));
+        g_return_if_fail (CC_IS_CAROUSEL_ITEM (item));
+
+        cc_carousel_setup_item (self, item);
+
+        self->children = g_list_insert (self->children, item, position);
+        index = g_list_index (self->children, item);
+
+        cc_carousel_relayout_from (self, index / ITEMS_PER_PAGE);
+}
+
+/**
+ * cc_carousel_insert_item_sorted:
+ * @self: a #CcCarousel
+ * @item: a #CcCarouselItem
+ * @func: the function comparing two items
+ * @user_data: user data passed to @func
+ *
+ * Inserts @item before the first item that sorts after it.
+ */
+void
+cc_carousel_insert_item_sorted (CcCarousel       *self,
+                                CcCarouselItem   *item,
+                                GCompareDataFunc  func,
+                                gpointer          user_data)
+{
+        GList *l;
+        gint position = 0;
+
+        for (l = self->children; l != NULL; l = l->next, position++) {
+                if (func (item, l->data, user_data) < 0)
+                        break;
         }
 
-        gtk_widget_show_all (widget);
-        gtk_box_pack_start (GTK_BOX (self->last_box), widget, TRUE, FALSE, 10);
+        cc_carousel_insert_item (self, item, l != NULL ? position : -1);
+}
 
-        update_buttons_visibility (self);
+/**
+ * cc_carousel_resort_item:
+ * @self: a #CcCarousel
+ * @item: a #CcCarouselItem of @self
+ * @func: the function comparing two items
+ * @user_data: user data passed to @func
+ *
+ * Moves @item to its sorted position after its sort key changed.
+ */
+void
+cc_carousel_resort_item (CcCarousel       *self,
+                         CcCarouselItem   *item,
+                         GCompareDataFunc  func,
+                         gpointer          user_data)
+{
+        GList *link, *l;
+        gint old_index, new_index = 0;
+
+        link = g_list_find (self->children, item);
+        g_return_if_fail (link != NULL);
+
+        old_index = g_list_position (self->children, link);
+        self->children = g_list_delete_link (self->children, link);
+
+        for (l = self->children; l != NULL; l = l->next, new_index++) {
+                if (func (item, l->data, user_data) < 0)
+                        break;
+        }
+
+        self->children = g_list_insert (self->children, item, new_index);
+
+        if (new_index != old_index)
+                cc_carousel_relayout_from (self, MIN (old_index, new_index) / ITEMS_PER_PAGE);
+}
+
+/**
+ * cc_carousel_remove_item:
+ * @self: a #CcCarousel
+ * @item: a #CcCarouselItem of @self
+ *
+ * Destroys @item. If it was selected, the item taking its place is
+ * selected instead.
+ */
+void
+cc_carousel_remove_item (CcCarousel     *self,
+                         CcCarouselItem *item)
+{
+        GList *link;
+        gboolean was_selected;
+        gint index;
+
+        link = g_list_find (self->children, item);
+        g_return_if_fail (link != NULL);
+
+        index = g_list_position (self->children, link);
+        was_selected = (self->selected_item == item);
+
+        self->children = g_list_delete_link (self->children, link);
+        if (was_selected)
+                self->selected_item = NULL;
+        gtk_widget_destroy (GTK_WIDGET (item));
+
+        cc_carousel_relayout_from (self, index / ITEMS_PER_PAGE);
+
+        if (was_selected && self->children != NULL) {
+                index = MIN (index, (gint) g_list_length (self->children) - 1);
+                cc_carousel_select_item (self, g_list_nth_data (self->children, index));
+        }
+}
+
+static void
+cc_carousel_add (GtkContainer *container,
+                 GtkWidget    *widget)
+{
+        CcCarousel *self = CC_CAROUSEL (container);
+
+        if (!CC_IS_CAROUSEL_ITEM (widget)) {
+                GTK_CONTAINER_CLASS (cc_carousel_parent_class)->add (container, widget);
+                return;
+        }
+
+        cc_carousel_insert_item (self, CC_CAROUSEL_ITEM (widget), -1);
 }
 
 void
@@ -334,6 +504,7 @@ cc_carousel_purge_items (CcCarousel *self)
         self->children = NULL;
         self->visible_page = 0;
         self->selected_item = NULL;
+        self->last_box = NULL;
 }
 
 CcCarousel *
@@ -55,6 +55,7 @@ struct _CcPasswordDialog
         GtkLabel           *verify_hint_label;
 
         gint                password_entry_timeout_id;
+        PwChecker          *pw_checker;
 
         ActUser            *user;
         ActUserPasswordMode password_mode;
@@ -81,8 +82,10 @@ update_password_strength (CcPasswordDialog *self)
         old_password = gtk_entry_get_text (self->old_password_entry);
         username = act_user_get_user_name (self->user);
 
-        pw_strength (password, old_password, username,
-                     &hint, &strength_level);
+        /* Evaluated off the main thread, see password_strength_cb() */
+        if (!pw_checker_lookup (self->pw_checker, password, old_password, username,
+                                &strength_level, &hint))
+                return 0;
 
         gtk_level_bar_set_value (self->strength_indicator, strength_level);
         gtk_label_set_label (self->password_hint_label, hint);
@@ -267,6 +270,20 @@ update_password_match (CcPasswordDialog *self)
         gtk_label_set_label (self->verify_hint_label, message);
 }
 
+static void
+password_strength_cb (gint         strength_level,
+                      const gchar *hint,
+                      gpointer     user_data)
+{
+        CcPasswordDialog *self = CC_PASSWORD_DIALOG (user_data);
+
+        /* Don't enable the OK button while a newer input is being debounced */
+        if (self->password_entry_timeout_id != 0)
+                return;
+
+        update_sensitivity (self);
+}
+
 static gboolean
 password_entry_timeout (CcPasswordDialog *self)
 {
@@ -432,6 +449,7 @@ cc_password_dialog_dispose (GObject *object)
         CcPasswordDialog *self = CC_PASSWORD_DIALOG (object);
 
         g_clear_object (&self->user);
+        g_clear_pointer (&self->pw_checker, pw_checker_free);
 
         if (self->passwd_handler) {
                 passwd_destroy (self->passwd_handler);
@@ -489,6 +507,8 @@ cc_password_dialog_init (CcPasswordDialog *self)
 {
         g_resources_register (cc_user_accounts_get_resource ());
 
+        self->pw_checker = pw_checker_new (password_strength_cb, self);
+
         gtk_widget_init_template (GTK_WIDGET (self));
 }
 
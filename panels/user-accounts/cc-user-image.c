@@ -21,6 +21,7 @@
 #include <gtk/gtk.h>
 #include <act/act.h>
 #include <sys/stat.h>
+#include <glib/gstdio.h>
 
 #include "user-utils.h"
 
@@ -28,6 +29,9 @@ struct _CcUserImage {
         GtkImage parent_instance;
 
         ActUser *user;
+
+        /* Describes what the current surface was rendered from */
+        gchar *render_key;
 };
 
 G_DEFINE_TYPE (CcUserImage, cc_user_image, GTK_TYPE_IMAGE)
@@ -72,10 +76,37 @@ render_user_icon (ActUser *user,
         return NULL;
 }
 
+/* The avatar only needs rendering again if the icon file was replaced,
+ * or, for generated avatars, the name it is made from changed. The
+ * mtime is taken with nanoseconds, as a file replaced within the same
+ * second would otherwise keep the old render */
+static gchar *
+get_render_key (ActUser *user,
+                gint     icon_size,
+                gint     scale)
+{
+        const gchar *icon_file;
+        GStatBuf st;
+
+        icon_file = act_user_get_icon_file (user);
+        if (icon_file != NULL && g_stat (icon_file, &st) == 0)
+                return g_strdup_printf ("%s:%" G_GINT64_FORMAT ".%09ld:%" G_GINT64_FORMAT ":%d:%d",
+                                        icon_file,
+                                        (gint64) st.st_mtim.tv_sec, (long) st.st_mtim.tv_nsec,
+                                        (gint64) st.st_size,
+                                        icon_size, scale);
+
+        return g_strdup_printf ("%s:%s:%d:%d",
+                                act_user_get_real_name (user),
+                                act_user_get_user_name (user),
+                                icon_size, scale);
+}
+
 static void
 render_image (CcUserImage *image)
 {
         cairo_surface_t *surface;
+        g_autofree gchar *render_key = NULL;
         gint scale, pixel_size;
 
         if (image->user == NULL)
@@ -83,6 +114,14 @@ render_image (CcUserImage *image)
 
         pixel_size = gtk_image_get_pixel_size (GTK_IMAGE (image));
         scale = gtk_widget_get_scale_factor (GTK_WIDGET (image));
+
+        render_key = get_render_key (image->user, pixel_size > 0 ? pixel_size : 48, scale);
+        if (g_strcmp0 (render_key, image->render_key) == 0)
+                return;
+
+        g_free (image->render_key);
+        image->render_key = g_steal_pointer (&render_key);
+
         surface = render_user_icon (image->user,
                                     pixel_size > 0 ? pixel_size : 48,
                                     scale);
@@ -106,6 +145,7 @@ cc_user_image_finalize (GObject *object)
         CcUserImage *image = CC_USER_IMAGE (object);
 
         g_clear_object (&image->user);
+        g_clear_pointer (&image->render_key, g_free);
 
         G_OBJECT_CLASS (cc_user_image_parent_class)->finalize (object);
 }
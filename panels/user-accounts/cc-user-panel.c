@@ -116,12 +116,12 @@ struct _CcUserPanel {
         CcFingerprintManager *fingerprint_manager;
 
         gint other_accounts;
+        GHashTable *user_items; /* uid → CcCarouselItem */
 };
 
 CC_PANEL_REGISTER (CcUserPanel, cc_user_panel)
 
 static void show_restart_notification (CcUserPanel *self, const gchar *locale);
-static gint user_compare (gconstpointer i, gconstpointer u);
 
 typedef struct {
         CcUserPanel *self;
@@ -197,26 +197,42 @@ set_selected_user (CcUserPanel *self, CcCarouselItem *item)
         }
 }
 
-static GtkWidget *
-create_carousel_entry (CcUserPanel *self, ActUser *user)
+static void
+update_carousel_entry (CcUserPanel *self, CcCarouselItem *item, ActUser *user)
 {
-        GtkWidget *box, *widget;
+        CcUserImage *image;
+        GtkLabel *name_label;
         g_autofree gchar *label = NULL;
+
+        image = g_object_get_data (G_OBJECT (item), "image");
+        cc_user_image_set_user (image, user);
+
+        name_label = g_object_get_data (G_OBJECT (item), "name-label");
+        label = g_markup_printf_escaped ("<b>%s</b>",
+                                         get_real_or_user_name (user));
+        gtk_label_set_label (name_label, label);
+}
+
+static CcCarouselItem *
+create_carousel_item (CcUserPanel *self, ActUser *user)
+{
+        GtkWidget *item, *box, *widget;
         g_autofree gchar *subtitle_label = NULL;
 
+        item = cc_carousel_item_new ();
         box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+        gtk_container_add (GTK_CONTAINER (item), box);
 
         widget = cc_user_image_new ();
-        cc_user_image_set_user (CC_USER_IMAGE (widget), user);
         gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
+        g_object_set_data (G_OBJECT (item), "image", widget);
 
-        label = g_markup_printf_escaped ("<b>%s</b>",
-                                         get_real_or_user_name (user));
-        widget = gtk_label_new (label);
+        widget = gtk_label_new (NULL);
         gtk_label_set_use_markup (GTK_LABEL (widget), TRUE);
         gtk_label_set_ellipsize (GTK_LABEL (widget), PANGO_ELLIPSIZE_END);
         gtk_widget_set_margin_top (widget, 5);
         gtk_box_pack_start (GTK_BOX (box), widget, FALSE, TRUE, 0);
+        g_object_set_data (G_OBJECT (item), "name-label", widget);
 
         if (act_user_get_uid (user) == getuid ())
                 subtitle_label = g_strdup_printf ("<small>%s</small>", _("Your account"));
@@ -230,37 +246,10 @@ create_carousel_entry (CcUserPanel *self, ActUser *user)
         gtk_style_context_add_class (gtk_widget_get_style_context (widget),
                                      "dim-label");
 
-        return box;
-}
-
-static void
-user_added (CcUserPanel *self, ActUser *user)
-{
-        GtkWidget *item, *widget;
-        gboolean show_carousel;
-
-        if (act_user_is_system_account (user)) {
-                return;
-        }
-
-        g_debug ("user added: %d %s\n", act_user_get_uid (user), get_real_or_user_name (user));
-
-        widget = create_carousel_entry (self, user);
-        item = cc_carousel_item_new ();
-        gtk_container_add (GTK_CONTAINER (item), widget);
-
         g_object_set_data (G_OBJECT (item), "uid", GINT_TO_POINTER (act_user_get_uid (user)));
-        gtk_container_add (GTK_CONTAINER (self->carousel), item);
-
-        if (act_user_get_uid (user) != getuid ()) {
-                self->other_accounts++;
-        }
+        update_carousel_entry (self, CC_CAROUSEL_ITEM (item), user);
 
-        /* Show heading for other accounts if new one have been added. */
-        show_carousel = (self->other_accounts > 0);
-        gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), show_carousel);
-
-        gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->users_overlay));
+        return CC_CAROUSEL_ITEM (item);
 }
 
 static gint
@@ -289,6 +278,117 @@ sort_users (gconstpointer a, gconstpointer b)
         }
 }
 
+static gint
+sort_carousel_items (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+        CcUserPanel *self = user_data;
+        ActUser *ua, *ub;
+
+        ua = act_user_manager_get_user_by_id (self->um, GPOINTER_TO_INT (g_object_get_data (G_OBJECT (a), "uid")));
+        ub = act_user_manager_get_user_by_id (self->um, GPOINTER_TO_INT (g_object_get_data (G_OBJECT (b), "uid")));
+        if (ua == NULL || ub == NULL)
+                return 0;
+
+        return sort_users (ua, ub);
+}
+
+static void
+update_users_visibility (CcUserPanel *self)
+{
+        gboolean show_carousel;
+
+        if (cc_carousel_get_item_count (self->carousel) == 0) {
+                gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->no_users_box));
+                gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), FALSE);
+                return;
+        }
+
+        gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->users_overlay));
+
+        /* Show heading for other accounts if there are any. */
+        show_carousel = (self->other_accounts > 0);
+        gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), show_carousel);
+
+#ifdef HAVE_MALCONTENT
+        /* Parental Controls row not to be shown for single user setups. */
+        gtk_widget_set_visible (GTK_WIDGET (self->parental_controls_row),
+                                g_hash_table_size (self->user_items) > 1);
+#endif
+}
+
+static CcCarouselItem *
+add_user_item (CcUserPanel *self, ActUser *user)
+{
+        CcCarouselItem *item;
+
+        if (act_user_is_system_account (user)) {
+                return NULL;
+        }
+
+        item = g_hash_table_lookup (self->user_items, GINT_TO_POINTER (act_user_get_uid (user)));
+        if (item != NULL)
+                return item;
+
+        g_debug ("user added: %d %s\n", act_user_get_uid (user), get_real_or_user_name (user));
+
+        item = create_carousel_item (self, user);
+        cc_carousel_insert_item_sorted (self->carousel, item, sort_carousel_items, self);
+        g_hash_table_insert (self->user_items, GINT_TO_POINTER (act_user_get_uid (user)), item);
+
+        if (act_user_get_uid (user) != getuid ()) {
+                self->other_accounts++;
+        }
+
+        return item;
+}
+
+static void
+user_added (CcUserPanel *self, ActUser *user)
+{
+        CcCarouselItem *item;
+
+        item = add_user_item (self, user);
+        if (item == NULL)
+                return;
+
+        update_users_visibility (self);
+
+        if (self->selected_user != NULL)
+                show_user (self->selected_user, self);
+        else
+                cc_carousel_select_item (self->carousel, item);
+}
+
+static void
+user_removed (CcUserPanel *self, ActUser *user)
+{
+        CcCarouselItem *item;
+        uid_t uid;
+
+        uid = act_user_get_uid (user);
+        item = g_hash_table_lookup (self->user_items, GINT_TO_POINTER (uid));
+        if (item == NULL)
+                return;
+
+        g_debug ("user removed: %d %s\n", uid, get_real_or_user_name (user));
+
+        if (uid != getuid ()) {
+                self->other_accounts--;
+        }
+
+        if (self->selected_user == user)
+                g_clear_object (&self->selected_user);
+
+        /* Selects the next user if the removed one was selected */
+        g_hash_table_remove (self->user_items, GINT_TO_POINTER (uid));
+        cc_carousel_remove_item (self->carousel, item);
+
+        update_users_visibility (self);
+
+        if (self->selected_user != NULL)
+                show_user (self->selected_user, self);
+}
+
 static void
 reload_users (CcUserPanel *self, ActUser *selected_user)
 {
@@ -297,7 +397,6 @@ reload_users (CcUserPanel *self, ActUser *selected_user)
         CcCarouselItem *item = NULL;
         GtkSettings *settings;
         gboolean animations;
-        guint users_count;
 
         settings = gtk_widget_get_settings (GTK_WIDGET (self->carousel));
 
@@ -305,60 +404,46 @@ reload_users (CcUserPanel *self, ActUser *selected_user)
         g_object_set (settings, "gtk-enable-animations", FALSE, NULL);
 
         cc_carousel_purge_items (self->carousel);
+        g_hash_table_remove_all (self->user_items);
         self->other_accounts = 0;
 
         list = act_user_manager_list_users (self->um);
-        users_count = g_slist_length (list);
-        g_debug ("Got %d users\n", users_count);
+        g_debug ("Got %u users", g_slist_length (list));
 
         list = g_slist_sort (list, (GCompareFunc) sort_users);
         for (l = list; l; l = l->next) {
                 user = l->data;
-                g_debug ("adding user %s\n", get_real_or_user_name (user));
-                user_added (self, user);
+                g_debug ("adding user %s", get_real_or_user_name (user));
+                add_user_item (self, user);
         }
         g_slist_free (list);
 
-        if (cc_carousel_get_item_count (self->carousel) == 0)
-                gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->no_users_box));
-        if (self->other_accounts == 0)
-                gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), FALSE);
+        update_users_visibility (self);
 
         if (selected_user)
-                item = cc_carousel_find_item (self->carousel, selected_user, user_compare);
+                item = g_hash_table_lookup (self->user_items, GINT_TO_POINTER (act_user_get_uid (selected_user)));
         cc_carousel_select_item (self->carousel, item);
 
         g_object_set (settings, "gtk-enable-animations", animations, NULL);
-#ifdef HAVE_MALCONTENT
-        /* Parental Controls row not to be shown for single user setups. */
-        gtk_widget_set_visible (GTK_WIDGET (self->parental_controls_row), users_count > 1);
-#endif
 }
 
-static gint
-user_compare (gconstpointer i,
-              gconstpointer u)
+static void
+user_changed (CcUserPanel *self, ActUser *user)
 {
         CcCarouselItem *item;
-        ActUser *user;
-        gint uid_a, uid_b;
-        gint result;
 
-        item = (CcCarouselItem *) i;
-        user = ACT_USER (u);
-
-        uid_a = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "uid"));
-        uid_b = act_user_get_uid (user);
-
-        result = uid_a - uid_b;
+        item = g_hash_table_lookup (self->user_items, GINT_TO_POINTER (act_user_get_uid (user)));
+        if (item == NULL) {
+                /* e.g. an account that stopped being a system account */
+                user_added (self, user);
+                return;
+        }
 
-        return result;
-}
+        update_carousel_entry (self, item, user);
+        cc_carousel_resort_item (self->carousel, item, sort_carousel_items, self);
 
-static void
-user_changed (CcUserPanel *self, ActUser *user)
-{
-        reload_users (self, self->selected_user);
+        if (user == self->selected_user)
+                show_user (user, self);
 }
 
 static void
@@ -377,8 +462,14 @@ add_user (CcUserPanel *self)
 
         user = cc_add_user_dialog_get_user (dialog);
         if (user != NULL) {
+                CcCarouselItem *item;
+
                 set_default_avatar (user);
-                reload_users (self, user);
+
+                /* The user-added signal may not have arrived yet */
+                item = add_user_item (self, user);
+                update_users_visibility (self);
+                cc_carousel_select_item (self->carousel, item);
         }
 
         gtk_widget_destroy (GTK_WIDGET (dialog));
@@ -1271,7 +1362,7 @@ users_loaded (CcUserPanel *self)
         g_signal_connect_object (self->um, "user-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-is-logged-in-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-added", G_CALLBACK (user_added), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_removed), self, G_CONNECT_SWAPPED);
 
         reload_users (self, NULL);
 }
@@ -1478,6 +1569,7 @@ setup_main_window (CcUserPanel *self)
         gboolean loaded;
 
         self->other_accounts = 0;
+        self->user_items = g_hash_table_new (g_direct_hash, g_direct_equal);
 
         add_unlock_tooltip (GTK_WIDGET (self->user_icon_image));
 
@@ -1586,6 +1678,7 @@ cc_user_panel_dispose (GObject *object)
         CcUserPanel *self = CC_USER_PANEL (object);
 
         g_clear_object (&self->selected_user);
+        g_clear_pointer (&self->user_items, g_hash_table_unref);
         g_clear_object (&self->login_screen_settings);
         g_clear_pointer ((GtkWidget **)&self->language_chooser, gtk_widget_destroy);
         g_clear_object (&self->permission);
@@ -27,28 +27,38 @@
 
 #include <pwquality.h>
 
+/* Delay before an input is handed to the worker, so that bursts of
+ * keystrokes only get evaluated once. */
+#define PW_CHECK_DELAY 100
+
+/* cracklib keeps static state, so checks must not run concurrently */
+G_LOCK_DEFINE_STATIC (pwquality);
+
 static pwquality_settings_t *
 get_pwq (void)
 {
         static pwquality_settings_t *settings;
 
-        if (settings == NULL) {
+        if (g_once_init_enter (&settings)) {
+                pwquality_settings_t *s;
                 gchar *err = NULL;
                 gint rv = 0;
 
-                settings = pwquality_default_settings ();
-                pwquality_set_int_value (settings, PWQ_SETTING_MAX_SEQUENCE, 4);
+                s = pwquality_default_settings ();
+                pwquality_set_int_value (s, PWQ_SETTING_MAX_SEQUENCE, 4);
 
-                rv = pwquality_read_config (settings, NULL, (gpointer)&err);
+                rv = pwquality_read_config (s, NULL, (gpointer)&err);
                 if (rv < 0) {
                         g_warning ("failed to read pwquality configuration: %s\n",
                                    pwquality_strerror (NULL, 0, rv, err));
-                        pwquality_free_settings (settings);
+                        pwquality_free_settings (s);
 
                         /* Load just default settings in case of failure. */
-                        settings = pwquality_default_settings ();
-                        pwquality_set_int_value (settings, PWQ_SETTING_MAX_SEQUENCE, 4);
+                        s = pwquality_default_settings ();
+                        pwquality_set_int_value (s, PWQ_SETTING_MAX_SEQUENCE, 4);
                 }
+
+                g_once_init_leave (&settings, s);
         }
 
         return settings;
@@ -75,7 +85,10 @@ pw_generate (void)
         gchar *res;
         gint rv;
 
+        /* The generated password goes through the cracklib check too */
+        G_LOCK (pwquality);
         rv = pwquality_generate (get_pwq (), 0, &res);
+        G_UNLOCK (pwquality);
 
         if (rv < 0) {
                 g_warning ("Password generation failed: %s\n",
@@ -86,6 +99,23 @@ pw_generate (void)
         return res;
 }
 
+/* Makes cracklib use the dictionary at @path, which is the prefix of
+ * its .pwd, .pwi and .hwm files, instead of the configured one */
+void
+pw_set_dict_path (const gchar *path)
+{
+        gint rv;
+
+        G_LOCK (pwquality);
+        rv = pwquality_set_str_value (get_pwq (), PWQ_SETTING_DICT_PATH, path);
+        G_UNLOCK (pwquality);
+
+        if (rv < 0) {
+                g_warning ("Failed to set the cracklib dictionary: %s",
+                           pwquality_strerror (NULL, 0, rv, NULL));
+        }
+}
+
 static const gchar *
 pw_error_hint (gint error)
 {
@@ -144,9 +174,11 @@ pw_strength (const gchar  *password,
         gdouble strength = 0.0;
         void *auxerror;
 
+        G_LOCK (pwquality);
         rv = pwquality_check (get_pwq (),
                               password, old_password, username,
                               &auxerror);
+        G_UNLOCK (pwquality);
 
         if (password != NULL)
                 length = strlen (password);
@@ -175,3 +207,195 @@ pw_strength (const gchar  *password,
 
         return strength;
 }
+
+struct _PwChecker {
+        PwCheckerFunc  callback;
+        gpointer       user_data;
+
+        /* The latest input, and its result once @done is set */
+        gboolean       has_input;
+        gchar         *password;
+        gchar         *old_password;
+        gchar         *username;
+        gboolean       done;
+        gint           strength_level;
+        const gchar   *hint;
+
+        guint          timeout_id;
+        GCancellable  *cancellable;
+};
+
+typedef struct {
+        gchar       *password;
+        gchar       *old_password;
+        gchar       *username;
+        gint         strength_level;
+        const gchar *hint;
+} CheckData;
+
+static void
+check_data_free (CheckData *data)
+{
+        g_free (data->password);
+        g_free (data->old_password);
+        g_free (data->username);
+        g_free (data);
+}
+
+static void
+check_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+        CheckData *data = task_data;
+
+        /* Superseded while waiting for the pool, no need to evaluate it */
+        if (g_task_return_error_if_cancelled (task))
+                return;
+
+        pw_strength (data->password, data->old_password, data->username,
+                     &data->hint, &data->strength_level);
+
+        g_task_return_boolean (task, TRUE);
+}
+
+static void
+check_done_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+        PwChecker *checker;
+        CheckData *data;
+
+        /* The checker is gone or the input changed; either way,
+         * @user_data must not be touched. */
+        if (!g_task_propagate_boolean (G_TASK (result), NULL))
+                return;
+
+        checker = user_data;
+        data = g_task_get_task_data (G_TASK (result));
+
+        g_clear_object (&checker->cancellable);
+        checker->done = TRUE;
+        checker->strength_level = data->strength_level;
+        checker->hint = data->hint;
+
+        checker->callback (checker->strength_level, checker->hint, checker->user_data);
+}
+
+static gboolean
+check_timeout_cb (gpointer user_data)
+{
+        PwChecker *checker = user_data;
+        g_autoptr(GTask) task = NULL;
+        CheckData *data;
+
+        checker->timeout_id = 0;
+        checker->cancellable = g_cancellable_new ();
+
+        data = g_new0 (CheckData, 1);
+        data->password = g_strdup (checker->password);
+        data->old_password = g_strdup (checker->old_password);
+        data->username = g_strdup (checker->username);
+
+        task = g_task_new (NULL, checker->cancellable, check_done_cb, checker);
+        g_task_set_source_tag (task, check_timeout_cb);
+        g_task_set_task_data (task, data, (GDestroyNotify) check_data_free);
+        g_task_run_in_thread (task, check_thread);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+pw_checker_cancel (PwChecker *checker)
+{
+        if (checker->timeout_id != 0) {
+                g_source_remove (checker->timeout_id);
+                checker->timeout_id = 0;
+        }
+
+        if (checker->cancellable != NULL) {
+                g_cancellable_cancel (checker->cancellable);
+                g_clear_object (&checker->cancellable);
+        }
+}
+
+PwChecker *
+pw_checker_new (PwCheckerFunc callback,
+                gpointer      user_data)
+{
+        PwChecker *checker;
+
+        g_return_val_if_fail (callback != NULL, NULL);
+
+        checker = g_new0 (PwChecker, 1);
+        checker->callback = callback;
+        checker->user_data = user_data;
+
+        return checker;
+}
+
+void
+pw_checker_free (PwChecker *checker)
+{
+        if (checker == NULL)
+                return;
+
+        pw_checker_cancel (checker);
+
+        g_free (checker->password);
+        g_free (checker->old_password);
+        g_free (checker->username);
+        g_free (checker);
+}
+
+/**
+ * pw_checker_lookup:
+ *
+ * Returns the strength of @password if it has already been evaluated
+ * for the given @old_password and @username. Otherwise, schedules its
+ * evaluation on a worker thread, dropping any evaluation of a previous
+ * input, and returns %FALSE; the callback passed to pw_checker_new()
+ * is then invoked once the result is available.
+ */
+gboolean
+pw_checker_lookup (PwChecker    *checker,
+                   const gchar  *password,
+                   const gchar  *old_password,
+                   const gchar  *username,
+                   gint         *strength_level,
+                   const gchar **hint)
+{
+        g_return_val_if_fail (checker != NULL, FALSE);
+
+        if (checker->has_input &&
+            g_strcmp0 (checker->password, password) == 0 &&
+            g_strcmp0 (checker->old_password, old_password) == 0 &&
+            g_strcmp0 (checker->username, username) == 0) {
+                if (!checker->done)
+                        return FALSE;
+
+                if (strength_level)
+                        *strength_level = checker->strength_level;
+                if (hint)
+                        *hint = checker->hint;
+
+                return TRUE;
+        }
+
+        pw_checker_cancel (checker);
+
+        g_free (checker->password);
+        g_free (checker->old_password);
+        g_free (checker->username);
+        checker->has_input = TRUE;
+        checker->password = g_strdup (password);
+        checker->old_password = g_strdup (old_password);
+        checker->username = g_strdup (username);
+        checker->done = FALSE;
+
+        checker->timeout_id = g_timeout_add (PW_CHECK_DELAY, check_timeout_cb, checker);
+
+        return FALSE;
+}
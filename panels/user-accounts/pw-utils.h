@@ -20,7 +20,7 @@
 
 #pragma once
 
-#include <glib.h>
+#include <gio/gio.h>
 
 gint     pw_min_length (void);
 gchar   *pw_generate   (void);
@@ -29,3 +29,24 @@ gdouble  pw_strength   (const gchar  *password,
                         const gchar  *username,
                         const gchar **hint,
                         gint         *strength_level);
+
+void     pw_set_dict_path (const gchar *path);
+
+typedef struct _PwChecker PwChecker;
+
+/* Called on the main thread once the strength of the latest input is known */
+typedef void (*PwCheckerFunc) (gint         strength_level,
+                               const gchar *hint,
+                               gpointer     user_data);
+
+PwChecker *pw_checker_new    (PwCheckerFunc  callback,
+                              gpointer       user_data);
+void       pw_checker_free   (PwChecker     *checker);
+gboolean   pw_checker_lookup (PwChecker     *checker,
+                              const gchar   *password,
+                              const gchar   *old_password,
+                              const gchar   *username,
+                              gint          *strength_level,
+                              const gchar  **hint);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwChecker, pw_checker_free)
@@ -19,12 +19,69 @@
 #include "cc-debug.h"
 #include "cc-log.h"
 
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <glib.h>
 
-G_LOCK_DEFINE_STATIC (channel_lock);
+/*
+ * Messages are formatted on the logging thread into a per-thread buffer,
+ * then handed over to a writer thread through a bounded lock-free ring
+ * (a multi-producer, single-consumer variant of Dmitry Vyukov's bounded
+ * queue). When the ring is full, messages are dropped and counted, and
+ * the writer reports how many were lost.
+ */
+
+#define RING_SIZE        4096
+#define RING_MASK        (RING_SIZE - 1)
+#define WRITE_BATCH_SIZE (64 * 1024)
+
+/* How long a write may wait for stdout to drain, and how long the fatal
+ * and exit paths wait for the writer thread, before giving up */
+#define WRITE_TIMEOUT_MS 1000
+#define FLUSH_TIMEOUT    (500 * G_TIME_SPAN_MILLISECOND)
+
+G_STATIC_ASSERT ((RING_SIZE & RING_MASK) == 0);
+
+typedef struct
+{
+  GLogLevelFlags  log_level;
+  gchar          *domain;   /* journal output only */
+  gchar          *text;     /* formatted line, or the bare message for the journal */
+} LogRecord;
+
+typedef struct
+{
+  gint       sequence;
+  LogRecord *record;
+} RingSlot;
+
+typedef struct
+{
+  GString   *buffer;
+  gint64     cached_second;
+  gchar      cached_time[16];
+} ThreadState;
 
-GIOChannel *standard_channel = NULL;
+static RingSlot ring[RING_SIZE];
+static gint enqueue_pos;
+static gint dequeue_pos;
+static gint written_pos;
+static gint n_dropped;
+
+static gboolean use_journal;
+static GThread *writer_thread;
+
+/* Only used to put the writer to sleep when the ring is empty */
+static GMutex writer_mutex;
+static GCond writer_cond;
+static gint writer_sleeping;
+
+static void thread_state_free (gpointer data);
+
+static GPrivate thread_state = G_PRIVATE_INIT (thread_state_free);
 
 static const gchar* ignored_domains[] =
 {
@@ -48,38 +105,378 @@ log_level_str (GLogLevelFlags log_level)
     }
 }
 
+static void
+log_record_free (LogRecord *record)
+{
+  g_free (record->domain);
+  g_free (record->text);
+  g_slice_free (LogRecord, record);
+}
+
+static void
+thread_state_free (gpointer data)
+{
+  ThreadState *state = data;
+
+  g_string_free (state->buffer, TRUE);
+  g_free (state);
+}
+
+static ThreadState *
+get_thread_state (void)
+{
+  ThreadState *state = g_private_get (&thread_state);
+
+  if (G_UNLIKELY (state == NULL))
+    {
+      state = g_new0 (ThreadState, 1);
+      state->buffer = g_string_sized_new (256);
+      state->cached_second = -1;
+      g_private_set (&thread_state, state);
+    }
+
+  return state;
+}
+
+/* Formats the message into the per-thread buffer; the wall clock time is
+ * only converted to local time when the second changes. */
+static const gchar *
+format_line (ThreadState    *state,
+             const gchar    *domain,
+             GLogLevelFlags  log_level,
+             const gchar    *message)
+{
+  gint64 now, second;
+
+  now = g_get_real_time ();
+  second = now / G_USEC_PER_SEC;
+
+  if (second != state->cached_second)
+    {
+      g_autoptr(GDateTime) date_time = g_date_time_new_from_unix_local (second);
+      g_autofree gchar *ftime = g_date_time_format (date_time, "%H:%M:%S");
+
+      g_strlcpy (state->cached_time, ftime, sizeof (state->cached_time));
+      state->cached_second = second;
+    }
+
+  g_string_truncate (state->buffer, 0);
+  g_string_append_printf (state->buffer,
+                          "%s.%04d  %24s: %s: %s\n",
+                          state->cached_time,
+                          (gint) (now % G_USEC_PER_SEC) / 1000,
+                          domain,
+                          log_level_str (log_level),
+                          message);
+
+  return state->buffer->str;
+}
+
+static gboolean
+ring_push (LogRecord *record)
+{
+  RingSlot *slot;
+  gint pos;
+
+  pos = g_atomic_int_get (&enqueue_pos);
+
+  for (;;)
+    {
+      gint diff;
+
+      slot = &ring[pos & RING_MASK];
+      diff = (gint) ((guint) g_atomic_int_get (&slot->sequence) - (guint) pos);
+
+      if (diff == 0)
+        {
+          if (g_atomic_int_compare_and_exchange (&enqueue_pos, pos, pos + 1))
+            break;
+          pos = g_atomic_int_get (&enqueue_pos);
+        }
+      else if (diff < 0)
+        {
+          /* Full */
+          return FALSE;
+        }
+      else
+        {
+          pos = g_atomic_int_get (&enqueue_pos);
+        }
+    }
+
+  slot->record = record;
+  g_atomic_int_set (&slot->sequence, pos + 1);
+
+  return TRUE;
+}
+
+/* Only ever called from the writer thread */
+static LogRecord *
+ring_pop (void)
+{
+  LogRecord *record;
+  RingSlot *slot;
+  gint pos;
+
+  pos = g_atomic_int_get (&dequeue_pos);
+  slot = &ring[pos & RING_MASK];
+
+  if ((gint) ((guint) g_atomic_int_get (&slot->sequence) - (guint) (pos + 1)) < 0)
+    return NULL;
+
+  record = slot->record;
+  slot->record = NULL;
+  g_atomic_int_set (&slot->sequence, pos + RING_SIZE);
+  g_atomic_int_set (&dequeue_pos, pos + 1);
+
+  return record;
+}
+
+static void
+wake_writer (void)
+{
+  if (!g_atomic_int_get (&writer_sleeping))
+    return;
+
+  g_mutex_lock (&writer_mutex);
+  g_cond_signal (&writer_cond);
+  g_mutex_unlock (&writer_mutex);
+}
+
+/* Drops whatever is left once stdout hasn't been writable for
+ * WRITE_TIMEOUT_MS, so that neither the writer thread nor a fatal
+ * message can hang on a full pipe or a stopped terminal for good */
+static void
+write_all (const gchar *data,
+           gsize        length)
+{
+  while (length > 0)
+    {
+      struct pollfd pfd = { STDOUT_FILENO, POLLOUT, 0 };
+      gssize written;
+      gint ready;
+
+      ready = poll (&pfd, 1, WRITE_TIMEOUT_MS);
+      if (ready < 0 && errno == EINTR)
+        continue;
+      if (ready <= 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        return;
+
+      written = write (STDOUT_FILENO, data, length);
+
+      if (written < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+            continue;
+          return;
+        }
+
+      data += written;
+      length -= written;
+    }
+}
+
+static void
+write_journal (GLogLevelFlags  log_level,
+               const gchar    *domain,
+               const gchar    *message)
+{
+  GLogField fields[] =
+    {
+      { "MESSAGE", message, -1 },
+      { "GLIB_DOMAIN", domain, -1 },
+    };
+
+  g_log_writer_journald (log_level, fields, domain ? G_N_ELEMENTS (fields) : 1, NULL);
+}
+
+static guint
+take_dropped (void)
+{
+  gint dropped;
+
+  do
+    dropped = g_atomic_int_get (&n_dropped);
+  while (dropped > 0 && !g_atomic_int_compare_and_exchange (&n_dropped, dropped, 0));
+
+  return dropped;
+}
+
+static void
+report_dropped (GString *batch)
+{
+  g_autofree gchar *message = NULL;
+  ThreadState *state;
+  guint dropped;
+
+  dropped = take_dropped ();
+  if (dropped == 0)
+    return;
+
+  message = g_strdup_printf ("%u messages dropped", dropped);
+
+  if (use_journal)
+    {
+      write_journal (G_LOG_LEVEL_WARNING, G_LOG_DOMAIN, message);
+      return;
+    }
+
+  state = get_thread_state ();
+  g_string_append (batch, format_line (state, G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, message));
+}
+
+static void
+write_batch (GString *batch)
+{
+  write_all (batch->str, batch->len);
+  g_string_truncate (batch, 0);
+}
+
+static gpointer
+writer_thread_func (gpointer user_data)
+{
+  g_autoptr(GString) batch = g_string_sized_new (WRITE_BATCH_SIZE);
+
+  for (;;)
+    {
+      LogRecord *record;
+
+      while ((record = ring_pop ()) != NULL)
+        {
+          if (use_journal)
+            write_journal (record->log_level, record->domain, record->text);
+          else
+            g_string_append (batch, record->text);
+
+          log_record_free (record);
+
+          if (batch->len >= WRITE_BATCH_SIZE)
+            {
+              write_batch (batch);
+              g_atomic_int_set (&written_pos, g_atomic_int_get (&dequeue_pos));
+            }
+        }
+
+      report_dropped (batch);
+
+      if (batch->len > 0)
+        write_batch (batch);
+
+      /* Everything popped so far is out, see cc_log_flush() */
+      g_atomic_int_set (&written_pos, g_atomic_int_get (&dequeue_pos));
+
+      /* Sleep until a producer wakes us up. The timeout covers the
+       * window between the last pop and setting writer_sleeping. */
+      g_mutex_lock (&writer_mutex);
+      g_atomic_int_set (&writer_sleeping, TRUE);
+      if (g_atomic_int_get (&ring[g_atomic_int_get (&dequeue_pos) & RING_MASK].sequence) !=
+          g_atomic_int_get (&dequeue_pos) + 1)
+        g_cond_wait_until (&writer_cond, &writer_mutex,
+                           g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+      g_atomic_int_set (&writer_sleeping, FALSE);
+      g_mutex_unlock (&writer_mutex);
+    }
+
+  return NULL;
+}
+
+/* Returns FALSE if the writer thread didn't get everything logged so far
+ * out by @deadline, or -1 to wait for as long as it takes */
+static gboolean
+flush_until (gint64 deadline)
+{
+  gint target;
+
+  /* Waiting on ourselves would never end */
+  if (g_thread_self () == writer_thread)
+    return FALSE;
+
+  target = g_atomic_int_get (&enqueue_pos);
+
+  while ((gint) ((guint) g_atomic_int_get (&written_pos) - (guint) target) < 0)
+    {
+      if (deadline >= 0 && g_get_monotonic_time () >= deadline)
+        return FALSE;
+
+      wake_writer ();
+      g_usleep (G_USEC_PER_SEC / 1000);
+    }
+
+  return TRUE;
+}
+
 static void
 log_handler (const gchar    *domain,
              GLogLevelFlags  log_level,
              const gchar    *message,
              gpointer        user_data)
 {
-  g_autoptr(GDateTime) now = NULL;
-  const gchar *level;
-  g_autofree gchar *ftime = NULL;
-  g_autofree gchar *buffer = NULL;
+  LogRecord *record;
 
   /* Skip ignored log domains */
   if (domain && g_strv_contains (ignored_domains, domain))
     return;
 
-  level = log_level_str (log_level);
-  now = g_date_time_new_now_local ();
-  ftime = g_date_time_format (now, "%H:%M:%S");
-  buffer = g_strdup_printf ("%s.%04d  %24s: %s: %s\n",
-                            ftime,
-                            g_date_time_get_microsecond (now) / 1000,
-                            domain,
-                            level,
-                            message);
+  /* The process is about to abort, so write everything out right away,
+   * unless the writer is stuck or is the one going down */
+  if (log_level & (G_LOG_FLAG_FATAL | G_LOG_LEVEL_ERROR))
+    {
+      flush_until (g_get_monotonic_time () + FLUSH_TIMEOUT);
+
+      if (use_journal)
+        {
+          write_journal (log_level, domain, message);
+        }
+      else
+        {
+          const gchar *line = format_line (get_thread_state (), domain, log_level, message);
+          write_all (line, strlen (line));
+        }
+
+      return;
+    }
+
+  record = g_slice_new0 (LogRecord);
+  record->log_level = log_level;
+
+  if (use_journal)
+    {
+      record->domain = g_strdup (domain);
+      record->text = g_strdup (message);
+    }
+  else
+    {
+      ThreadState *state = get_thread_state ();
+
+      format_line (state, domain, log_level, message);
+      record->text = g_strndup (state->buffer->str, state->buffer->len);
+    }
 
-  /* Safely write to the channel */
-  G_LOCK (channel_lock);
+  if (!ring_push (record))
+    {
+      g_atomic_int_inc (&n_dropped);
+      log_record_free (record);
+    }
 
-  g_io_channel_write_chars (standard_channel, buffer, -1, NULL, NULL);
-  g_io_channel_flush (standard_channel, NULL);
+  wake_writer ();
+}
 
-  G_UNLOCK (channel_lock);
+static void
+flush_at_exit (void)
+{
+  flush_until (g_get_monotonic_time () + FLUSH_TIMEOUT);
+}
+
+/**
+ * cc_log_flush:
+ *
+ * Blocks until every message logged so far has been written out. Does
+ * nothing when called from the writer thread.
+ */
+void
+cc_log_flush (void)
+{
+  flush_until (-1);
 }
 
 void
@@ -89,13 +486,23 @@ cc_log_init (void)
 
   if (g_once_init_enter (&initialized))
     {
-      standard_channel = g_io_channel_unix_new (STDOUT_FILENO);
+      guint i;
+
+      for (i = 0; i < RING_SIZE; i++)
+        ring[i].sequence = i;
+
+      /* Send structured records to the journal when stdout goes there */
+      use_journal = g_log_writer_is_journald (STDOUT_FILENO) ||
+                    g_getenv ("CC_LOG_JOURNAL") != NULL;
 
       g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
 
+      /* The writer never exits, the reference is kept for flush_until() */
+      writer_thread = g_thread_new ("cc-log", writer_thread_func, NULL);
+      atexit (flush_at_exit);
+
       g_log_set_default_handler (log_handler, NULL);
 
       g_once_init_leave (&initialized, TRUE);
     }
 }
-
@@ -20,6 +20,8 @@
 
 G_BEGIN_DECLS
 
-void cc_log_init (void);
+void cc_log_init  (void);
+
+void cc_log_flush (void);
 
 G_END_DECLS
@@ -115,6 +115,9 @@ gvc_mixer_card_set_name (GvcMixerCard *card,
 {
         g_return_val_if_fail (GVC_IS_MIXER_CARD (card), FALSE);
 
+        if (g_strcmp0 (card->priv->name, name) == 0)
+                return TRUE;
+
         g_free (card->priv->name);
         card->priv->name = g_strdup (name);
         g_object_notify (G_OBJECT (card), "name");
@@ -135,6 +138,9 @@ gvc_mixer_card_set_icon_name (GvcMixerCard *card,
 {
         g_return_val_if_fail (GVC_IS_MIXER_CARD (card), FALSE);
 
+        if (g_strcmp0 (card->priv->icon_name, icon_name) == 0)
+                return TRUE;
+
         g_free (card->priv->icon_name);
         card->priv->icon_name = g_strdup (icon_name);
         g_object_notify (G_OBJECT (card), "icon-name");
@@ -177,6 +183,9 @@ gvc_mixer_card_set_profile (GvcMixerCard *card,
         g_return_val_if_fail (GVC_IS_MIXER_CARD (card), FALSE);
         g_return_val_if_fail (card->priv->profiles != NULL, FALSE);
 
+        if (g_strcmp0 (card->priv->profile, profile) == 0)
+                return TRUE;
+
         g_free (card->priv->profile);
         card->priv->profile = g_strdup (profile);
 
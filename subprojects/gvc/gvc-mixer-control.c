@@ -48,6 +48,8 @@
 #include "gvc-mixer-card-private.h"
 #include "gvc-channel-map-private.h"
 #include "gvc-mixer-control-private.h"
+#include "gvc-mixer-event-queue.h"
+#include "gvc-mixer-stream-private.h"
 #include "gvc-mixer-ui-device.h"
 
 #define RECONNECT_DELAY 5
@@ -90,6 +92,7 @@ struct GvcMixerControlPrivate
 
         GHashTable       *ui_outputs; /* UI visible outputs */
         GHashTable       *ui_inputs;  /* UI visible inputs */
+        GHashTable       *port_devices; /* "card index:port name" -> device in the above */
 
         /* When we change profile on a device that is not the server default sink,
          * it will jump back to the default sink set by the server to prevent the
@@ -112,6 +115,9 @@ struct GvcMixerControlPrivate
         char    *internalmic_name;
 #endif /* HAVE_ALSA */
 
+        /* Subscription events waiting to be turned into requests */
+        GvcMixerEventQueue *event_queue;
+
         GvcMixerControlState state;
 };
 
@@ -1211,10 +1217,35 @@ add_stream (GvcMixerControl *control,
                        gvc_mixer_stream_get_id (stream));
 }
 
+static gchar *
+port_device_key (guint        card_index,
+                 const gchar *port_name)
+{
+        return g_strdup_printf ("%u:%s", card_index, port_name);
+}
+
+/* The device created for @port_name on the card at @card_index, if any */
+static GvcMixerUIDevice *
+lookup_port_device (GvcMixerControl *control,
+                    guint            card_index,
+                    const gchar     *port_name)
+{
+        GvcMixerUIDevice *device;
+        gchar            *key;
+
+        if (port_name == NULL)
+                return NULL;
+
+        key = port_device_key (card_index, port_name);
+        device = g_hash_table_lookup (control->priv->port_devices, key);
+        g_free (key);
+
+        return device;
+}
+
 /* This method will match individual stream ports against its corresponding device
- * It does this by:
- * - iterates through our devices and finds the one where the card-id on the device is the same as the card-id on the stream
- *   and the port-name on the device is the same as the streamport-name.
+ * It does this by looking up the device created for the port of the same name
+ * on the card the stream belongs to.
  * This should always find a match and is used exclusively by sync_devices().
  */
 static gboolean
@@ -1222,68 +1253,29 @@ match_stream_with_devices (GvcMixerControl    *control,
                            GvcMixerStreamPort *stream_port,
                            GvcMixerStream     *stream)
 {
-        GList                   *devices, *d;
+        GvcMixerUIDevice        *device;
         guint                    stream_card_id;
         guint                    stream_id;
-        gboolean                 in_possession = FALSE;
 
         stream_id      =  gvc_mixer_stream_get_id (stream);
         stream_card_id =  gvc_mixer_stream_get_card_index (stream);
 
-        devices  = g_hash_table_get_values (GVC_IS_MIXER_SOURCE (stream) ? control->priv->ui_inputs : control->priv->ui_outputs);
-
-        for (d = devices; d != NULL; d = d->next) {
-                GvcMixerUIDevice *device;
-                gint              device_stream_id;
-                gchar            *device_port_name;
-                gchar            *origin;
-                gchar            *description;
-                GvcMixerCard     *card;
-                guint             card_id;
-
-                device = d->data;
-                g_object_get (G_OBJECT (device),
-                             "stream-id", &device_stream_id,
-                             "card", &card,
-                             "origin", &origin,
-                             "description", &description,
-                             "port-name", &device_port_name,
-                              NULL);
-
-                card_id = gvc_mixer_card_get_index (card);
-
-                g_debug ("Attempt to match_stream update_with_existing_outputs - Try description : '%s', origin : '%s', device port name : '%s', card : %p, AGAINST stream port: '%s', sink card id %i",
-                         description,
-                         origin,
-                         device_port_name,
-                         card,
-                         stream_port->port,
-                         stream_card_id);
-
-                if (stream_card_id == card_id &&
-                    g_strcmp0 (device_port_name, stream_port->port) == 0) {
-                        g_debug ("Match device with stream: We have a match with description: '%s', origin: '%s', cached already with device id %u, so set stream id to %i",
-                                 description,
-                                 origin,
-                                 gvc_mixer_ui_device_get_id (device),
-                                 stream_id);
-
-                        g_object_set (G_OBJECT (device),
-                                      "stream-id", (gint)stream_id,
-                                      NULL);
-                        in_possession = TRUE;
-                }
+        device = lookup_port_device (control, stream_card_id, stream_port->port);
+        if (device == NULL ||
+            gvc_mixer_ui_device_is_output (device) == GVC_IS_MIXER_SOURCE (stream))
+                return FALSE;
 
-                g_free (device_port_name);
-                g_free (origin);
-                g_free (description);
+        g_debug ("Match device with stream: We have a match with description: '%s', origin: '%s', cached already with device id %u, so set stream id to %i",
+                 gvc_mixer_ui_device_get_description (device),
+                 gvc_mixer_ui_device_get_origin (device),
+                 gvc_mixer_ui_device_get_id (device),
+                 stream_id);
 
-                if (in_possession == TRUE)
-                        break;
-        }
+        g_object_set (G_OBJECT (device),
+                      "stream-id", (gint)stream_id,
+                      NULL);
 
-        g_list_free (devices);
-        return in_possession;
+        return TRUE;
 }
 
 /*
@@ -1484,6 +1476,7 @@ update_sink (GvcMixerControl    *control,
 {
         GvcMixerStream  *stream;
         gboolean        is_new;
+        guint           serial = 0;
         pa_volume_t     max_volume;
         GvcChannelMap   *map;
         char            map_buff[PA_CHANNEL_MAP_SNPRINT_MAX];
@@ -1533,6 +1526,9 @@ update_sink (GvcMixerControl    *control,
                 return;
         }
 
+        if (!is_new)
+                serial = gvc_mixer_stream_get_serial (stream);
+
         max_volume = pa_cvolume_max (&info->volume);
         gvc_mixer_stream_set_name (stream, info->name);
         gvc_mixer_stream_set_card_index (stream, info->card);
@@ -1573,7 +1569,7 @@ update_sink (GvcMixerControl    *control,
                 /* Always sink on a new stream to able to assign the right stream id
                  * to the appropriate outputs (multiple potential outputs per stream). */
                 sync_devices (control, stream);
-        } else {
+        } else if (serial != gvc_mixer_stream_get_serial (stream)) {
                 g_signal_emit (G_OBJECT (control),
                                signals[STREAM_CHANGED],
                                0,
@@ -1618,6 +1614,7 @@ update_source (GvcMixerControl      *control,
 {
         GvcMixerStream *stream;
         gboolean        is_new;
+        guint           serial = 0;
         pa_volume_t     max_volume;
 
 #if 1
@@ -1665,6 +1662,9 @@ update_source (GvcMixerControl      *control,
                 return;
         }
 
+        if (!is_new)
+                serial = gvc_mixer_stream_get_serial (stream);
+
         max_volume = pa_cvolume_max (&info->volume);
 
         gvc_mixer_stream_set_name (stream, info->name);
@@ -1698,7 +1698,7 @@ update_source (GvcMixerControl      *control,
                                      g_object_ref (stream));
                 add_stream (control, stream);
                 sync_devices (control, stream);
-        } else {
+        } else if (serial != gvc_mixer_stream_get_serial (stream)) {
                 g_signal_emit (G_OBJECT (control),
                                signals[STREAM_CHANGED],
                                0,
@@ -1760,6 +1760,7 @@ update_sink_input (GvcMixerControl          *control,
 {
         GvcMixerStream *stream;
         gboolean        is_new;
+        guint           serial = 0;
         pa_volume_t     max_volume;
         const char     *name;
 
@@ -1789,6 +1790,9 @@ update_sink_input (GvcMixerControl          *control,
                 return;
         }
 
+        if (!is_new)
+                serial = gvc_mixer_stream_get_serial (stream);
+
         max_volume = pa_cvolume_max (&info->volume);
 
         name = (const char *)g_hash_table_lookup (control->priv->clients,
@@ -1808,7 +1812,7 @@ update_sink_input (GvcMixerControl          *control,
                                      GUINT_TO_POINTER (info->index),
                                      g_object_ref (stream));
                 add_stream (control, stream);
-        } else {
+        } else if (serial != gvc_mixer_stream_get_serial (stream)) {
                 g_signal_emit (G_OBJECT (control),
                                signals[STREAM_CHANGED],
                                0,
@@ -1822,6 +1826,7 @@ update_source_output (GvcMixerControl             *control,
 {
         GvcMixerStream *stream;
         gboolean        is_new;
+        guint           serial = 0;
         pa_volume_t     max_volume;
         const char     *name;
 
@@ -1846,6 +1851,9 @@ update_source_output (GvcMixerControl             *control,
                 is_new = TRUE;
         }
 
+        if (!is_new)
+                serial = gvc_mixer_stream_get_serial (stream);
+
         name = (const char *)g_hash_table_lookup (control->priv->clients,
                                                   GUINT_TO_POINTER (info->client));
 
@@ -1864,7 +1872,7 @@ update_source_output (GvcMixerControl             *control,
                                      GUINT_TO_POINTER (info->index),
                                      g_object_ref (stream));
                 add_stream (control, stream);
-        } else {
+        } else if (serial != gvc_mixer_stream_get_serial (stream)) {
                 g_signal_emit (G_OBJECT (control),
                                signals[STREAM_CHANGED],
                                0,
@@ -1990,6 +1998,9 @@ create_ui_device_from_port (GvcMixerControl* control,
         g_hash_table_insert (is_card_port_an_output (port) ? control->priv->ui_outputs : control->priv->ui_inputs,
                              GUINT_TO_POINTER (gvc_mixer_ui_device_get_id (uidevice)),
                              uidevice);
+        g_hash_table_insert (control->priv->port_devices,
+                             port_device_key (gvc_mixer_card_get_index (card), port->port),
+                             uidevice);
 
 
         if (available) {
@@ -2018,40 +2029,23 @@ match_card_port_with_existing_device (GvcMixerControl   *control,
                                       GvcMixerCard      *card,
                                       gboolean           available)
 {
-        GList                   *d;
-        GList                   *devices;
         GvcMixerUIDevice        *device;
         gboolean                 is_output = is_card_port_an_output (card_port);
 
-        devices  = g_hash_table_get_values (is_output ? control->priv->ui_outputs : control->priv->ui_inputs);
-
-        for (d = devices; d != NULL; d = d->next) {
-                GvcMixerCard *device_card;
-                gchar        *device_port_name;
-
-                device = d->data;
-                g_object_get (G_OBJECT (device),
-                             "card", &device_card,
-                             "port-name", &device_port_name,
-                              NULL);
-
-                if (g_strcmp0 (card_port->port, device_port_name) == 0 &&
-                        device_card == card) {
-                        g_debug ("Found the relevant device %s, update its port availability flag to %i, is_output %i",
-                                 device_port_name,
-                                 available,
-                                 is_output);
-                        g_object_set (G_OBJECT (device),
-                                      "port-available", available, NULL);
-                        g_signal_emit (G_OBJECT (control),
-                                       is_output ? signals[available ? OUTPUT_ADDED : OUTPUT_REMOVED] : signals[available ? INPUT_ADDED : INPUT_REMOVED],
-                                       0,
-                                       gvc_mixer_ui_device_get_id (device));
-               }
-               g_free (device_port_name);
-        }
+        device = lookup_port_device (control, gvc_mixer_card_get_index (card), card_port->port);
+        if (device == NULL)
+                return;
 
-        g_list_free (devices);
+        g_debug ("Found the relevant device %s, update its port availability flag to %i, is_output %i",
+                 card_port->port,
+                 available,
+                 is_output);
+        g_object_set (G_OBJECT (device),
+                      "port-available", available, NULL);
+        g_signal_emit (G_OBJECT (control),
+                       is_output ? signals[available ? OUTPUT_ADDED : OUTPUT_REMOVED] : signals[available ? INPUT_ADDED : INPUT_REMOVED],
+                       0,
+                       gvc_mixer_ui_device_get_id (device));
 }
 
 static void
@@ -2536,6 +2530,7 @@ update_card (GvcMixerControl      *control,
         const GList  *m = NULL;
         GvcMixerCard *card;
         gboolean      is_new = FALSE;
+        GHashTable   *info_ports = NULL;
 #if 1
         guint i;
         const char *key;
@@ -2617,30 +2612,44 @@ update_card (GvcMixerControl      *control,
                 create_ui_device_from_card (control, card);
         }
 
+        /* Index the ports of the reply once, rather than searching them
+         * for each port of the card */
+        if (!is_new && card_ports != NULL) {
+                info_ports = g_hash_table_new (g_str_hash, g_str_equal);
+                for (i = 0; i < info->n_ports; i++)
+                        g_hash_table_insert (info_ports, (gpointer) info->ports[i]->name, info->ports[i]);
+        }
+
         for (m = card_ports; m != NULL; m = m->next) {
                 GvcMixerCardPort *card_port;
+                pa_card_port_info *info_port;
+
                 card_port = m->data;
-                if (is_new)
+                if (is_new) {
                         create_ui_device_from_port (control, card_port, card);
-                else {
-                        for (i = 0; i < info->n_ports; i++) {
-                                if (g_strcmp0 (card_port->port, info->ports[i]->name) == 0) {
-                                        if ((card_port->available == PA_PORT_AVAILABLE_NO) != (info->ports[i]->available == PA_PORT_AVAILABLE_NO)) {
-                                                card_port->available = info->ports[i]->available;
-                                                g_debug ("sync port availability on card %i, card port name '%s', new available value %i",
-                                                          gvc_mixer_card_get_index (card),
-                                                          card_port->port,
-                                                          card_port->available);
-                                                match_card_port_with_existing_device (control,
-                                                                                      card_port,
-                                                                                      card,
-                                                                                      card_port->available != PA_PORT_AVAILABLE_NO);
-                                        }
-                                }
-                        }
+                        continue;
+                }
+
+                info_port = g_hash_table_lookup (info_ports, card_port->port);
+                if (info_port == NULL)
+                        continue;
+
+                if ((card_port->available == PA_PORT_AVAILABLE_NO) != (info_port->available == PA_PORT_AVAILABLE_NO)) {
+                        card_port->available = info_port->available;
+                        g_debug ("sync port availability on card %i, card port name '%s', new available value %i",
+                                  gvc_mixer_card_get_index (card),
+                                  card_port->port,
+                                  card_port->available);
+                        match_card_port_with_existing_device (control,
+                                                              card_port,
+                                                              card,
+                                                              card_port->available != PA_PORT_AVAILABLE_NO);
                 }
         }
 
+        if (info_ports != NULL)
+                g_hash_table_destroy (info_ports);
+
 #ifdef HAVE_ALSA
         check_audio_device_selection_needed (control, info);
 #endif /* HAVE_ALSA */
@@ -3117,6 +3126,11 @@ remove_card (GvcMixerControl *control,
                                        gvc_mixer_ui_device_get_id (device));
                         g_debug ("Card removal remove device %s",
                                  gvc_mixer_ui_device_get_description (device));
+                        if (gvc_mixer_ui_device_get_port (device) != NULL) {
+                                gchar *key = port_device_key (index, gvc_mixer_ui_device_get_port (device));
+                                g_hash_table_remove (control->priv->port_devices, key);
+                                g_free (key);
+                        }
                         g_hash_table_remove (gvc_mixer_ui_device_is_output (device) ? control->priv->ui_outputs : control->priv->ui_inputs,
                                              GUINT_TO_POINTER (gvc_mixer_ui_device_get_id (device)));
                 }
@@ -3268,70 +3282,81 @@ remove_source_output (GvcMixerControl *control,
 }
 
 static void
-_pa_context_subscribe_cb (pa_context                  *context,
-                          pa_subscription_event_type_t t,
-                          uint32_t                     index,
-                          void                        *userdata)
+event_queue_update_cb (pa_subscription_event_type_t  facility,
+                       int                           index,
+                       gpointer                      user_data)
 {
-        GvcMixerControl *control = GVC_MIXER_CONTROL (userdata);
+        GvcMixerControl *control = GVC_MIXER_CONTROL (user_data);
 
-        switch (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+                req_update_server_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_CARD:
+                req_update_card (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+                req_update_client_info (control, index);
+                break;
         case PA_SUBSCRIPTION_EVENT_SINK:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_sink (control, index);
-                } else {
-                        req_update_sink_info (control, index);
-                }
+                req_update_sink_info (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_SOURCE:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_source (control, index);
-                } else {
-                        req_update_source_info (control, index);
-                }
+                req_update_source_info (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_sink_input (control, index);
-                } else {
-                        req_update_sink_input_info (control, index);
-                }
+                req_update_sink_input_info (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_source_output (control, index);
-                } else {
-                        req_update_source_output_info (control, index);
-                }
+                req_update_source_output_info (control, index);
                 break;
-
-        case PA_SUBSCRIPTION_EVENT_CLIENT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_client (control, index);
-                } else {
-                        req_update_client_info (control, index);
-                }
+        default:
                 break;
+        }
+}
 
-        case PA_SUBSCRIPTION_EVENT_SERVER:
-                req_update_server_info (control, index);
-                break;
+static void
+event_queue_remove_cb (pa_subscription_event_type_t  facility,
+                       uint32_t                      index,
+                       gpointer                      user_data)
+{
+        GvcMixerControl *control = GVC_MIXER_CONTROL (user_data);
 
+        switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+                remove_sink (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+                remove_source (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+                remove_sink_input (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+                remove_source_output (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+                remove_client (control, index);
+                break;
         case PA_SUBSCRIPTION_EVENT_CARD:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_card (control, index);
-                } else {
-                        req_update_card (control, index);
-                }
+                remove_card (control, index);
                 break;
         default:
                 break;
         }
 }
 
+static void
+_pa_context_subscribe_cb (pa_context                  *context,
+                          pa_subscription_event_type_t t,
+                          uint32_t                     index,
+                          void                        *userdata)
+{
+        GvcMixerControl *control = GVC_MIXER_CONTROL (userdata);
+
+        gvc_mixer_event_queue_push (control->priv->event_queue, t, index);
+}
+
 static void
 gvc_mixer_control_ready (GvcMixerControl *control)
 {
@@ -3453,6 +3478,8 @@ idle_reconnect (gpointer data)
                 gvc_mixer_new_pa_context (control);
         }
 
+        gvc_mixer_event_queue_clear (control->priv->event_queue);
+
         remove_all_streams (control, control->priv->sinks);
         remove_all_streams (control, control->priv->sources);
         remove_all_streams (control, control->priv->sink_inputs);
@@ -3529,6 +3556,7 @@ gvc_mixer_control_close (GvcMixerControl *control)
         g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), FALSE);
         g_return_val_if_fail (control->priv->pa_context != NULL, FALSE);
 
+        gvc_mixer_event_queue_clear (control->priv->event_queue);
         pa_context_disconnect (control->priv->pa_context);
 
         control->priv->state = GVC_STATE_CLOSED;
@@ -3546,6 +3574,8 @@ gvc_mixer_control_dispose (GObject *object)
                 control->priv->reconnect_id = 0;
         }
 
+        g_clear_pointer (&control->priv->event_queue, gvc_mixer_event_queue_free);
+
         if (control->priv->pa_context != NULL) {
                 pa_context_unref (control->priv->pa_context);
                 control->priv->pa_context = NULL;
@@ -3602,6 +3632,10 @@ gvc_mixer_control_dispose (GObject *object)
                 g_hash_table_destroy (control->priv->ui_inputs);
                 control->priv->ui_inputs = NULL;
         }
+        if (control->priv->port_devices != NULL) {
+                g_hash_table_destroy (control->priv->port_devices);
+                control->priv->port_devices = NULL;
+        }
 
         free_priv_port_names (control);
         G_OBJECT_CLASS (gvc_mixer_control_parent_class)->dispose (object);
@@ -3825,9 +3859,14 @@ gvc_mixer_control_init (GvcMixerControl *control)
         control->priv->cards = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_object_unref);
         control->priv->ui_outputs = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_object_unref);
         control->priv->ui_inputs = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_object_unref);
+        control->priv->port_devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
         control->priv->clients = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_free);
 
+        control->priv->event_queue = gvc_mixer_event_queue_new (event_queue_update_cb,
+                                                                event_queue_remove_cb,
+                                                                control);
+
 #ifdef HAVE_ALSA
         control->priv->headset_card = -1;
 #endif /* HAVE_ALSA */
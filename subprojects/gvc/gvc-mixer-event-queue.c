@@ -0,0 +1,189 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "gvc-mixer-event-queue.h"
+
+/*
+ * Folds bursts of subscription events, e.g. while a Bluetooth headset
+ * connects or an application sets up its streams, into a single update
+ * per object, handed out once the main loop is idle. Remove events go
+ * through straight away, and drop any pending update for the object.
+ */
+struct GvcMixerEventQueue
+{
+        GvcMixerEventQueueUpdateFunc  update_func;
+        GvcMixerEventQueueRemoveFunc  remove_func;
+        gpointer                      user_data;
+
+        /* Objects changed since the last flush, per facility. Sets of
+         * indexes. */
+        GHashTable                   *pending[PA_SUBSCRIPTION_EVENT_CARD + 1];
+        gboolean                      pending_server;
+        guint                         flush_id;
+};
+
+/* Same order as the initial requests in gvc_mixer_control_ready (), so
+ * cards are known before the streams referring to them */
+static const pa_subscription_event_type_t flush_order[] = {
+        PA_SUBSCRIPTION_EVENT_CARD,
+        PA_SUBSCRIPTION_EVENT_CLIENT,
+        PA_SUBSCRIPTION_EVENT_SINK,
+        PA_SUBSCRIPTION_EVENT_SOURCE,
+        PA_SUBSCRIPTION_EVENT_SINK_INPUT,
+        PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT,
+};
+
+GvcMixerEventQueue *
+gvc_mixer_event_queue_new (GvcMixerEventQueueUpdateFunc update_func,
+                           GvcMixerEventQueueRemoveFunc remove_func,
+                           gpointer                     user_data)
+{
+        GvcMixerEventQueue *queue;
+        guint i;
+
+        queue = g_new0 (GvcMixerEventQueue, 1);
+        queue->update_func = update_func;
+        queue->remove_func = remove_func;
+        queue->user_data = user_data;
+
+        for (i = 0; i < G_N_ELEMENTS (flush_order); i++)
+                queue->pending[flush_order[i]] = g_hash_table_new (NULL, NULL);
+
+        return queue;
+}
+
+void
+gvc_mixer_event_queue_free (GvcMixerEventQueue *queue)
+{
+        guint i;
+
+        if (queue == NULL)
+                return;
+
+        gvc_mixer_event_queue_clear (queue);
+        for (i = 0; i < G_N_ELEMENTS (queue->pending); i++)
+                g_clear_pointer (&queue->pending[i], g_hash_table_destroy);
+
+        g_free (queue);
+}
+
+static void
+flush_facility (GvcMixerEventQueue           *queue,
+                pa_subscription_event_type_t  facility)
+{
+        GHashTable *pending = queue->pending[facility];
+        GHashTableIter iter;
+        gpointer key;
+
+        if (g_hash_table_size (pending) == 0)
+                return;
+
+        /* Swapped out before calling out, as the callbacks may queue more */
+        queue->pending[facility] = g_hash_table_new (NULL, NULL);
+
+        if (g_hash_table_size (pending) > GVC_MIXER_EVENT_QUEUE_LIST_THRESHOLD) {
+                queue->update_func (facility, -1, queue->user_data);
+        } else {
+                g_hash_table_iter_init (&iter, pending);
+                while (g_hash_table_iter_next (&iter, &key, NULL))
+                        queue->update_func (facility, GPOINTER_TO_UINT (key), queue->user_data);
+        }
+
+        g_hash_table_destroy (pending);
+}
+
+/* Hands out one update per object changed since the last flush */
+void
+gvc_mixer_event_queue_flush (GvcMixerEventQueue *queue)
+{
+        guint i;
+
+        if (queue->flush_id != 0) {
+                g_source_remove (queue->flush_id);
+                queue->flush_id = 0;
+        }
+
+        if (queue->pending_server) {
+                queue->pending_server = FALSE;
+                queue->update_func (PA_SUBSCRIPTION_EVENT_SERVER, -1, queue->user_data);
+        }
+
+        for (i = 0; i < G_N_ELEMENTS (flush_order); i++)
+                flush_facility (queue, flush_order[i]);
+}
+
+static gboolean
+flush_idle_cb (gpointer user_data)
+{
+        GvcMixerEventQueue *queue = user_data;
+
+        queue->flush_id = 0;
+        gvc_mixer_event_queue_flush (queue);
+
+        return G_SOURCE_REMOVE;
+}
+
+/* Drops the pending updates, e.g. when the connection goes away */
+void
+gvc_mixer_event_queue_clear (GvcMixerEventQueue *queue)
+{
+        guint i;
+
+        if (queue->flush_id != 0) {
+                g_source_remove (queue->flush_id);
+                queue->flush_id = 0;
+        }
+
+        queue->pending_server = FALSE;
+        for (i = 0; i < G_N_ELEMENTS (queue->pending); i++) {
+                if (queue->pending[i] != NULL)
+                        g_hash_table_remove_all (queue->pending[i]);
+        }
+}
+
+void
+gvc_mixer_event_queue_push (GvcMixerEventQueue           *queue,
+                            pa_subscription_event_type_t  t,
+                            uint32_t                      index)
+{
+        pa_subscription_event_type_t facility;
+
+        facility = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+
+        if (facility == PA_SUBSCRIPTION_EVENT_SERVER) {
+                queue->pending_server = TRUE;
+        } else if (facility < G_N_ELEMENTS (queue->pending) && queue->pending[facility] != NULL) {
+                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+                        /* No point in asking about an object that is gone */
+                        if (g_hash_table_remove (queue->pending[facility], GUINT_TO_POINTER (index)))
+                                g_debug ("Dropping pending update for removed object %u", index);
+
+                        queue->remove_func (facility, index, queue->user_data);
+                        return;
+                }
+
+                g_hash_table_add (queue->pending[facility], GUINT_TO_POINTER (index));
+        } else {
+                return;
+        }
+
+        if (queue->flush_id == 0)
+                queue->flush_id = g_idle_add (flush_idle_cb, queue);
+}
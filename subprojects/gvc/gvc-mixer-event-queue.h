@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef __GVC_MIXER_EVENT_QUEUE_H
+#define __GVC_MIXER_EVENT_QUEUE_H
+
+#include <glib.h>
+#include <pulse/def.h>
+
+G_BEGIN_DECLS
+
+/* When more objects of one kind than this changed within the same main
+ * loop iteration, they are all fetched with a single list request. */
+#define GVC_MIXER_EVENT_QUEUE_LIST_THRESHOLD 8
+
+typedef struct GvcMixerEventQueue GvcMixerEventQueue;
+
+/* @index is -1 to ask for every object of @facility */
+typedef void (* GvcMixerEventQueueUpdateFunc) (pa_subscription_event_type_t  facility,
+                                               int                           index,
+                                               gpointer                      user_data);
+typedef void (* GvcMixerEventQueueRemoveFunc) (pa_subscription_event_type_t  facility,
+                                               uint32_t                      index,
+                                               gpointer                      user_data);
+
+GvcMixerEventQueue *gvc_mixer_event_queue_new   (GvcMixerEventQueueUpdateFunc  update_func,
+                                                 GvcMixerEventQueueRemoveFunc  remove_func,
+                                                 gpointer                      user_data);
+void                gvc_mixer_event_queue_free  (GvcMixerEventQueue           *queue);
+
+void                gvc_mixer_event_queue_push  (GvcMixerEventQueue           *queue,
+                                                 pa_subscription_event_type_t  t,
+                                                 uint32_t                      index);
+void                gvc_mixer_event_queue_flush (GvcMixerEventQueue           *queue);
+void                gvc_mixer_event_queue_clear (GvcMixerEventQueue           *queue);
+
+G_END_DECLS
+
+#endif /* __GVC_MIXER_EVENT_QUEUE_H */
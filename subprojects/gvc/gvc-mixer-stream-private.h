@@ -28,6 +28,7 @@
 G_BEGIN_DECLS
 
 pa_context *        gvc_mixer_stream_get_pa_context  (GvcMixerStream *stream);
+guint               gvc_mixer_stream_get_serial      (GvcMixerStream *stream);
 
 G_END_DECLS
 
@@ -59,6 +59,7 @@ struct GvcMixerStreamPrivate
         char          *human_port;
         GList         *ports;
         GvcMixerStreamState state;
+        guint          serial;
 };
 
 enum
@@ -286,6 +287,9 @@ gvc_mixer_stream_set_name (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->name, name) == 0)
+                return TRUE;
+
         g_free (stream->priv->name);
         stream->priv->name = g_strdup (name);
         g_object_notify (G_OBJECT (stream), "name");
@@ -299,6 +303,9 @@ gvc_mixer_stream_set_description (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->description, description) == 0)
+                return TRUE;
+
         g_free (stream->priv->description);
         stream->priv->description = g_strdup (description);
         g_object_notify (G_OBJECT (stream), "description");
@@ -320,6 +327,9 @@ gvc_mixer_stream_set_is_event_stream (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (stream->priv->is_event_stream == is_event_stream)
+                return TRUE;
+
         stream->priv->is_event_stream = is_event_stream;
         g_object_notify (G_OBJECT (stream), "is-event-stream");
 
@@ -340,6 +350,9 @@ gvc_mixer_stream_set_is_virtual (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (stream->priv->is_virtual == is_virtual)
+                return TRUE;
+
         stream->priv->is_virtual = is_virtual;
         g_object_notify (G_OBJECT (stream), "is-virtual");
 
@@ -359,6 +372,9 @@ gvc_mixer_stream_set_application_id (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->application_id, application_id) == 0)
+                return TRUE;
+
         g_free (stream->priv->application_id);
         stream->priv->application_id = g_strdup (application_id);
         g_object_notify (G_OBJECT (stream), "application-id");
@@ -450,6 +466,9 @@ gvc_mixer_stream_set_icon_name (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->icon_name, icon_name) == 0)
+                return TRUE;
+
         g_free (stream->priv->icon_name);
         stream->priv->icon_name = g_strdup (icon_name);
         g_object_notify (G_OBJECT (stream), "icon-name");
@@ -463,6 +482,9 @@ gvc_mixer_stream_set_form_factor (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->form_factor, form_factor) == 0)
+                return TRUE;
+
         g_free (stream->priv->form_factor);
         stream->priv->form_factor = g_strdup (form_factor);
         g_object_notify (G_OBJECT (stream), "form-factor");
@@ -476,6 +498,9 @@ gvc_mixer_stream_set_sysfs_path (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (g_strcmp0 (stream->priv->sysfs_path, sysfs_path) == 0)
+                return TRUE;
+
         g_free (stream->priv->sysfs_path);
         stream->priv->sysfs_path = g_strdup (sysfs_path);
         g_object_notify (G_OBJECT (stream), "sysfs-path");
@@ -544,6 +569,9 @@ gvc_mixer_stream_set_port (GvcMixerStream *stream,
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
         g_return_val_if_fail (stream->priv->ports != NULL, FALSE);
 
+        if (g_strcmp0 (stream->priv->port, port) == 0)
+                return TRUE;
+
         g_free (stream->priv->port);
         stream->priv->port = g_strdup (port);
 
@@ -644,12 +672,36 @@ gvc_mixer_stream_set_card_index (GvcMixerStream *stream,
 {
         g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), FALSE);
 
+        if (stream->priv->card_index == card_index)
+                return TRUE;
+
         stream->priv->card_index = card_index;
         g_object_notify (G_OBJECT (stream), "card-index");
 
         return TRUE;
 }
 
+/* Bumped whenever properties changed, so that callers can tell whether
+ * an update from the server actually changed anything. */
+guint
+gvc_mixer_stream_get_serial (GvcMixerStream *stream)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), 0);
+        return stream->priv->serial;
+}
+
+static void
+gvc_mixer_stream_dispatch_properties_changed (GObject     *object,
+                                              guint        n_pspecs,
+                                              GParamSpec **pspecs)
+{
+        GvcMixerStream *self = GVC_MIXER_STREAM (object);
+
+        self->priv->serial++;
+
+        G_OBJECT_CLASS (gvc_mixer_stream_parent_class)->dispatch_properties_changed (object, n_pspecs, pspecs);
+}
+
 static void
 gvc_mixer_stream_set_property (GObject       *object,
                                guint          prop_id,
@@ -892,6 +944,7 @@ gvc_mixer_stream_class_init (GvcMixerStreamClass *klass)
         gobject_class->finalize = gvc_mixer_stream_finalize;
         gobject_class->set_property = gvc_mixer_stream_set_property;
         gobject_class->get_property = gvc_mixer_stream_get_property;
+        gobject_class->dispatch_properties_changed = gvc_mixer_stream_dispatch_properties_changed;
 
         klass->push_volume = gvc_mixer_stream_real_push_volume;
         klass->change_port = gvc_mixer_stream_real_change_port;
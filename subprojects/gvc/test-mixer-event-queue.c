@@ -0,0 +1,331 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib.h>
+
+#include "gvc-mixer-event-queue.h"
+
+/* Replays subscription events, as recorded from PulseAudio, through the
+ * queue GvcMixerControl uses, with a stub standing in for the
+ * introspection requests */
+
+#define NEW(f)    (PA_SUBSCRIPTION_EVENT_ ## f | PA_SUBSCRIPTION_EVENT_NEW)
+#define CHANGE(f) (PA_SUBSCRIPTION_EVENT_ ## f | PA_SUBSCRIPTION_EVENT_CHANGE)
+#define REMOVE(f) (PA_SUBSCRIPTION_EVENT_ ## f | PA_SUBSCRIPTION_EVENT_REMOVE)
+
+/* Marks the end of what PulseAudio delivered within one main loop
+ * iteration, and of a recording */
+#define ITERATION ((pa_subscription_event_type_t) -1)
+#define END       ((pa_subscription_event_type_t) -2)
+
+typedef struct {
+        pa_subscription_event_type_t t;
+        uint32_t                     index;
+} RecordedEvent;
+
+/* A Bluetooth headset connecting: the card comes up and switches
+ * profile, its sink and source appear, and the running streams move */
+static const RecordedEvent headset_connect[] = {
+        { NEW (CARD), 5 },
+        { CHANGE (CARD), 5 },
+        { CHANGE (CARD), 5 },
+        { NEW (SINK), 12 },
+        { CHANGE (SINK), 12 },
+        { CHANGE (CARD), 5 },
+        { NEW (SOURCE), 20 },
+        { NEW (SOURCE), 21 },
+        { CHANGE (SOURCE), 20 },
+        { CHANGE (SERVER), PA_INVALID_INDEX },
+        { CHANGE (SINK), 12 },
+        { CHANGE (SINK), 12 },
+        { ITERATION, 0 },
+        { CHANGE (SINK_INPUT), 40 },
+        { CHANGE (SINK_INPUT), 41 },
+        { CHANGE (SINK_INPUT), 40 },
+        { CHANGE (SINK), 0 },
+        { CHANGE (SINK), 12 },
+        { CHANGE (SERVER), PA_INVALID_INDEX },
+        { CHANGE (SINK_INPUT), 41 },
+        { CHANGE (CARD), 5 },
+        { END, 0 },
+};
+
+/* An application setting up and tearing down its streams */
+static const RecordedEvent stream_churn[] = {
+        { NEW (CLIENT), 7 },
+        { NEW (SINK_INPUT), 42 },
+        { CHANGE (SINK_INPUT), 42 },
+        { CHANGE (SINK_INPUT), 42 },
+        { REMOVE (SINK_INPUT), 42 },
+        { NEW (SINK_INPUT), 43 },
+        { CHANGE (SINK_INPUT), 43 },
+        { CHANGE (CLIENT), 7 },
+        { ITERATION, 0 },
+        { CHANGE (SINK_INPUT), 43 },
+        { NEW (SOURCE_OUTPUT), 60 },
+        { CHANGE (SOURCE_OUTPUT), 60 },
+        { REMOVE (SOURCE_OUTPUT), 60 },
+        { CHANGE (SINK_INPUT), 43 },
+        { ITERATION, 0 },
+        { REMOVE (SINK_INPUT), 43 },
+        { REMOVE (CLIENT), 7 },
+        { END, 0 },
+};
+
+typedef struct {
+        pa_subscription_event_type_t facility;
+        int                          index;
+        gint64                       time;
+} Request;
+
+typedef struct {
+        GArray *requests;
+        GArray *removals;
+} Stub;
+
+static void
+stub_update_cb (pa_subscription_event_type_t  facility,
+                int                           index,
+                gpointer                      user_data)
+{
+        Stub *stub = user_data;
+        Request request = { facility, index, g_get_monotonic_time () };
+
+        g_array_append_val (stub->requests, request);
+}
+
+static void
+stub_remove_cb (pa_subscription_event_type_t  facility,
+                uint32_t                      index,
+                gpointer                      user_data)
+{
+        Stub *stub = user_data;
+        Request request = { facility, index, g_get_monotonic_time () };
+
+        g_array_append_val (stub->removals, request);
+}
+
+static void
+stub_init (Stub *stub)
+{
+        stub->requests = g_array_new (FALSE, FALSE, sizeof (Request));
+        stub->removals = g_array_new (FALSE, FALSE, sizeof (Request));
+}
+
+static void
+stub_clear (Stub *stub)
+{
+        g_array_unref (stub->requests);
+        g_array_unref (stub->removals);
+}
+
+static void
+run_main_loop (void)
+{
+        while (g_main_context_iteration (NULL, FALSE))
+                ;
+}
+
+static gpointer
+object_key (pa_subscription_event_type_t facility,
+            uint32_t                     index)
+{
+        return GUINT_TO_POINTER ((facility << 24) | (index & 0xffffff));
+}
+
+/* Where each of the facilities is flushed, so that cards are known
+ * before the streams referring to them */
+static gint
+flush_rank (pa_subscription_event_type_t facility)
+{
+        switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+                return 0;
+        case PA_SUBSCRIPTION_EVENT_CARD:
+                return 1;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+                return 2;
+        default:
+                return 3;
+        }
+}
+
+/*
+ * Feeds @events to @queue, one main loop iteration at a time, and checks
+ * that each iteration results in exactly one request per object changed
+ * and still around, in flush order. Returns the number of requests.
+ */
+static guint
+replay (const RecordedEvent *events,
+        guint               *n_events,
+        gint64              *max_latency)
+{
+        GvcMixerEventQueue *queue;
+        Stub stub;
+        guint n_requests = 0;
+        guint i = 0;
+
+        stub_init (&stub);
+        queue = gvc_mixer_event_queue_new (stub_update_cb, stub_remove_cb, &stub);
+        *n_events = 0;
+        *max_latency = 0;
+
+        while (events[i].t != END) {
+                g_autoptr(GHashTable) expected = g_hash_table_new (NULL, NULL);
+                g_autoptr(GHashTable) seen = g_hash_table_new (NULL, NULL);
+                guint n_removals = 0;
+                gint64 pushed;
+                guint j;
+
+                g_array_set_size (stub.requests, 0);
+                g_array_set_size (stub.removals, 0);
+
+                for (; events[i].t != ITERATION && events[i].t != END; i++) {
+                        pa_subscription_event_type_t facility = events[i].t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+                        gpointer key = object_key (facility, events[i].index);
+
+                        if ((events[i].t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+                                g_hash_table_remove (expected, key);
+                                n_removals++;
+                        } else {
+                                g_hash_table_add (expected, key);
+                        }
+
+                        gvc_mixer_event_queue_push (queue, events[i].t, events[i].index);
+                        (*n_events)++;
+                }
+                pushed = g_get_monotonic_time ();
+
+                /* Removals go through straight away, updates wait */
+                g_assert_cmpuint (stub.removals->len, ==, n_removals);
+                g_assert_cmpuint (stub.requests->len, ==, 0);
+
+                run_main_loop ();
+
+                g_assert_cmpuint (stub.requests->len, ==, g_hash_table_size (expected));
+                for (j = 0; j < stub.requests->len; j++) {
+                        Request *request = &g_array_index (stub.requests, Request, j);
+                        uint32_t index = request->facility == PA_SUBSCRIPTION_EVENT_SERVER ? PA_INVALID_INDEX : (uint32_t) request->index;
+                        gpointer key = object_key (request->facility, index);
+
+                        g_assert_true (g_hash_table_contains (expected, key));
+                        g_assert_true (g_hash_table_add (seen, key));
+
+                        if (j > 0) {
+                                Request *previous = &g_array_index (stub.requests, Request, j - 1);
+                                g_assert_cmpint (flush_rank (previous->facility), <=, flush_rank (request->facility));
+                        }
+
+                        *max_latency = MAX (*max_latency, request->time - pushed);
+                }
+
+                n_requests += stub.requests->len;
+
+                if (events[i].t == ITERATION)
+                        i++;
+        }
+
+        gvc_mixer_event_queue_free (queue);
+        stub_clear (&stub);
+
+        return n_requests;
+}
+
+static void
+test_replay (gconstpointer data)
+{
+        const RecordedEvent *events = data;
+        guint n_events, n_requests;
+        gint64 max_latency;
+
+        n_requests = replay (events, &n_events, &max_latency);
+
+        g_test_message ("%u events, %u requests, at most %" G_GINT64_FORMAT " µs from the last event to a request",
+                        n_events, n_requests, max_latency);
+        g_assert_cmpuint (n_requests, <, n_events);
+        g_assert_cmpint (max_latency, <, 50 * G_TIME_SPAN_MILLISECOND);
+}
+
+static void
+test_list_threshold (void)
+{
+        GvcMixerEventQueue *queue;
+        Stub stub;
+        Request *request;
+        guint i;
+
+        stub_init (&stub);
+        queue = gvc_mixer_event_queue_new (stub_update_cb, stub_remove_cb, &stub);
+
+        /* Lots of streams at once are fetched with a single list request */
+        for (i = 0; i <= GVC_MIXER_EVENT_QUEUE_LIST_THRESHOLD * 2; i++) {
+                gvc_mixer_event_queue_push (queue, NEW (SINK_INPUT), 100 + i);
+                gvc_mixer_event_queue_push (queue, CHANGE (SINK_INPUT), 100 + i);
+        }
+        gvc_mixer_event_queue_push (queue, CHANGE (SINK), 1);
+        run_main_loop ();
+
+        g_assert_cmpuint (stub.requests->len, ==, 2);
+        request = &g_array_index (stub.requests, Request, 0);
+        g_assert_cmpuint (request->facility, ==, PA_SUBSCRIPTION_EVENT_SINK);
+        g_assert_cmpint (request->index, ==, 1);
+        request = &g_array_index (stub.requests, Request, 1);
+        g_assert_cmpuint (request->facility, ==, PA_SUBSCRIPTION_EVENT_SINK_INPUT);
+        g_assert_cmpint (request->index, ==, -1);
+
+        gvc_mixer_event_queue_free (queue);
+        stub_clear (&stub);
+}
+
+static void
+test_clear (void)
+{
+        GvcMixerEventQueue *queue;
+        Stub stub;
+
+        stub_init (&stub);
+        queue = gvc_mixer_event_queue_new (stub_update_cb, stub_remove_cb, &stub);
+
+        /* Nothing is asked of a connection that went away */
+        gvc_mixer_event_queue_push (queue, CHANGE (SERVER), PA_INVALID_INDEX);
+        gvc_mixer_event_queue_push (queue, NEW (CARD), 3);
+        gvc_mixer_event_queue_clear (queue);
+        run_main_loop ();
+        g_assert_cmpuint (stub.requests->len, ==, 0);
+
+        /* Nor after the queue is gone */
+        gvc_mixer_event_queue_push (queue, NEW (CARD), 3);
+        gvc_mixer_event_queue_free (queue);
+        run_main_loop ();
+        g_assert_cmpuint (stub.requests->len, ==, 0);
+
+        stub_clear (&stub);
+}
+
+int
+main (int argc, char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_data_func ("/gvc/event-queue/replay/headset-connect", headset_connect, test_replay);
+        g_test_add_data_func ("/gvc/event-queue/replay/stream-churn", stream_churn, test_replay);
+        g_test_add_func ("/gvc/event-queue/list-threshold", test_list_threshold);
+        g_test_add_func ("/gvc/event-queue/clear", test_clear);
+
+        return g_test_run ();
+}
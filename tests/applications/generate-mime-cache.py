@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# Writes the synthetic mime.cache used by test-globs. Only the lists read by
+# the glob index are populated; the others are present but empty.
+#
+# Usage: generate-mime-cache.py OUTPUT
+
+import struct
+import sys
+
+LITERALS = [
+    ('README', 'text/x-readme'),
+]
+
+SUFFIXES = [
+    ('*.txt', 'text/plain'),
+    ('*.text', 'text/plain'),
+    ('*.c', 'text/x-csrc'),
+    ('*.h', 'text/x-chdr'),
+    ('*.png', 'image/png'),
+    ('*.tar.gz', 'application/x-compressed-tar'),
+    ('*.gz', 'application/gzip'),
+]
+
+GLOBS = [
+    ('*.[fF]oo', 'application/x-foo'),
+]
+
+WEIGHT = 50
+
+
+class Writer:
+    def __init__(self):
+        self.data = bytearray(40)
+        self.strings = {}
+
+    def tell(self):
+        return len(self.data)
+
+    def align(self):
+        while len(self.data) % 4:
+            self.data.append(0)
+
+    def u32(self, value):
+        self.data += struct.pack('>I', value)
+
+    def patch(self, offset, value):
+        self.data[offset:offset + 4] = struct.pack('>I', value)
+
+    def string(self, value):
+        if value not in self.strings:
+            self.strings[value] = self.tell()
+            self.data += value.encode('utf-8') + b'\0'
+        return self.strings[value]
+
+
+def build_tree(suffixes):
+    tree = {}
+    for glob, mime_type in suffixes:
+        node = tree
+        for char in reversed(glob[1:]):
+            node = node.setdefault(char, {})
+        node.setdefault(None, []).append(mime_type)
+    return tree
+
+
+def write_nodes(writer, tree, strings):
+    # Leaves sort first, like update-mime-database writes them
+    keys = sorted(tree, key=lambda k: -1 if k is None else ord(k))
+    entries = []
+    for key in keys:
+        if key is None:
+            for mime_type in tree[key]:
+                entries.append((0, strings[mime_type], WEIGHT, None))
+        else:
+            entries.append((ord(key), 0, 0, tree[key]))
+
+    start = writer.tell()
+    writer.data += bytes(12 * len(entries))
+    for i, (char, value1, value2, children) in enumerate(entries):
+        offset = start + 12 * i
+        writer.patch(offset, char)
+        if children is None:
+            writer.patch(offset + 4, value1)
+            writer.patch(offset + 8, value2)
+        else:
+            child_offset = write_nodes(writer, children, strings)
+            writer.patch(offset + 4, len(children) + sum(len(v) - 1 for k, v in children.items() if k is None))
+            writer.patch(offset + 8, child_offset)
+    return start
+
+
+def write_list(writer, entries, strings):
+    offset = writer.tell()
+    writer.u32(len(entries))
+    for pattern, mime_type in entries:
+        writer.u32(strings[pattern])
+        writer.u32(strings[mime_type])
+        writer.u32(WEIGHT)
+    return offset
+
+
+def main():
+    writer = Writer()
+    strings = {}
+    for pattern, mime_type in LITERALS + SUFFIXES + GLOBS:
+        strings[pattern] = writer.string(pattern)
+        strings[mime_type] = writer.string(mime_type)
+    writer.align()
+
+    empty = writer.tell()
+    writer.u32(0)
+
+    literal_list = write_list(writer, LITERALS, strings)
+    glob_list = write_list(writer, GLOBS, strings)
+
+    tree = build_tree(SUFFIXES)
+    suffix_tree = writer.tell()
+    writer.data += bytes(8)
+    writer.patch(suffix_tree, len(tree))
+    writer.patch(suffix_tree + 4, write_nodes(writer, tree, strings))
+
+    # Magic and namespace lists carry extra fields after the count
+    magic_list = writer.tell()
+    writer.u32(0)
+    writer.u32(0)
+    writer.u32(0)
+
+    header = struct.pack('>HHIIIIIIIII', 1, 2,
+                         empty, empty, literal_list, suffix_tree, glob_list,
+                         magic_list, empty, empty, empty)
+    writer.data[0:40] = header
+
+    with open(sys.argv[1], 'wb') as f:
+        f.write(writer.data)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,178 @@
+/* test-globs.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "globs.h"
+
+/* mime-cache/mime/mime.cache is generated by generate-mime-cache.py */
+
+static void
+assert_globs (CcGlobs     *globs,
+              const gchar *type,
+              const gchar *expected)
+{
+  g_autofree gchar *description = cc_globs_describe (globs, type);
+
+  g_assert_cmpstr (description, ==, expected);
+}
+
+static void
+test_mime_cache (void)
+{
+  const gchar *dirs[] = { TEST_SRCDIR "/mime-cache", NULL };
+  g_autoptr(CcGlobs) globs = cc_globs_new (dirs);
+
+  assert_globs (globs, "text/plain", "*.text, *.txt");
+  assert_globs (globs, "text/x-csrc", "*.c");
+  assert_globs (globs, "application/gzip", "*.gz");
+  assert_globs (globs, "application/x-compressed-tar", "*.tar.gz");
+  assert_globs (globs, "text/x-readme", "README");
+  assert_globs (globs, "application/x-foo", "*.[fF]oo");
+  assert_globs (globs, "application/x-unknown", "");
+
+  g_assert_null (cc_globs_lookup (globs, "application/x-unknown"));
+}
+
+static void
+test_text_fallback (void)
+{
+  const gchar *dirs[] = { TEST_SRCDIR "/mime-text", NULL };
+  g_autoptr(CcGlobs) globs = cc_globs_new (dirs);
+
+  assert_globs (globs, "text/plain", "*.asc, *.txt");
+  assert_globs (globs, "text/x-markdown", "*.md, *.mkd");
+}
+
+static void
+test_merge_dirs (void)
+{
+  const gchar *dirs[] = { TEST_SRCDIR "/mime-cache", TEST_SRCDIR "/mime-text", NULL };
+  g_autoptr(CcGlobs) globs = cc_globs_new (dirs);
+
+  assert_globs (globs, "text/plain", "*.asc, *.text, *.txt");
+  assert_globs (globs, "text/x-markdown", "*.md, *.mkd");
+  assert_globs (globs, "image/png", "*.png");
+}
+
+static void
+test_corrupt_cache (void)
+{
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *mimedir = NULL;
+  g_autofree gchar *cache = NULL;
+  g_autofree gchar *text = NULL;
+  g_autoptr(CcGlobs) globs = NULL;
+  const gchar *dirs[2] = { NULL, NULL };
+  const guint8 header[] = { 0, 1, 0, 2, 0, 0, 0xff, 0xff };
+
+  tmpdir = g_dir_make_tmp ("test-globs-XXXXXX", NULL);
+  g_assert_nonnull (tmpdir);
+  mimedir = g_build_filename (tmpdir, "mime", NULL);
+  g_assert_cmpint (g_mkdir (mimedir, 0700), ==, 0);
+
+  /* A truncated cache is ignored in favour of the text database */
+  cache = g_build_filename (mimedir, "mime.cache", NULL);
+  g_assert_true (g_file_set_contents (cache, (const gchar *) header, sizeof (header), NULL));
+  text = g_build_filename (mimedir, "globs", NULL);
+  g_assert_true (g_file_set_contents (text, "text/plain:*.txt\n", -1, NULL));
+
+  dirs[0] = tmpdir;
+  globs = cc_globs_new (dirs);
+
+  g_test_expect_message ("applications-cc-panel", G_LOG_LEVEL_WARNING, "Ignoring corrupt MIME cache*");
+  assert_globs (globs, "text/plain", "*.txt");
+  g_test_assert_expected_messages ();
+
+  g_clear_object (&globs);
+  g_unlink (cache);
+  g_unlink (text);
+  g_rmdir (mimedir);
+  g_rmdir (tmpdir);
+}
+
+static void
+on_changed_cb (CcGlobs  *globs,
+               gboolean *changed)
+{
+  *changed = TRUE;
+}
+
+static gboolean
+on_timeout_cb (gpointer user_data)
+{
+  g_assert_not_reached ();
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_invalidation (void)
+{
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *mimedir = NULL;
+  g_autofree gchar *text = NULL;
+  g_autoptr(CcGlobs) globs = NULL;
+  const gchar *dirs[2] = { NULL, NULL };
+  gboolean changed = FALSE;
+  guint timeout_id;
+
+  tmpdir = g_dir_make_tmp ("test-globs-XXXXXX", NULL);
+  g_assert_nonnull (tmpdir);
+  mimedir = g_build_filename (tmpdir, "mime", NULL);
+  g_assert_cmpint (g_mkdir (mimedir, 0700), ==, 0);
+
+  text = g_build_filename (mimedir, "globs", NULL);
+  g_assert_true (g_file_set_contents (text, "text/plain:*.txt\n", -1, NULL));
+
+  dirs[0] = tmpdir;
+  globs = cc_globs_new (dirs);
+  g_signal_connect (globs, "changed", G_CALLBACK (on_changed_cb), &changed);
+
+  assert_globs (globs, "text/plain", "*.txt");
+
+  g_assert_true (g_file_set_contents (text, "text/plain:*.txt\ntext/plain:*.asc\n", -1, NULL));
+
+  timeout_id = g_timeout_add_seconds (10, on_timeout_cb, NULL);
+  while (!changed)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+
+  assert_globs (globs, "text/plain", "*.asc, *.txt");
+
+  g_clear_object (&globs);
+  g_unlink (text);
+  g_rmdir (mimedir);
+  g_rmdir (tmpdir);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/applications/globs/mime-cache", test_mime_cache);
+  g_test_add_func ("/applications/globs/text-fallback", test_text_fallback);
+  g_test_add_func ("/applications/globs/merge-dirs", test_merge_dirs);
+  g_test_add_func ("/applications/globs/corrupt-cache", test_corrupt_cache);
+  g_test_add_func ("/applications/globs/invalidation", test_invalidation);
+
+  return g_test_run ();
+}
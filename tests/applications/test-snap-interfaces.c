@@ -0,0 +1,289 @@
+/* test-snap-interfaces.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "cc-snap-interfaces.h"
+
+/* A stand-in for snapd answering the two queries the snapshot makes */
+
+#define INTERFACES_RESPONSE \
+  "{\"type\":\"sync\",\"status-code\":200,\"status\":\"OK\",\"result\":[" \
+    "{\"name\":\"camera\",\"summary\":\"allows access to cameras\"}," \
+    "{\"name\":\"home\",\"summary\":\"allows access to non-hidden files in the home directory\"}" \
+  "]}"
+
+#define CONNECTIONS_RESPONSE \
+  "{\"type\":\"sync\",\"status-code\":200,\"status\":\"OK\",\"result\":{" \
+    "\"established\":[" \
+      "{\"slot\":{\"snap\":\"core\",\"slot\":\"camera\"},\"plug\":{\"snap\":\"foo\",\"plug\":\"camera\"},\"interface\":\"camera\",\"manual\":true}" \
+    "]," \
+    "\"plugs\":[" \
+      "{\"snap\":\"foo\",\"plug\":\"camera\",\"interface\":\"camera\",\"connections\":[{\"snap\":\"core\",\"slot\":\"camera\"}]}," \
+      "{\"snap\":\"foo\",\"plug\":\"home\",\"interface\":\"home\"}," \
+      "{\"snap\":\"bar\",\"plug\":\"home\",\"interface\":\"home\"}" \
+    "]," \
+    "\"slots\":[" \
+      "{\"snap\":\"core\",\"slot\":\"camera\",\"interface\":\"camera\",\"connections\":[{\"snap\":\"foo\",\"plug\":\"camera\"}]}," \
+      "{\"snap\":\"core\",\"slot\":\"home\",\"interface\":\"home\"}" \
+    "]," \
+    "\"undesired\":[]" \
+  "}}"
+
+typedef struct
+{
+  gchar                *tmpdir;
+  gchar                *socket_path;
+  GSocketService       *service;
+  CcSnapInterfaces     *snap_interfaces;
+
+  gint                  n_interfaces_requests;
+  gint                  n_connections_requests;
+  guint                 n_changed;
+} Fixture;
+
+static gboolean
+write_response (GOutputStream *output,
+                const gchar   *status,
+                const gchar   *body)
+{
+  g_autofree gchar *response = NULL;
+
+  response = g_strdup_printf ("HTTP/1.1 %s\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: %zu\r\n"
+                              "\r\n"
+                              "%s",
+                              status, strlen (body), body);
+
+  return g_output_stream_write_all (output, response, strlen (response), NULL, NULL, NULL);
+}
+
+static gboolean
+on_run_cb (GThreadedSocketService *service,
+           GSocketConnection      *connection,
+           GObject                *source_object,
+           Fixture                *fixture)
+{
+  g_autoptr(GDataInputStream) input = NULL;
+  GOutputStream *output;
+
+  input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+  g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  while (TRUE)
+    {
+      g_autofree gchar *request = NULL;
+      g_auto(GStrv) parts = NULL;
+      gboolean ok;
+
+      request = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+      if (request == NULL)
+        break;
+
+      /* Skip the headers, requests have no body */
+      while (TRUE)
+        {
+          g_autofree gchar *header = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+
+          if (header == NULL || *header == '\0')
+            break;
+        }
+
+      parts = g_strsplit (request, " ", 3);
+      if (g_strv_length (parts) < 2)
+        break;
+
+      if (g_str_has_prefix (parts[1], "/v2/interfaces"))
+        {
+          g_atomic_int_inc (&fixture->n_interfaces_requests);
+          ok = write_response (output, "200 OK", INTERFACES_RESPONSE);
+        }
+      else if (g_str_has_prefix (parts[1], "/v2/connections"))
+        {
+          g_atomic_int_inc (&fixture->n_connections_requests);
+          ok = write_response (output, "200 OK", CONNECTIONS_RESPONSE);
+        }
+      else
+        {
+          ok = write_response (output, "404 Not Found",
+                               "{\"type\":\"error\",\"status-code\":404,\"status\":\"Not Found\",\"result\":{\"message\":\"not found\"}}");
+        }
+
+      if (!ok)
+        break;
+    }
+
+  return TRUE;
+}
+
+static void
+on_changed_cb (CcSnapInterfaces *snap_interfaces,
+               Fixture          *fixture)
+{
+  fixture->n_changed++;
+}
+
+static gboolean
+on_timeout_cb (gpointer user_data)
+{
+  g_assert_not_reached ();
+  return G_SOURCE_REMOVE;
+}
+
+static void
+wait_for_changed (Fixture *fixture,
+                  guint    n_changed)
+{
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (10, on_timeout_cb, NULL);
+  while (fixture->n_changed < n_changed)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+}
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(SnapdClient) client = NULL;
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-snap-interfaces-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->socket_path = g_build_filename (fixture->tmpdir, "snapd.socket", NULL);
+
+  fixture->service = g_threaded_socket_service_new (1);
+  address = g_unix_socket_address_new (fixture->socket_path);
+  g_socket_listener_add_address (G_SOCKET_LISTENER (fixture->service), address,
+                                 G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+                                 NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_signal_connect (fixture->service, "run", G_CALLBACK (on_run_cb), fixture);
+  g_socket_service_start (fixture->service);
+
+  client = snapd_client_new ();
+  snapd_client_set_socket_path (client, fixture->socket_path);
+
+  fixture->snap_interfaces = cc_snap_interfaces_new (client);
+  g_signal_connect (fixture->snap_interfaces, "changed", G_CALLBACK (on_changed_cb), fixture);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  user_data)
+{
+  g_clear_object (&fixture->snap_interfaces);
+
+  g_socket_service_stop (fixture->service);
+  g_socket_listener_close (G_SOCKET_LISTENER (fixture->service));
+  g_clear_object (&fixture->service);
+
+  g_unlink (fixture->socket_path);
+  g_rmdir (fixture->tmpdir);
+  g_clear_pointer (&fixture->socket_path, g_free);
+  g_clear_pointer (&fixture->tmpdir, g_free);
+}
+
+static void
+test_index (Fixture       *fixture,
+            gconstpointer  user_data)
+{
+  GPtrArray *plugs, *slots;
+  SnapdInterface *interface;
+
+  g_assert_false (cc_snap_interfaces_get_loaded (fixture->snap_interfaces));
+
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  wait_for_changed (fixture, 1);
+
+  g_assert_true (cc_snap_interfaces_get_loaded (fixture->snap_interfaces));
+
+  plugs = cc_snap_interfaces_get_plugs (fixture->snap_interfaces, "foo");
+  g_assert_nonnull (plugs);
+  g_assert_cmpuint (plugs->len, ==, 2);
+
+  plugs = cc_snap_interfaces_get_plugs (fixture->snap_interfaces, "bar");
+  g_assert_nonnull (plugs);
+  g_assert_cmpuint (plugs->len, ==, 1);
+  g_assert_cmpstr (snapd_plug_get_interface (g_ptr_array_index (plugs, 0)), ==, "home");
+
+  g_assert_null (cc_snap_interfaces_get_plugs (fixture->snap_interfaces, "baz"));
+
+  slots = cc_snap_interfaces_get_slots (fixture->snap_interfaces, "camera");
+  g_assert_nonnull (slots);
+  g_assert_cmpuint (slots->len, ==, 1);
+  g_assert_cmpstr (snapd_slot_get_snap (g_ptr_array_index (slots, 0)), ==, "core");
+
+  interface = cc_snap_interfaces_lookup_interface (fixture->snap_interfaces, "camera");
+  g_assert_nonnull (interface);
+  g_assert_cmpstr (snapd_interface_get_summary (interface), ==, "allows access to cameras");
+
+  /* Lookups are served from the snapshot */
+  g_assert_cmpint (g_atomic_int_get (&fixture->n_interfaces_requests), ==, 1);
+  g_assert_cmpint (g_atomic_int_get (&fixture->n_connections_requests), ==, 1);
+}
+
+static void
+test_coalesce (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  /* Refreshes during a fetch collapse into one more fetch */
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  wait_for_changed (fixture, 2);
+
+  g_assert_cmpuint (fixture->n_changed, ==, 2);
+  g_assert_cmpint (g_atomic_int_get (&fixture->n_interfaces_requests), ==, 2);
+  g_assert_cmpint (g_atomic_int_get (&fixture->n_connections_requests), ==, 2);
+}
+
+static void
+test_dispose_while_loading (Fixture       *fixture,
+                            gconstpointer  user_data)
+{
+  cc_snap_interfaces_refresh (fixture->snap_interfaces);
+  g_clear_object (&fixture->snap_interfaces);
+
+  /* Let the cancelled requests finish without touching the snapshot */
+  while (g_main_context_iteration (NULL, FALSE));
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/applications/snap-interfaces/index", Fixture, NULL,
+              fixture_setup, test_index, fixture_teardown);
+  g_test_add ("/applications/snap-interfaces/coalesce", Fixture, NULL,
+              fixture_setup, test_coalesce, fixture_teardown);
+  g_test_add ("/applications/snap-interfaces/dispose-while-loading", Fixture, NULL,
+              fixture_setup, test_dispose_while_loading, fixture_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,174 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <stdio.h>
+
+#include "cc-background-item.h"
+#include "cc-background-xml.h"
+
+static gchar *collection_path;
+
+/* Rewrites the collection in place, the way an editor saving over the
+ * file would, which leaves the mtime of the directory alone */
+static void
+write_collection (const gchar *name)
+{
+  FILE *file;
+
+  file = fopen (collection_path, "w");
+  g_assert_nonnull (file);
+  fprintf (file,
+           "<?xml version=\"1.0\"?>\n"
+           "<wallpapers>\n"
+           "  <wallpaper>\n"
+           "    <name>%s</name>\n"
+           "    <filename>(none)</filename>\n"
+           "    <pcolor>#3465a4</pcolor>\n"
+           "  </wallpaper>\n"
+           "</wallpapers>\n",
+           name);
+  g_assert_cmpint (fclose (file), ==, 0);
+}
+
+static void
+shift_mtime (gint64 seconds)
+{
+  g_autoptr(GFile) file = g_file_new_for_path (collection_path);
+  g_autoptr(GFileInfo) info = NULL;
+  g_autoptr(GError) error = NULL;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+
+  g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                               g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) + seconds,
+                               G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+}
+
+static void
+added_cb (CcBackgroundXml  *xml,
+          CcBackgroundItem *item,
+          GPtrArray        *names)
+{
+  g_ptr_array_add (names, g_strdup (cc_background_item_get_name (item)));
+}
+
+static void
+async_result_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  *(GAsyncResult **) user_data = g_object_ref (res);
+}
+
+/* Returns the names of the wallpapers a new loader finds */
+static GPtrArray *
+load_names (void)
+{
+  g_autoptr(CcBackgroundXml) xml = NULL;
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GError) error = NULL;
+  GPtrArray *names;
+
+  names = g_ptr_array_new_with_free_func (g_free);
+
+  xml = cc_background_xml_new ();
+  g_signal_connect (xml, "added", G_CALLBACK (added_cb), names);
+  cc_background_xml_load_list_async (xml, NULL, async_result_cb, &res);
+  while (res == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (cc_background_xml_load_list_finish (xml, res, &error));
+  g_assert_no_error (error);
+
+  /* The items come in from idles */
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  return names;
+}
+
+static void
+assert_names (const gchar *name)
+{
+  g_autoptr(GPtrArray) names = load_names ();
+
+  g_assert_cmpuint (names->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (names, 0), ==, name);
+}
+
+static void
+test_edit_in_place (void)
+{
+  write_collection ("First");
+  assert_names ("First");
+
+  /* Served from the cache */
+  assert_names ("First");
+
+  /* Edited without touching the directory */
+  write_collection ("Second");
+  assert_names ("Second");
+
+  /* Same size, only the mtime tells */
+  write_collection ("Third!");
+  shift_mtime (10);
+  assert_names ("Third!");
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *tmp_dir = NULL;
+  g_autofree gchar *data_home = NULL;
+  g_autofree gchar *data_dirs = NULL;
+  g_autofree gchar *collection_dir = NULL;
+  int ret;
+
+  setlocale (LC_ALL, "");
+
+  /* Only look at the collection written here, set up before GLib reads
+   * the data directories */
+  tmp_dir = g_dir_make_tmp ("test-background-xml-XXXXXX", &error);
+  g_assert_no_error (error);
+  data_home = g_build_filename (tmp_dir, "data", NULL);
+  data_dirs = g_build_filename (tmp_dir, "system", NULL);
+  collection_dir = g_build_filename (data_home, "gnome-background-properties", NULL);
+  collection_path = g_build_filename (collection_dir, "test.xml", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (collection_dir, 0700), ==, 0);
+  g_setenv ("XDG_DATA_HOME", data_home, TRUE);
+  g_setenv ("XDG_DATA_DIRS", data_dirs, TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/background/xml/edit-in-place", test_edit_in_place);
+
+  ret = g_test_run ();
+
+  g_unlink (collection_path);
+  g_rmdir (collection_dir);
+  g_rmdir (data_home);
+  g_rmdir (tmp_dir);
+  g_free (collection_path);
+
+  return ret;
+}
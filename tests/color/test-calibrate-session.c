@@ -0,0 +1,574 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+#include <colord-session/cd-session.h>
+
+#include "cc-color-calibrate-session.h"
+
+/* A stand-in colord-session helper, on a private bus, that replays a
+ * recorded calibration instead of driving a sensor */
+
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.ColorHelper.Display'>"
+  "    <method name='Start'>"
+  "      <arg type='s' direction='in'/>"
+  "      <arg type='s' direction='in'/>"
+  "      <arg type='a{sv}' direction='in'/>"
+  "    </method>"
+  "    <method name='Resume'/>"
+  "    <method name='Cancel'/>"
+  "    <signal name='Finished'><arg type='u'/><arg type='a{sv}'/></signal>"
+  "    <signal name='UpdateSample'><arg type='d'/><arg type='d'/><arg type='d'/></signal>"
+  "    <signal name='UpdateGamma'><arg type='a(ddd)'/></signal>"
+  "    <signal name='InteractionRequired'><arg type='u'/><arg type='s'/><arg type='s'/></signal>"
+  "    <property name='Progress' type='u' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+/* A signal and its parameters, "Progress" for a property change, or no
+ * signal to wait for Resume */
+typedef struct
+{
+  const gchar *signal_name;
+  const gchar *parameters;
+} ReplayStep;
+
+#define PROFILE_PATH "/org/freedesktop/ColorManager/profiles/icc_calibrated"
+
+static const ReplayStep calibration[] = {
+  { "InteractionRequired", "(uint32 0, 'attach the sensor', '')" },
+  { NULL, NULL },
+  { "Progress", "uint32 5" },
+  { "UpdateSample", "(1.0, 1.0, 1.0)" },
+  { "UpdateSample", "(0.0, 0.0, 0.0)" },
+  { "Progress", "uint32 30" },
+  { "UpdateGamma", "([(0.0, 0.0, 0.0), (0.5, 0.5, 0.5), (1.0, 1.0, 1.0)],)" },
+  { "UpdateSample", "(0.5, 0.5, 0.5)" },
+  { "InteractionRequired", "(uint32 1, 'move the dial', '/usr/share/colord/icons/dial.svg')" },
+  { NULL, NULL },
+  { "UpdateSample", "(1.0, 0.0, 0.0)" },
+  { "UpdateSample", "(0.0, 1.0, 0.0)" },
+  { "UpdateSample", "(0.0, 0.0, 1.0)" },
+  { "Progress", "uint32 100" },
+  { "Finished", "(uint32 0, {'ProfilePath': <'" PROFILE_PATH "'>})" },
+};
+
+static const ReplayStep failed_calibration[] = {
+  { "InteractionRequired", "(uint32 0, 'attach the sensor', '')" },
+  { NULL, NULL },
+  { "Progress", "uint32 10" },
+  { "UpdateSample", "(1.0, 1.0, 1.0)" },
+  { "Finished", "(uint32 6, {'ErrorDetails': <'whitepoint out of range'>})" },
+};
+
+typedef struct
+{
+  GDBusConnection  *connection;
+  GDBusNodeInfo    *introspection;
+  const ReplayStep *script;
+  guint             n_steps;
+  guint             position;
+  guint             replay_id;
+  gboolean          waiting;
+  guint32           progress;
+  gchar            *device_id;
+  gchar            *sensor_id;
+  GVariant         *options;
+  guint             n_resumes;
+  guint             n_cancels;
+} MockHelper;
+
+static MockHelper mock;
+
+static void
+mock_reset (const ReplayStep *script,
+            guint             n_steps)
+{
+  g_clear_handle_id (&mock.replay_id, g_source_remove);
+  mock.script = script;
+  mock.n_steps = n_steps;
+  mock.position = 0;
+  mock.waiting = FALSE;
+  mock.progress = 0;
+  g_clear_pointer (&mock.device_id, g_free);
+  g_clear_pointer (&mock.sensor_id, g_free);
+  g_clear_pointer (&mock.options, g_variant_unref);
+  mock.n_resumes = 0;
+  mock.n_cancels = 0;
+}
+
+static void
+mock_emit (const gchar *signal_name,
+           GVariant    *parameters)
+{
+  g_dbus_connection_emit_signal (mock.connection, NULL,
+                                 CD_SESSION_DBUS_PATH,
+                                 CD_SESSION_DBUS_INTERFACE_DISPLAY,
+                                 signal_name, parameters, NULL);
+}
+
+static void
+mock_set_progress (guint32 progress)
+{
+  GVariantBuilder changed;
+
+  mock.progress = progress;
+  g_variant_builder_init (&changed, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&changed, "{sv}", "Progress", g_variant_new_uint32 (progress));
+  g_dbus_connection_emit_signal (mock.connection, NULL,
+                                 CD_SESSION_DBUS_PATH,
+                                 "org.freedesktop.DBus.Properties",
+                                 "PropertiesChanged",
+                                 g_variant_new ("(sa{sv}as)",
+                                                CD_SESSION_DBUS_INTERFACE_DISPLAY,
+                                                &changed, NULL),
+                                 NULL);
+}
+
+/* One step per main loop iteration, like a helper busy measuring */
+static gboolean
+mock_replay_cb (gpointer user_data)
+{
+  const ReplayStep *step;
+  g_autoptr(GVariant) parameters = NULL;
+  g_autoptr(GError) error = NULL;
+
+  if (mock.position == mock.n_steps)
+    {
+      mock.replay_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  step = &mock.script[mock.position++];
+  if (step->signal_name == NULL)
+    {
+      mock.waiting = TRUE;
+      mock.replay_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  parameters = g_variant_parse (NULL, step->parameters, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  if (g_strcmp0 (step->signal_name, "Progress") == 0)
+    mock_set_progress (g_variant_get_uint32 (parameters));
+  else
+    mock_emit (step->signal_name, parameters);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+mock_replay (void)
+{
+  if (mock.replay_id == 0)
+    mock.replay_id = g_idle_add (mock_replay_cb, NULL);
+}
+
+static void
+helper_method_call_cb (GDBusConnection       *connection,
+                       const gchar           *sender,
+                       const gchar           *object_path,
+                       const gchar           *interface_name,
+                       const gchar           *method_name,
+                       GVariant              *parameters,
+                       GDBusMethodInvocation *invocation,
+                       gpointer               user_data)
+{
+  if (g_strcmp0 (method_name, "Start") == 0)
+    {
+      g_variant_get (parameters, "(ss@a{sv})",
+                     &mock.device_id, &mock.sensor_id, &mock.options);
+      if (mock.device_id[0] == '\0')
+        {
+          g_dbus_method_invocation_return_dbus_error (invocation,
+                                                      "org.freedesktop.ColorHelper.Failed",
+                                                      "no such device");
+          return;
+        }
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      mock_replay ();
+      return;
+    }
+  if (g_strcmp0 (method_name, "Resume") == 0)
+    {
+      mock.n_resumes++;
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      if (mock.waiting)
+        {
+          mock.waiting = FALSE;
+          mock_replay ();
+        }
+      return;
+    }
+
+  g_assert_cmpstr (method_name, ==, "Cancel");
+
+  /* the real helper reports the cancelled calibration as failed */
+  mock.n_cancels++;
+  mock.waiting = FALSE;
+  g_clear_handle_id (&mock.replay_id, g_source_remove);
+  g_dbus_method_invocation_return_value (invocation, NULL);
+  mock_emit ("Finished", g_variant_new_parsed ("(uint32 1, {'ErrorDetails': <'cancelled'>})"));
+}
+
+static GVariant *
+helper_get_property (GDBusConnection  *connection,
+                     const gchar      *sender,
+                     const gchar      *object_path,
+                     const gchar      *interface_name,
+                     const gchar      *property_name,
+                     GError          **error,
+                     gpointer          user_data)
+{
+  if (g_strcmp0 (property_name, "Progress") == 0)
+    return g_variant_new_uint32 (mock.progress);
+  return NULL;
+}
+
+static const GDBusInterfaceVTable helper_vtable = {
+  helper_method_call_cb,
+  helper_get_property,
+  NULL,
+};
+
+static void
+name_acquired_cb (GDBusConnection *connection,
+                  const gchar     *name,
+                  gpointer         user_data)
+{
+  *(gboolean *) user_data = TRUE;
+}
+
+static void
+mock_start (const gchar *address)
+{
+  g_autoptr(GError) error = NULL;
+  gboolean acquired = FALSE;
+
+  mock.introspection = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  mock.connection = g_dbus_connection_new_for_address_sync (address,
+                                                            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                            NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (mock.connection, CD_SESSION_DBUS_PATH,
+                                     mock.introspection->interfaces[0],
+                                     &helper_vtable, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_bus_own_name_on_connection (mock.connection, CD_SESSION_DBUS_SERVICE, 0,
+                                name_acquired_cb, NULL, &acquired, NULL);
+  while (!acquired)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+/* What the panel saw of the calibration */
+typedef struct
+{
+  CcColorCalibrateSession *session;
+  GCancellable            *cancellable;
+  GArray                  *progress;
+  GArray                  *interactions;
+  guint                    n_samples;
+  guint                    n_gamma;
+  guint                    gamma_len;
+  gboolean                 finished;
+} Observer;
+
+static void
+progress_cb (CcColorCalibrateSession *session,
+             guint                    value,
+             Observer                *observer)
+{
+  g_assert_false (observer->finished);
+  g_array_append_val (observer->progress, value);
+}
+
+static void
+update_sample_cb (CcColorCalibrateSession *session,
+                  gdouble                  red,
+                  gdouble                  green,
+                  gdouble                  blue,
+                  Observer                *observer)
+{
+  g_assert_false (observer->finished);
+  g_assert_cmpfloat (red, >=, 0.0);
+  g_assert_cmpfloat (red, <=, 1.0);
+  observer->n_samples++;
+}
+
+static void
+update_gamma_cb (CcColorCalibrateSession *session,
+                 GPtrArray               *array,
+                 Observer                *observer)
+{
+  observer->n_gamma++;
+  observer->gamma_len = array->len;
+}
+
+static void
+interaction_required_cb (CcColorCalibrateSession *session,
+                         guint                    code,
+                         const gchar             *message,
+                         const gchar             *image,
+                         Observer                *observer)
+{
+  g_array_append_val (observer->interactions, code);
+
+  /* like pressing "Start" or "Continue", or "Cancel" */
+  if (observer->cancellable != NULL)
+    g_cancellable_cancel (observer->cancellable);
+  else
+    cc_color_calibrate_session_resume (session);
+}
+
+static void
+observer_init (Observer                *observer,
+               CcColorCalibrateSession *session)
+{
+  memset (observer, 0, sizeof (Observer));
+  observer->session = session;
+  observer->progress = g_array_new (FALSE, FALSE, sizeof (guint));
+  observer->interactions = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_signal_connect (session, "progress", G_CALLBACK (progress_cb), observer);
+  g_signal_connect (session, "update-sample", G_CALLBACK (update_sample_cb), observer);
+  g_signal_connect (session, "update-gamma", G_CALLBACK (update_gamma_cb), observer);
+  g_signal_connect (session, "interaction-required", G_CALLBACK (interaction_required_cb), observer);
+}
+
+static void
+observer_clear (Observer *observer)
+{
+  g_signal_handlers_disconnect_by_data (observer->session, observer);
+  g_array_unref (observer->progress);
+  g_array_unref (observer->interactions);
+  g_clear_object (&observer->cancellable);
+}
+
+static void
+async_result_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  *(GAsyncResult **) user_data = g_object_ref (res);
+}
+
+static GAsyncResult *
+wait_for_result (GAsyncResult **res)
+{
+  while (*res == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  return *res;
+}
+
+static CcColorCalibrateSession *
+create_session (void)
+{
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GError) error = NULL;
+  CcColorCalibrateSession *session;
+
+  cc_color_calibrate_session_new_async (NULL, async_result_cb, &res);
+  session = cc_color_calibrate_session_new_finish (wait_for_result (&res), &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (session);
+
+  return session;
+}
+
+static gchar *
+run_calibration (Observer     *observer,
+                 const gchar  *device_id,
+                 GError      **error)
+{
+  g_autoptr(GAsyncResult) res = NULL;
+  GVariantBuilder options;
+  gchar *profile_path;
+
+  g_variant_builder_init (&options, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&options, "{sv}", "Quality", g_variant_new_uint32 (2));
+  g_variant_builder_add (&options, "{sv}", "Whitepoint", g_variant_new_uint32 (6500));
+  g_variant_builder_add (&options, "{sv}", "Gamma", g_variant_new_double (2.2));
+  g_variant_builder_add (&options, "{sv}", "Title", g_variant_new_string ("Test Monitor"));
+
+  cc_color_calibrate_session_start_async (observer->session,
+                                          device_id,
+                                          "Test-sensor",
+                                          g_variant_builder_end (&options),
+                                          observer->cancellable,
+                                          async_result_cb,
+                                          &res);
+  profile_path = cc_color_calibrate_session_start_finish (observer->session,
+                                                          wait_for_result (&res),
+                                                          error);
+  observer->finished = TRUE;
+
+  return profile_path;
+}
+
+static void
+test_replay (void)
+{
+  g_autoptr(CcColorCalibrateSession) session = NULL;
+  g_autofree gchar *profile_path = NULL;
+  g_autoptr(GError) error = NULL;
+  Observer observer;
+  guint32 whitepoint;
+
+  mock_reset (calibration, G_N_ELEMENTS (calibration));
+  session = create_session ();
+  observer_init (&observer, session);
+
+  profile_path = run_calibration (&observer, "xrandr-Test-Monitor", &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (profile_path, ==, PROFILE_PATH);
+
+  g_assert_cmpstr (mock.device_id, ==, "xrandr-Test-Monitor");
+  g_assert_cmpstr (mock.sensor_id, ==, "Test-sensor");
+  g_assert_true (g_variant_lookup (mock.options, "Whitepoint", "u", &whitepoint));
+  g_assert_cmpuint (whitepoint, ==, 6500);
+
+  /* Everything arrived while the calibration was running */
+  g_assert_cmpuint (observer.progress->len, ==, 3);
+  g_assert_cmpuint (g_array_index (observer.progress, guint, 0), ==, 5);
+  g_assert_cmpuint (g_array_index (observer.progress, guint, 1), ==, 30);
+  g_assert_cmpuint (g_array_index (observer.progress, guint, 2), ==, 100);
+  g_assert_cmpuint (observer.n_samples, ==, 6);
+  g_assert_cmpuint (observer.n_gamma, ==, 1);
+  g_assert_cmpuint (observer.gamma_len, ==, 3);
+  g_assert_cmpuint (observer.interactions->len, ==, 2);
+  g_assert_cmpuint (g_array_index (observer.interactions, guint, 0), ==, 0);
+  g_assert_cmpuint (g_array_index (observer.interactions, guint, 1), ==, 1);
+  g_assert_cmpuint (mock.n_resumes, ==, 2);
+  g_assert_cmpuint (mock.n_cancels, ==, 0);
+
+  observer_clear (&observer);
+}
+
+static void
+test_failed (void)
+{
+  g_autoptr(CcColorCalibrateSession) session = NULL;
+  g_autofree gchar *profile_path = NULL;
+  g_autoptr(GError) error = NULL;
+  Observer observer;
+
+  mock_reset (failed_calibration, G_N_ELEMENTS (failed_calibration));
+  session = create_session ();
+  observer_init (&observer, session);
+
+  profile_path = run_calibration (&observer, "xrandr-Test-Monitor", &error);
+  g_assert_error (error, CC_COLOR_CALIBRATE_SESSION_ERROR, 6);
+  g_assert_cmpstr (error->message, ==, "whitepoint out of range");
+  g_assert_null (profile_path);
+  g_assert_cmpuint (observer.n_samples, ==, 1);
+
+  observer_clear (&observer);
+}
+
+static void
+test_start_failed (void)
+{
+  g_autoptr(CcColorCalibrateSession) session = NULL;
+  g_autofree gchar *profile_path = NULL;
+  g_autoptr(GError) error = NULL;
+  Observer observer;
+
+  mock_reset (calibration, G_N_ELEMENTS (calibration));
+  session = create_session ();
+  observer_init (&observer, session);
+
+  profile_path = run_calibration (&observer, "", &error);
+  g_assert_nonnull (error);
+  g_assert_false (error->domain == CC_COLOR_CALIBRATE_SESSION_ERROR);
+  g_assert_null (profile_path);
+  g_assert_cmpuint (observer.interactions->len, ==, 0);
+
+  observer_clear (&observer);
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(CcColorCalibrateSession) session = NULL;
+  g_autofree gchar *profile_path = NULL;
+  g_autofree gchar *second_path = NULL;
+  g_autoptr(GError) error = NULL;
+  Observer observer;
+
+  mock_reset (calibration, G_N_ELEMENTS (calibration));
+  session = create_session ();
+  observer_init (&observer, session);
+
+  /* Cancel while the helper waits for the user */
+  observer.cancellable = g_cancellable_new ();
+  profile_path = run_calibration (&observer, "xrandr-Test-Monitor", &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (profile_path);
+
+  /* The helper is told, and its late Finished is ignored */
+  while (mock.n_cancels == 0)
+    g_main_context_iteration (NULL, TRUE);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_cmpuint (mock.n_resumes, ==, 0);
+
+  /* The session can be used again */
+  g_clear_error (&error);
+  g_clear_object (&observer.cancellable);
+  observer.finished = FALSE;
+  mock_reset (calibration, G_N_ELEMENTS (calibration));
+  second_path = run_calibration (&observer, "xrandr-Test-Monitor", &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (second_path, ==, PROFILE_PATH);
+
+  observer_clear (&observer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+  int ret;
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  /* the helper lives on the session bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  mock_start (g_test_dbus_get_bus_address (bus));
+
+  g_test_add_func ("/color/calibrate-session/replay", test_replay);
+  g_test_add_func ("/color/calibrate-session/failed", test_failed);
+  g_test_add_func ("/color/calibrate-session/start-failed", test_start_failed);
+  g_test_add_func ("/color/calibrate-session/cancel", test_cancel);
+
+  ret = g_test_run ();
+
+  mock_reset (NULL, 0);
+  g_test_dbus_down (bus);
+
+  return ret;
+}
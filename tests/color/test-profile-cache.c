@@ -0,0 +1,564 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cc-color-profile-cache.h"
+
+#define COLORD_NAME         "org.freedesktop.ColorManager"
+#define COLORD_PATH         "/org/freedesktop/ColorManager"
+#define COLORD_INTERFACE    "org.freedesktop.ColorManager"
+#define PROFILES_PATH       COLORD_PATH "/profiles"
+
+/* A stand-in colord, on a private bus, that only knows about profiles */
+
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.ColorManager'>"
+  "    <method name='GetProfiles'>"
+  "      <arg type='ao' direction='out'/>"
+  "    </method>"
+  "    <signal name='ProfileAdded'><arg type='o'/></signal>"
+  "    <signal name='ProfileRemoved'><arg type='o'/></signal>"
+  "    <signal name='ProfileChanged'><arg type='o'/></signal>"
+  "    <property name='DaemonVersion' type='s' access='read'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.ColorManager.Profile'>"
+  "    <property name='Id' type='s' access='read'/>"
+  "    <property name='Title' type='s' access='read'/>"
+  "    <property name='Kind' type='s' access='read'/>"
+  "    <property name='Colorspace' type='s' access='read'/>"
+  "    <property name='Filename' type='s' access='read'/>"
+  "    <property name='Format' type='s' access='read'/>"
+  "    <property name='Qualifier' type='s' access='read'/>"
+  "    <property name='Scope' type='s' access='read'/>"
+  "    <property name='Created' type='x' access='read'/>"
+  "    <property name='HasVcgt' type='b' access='read'/>"
+  "    <property name='IsSystemWide' type='b' access='read'/>"
+  "    <property name='Owner' type='u' access='read'/>"
+  "    <property name='Metadata' type='a{ss}' access='read'/>"
+  "    <property name='Warnings' type='as' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+typedef struct
+{
+  GDBusConnection *connection;
+  GDBusNodeInfo   *introspection;
+  GPtrArray       *profiles;
+  guint            n_connects;
+} MockColord;
+
+static MockColord mock;
+
+static gchar *
+profile_object_path (guint i)
+{
+  return g_strdup_printf (PROFILES_PATH "/profile_%u", i);
+}
+
+static gchar *
+profile_id (const gchar *object_path)
+{
+  return g_strdup_printf ("profile-%s", strrchr (object_path, '_') + 1);
+}
+
+static void
+mock_add_profile (guint i)
+{
+  g_ptr_array_add (mock.profiles, g_strdup_printf ("profile_%u", i));
+}
+
+static void
+mock_emit (const gchar *signal_name,
+           guint        i)
+{
+  g_autofree gchar *object_path = profile_object_path (i);
+
+  g_dbus_connection_emit_signal (mock.connection, NULL,
+                                 COLORD_PATH, COLORD_INTERFACE, signal_name,
+                                 g_variant_new ("(o)", object_path),
+                                 NULL);
+}
+
+static void
+mock_reset (guint n_profiles)
+{
+  guint i;
+
+  g_ptr_array_set_size (mock.profiles, 0);
+  for (i = 0; i < n_profiles; i++)
+    mock_add_profile (i);
+  mock.n_connects = 0;
+}
+
+static void
+manager_method_call (GDBusConnection       *connection,
+                     const gchar           *sender,
+                     const gchar           *object_path,
+                     const gchar           *interface_name,
+                     const gchar           *method_name,
+                     GVariant              *parameters,
+                     GDBusMethodInvocation *invocation,
+                     gpointer               user_data)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_assert_cmpstr (method_name, ==, "GetProfiles");
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("ao"));
+  for (i = 0; i < mock.profiles->len; i++)
+    {
+      g_autofree gchar *path = NULL;
+
+      path = g_strdup_printf (PROFILES_PATH "/%s", (gchar *) g_ptr_array_index (mock.profiles, i));
+      g_variant_builder_add (&builder, "o", path);
+    }
+
+  g_dbus_method_invocation_return_value (invocation, g_variant_new ("(ao)", &builder));
+}
+
+static GVariant *
+manager_get_property (GDBusConnection  *connection,
+                      const gchar      *sender,
+                      const gchar      *object_path,
+                      const gchar      *interface_name,
+                      const gchar      *property_name,
+                      GError          **error,
+                      gpointer          user_data)
+{
+  if (g_strcmp0 (property_name, "DaemonVersion") == 0)
+    return g_variant_new_string ("1.4.4");
+  return NULL;
+}
+
+static const GDBusInterfaceVTable manager_vtable = {
+  manager_method_call,
+  manager_get_property,
+  NULL,
+};
+
+static GVariant *
+profile_get_property (GDBusConnection  *connection,
+                      const gchar      *sender,
+                      const gchar      *object_path,
+                      const gchar      *interface_name,
+                      const gchar      *property_name,
+                      GError          **error,
+                      gpointer          user_data)
+{
+  /* every connect reads all the properties once */
+  if (g_strcmp0 (property_name, "Id") == 0)
+    {
+      mock.n_connects++;
+      return g_variant_new_take_string (profile_id (object_path));
+    }
+  if (g_strcmp0 (property_name, "Title") == 0)
+    return g_variant_new_string ("Test profile");
+  if (g_strcmp0 (property_name, "Kind") == 0)
+    return g_variant_new_string ("display-device");
+  if (g_strcmp0 (property_name, "Colorspace") == 0)
+    return g_variant_new_string ("rgb");
+  if (g_strcmp0 (property_name, "Filename") == 0)
+    return g_variant_new_string ("/nonexistent.icc");
+  if (g_strcmp0 (property_name, "Format") == 0 ||
+      g_strcmp0 (property_name, "Qualifier") == 0)
+    return g_variant_new_string ("");
+  if (g_strcmp0 (property_name, "Scope") == 0)
+    return g_variant_new_string ("normal");
+  if (g_strcmp0 (property_name, "Created") == 0)
+    return g_variant_new_int64 (0);
+  if (g_strcmp0 (property_name, "HasVcgt") == 0 ||
+      g_strcmp0 (property_name, "IsSystemWide") == 0)
+    return g_variant_new_boolean (FALSE);
+  if (g_strcmp0 (property_name, "Owner") == 0)
+    return g_variant_new_uint32 (getuid ());
+  if (g_strcmp0 (property_name, "Metadata") == 0)
+    return g_variant_new_array (G_VARIANT_TYPE ("{ss}"), NULL, 0);
+  if (g_strcmp0 (property_name, "Warnings") == 0)
+    return g_variant_new_strv (NULL, 0);
+  return NULL;
+}
+
+static const GDBusInterfaceVTable profile_vtable = {
+  NULL,
+  profile_get_property,
+  NULL,
+};
+
+static gchar **
+profiles_enumerate (GDBusConnection *connection,
+                    const gchar     *sender,
+                    const gchar     *object_path,
+                    gpointer         user_data)
+{
+  GPtrArray *nodes;
+  guint i;
+
+  nodes = g_ptr_array_new ();
+  for (i = 0; i < mock.profiles->len; i++)
+    g_ptr_array_add (nodes, g_strdup (g_ptr_array_index (mock.profiles, i)));
+  g_ptr_array_add (nodes, NULL);
+
+  return (gchar **) g_ptr_array_free (nodes, FALSE);
+}
+
+static GDBusInterfaceInfo **
+profiles_introspect (GDBusConnection *connection,
+                     const gchar     *sender,
+                     const gchar     *object_path,
+                     const gchar     *node,
+                     gpointer         user_data)
+{
+  GDBusInterfaceInfo **interfaces;
+
+  if (node == NULL)
+    return NULL;
+
+  interfaces = g_new0 (GDBusInterfaceInfo *, 2);
+  interfaces[0] = g_dbus_interface_info_ref (mock.introspection->interfaces[1]);
+
+  return interfaces;
+}
+
+static const GDBusInterfaceVTable *
+profiles_dispatch (GDBusConnection *connection,
+                   const gchar     *sender,
+                   const gchar     *object_path,
+                   const gchar     *interface_name,
+                   const gchar     *node,
+                   gpointer        *out_user_data,
+                   gpointer         user_data)
+{
+  return &profile_vtable;
+}
+
+static const GDBusSubtreeVTable profiles_vtable = {
+  profiles_enumerate,
+  profiles_introspect,
+  profiles_dispatch,
+};
+
+static void
+name_acquired_cb (GDBusConnection *connection,
+                  const gchar     *name,
+                  gpointer         user_data)
+{
+  *(gboolean *) user_data = TRUE;
+}
+
+static void
+mock_start (const gchar *address)
+{
+  g_autoptr(GError) error = NULL;
+  gboolean acquired = FALSE;
+
+  mock.profiles = g_ptr_array_new_with_free_func (g_free);
+  mock.introspection = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  mock.connection = g_dbus_connection_new_for_address_sync (address,
+                                                            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                            NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (mock.connection, COLORD_PATH,
+                                     mock.introspection->interfaces[0],
+                                     &manager_vtable, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_dbus_connection_register_subtree (mock.connection, PROFILES_PATH,
+                                      &profiles_vtable, 0, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_bus_own_name_on_connection (mock.connection, COLORD_NAME, 0,
+                                name_acquired_cb, NULL, &acquired, NULL);
+  while (!acquired)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+async_result_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  *(GAsyncResult **) user_data = g_object_ref (res);
+}
+
+static GAsyncResult *
+wait_for_result (GAsyncResult **res)
+{
+  while (*res == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  return *res;
+}
+
+static CcColorProfileCache *
+create_cache (void)
+{
+  g_autoptr(CdClient) client = NULL;
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GError) error = NULL;
+
+  client = cd_client_new ();
+  cd_client_connect (client, NULL, async_result_cb, &res);
+  cd_client_connect_finish (client, wait_for_result (&res), &error);
+  g_assert_no_error (error);
+
+  return cc_color_profile_cache_new (client);
+}
+
+static void
+load_cache (CcColorProfileCache *cache)
+{
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GError) error = NULL;
+
+  cc_color_profile_cache_load_async (cache, NULL, async_result_cb, &res);
+  cc_color_profile_cache_load_finish (cache, wait_for_result (&res), &error);
+  g_assert_no_error (error);
+  g_assert_true (cc_color_profile_cache_is_loaded (cache));
+}
+
+static void
+assert_cached (CcColorProfileCache *cache,
+               guint                i)
+{
+  g_autofree gchar *object_path = profile_object_path (i);
+  g_autofree gchar *id = profile_id (object_path);
+  CdProfile *profile;
+
+  profile = cc_color_profile_cache_lookup (cache, object_path);
+  g_assert_nonnull (profile);
+  g_assert_true (cd_profile_get_connected (profile));
+  g_assert_cmpstr (cd_profile_get_id (profile), ==, id);
+}
+
+static void
+test_load (void)
+{
+  g_autoptr(CcColorProfileCache) cache = NULL;
+  g_autoptr(GPtrArray) profiles = NULL;
+  guint n_profiles;
+  gint64 start;
+  guint i;
+
+  /* A calibration workstation */
+  n_profiles = g_test_slow () ? 2000 : 300;
+  mock_reset (n_profiles);
+
+  cache = create_cache ();
+  g_assert_false (cc_color_profile_cache_is_loaded (cache));
+
+  start = g_get_monotonic_time ();
+  load_cache (cache);
+  g_test_message ("Connected %u profiles in %.1f ms", n_profiles,
+                  (g_get_monotonic_time () - start) / 1000.0);
+
+  profiles = cc_color_profile_cache_get_profiles (cache);
+  g_assert_cmpuint (profiles->len, ==, n_profiles);
+  for (i = 0; i < n_profiles; i++)
+    assert_cached (cache, i);
+  g_assert_cmpuint (mock.n_connects, ==, n_profiles);
+
+  /* Loading again only fetches the list */
+  load_cache (cache);
+  g_assert_cmpuint (mock.n_connects, ==, n_profiles);
+}
+
+static GPtrArray *
+new_profiles (guint first,
+              guint last)
+{
+  GPtrArray *profiles;
+  guint i;
+
+  profiles = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = first; i <= last; i++)
+    {
+      g_autofree gchar *object_path = profile_object_path (i);
+
+      g_ptr_array_add (profiles, cd_profile_new_with_object_path (object_path));
+    }
+
+  return profiles;
+}
+
+static void
+test_ensure (void)
+{
+  g_autoptr(CcColorProfileCache) cache = NULL;
+  g_autoptr(GPtrArray) first = NULL;
+  g_autoptr(GPtrArray) second = NULL;
+  g_autoptr(GAsyncResult) res1 = NULL;
+  g_autoptr(GAsyncResult) res2 = NULL;
+  g_autoptr(GAsyncResult) res3 = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  mock_reset (6);
+  cache = create_cache ();
+
+  /* Overlapping requests share the connections */
+  first = new_profiles (0, 3);
+  second = new_profiles (2, 5);
+  cc_color_profile_cache_ensure_async (cache, first, NULL, async_result_cb, &res1);
+  cc_color_profile_cache_ensure_async (cache, second, NULL, async_result_cb, &res2);
+
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res1), &error);
+  g_assert_no_error (error);
+  for (i = 0; i <= 3; i++)
+    assert_cached (cache, i);
+
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res2), &error);
+  g_assert_no_error (error);
+  for (i = 0; i <= 5; i++)
+    assert_cached (cache, i);
+  g_assert_cmpuint (mock.n_connects, ==, 6);
+
+  /* Nothing left to connect */
+  cc_color_profile_cache_ensure_async (cache, first, NULL, async_result_cb, &res3);
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res3), &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (mock.n_connects, ==, 6);
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(CcColorProfileCache) cache = NULL;
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GPtrArray) first = NULL;
+  g_autoptr(GPtrArray) second = NULL;
+  g_autoptr(GAsyncResult) res1 = NULL;
+  g_autoptr(GAsyncResult) res2 = NULL;
+  g_autoptr(GAsyncResult) res3 = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  mock_reset (6);
+  cache = create_cache ();
+  cancellable = g_cancellable_new ();
+
+  first = new_profiles (0, 3);
+  second = new_profiles (2, 5);
+  cc_color_profile_cache_ensure_async (cache, first, cancellable, async_result_cb, &res1);
+  cc_color_profile_cache_ensure_async (cache, second, NULL, async_result_cb, &res2);
+  g_cancellable_cancel (cancellable);
+
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res1), &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  /* Connections the other request waits for carry on */
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res2), &error);
+  g_assert_no_error (error);
+  for (i = 2; i <= 5; i++)
+    assert_cached (cache, i);
+  for (i = 0; i <= 1; i++)
+    {
+      g_autofree gchar *object_path = profile_object_path (i);
+
+      g_assert_null (cc_color_profile_cache_lookup (cache, object_path));
+    }
+
+  /* The cancelled connections can be started again */
+  cc_color_profile_cache_ensure_async (cache, first, NULL, async_result_cb, &res3);
+  cc_color_profile_cache_ensure_finish (cache, wait_for_result (&res3), &error);
+  g_assert_no_error (error);
+  for (i = 0; i <= 5; i++)
+    assert_cached (cache, i);
+}
+
+static void
+changed_cb (CcColorProfileCache *cache,
+            guint               *n_changed)
+{
+  (*n_changed)++;
+}
+
+static void
+wait_for_changed (guint *n_changed)
+{
+  guint n = *n_changed;
+
+  while (*n_changed == n)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_signals (void)
+{
+  g_autoptr(CcColorProfileCache) cache = NULL;
+  g_autoptr(GPtrArray) profiles = NULL;
+  g_autofree gchar *removed_path = profile_object_path (0);
+  guint n_changed = 0;
+
+  mock_reset (2);
+  cache = create_cache ();
+  load_cache (cache);
+  g_signal_connect (cache, "changed", G_CALLBACK (changed_cb), &n_changed);
+
+  /* New profiles are connected as they show up */
+  mock_add_profile (2);
+  mock_emit ("ProfileAdded", 2);
+  wait_for_changed (&n_changed);
+  assert_cached (cache, 2);
+
+  mock_emit ("ProfileChanged", 2);
+  wait_for_changed (&n_changed);
+
+  g_ptr_array_remove_index (mock.profiles, 0);
+  mock_emit ("ProfileRemoved", 0);
+  wait_for_changed (&n_changed);
+  g_assert_null (cc_color_profile_cache_lookup (cache, removed_path));
+
+  profiles = cc_color_profile_cache_get_profiles (cache);
+  g_assert_cmpuint (profiles->len, ==, 2);
+  g_assert_cmpuint (mock.n_connects, ==, 3);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+  int ret;
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  /* colord lives on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+  mock_start (g_test_dbus_get_bus_address (bus));
+
+  g_test_add_func ("/color/profile-cache/load", test_load);
+  g_test_add_func ("/color/profile-cache/ensure", test_ensure);
+  g_test_add_func ("/color/profile-cache/cancel", test_cancel);
+  g_test_add_func ("/color/profile-cache/signals", test_signals);
+
+  ret = g_test_run ();
+
+  g_test_dbus_down (bus);
+
+  return ret;
+}
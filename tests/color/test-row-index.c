@@ -0,0 +1,283 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <locale.h>
+
+#include "cc-color-row-index.h"
+
+/* Stands in for the list box rows */
+typedef struct
+{
+  gchar *device_path;
+  gchar *profile_path;
+} Row;
+
+static Row *
+row_new (const gchar *device_path,
+         const gchar *profile_path)
+{
+  Row *row = g_new0 (Row, 1);
+
+  row->device_path = g_strdup (device_path);
+  row->profile_path = g_strdup (profile_path);
+
+  return row;
+}
+
+static void
+row_free (Row *row)
+{
+  g_free (row->device_path);
+  g_free (row->profile_path);
+  g_free (row);
+}
+
+static void
+test_devices (void)
+{
+  g_autoptr(CcColorRowIndex) index = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GList) devices = NULL;
+  Row *display, *printer, *profile;
+
+  index = cc_color_row_index_new ();
+  display = row_new ("/display", NULL);
+  printer = row_new ("/printer", NULL);
+  profile = row_new ("/display", "/profile");
+
+  cc_color_row_index_add_device (index, "/display", display);
+  cc_color_row_index_add_device (index, "/printer", printer);
+  cc_color_row_index_add_profile (index, "/display", "/profile", profile);
+
+  g_assert_true (cc_color_row_index_lookup_device (index, "/display") == display);
+  g_assert_true (cc_color_row_index_lookup_profile (index, "/display", "/profile") == profile);
+  g_assert_null (cc_color_row_index_lookup_profile (index, "/printer", "/profile"));
+  g_assert_cmpuint (cc_color_row_index_get_n_devices (index), ==, 2);
+
+  devices = cc_color_row_index_get_devices (index);
+  g_assert_cmpuint (g_list_length (devices), ==, 2);
+  g_assert_nonnull (g_list_find (devices, display));
+  g_assert_nonnull (g_list_find (devices, printer));
+
+  /* The device row comes first, then its profiles */
+  removed = cc_color_row_index_remove_device (index, "/display");
+  g_assert_cmpuint (removed->len, ==, 2);
+  g_assert_true (g_ptr_array_index (removed, 0) == display);
+  g_assert_true (g_ptr_array_index (removed, 1) == profile);
+  g_assert_null (cc_color_row_index_lookup_device (index, "/display"));
+  g_assert_null (cc_color_row_index_lookup_profile (index, "/display", "/profile"));
+  g_assert_cmpuint (cc_color_row_index_get_n_devices (index), ==, 1);
+
+  row_free (display);
+  row_free (printer);
+  row_free (profile);
+}
+
+static void
+test_update_profiles (void)
+{
+  g_autoptr(CcColorRowIndex) index = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GArray) missing = NULL;
+  const gchar *profiles[] = { "/p0", "/p1", "/p2", "/p2" };
+  Row *p0, *p1, *other;
+
+  index = cc_color_row_index_new ();
+  p0 = row_new ("/display", "/p0");
+  p1 = row_new ("/display", "/old");
+  other = row_new ("/printer", "/p1");
+  cc_color_row_index_add_profile (index, "/display", "/p0", p0);
+  cc_color_row_index_add_profile (index, "/display", "/old", p1);
+  cc_color_row_index_add_profile (index, "/printer", "/p1", other);
+
+  missing = g_array_new (FALSE, FALSE, sizeof (guint));
+  removed = cc_color_row_index_update_profiles (index, "/display",
+                                                profiles, G_N_ELEMENTS (profiles),
+                                                missing);
+
+  /* Only rows of that device are touched, duplicates are added once */
+  g_assert_cmpuint (removed->len, ==, 1);
+  g_assert_true (g_ptr_array_index (removed, 0) == p1);
+  g_assert_cmpuint (missing->len, ==, 2);
+  g_assert_cmpuint (g_array_index (missing, guint, 0), ==, 1);
+  g_assert_cmpuint (g_array_index (missing, guint, 1), ==, 2);
+  g_assert_null (cc_color_row_index_lookup_profile (index, "/display", "/old"));
+  g_assert_true (cc_color_row_index_lookup_profile (index, "/display", "/p0") == p0);
+  g_assert_true (cc_color_row_index_lookup_profile (index, "/printer", "/p1") == other);
+
+  row_free (p0);
+  row_free (p1);
+  row_free (other);
+}
+
+/* The list box scan the panel did before, for comparison */
+static guint
+scan_update_profiles (GList       **rows,
+                      const gchar  *device_path,
+                      GPtrArray    *profile_paths)
+{
+  GList *l, *next;
+  guint n_changes = 0;
+  guint i, j;
+
+  for (l = *rows; l != NULL; l = next)
+    {
+      Row *row = l->data;
+      gboolean found = FALSE;
+
+      next = l->next;
+      if (row->profile_path == NULL || g_strcmp0 (row->device_path, device_path) != 0)
+        continue;
+      for (j = 0; j < profile_paths->len && !found; j++)
+        found = g_strcmp0 (row->profile_path, g_ptr_array_index (profile_paths, j)) == 0;
+      if (!found)
+        {
+          row_free (row);
+          *rows = g_list_delete_link (*rows, l);
+          n_changes++;
+        }
+    }
+
+  for (i = 0; i < profile_paths->len; i++)
+    {
+      gboolean found = FALSE;
+
+      for (l = *rows; l != NULL && !found; l = l->next)
+        {
+          Row *row = l->data;
+
+          found = g_strcmp0 (row->device_path, device_path) == 0 &&
+                  g_strcmp0 (row->profile_path, g_ptr_array_index (profile_paths, i)) == 0;
+        }
+      if (!found)
+        {
+          *rows = g_list_prepend (*rows, row_new (device_path, g_ptr_array_index (profile_paths, i)));
+          n_changes++;
+        }
+    }
+
+  return n_changes;
+}
+
+static guint
+index_update_profiles (CcColorRowIndex *index,
+                       const gchar     *device_path,
+                       GPtrArray       *profile_paths)
+{
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GArray) missing = NULL;
+  guint i;
+
+  missing = g_array_new (FALSE, FALSE, sizeof (guint));
+  removed = cc_color_row_index_update_profiles (index, device_path,
+                                                (const gchar **) profile_paths->pdata,
+                                                profile_paths->len,
+                                                missing);
+  g_ptr_array_foreach (removed, (GFunc) row_free, NULL);
+
+  for (i = 0; i < missing->len; i++)
+    {
+      const gchar *profile_path = g_ptr_array_index (profile_paths, g_array_index (missing, guint, i));
+
+      cc_color_row_index_add_profile (index, device_path, profile_path,
+                                      row_new (device_path, profile_path));
+    }
+
+  return removed->len + missing->len;
+}
+
+static void
+free_index_rows (CcColorRowIndex *index,
+                 const gchar     *device_path)
+{
+  g_autoptr(GPtrArray) removed = NULL;
+
+  removed = cc_color_row_index_remove_device (index, device_path);
+  g_ptr_array_foreach (removed, (GFunc) row_free, NULL);
+}
+
+/* A few devices with a few hundred profiles each, every change event
+ * swapping one profile for a new one */
+static void
+test_benchmark (void)
+{
+  g_autoptr(CcColorRowIndex) index = NULL;
+  g_autoptr(GPtrArray) device_paths = NULL;
+  g_autoptr(GPtrArray) profile_paths = NULL;
+  GList *rows = NULL;
+  gdouble index_time = 0, scan_time = 0;
+  guint n_devices = 4, n_profiles = 300, n_events = 200;
+  guint i;
+  GTimer *timer;
+
+  if (g_test_slow ())
+    n_events = 2000;
+
+  index = cc_color_row_index_new ();
+  device_paths = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < n_devices; i++)
+    g_ptr_array_add (device_paths, g_strdup_printf ("/devices/device_%u", i));
+  profile_paths = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < n_profiles; i++)
+    g_ptr_array_add (profile_paths, g_strdup_printf ("/profiles/profile_%u", i));
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < n_events; i++)
+    {
+      const gchar *device_path = g_ptr_array_index (device_paths, i % n_devices);
+      guint n_index_changes, n_scan_changes;
+
+      if (i >= n_devices)
+        {
+          g_free (g_ptr_array_index (profile_paths, i % n_profiles));
+          g_ptr_array_index (profile_paths, i % n_profiles) = g_strdup_printf ("/profiles/profile_%u", n_profiles + i);
+        }
+
+      g_timer_start (timer);
+      n_index_changes = index_update_profiles (index, device_path, profile_paths);
+      index_time += g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      n_scan_changes = scan_update_profiles (&rows, device_path, profile_paths);
+      scan_time += g_timer_elapsed (timer, NULL);
+
+      g_assert_cmpuint (n_index_changes, ==, n_scan_changes);
+    }
+
+  g_test_message ("%u change events over %u rows: index %.3f ms, scan %.3f ms",
+                  n_events, g_list_length (rows), index_time * 1000, scan_time * 1000);
+
+  for (i = 0; i < n_devices; i++)
+    free_index_rows (index, g_ptr_array_index (device_paths, i));
+  g_list_free_full (rows, (GDestroyNotify) row_free);
+  g_timer_destroy (timer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/color/row-index/devices", test_devices);
+  g_test_add_func ("/color/row-index/update-profiles", test_update_profiles);
+  g_test_add_func ("/color/row-index/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
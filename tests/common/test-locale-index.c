@@ -0,0 +1,317 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+
+#include "cc-locale-index.h"
+#include "cc-util.h"
+
+static gchar **
+split_filter (const gchar *text)
+{
+  g_autofree gchar *normalized = NULL;
+
+  normalized = cc_util_normalize_casefold_and_unaccent (text);
+  return g_strsplit_set (g_strstrip (normalized), " ", 0);
+}
+
+static void
+test_match (void)
+{
+  g_autoptr(CcLocaleIndex) index = NULL;
+  const CcLocaleEntry *entry;
+  g_auto(GStrv) german = NULL;
+  g_auto(GStrv) across = NULL;
+  g_auto(GStrv) missing = NULL;
+
+  index = cc_locale_index_new ();
+
+  /* Locales that aren't installed can be added */
+  entry = cc_locale_index_ensure (index, "de_DE.UTF-8");
+  g_assert_nonnull (entry);
+  g_assert_true (cc_locale_index_ensure (index, "de_DE.UTF-8") == entry);
+  g_assert_true (cc_locale_index_lookup (index, "de_DE.UTF-8") == entry);
+  g_assert_cmpstr (entry->language_local, ==, "German");
+  g_assert_cmpstr (entry->language_local_search_key, ==, "german");
+  g_assert_nonnull (entry->region_untranslated);
+
+  german = split_filter ("GERM");
+  g_assert_true (cc_locale_entry_match_language (entry, german));
+  g_assert_true (cc_locale_entry_match_region (entry, german));
+
+  missing = split_filter ("german france");
+  g_assert_false (cc_locale_entry_match_language (entry, missing));
+  g_assert_false (cc_locale_entry_match_region (entry, missing));
+
+  /* All the words have to be in the same name */
+  entry = cc_locale_index_ensure (index, "fr_FR.UTF-8");
+  g_assert_cmpstr (entry->country_local, ==, "France");
+  across = split_filter ("french france");
+  g_assert_false (cc_locale_entry_match_language (entry, across));
+}
+
+static gint
+compare_language (gconstpointer a,
+                  gconstpointer b)
+{
+  return cc_locale_entry_compare_language (*(const CcLocaleEntry **) a,
+                                           *(const CcLocaleEntry **) b);
+}
+
+static void
+test_sort (void)
+{
+  g_autoptr(CcLocaleIndex) index = NULL;
+  g_autoptr(GPtrArray) sorted = NULL;
+  GPtrArray *entries;
+  guint i;
+
+  index = cc_locale_index_new ();
+  entries = cc_locale_index_get_entries (index);
+
+  sorted = g_ptr_array_new ();
+  for (i = 0; i < entries->len; i++)
+    g_ptr_array_add (sorted, g_ptr_array_index (entries, i));
+  g_ptr_array_add (sorted, (gpointer) cc_locale_index_ensure (index, "de_DE.UTF-8"));
+  g_ptr_array_add (sorted, (gpointer) cc_locale_index_ensure (index, "fr_FR.UTF-8"));
+  g_ptr_array_add (sorted, (gpointer) cc_locale_index_ensure (index, "sv_SE.UTF-8"));
+  g_ptr_array_sort (sorted, compare_language);
+
+  /* The collation keys order the names like g_utf8_collate() does */
+  for (i = 1; i < sorted->len; i++)
+    {
+      const CcLocaleEntry *a = g_ptr_array_index (sorted, i - 1);
+      const CcLocaleEntry *b = g_ptr_array_index (sorted, i);
+
+      g_assert_cmpint (g_utf8_collate (a->language, b->language), <=, 0);
+      g_assert_cmpint (cc_locale_entry_compare_language (b, a), >=, 0);
+    }
+}
+
+static void
+test_ensure (void)
+{
+  g_autoptr(CcLocaleIndex) index = NULL;
+  const gchar *locale_ids[] = { "de_DE.UTF-8", "fr_FR.UTF-8", "sv_SE.UTF-8", "ja_JP.UTF-8" };
+  GPtrArray *entries, *by_language, *by_region;
+  guint n_entries, n_regions;
+  guint i;
+
+  index = cc_locale_index_new ();
+  entries = cc_locale_index_get_entries (index);
+  by_language = cc_locale_index_get_by_language (index);
+  by_region = cc_locale_index_get_by_region (index);
+  n_entries = entries->len;
+  n_regions = by_region->len;
+
+  /* Only the installed locales are listed, whatever else gets added */
+  for (i = 0; i < G_N_ELEMENTS (locale_ids); i++)
+    {
+      gboolean installed = cc_locale_index_lookup (index, locale_ids[i]) != NULL;
+      const CcLocaleEntry *entry = cc_locale_index_ensure (index, locale_ids[i]);
+
+      g_assert_true (cc_locale_index_lookup (index, locale_ids[i]) == entry);
+      g_assert_cmpint (g_ptr_array_find (entries, entry, NULL), ==, installed);
+      g_assert_cmpint (g_ptr_array_find (by_language, entry, NULL), ==, installed);
+      g_assert_cmpint (g_ptr_array_find (by_region, entry, NULL), ==, installed && entry->region != NULL);
+    }
+
+  g_assert_cmpuint (entries->len, ==, n_entries);
+  g_assert_cmpuint (by_language->len, ==, n_entries);
+  g_assert_cmpuint (by_region->len, ==, n_regions);
+}
+
+static gint
+compare_region (gconstpointer a,
+                gconstpointer b)
+{
+  return cc_locale_entry_compare_region (*(const CcLocaleEntry **) a,
+                                         *(const CcLocaleEntry **) b);
+}
+
+static void
+default_index_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  CcLocaleIndex **index = user_data;
+  g_autoptr(GError) error = NULL;
+
+  *index = cc_locale_index_get_default_finish (res, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (*index);
+}
+
+static void
+cancelled_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  gboolean *done = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert_null (cc_locale_index_get_default_finish (res, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  *done = TRUE;
+}
+
+static void
+test_default (void)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  CcLocaleIndex *first = NULL, *second = NULL, *again = NULL;
+  gboolean cancelled_done = FALSE;
+  GPtrArray *by_language, *by_region;
+  guint i;
+
+  /* Choosers opened while it's being built share the one build */
+  cc_locale_index_get_default (NULL, default_index_cb, &first);
+  cc_locale_index_get_default (NULL, default_index_cb, &second);
+  cancellable = g_cancellable_new ();
+  cc_locale_index_get_default (cancellable, cancelled_cb, &cancelled_done);
+  g_cancellable_cancel (cancellable);
+  g_assert_null (first);
+
+  while (first == NULL || second == NULL || !cancelled_done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_true (first == second);
+
+  cc_locale_index_get_default (NULL, default_index_cb, &again);
+  while (again == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_true (again == first);
+
+  by_language = cc_locale_index_get_by_language (first);
+  g_assert_cmpuint (by_language->len, ==, cc_locale_index_get_entries (first)->len);
+  for (i = 1; i < by_language->len; i++)
+    g_assert_cmpint (compare_language (&g_ptr_array_index (by_language, i - 1),
+                                       &g_ptr_array_index (by_language, i)), <=, 0);
+
+  by_region = cc_locale_index_get_by_region (first);
+  for (i = 0; i < by_region->len; i++)
+    {
+      g_assert_nonnull (((const CcLocaleEntry *) g_ptr_array_index (by_region, i))->region);
+      if (i > 0)
+        g_assert_cmpint (compare_region (&g_ptr_array_index (by_region, i - 1),
+                                         &g_ptr_array_index (by_region, i)), <=, 0);
+    }
+}
+
+/* What the choosers did on every keystroke before */
+static gboolean
+match_all (gchar       **words,
+           const gchar  *str)
+{
+  gchar **w;
+
+  if (str == NULL)
+    return FALSE;
+
+  for (w = words; *w; ++w)
+    if (!strstr (str, *w))
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+normalize_and_match (gchar       **words,
+                     const gchar  *str)
+{
+  g_autofree gchar *normalized = NULL;
+
+  normalized = cc_util_normalize_casefold_and_unaccent (str);
+  return match_all (words, normalized);
+}
+
+static gboolean
+normalize_and_match_language (const CcLocaleEntry  *entry,
+                              gchar               **words)
+{
+  return normalize_and_match (words, entry->language) ||
+         normalize_and_match (words, entry->country) ||
+         normalize_and_match (words, entry->language_local) ||
+         normalize_and_match (words, entry->country_local);
+}
+
+/* Filtering every locale, as the filter text is typed in */
+static void
+test_benchmark (void)
+{
+  g_autoptr(CcLocaleIndex) index = NULL;
+  const gchar *typed = "united kingdom";
+  gdouble index_time = 0, normalize_time = 0, build_time;
+  guint n_rounds = 10;
+  GPtrArray *entries;
+  GTimer *timer;
+  guint round, len, i;
+
+  if (g_test_slow ())
+    n_rounds = 100;
+
+  timer = g_timer_new ();
+  index = cc_locale_index_new ();
+  build_time = g_timer_elapsed (timer, NULL);
+  entries = cc_locale_index_get_entries (index);
+
+  for (round = 0; round < n_rounds; round++)
+    {
+      for (len = 1; len <= strlen (typed); len++)
+        {
+          g_autofree gchar *text = g_strndup (typed, len);
+          g_auto(GStrv) words = split_filter (text);
+          guint n_index = 0, n_normalize = 0;
+
+          g_timer_start (timer);
+          for (i = 0; i < entries->len; i++)
+            n_index += cc_locale_entry_match_language (g_ptr_array_index (entries, i), words);
+          index_time += g_timer_elapsed (timer, NULL);
+
+          g_timer_start (timer);
+          for (i = 0; i < entries->len; i++)
+            n_normalize += normalize_and_match_language (g_ptr_array_index (entries, i), words);
+          normalize_time += g_timer_elapsed (timer, NULL);
+
+          g_assert_cmpuint (n_index, ==, n_normalize);
+        }
+    }
+
+  g_test_message ("%u locales indexed in %.3f ms, %u filter passes: keys %.3f ms, normalizing %.3f ms",
+                  entries->len, build_time * 1000,
+                  n_rounds * (guint) strlen (typed),
+                  index_time * 1000, normalize_time * 1000);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  /* The names in the current language are the English ones */
+  setlocale (LC_ALL, "C");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/common/locale-index/match", test_match);
+  g_test_add_func ("/common/locale-index/sort", test_sort);
+  g_test_add_func ("/common/locale-index/ensure", test_ensure);
+  g_test_add_func ("/common/locale-index/default", test_default);
+  g_test_add_func ("/common/locale-index/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
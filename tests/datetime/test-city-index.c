@@ -0,0 +1,194 @@
+#include <locale.h>
+#include <string.h>
+#include <glib.h>
+#include "cc-city-index.h"
+#include "tz.h"
+
+static void
+test_fold (void)
+{
+  const struct {
+    const gchar *text;
+    const gchar *folded;
+  } tests[] = {
+    { "Zürich", "zurich" },
+    { "  São   Paulo, Brazil ", "sao paulo brazil" },
+    { "Port-au-Prince", "port au prince" },
+    { "N’Djamena", "ndjamena" },
+    { "America/Argentina/Buenos_Aires", "america argentina buenos aires" },
+    { "Straße", "strasse" },
+    { "", "" },
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (tests); i++)
+    {
+      g_autofree gchar *folded = cc_city_index_fold (tests[i].text);
+
+      g_assert_cmpstr (folded, ==, tests[i].folded);
+    }
+}
+
+static void
+assert_results (CcCityIndex *index,
+                const gchar *query,
+                ...)
+{
+  g_autoptr(GArray) matches = NULL;
+  const gchar *zone;
+  va_list args;
+  guint i = 0;
+
+  matches = cc_city_index_search (index, query, 0);
+
+  va_start (args, query);
+  while ((zone = va_arg (args, const gchar *)) != NULL)
+    {
+      g_assert_cmpuint (i, <, matches->len);
+      g_assert_cmpstr (cc_city_index_get_zone (index, g_array_index (matches, guint, i)), ==, zone);
+      i++;
+    }
+  va_end (args);
+
+  g_assert_cmpuint (i, ==, matches->len);
+}
+
+static void
+test_search (void)
+{
+  g_autoptr(CcCityIndex) index = NULL;
+
+  index = cc_city_index_new ();
+  cc_city_index_add (index, "Zürich, Switzerland", "Europe/Zurich", "Europe/Zurich Schweiz");
+  cc_city_index_add (index, "New York, United States", "America/New_York", "America/New_York");
+  cc_city_index_add (index, "York, United Kingdom", "Europe/York", NULL);
+
+  /* Accents and case don't matter */
+  assert_results (index, "ZURICH", "Europe/Zurich", NULL);
+  assert_results (index, "zür", "Europe/Zurich", NULL);
+
+  /* Keywords are matched too */
+  assert_results (index, "schweiz", "Europe/Zurich", NULL);
+  assert_results (index, "america", "America/New_York", NULL);
+
+  /* Every word has to match, in any order */
+  assert_results (index, "united states", "America/New_York", NULL);
+  assert_results (index, "kingdom york", "Europe/York", NULL);
+  assert_results (index, "york mars", NULL);
+
+  /* Names starting with the query, then word prefixes, then substrings */
+  assert_results (index, "york", "Europe/York", "America/New_York", NULL);
+  assert_results (index, "york united", "Europe/York", "America/New_York", NULL);
+  assert_results (index, "ork", "America/New_York", "Europe/York", NULL);
+  assert_results (index, "rich", "Europe/Zurich", NULL);
+
+  /* Single letters only match at the start of words */
+  assert_results (index, "k", "Europe/York", NULL);
+
+  assert_results (index, "", NULL);
+  assert_results (index, " ,- ", NULL);
+}
+
+static gchar *
+city_name (TzLocation *loc)
+{
+  const gchar *city;
+  gchar *name;
+
+  city = strrchr (loc->zone, '/');
+  city = city ? city + 1 : loc->zone;
+
+  name = g_strdup_printf ("%s, %s", city, loc->country);
+  g_strdelimit (name, "_", ' ');
+
+  return name;
+}
+
+/* Compares against a prefix match of every name on each query, like the
+ * entry completion did before */
+static void
+test_benchmark (void)
+{
+  g_autoptr(CcCityIndex) index = NULL;
+  g_autoptr(GPtrArray) names = NULL;
+  g_autoptr(TzDB) db = NULL;
+  gdouble index_time = 0, scan_time = 0;
+  guint n_queries = 0;
+  GTimer *timer;
+  guint i;
+
+  db = tz_load_db ();
+  g_assert_nonnull (db);
+
+  timer = g_timer_new ();
+
+  index = cc_city_index_new ();
+  names = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < db->locations->len; i++)
+    {
+      TzLocation *loc = g_ptr_array_index (db->locations, i);
+      gchar *name = city_name (loc);
+
+      cc_city_index_add (index, name, loc->zone, loc->zone);
+      g_ptr_array_add (names, name);
+    }
+  g_test_message ("Indexed %u cities in %.3f ms",
+                  names->len, g_timer_elapsed (timer, NULL) * 1000);
+
+  for (i = 0; i < names->len; i++)
+    {
+      const gchar *name = g_ptr_array_index (names, i);
+      gsize length;
+
+      /* Every keystroke of the city name */
+      for (length = 1; name[length - 1] != ',' && name[length - 1] != '\0'; length++)
+        {
+          g_autofree gchar *query = g_strndup (name, length);
+          g_autofree gchar *folded_query = NULL;
+          g_autoptr(GArray) matches = NULL;
+          guint n_scan_matches = 0;
+          guint j;
+
+          g_timer_start (timer);
+          matches = cc_city_index_search (index, query, 0);
+          index_time += g_timer_elapsed (timer, NULL);
+
+          g_timer_start (timer);
+          folded_query = g_utf8_casefold (query, -1);
+          for (j = 0; j < names->len; j++)
+            {
+              g_autofree gchar *normalized = NULL;
+              g_autofree gchar *folded = NULL;
+
+              normalized = g_utf8_normalize (g_ptr_array_index (names, j), -1, G_NORMALIZE_ALL);
+              folded = g_utf8_casefold (normalized, -1);
+              if (g_str_has_prefix (folded, folded_query))
+                n_scan_matches++;
+            }
+          scan_time += g_timer_elapsed (timer, NULL);
+
+          /* The index finds at least what the prefix match did */
+          g_assert_cmpuint (matches->len, >=, n_scan_matches);
+          n_queries++;
+        }
+    }
+
+  g_test_message ("%u queries: index %.3f ms, full scan %.3f ms",
+                  n_queries, index_time * 1000, scan_time * 1000);
+
+  g_timer_destroy (timer);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/datetime/city-index/fold", test_fold);
+  g_test_add_func ("/datetime/city-index/search", test_search);
+  g_test_add_func ("/datetime/city-index/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,194 @@
+/* -*- mode: c; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* test-qr-code.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#undef NDEBUG
+#undef G_DISABLE_ASSERT
+#undef G_DISABLE_CHECKS
+#undef G_DISABLE_CAST_CHECKS
+#undef G_LOG_DOMAIN
+
+#include <glib.h>
+
+#include "cc-qr-code.h"
+#include "qrcodegen.h"
+
+static const gchar *texts[] = {
+  "WIFI:S:Hotspot;T:WPA;P:password;;",
+  "WIFI:S:\"വൈഫൈ\";T:WPA;P:\"a\\;much\\:longer\\\\password with spaces\";H:true;;",
+  "x",
+};
+
+static const gint sizes[] = { 16, 64, 180, 199, 256 };
+
+/* The renderer used before modules were written directly into the
+ * image, which the cached surfaces must match pixel for pixel. */
+static cairo_surface_t *
+render_reference (const gchar *text,
+                  gint         size,
+                  gint         scale)
+{
+  uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+  uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  gint pixel_size, padding, qr_size;
+
+  g_assert_true (qrcodegen_encodeText (text, temp_buf, qr_code,
+                                       qrcodegen_Ecc_LOW,
+                                       qrcodegen_VERSION_MIN,
+                                       qrcodegen_VERSION_MAX,
+                                       qrcodegen_Mask_AUTO,
+                                       FALSE));
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, size * scale, size * scale);
+  cairo_surface_set_device_scale (surface, scale, scale);
+  cr = cairo_create (surface);
+  cairo_set_antialias (cr, CAIRO_ANTIALIAS_NONE);
+
+  cairo_set_source_rgba (cr, 1, 1, 1, 1);
+  cairo_rectangle (cr, 0, 0, size * scale, size * scale);
+  cairo_fill (cr);
+
+  qr_size = qrcodegen_getSize (qr_code);
+  pixel_size = MAX (1, size / (qr_size));
+  padding = (size - qr_size * pixel_size) / 2;
+
+  if (pixel_size > 4 && padding < 12)
+    {
+      pixel_size--;
+      padding = (size - qr_size * pixel_size) / 2;
+    }
+
+  cairo_set_source_rgba (cr, 0, 0, 0, 1);
+  for (int row = 0; row < qr_size; row++)
+    {
+      for (int column = 0; column < qr_size; column++)
+        {
+          if (qrcodegen_getModule (qr_code, row, column))
+            {
+              cairo_rectangle (cr,
+                               column * pixel_size + padding,
+                               row * pixel_size + padding,
+                               pixel_size, pixel_size);
+              cairo_fill (cr);
+            }
+        }
+    }
+
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  return surface;
+}
+
+static void
+assert_surfaces_equal (cairo_surface_t *a,
+                       cairo_surface_t *b)
+{
+  gint width, height, stride_a, stride_b;
+  const guchar *data_a, *data_b;
+
+  width = cairo_image_surface_get_width (a);
+  height = cairo_image_surface_get_height (a);
+  g_assert_cmpint (cairo_image_surface_get_format (a), ==, cairo_image_surface_get_format (b));
+  g_assert_cmpint (width, ==, cairo_image_surface_get_width (b));
+  g_assert_cmpint (height, ==, cairo_image_surface_get_height (b));
+
+  data_a = cairo_image_surface_get_data (a);
+  data_b = cairo_image_surface_get_data (b);
+  stride_a = cairo_image_surface_get_stride (a);
+  stride_b = cairo_image_surface_get_stride (b);
+
+  for (gint y = 0; y < height; y++)
+    {
+      const guint32 *row_a = (const guint32 *) (data_a + y * stride_a);
+      const guint32 *row_b = (const guint32 *) (data_b + y * stride_b);
+
+      /* The top byte is unused in RGB24 */
+      for (gint x = 0; x < width; x++)
+        g_assert_cmphex (row_a[x] & 0x00ffffff, ==, row_b[x] & 0x00ffffff);
+    }
+}
+
+static void
+test_qr_code_matches_reference (void)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (texts); i++)
+    {
+      g_autoptr(CcQrCode) qr_code = cc_qr_code_new ();
+
+      g_assert_true (cc_qr_code_set_text (qr_code, texts[i]));
+
+      for (guint j = 0; j < G_N_ELEMENTS (sizes); j++)
+        {
+          for (gint scale = 1; scale <= 3; scale++)
+            {
+              cairo_surface_t *reference;
+              cairo_surface_t *surface;
+
+              surface = cc_qr_code_get_surface (qr_code, sizes[j], scale);
+              g_assert_nonnull (surface);
+
+              reference = render_reference (texts[i], sizes[j], scale);
+              assert_surfaces_equal (surface, reference);
+              cairo_surface_destroy (reference);
+            }
+        }
+    }
+}
+
+static void
+test_qr_code_cache (void)
+{
+  g_autoptr(CcQrCode) qr_code = cc_qr_code_new ();
+  cairo_surface_t *surface_1x, *surface_2x, *surface;
+  cairo_surface_t *reference;
+
+  g_assert_true (cc_qr_code_set_text (qr_code, texts[0]));
+  g_assert_false (cc_qr_code_set_text (qr_code, texts[0]));
+
+  surface_1x = cc_qr_code_get_surface (qr_code, 180, 1);
+  surface_2x = cc_qr_code_get_surface (qr_code, 180, 2);
+  g_assert_true (surface_1x != surface_2x);
+
+  /* Switching back and forth between scales reuses the surfaces */
+  g_assert_true (cc_qr_code_get_surface (qr_code, 180, 1) == surface_1x);
+  g_assert_true (cc_qr_code_get_surface (qr_code, 180, 2) == surface_2x);
+
+  /* A new text renders a new code */
+  g_assert_true (cc_qr_code_set_text (qr_code, texts[1]));
+  surface = cc_qr_code_get_surface (qr_code, 180, 1);
+  g_assert_nonnull (surface);
+
+  reference = render_reference (texts[1], 180, 1);
+  assert_surfaces_equal (surface, reference);
+  cairo_surface_destroy (reference);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/qr-code/matches-reference", test_qr_code_matches_reference);
+  g_test_add_func ("/qr-code/cache", test_qr_code_cache);
+
+  return g_test_run ();
+}
@@ -0,0 +1,180 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+#include <glib/gstdio.h>
+#include <gio/gdesktopappinfo.h>
+
+#include "cc-notifications-apps.h"
+
+static gchar *data_dir = NULL;
+
+static void
+write_desktop_file (const gchar *desktop_id,
+                    const gchar *extra)
+{
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) error = NULL;
+
+  path = g_build_filename (data_dir, "applications", desktop_id, NULL);
+  contents = g_strdup_printf ("[Desktop Entry]\n"
+                              "Type=Application\n"
+                              "Name=%s\n"
+                              "Exec=true\n"
+                              "%s",
+                              desktop_id, extra);
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+static void
+discover_cb (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  GAsyncResult **result = user_data;
+
+  *result = g_object_ref (res);
+}
+
+static GPtrArray *
+discover (const gchar * const  *children,
+          GCancellable         *cancellable,
+          GError              **error)
+{
+  g_autoptr(GAsyncResult) result = NULL;
+
+  cc_notifications_apps_discover (children, cancellable, discover_cb, &result);
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  return cc_notifications_apps_discover_finish (result, error);
+}
+
+static const CcNotificationsApp *
+find_app (GPtrArray   *apps,
+          const gchar *canonical_app_id)
+{
+  guint i;
+
+  for (i = 0; i < apps->len; i++)
+    {
+      const CcNotificationsApp *app = g_ptr_array_index (apps, i);
+
+      if (g_strcmp0 (app->canonical_app_id, canonical_app_id) == 0)
+        return app;
+    }
+
+  return NULL;
+}
+
+static void
+test_canonicalize (void)
+{
+  g_autoptr(GDesktopAppInfo) app_info = NULL;
+  g_autofree gchar *canonical_app_id = NULL;
+
+  app_info = g_desktop_app_info_new ("org.example.Child.desktop");
+  g_assert_nonnull (app_info);
+
+  canonical_app_id = cc_notifications_app_canonicalize_id (G_APP_INFO (app_info));
+  g_assert_cmpstr (canonical_app_id, ==, "org-example-child");
+}
+
+static void
+test_discover (void)
+{
+  const gchar *children[] = { "org-example-child", "", "uses", "org-example-child", NULL };
+  g_autoptr(GPtrArray) apps = NULL;
+  g_autoptr(GError) error = NULL;
+  const CcNotificationsApp *app;
+
+  apps = discover (children, NULL, &error);
+  g_assert_no_error (error);
+
+  /* Children are listed once, whether or not they declare it */
+  g_assert_cmpuint (apps->len, ==, 2);
+  app = find_app (apps, "org-example-child");
+  g_assert_nonnull (app);
+  g_assert_cmpstr (g_app_info_get_id (app->app_info), ==, "org.example.Child.desktop");
+  g_assert_nonnull (find_app (apps, "uses"));
+
+  /* Compatibility desktop files are skipped */
+  g_assert_null (find_app (apps, "nautilus"));
+  g_assert_null (find_app (apps, "plain"));
+}
+
+static void
+test_cancel (void)
+{
+  const gchar *children[] = { "org-example-child", NULL };
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GPtrArray) apps = NULL;
+  g_autoptr(GError) error = NULL;
+
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  apps = discover (children, cancellable, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (apps);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const gchar *desktop_ids[] = { "uses.desktop", "nautilus.desktop", "org.example.Child.desktop", "plain.desktop" };
+  g_autofree gchar *applications_dir = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+  int ret;
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  /* Only see the applications written here */
+  data_dir = g_dir_make_tmp ("test-notifications-apps-XXXXXX", &error);
+  g_assert_no_error (error);
+  applications_dir = g_build_filename (data_dir, "applications", NULL);
+  g_mkdir (applications_dir, 0700);
+  g_setenv ("XDG_DATA_HOME", data_dir, TRUE);
+  g_setenv ("XDG_DATA_DIRS", data_dir, TRUE);
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+
+  write_desktop_file ("uses.desktop", "X-GNOME-UsesNotifications=true\n");
+  write_desktop_file ("nautilus.desktop", "X-GNOME-UsesNotifications=true\n");
+  write_desktop_file ("org.example.Child.desktop", "");
+  write_desktop_file ("plain.desktop", "");
+
+  g_test_add_func ("/notifications/apps/canonicalize", test_canonicalize);
+  g_test_add_func ("/notifications/apps/discover", test_discover);
+  g_test_add_func ("/notifications/apps/cancel", test_cancel);
+
+  ret = g_test_run ();
+
+  for (i = 0; i < G_N_ELEMENTS (desktop_ids); i++)
+    {
+      g_autofree gchar *path = g_build_filename (applications_dir, desktop_ids[i], NULL);
+      g_remove (path);
+    }
+  g_rmdir (applications_dir);
+  g_rmdir (data_dir);
+  g_free (data_dir);
+
+  return ret;
+}
@@ -0,0 +1,322 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <locale.h>
+
+#include "cc-power-probes.h"
+#include "mock-bus.h"
+
+/* Stand-ins for hostnamed, logind, power-profiles-daemon, iio-sensor-proxy
+ * and gsd-rfkill, on a private bus that is both the system and the session
+ * bus, which hold on to their answers until a test lets them go */
+
+typedef struct
+{
+  const gchar *path;
+  const gchar *member;
+  const gchar *reply;
+} FakeMethod;
+
+static FakeMethod methods[] = {
+  { "/org/freedesktop/hostname1", "Get", "(<'laptop'>,)" },
+  { "/org/freedesktop/login1", "CanSuspend", "('yes',)" },
+  { "/org/freedesktop/login1", "CanHibernate", "('challenge',)" },
+  { "/net/hadess/PowerProfiles", "GetAll",
+    "({'ActiveProfile': <'balanced'>, 'PerformanceInhibited': <''>,"
+    "  'Profiles': <[{'Profile': <'power-saver'>, 'Driver': <'placeholder'>},"
+    "                {'Profile': <'balanced'>, 'Driver': <'placeholder'>},"
+    "                {'Profile': <'performance'>, 'Driver': <'intel_pstate'>}]>},)" },
+  { "/net/hadess/SensorProxy", "GetAll",
+    "({'HasAmbientLight': <true>, 'LightLevel': <100.0>},)" },
+  /* Both the Rfkill and the Properties proxies fetch their properties */
+  { "/org/gnome/SettingsDaemon/Rfkill", "GetAll",
+    "({'BluetoothHasAirplaneMode': <true>, 'BluetoothAirplaneMode': <false>},)" },
+};
+
+static const gchar *names[] = {
+  "org.freedesktop.hostname1",
+  "org.freedesktop.login1",
+  "net.hadess.PowerProfiles",
+  "net.hadess.SensorProxy",
+  "org.gnome.SettingsDaemon.Rfkill",
+  NULL
+};
+
+static gboolean owned;
+
+/* Every answer is held back until the test releases it */
+static GVariant *
+handle_method (const gchar *path,
+               const gchar *member,
+               gboolean    *hold,
+               gpointer     user_data)
+{
+  g_autoptr(GError) error = NULL;
+  GVariant *body;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (methods); i++)
+    {
+      if (g_strcmp0 (path, methods[i].path) != 0 ||
+          g_strcmp0 (member, methods[i].member) != 0)
+        continue;
+
+      body = g_variant_parse (NULL, methods[i].reply, NULL, NULL, &error);
+      g_assert_no_error (error);
+
+      *hold = TRUE;
+      return body;
+    }
+
+  return NULL;
+}
+
+/* The services only show up on the bus when a test asks for them */
+static void
+own_names (void)
+{
+  if (owned)
+    return;
+
+  mock_bus_own_names (names);
+  owned = TRUE;
+}
+
+static void
+test_concurrent (void)
+{
+  g_autoptr(GAsyncResult) chassis_res = NULL;
+  g_autoptr(GAsyncResult) suspend_res = NULL;
+  g_autoptr(GAsyncResult) hibernate_res = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *chassis_type = NULL;
+  gint64 start;
+
+  own_names ();
+
+  start = g_get_monotonic_time ();
+  cc_power_probe_chassis_type (NULL, mock_bus_async_result_cb, &chassis_res);
+  cc_power_probe_logind_can ("CanSuspend", NULL, mock_bus_async_result_cb, &suspend_res);
+  cc_power_probe_logind_can ("CanHibernate", NULL, mock_bus_async_result_cb, &hibernate_res);
+
+  /* The services are all waited on at the same time */
+  mock_bus_wait_in_flight (3);
+  g_assert_null (chassis_res);
+  g_assert_null (suspend_res);
+  g_assert_null (hibernate_res);
+  mock_bus_release (NULL);
+
+  chassis_type = cc_power_probe_chassis_type_finish (mock_bus_wait_for_result (&chassis_res), &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (chassis_type, ==, "laptop");
+
+  g_assert_true (cc_power_probe_logind_can_finish (mock_bus_wait_for_result (&suspend_res), &error));
+  g_assert_no_error (error);
+
+  /* Only "yes" counts */
+  g_assert_false (cc_power_probe_logind_can_finish (mock_bus_wait_for_result (&hibernate_res), &error));
+  g_assert_no_error (error);
+
+  g_test_message ("3 probes took %" G_GINT64_FORMAT " ms",
+                  (g_get_monotonic_time () - start) / 1000);
+}
+
+static void
+test_absent (void)
+{
+  g_autoptr(GAsyncResult) chassis_res = NULL;
+  g_autoptr(GAsyncResult) suspend_res = NULL;
+  g_autoptr(GError) chassis_error = NULL;
+  g_autoptr(GError) suspend_error = NULL;
+  g_autofree gchar *chassis_type = NULL;
+
+  if (owned)
+    {
+      g_test_skip ("The services are already on the bus");
+      return;
+    }
+
+  /* Nobody owns the names, the bus answers for them */
+  cc_power_probe_chassis_type (NULL, mock_bus_async_result_cb, &chassis_res);
+  cc_power_probe_logind_can ("CanSuspend", NULL, mock_bus_async_result_cb, &suspend_res);
+
+  chassis_type = cc_power_probe_chassis_type_finish (mock_bus_wait_for_result (&chassis_res), &chassis_error);
+  g_assert_error (chassis_error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN);
+  g_assert_null (chassis_type);
+
+  g_assert_false (cc_power_probe_logind_can_finish (mock_bus_wait_for_result (&suspend_res), &suspend_error));
+  g_assert_error (suspend_error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN);
+}
+
+static void
+new_proxy (GBusType       bus_type,
+           const gchar   *name,
+           const gchar   *path,
+           const gchar   *interface,
+           GAsyncResult **res)
+{
+  /* The same way the panel creates them */
+  g_dbus_proxy_new_for_bus (bus_type, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                            name, path, interface,
+                            NULL, mock_bus_async_result_cb, res);
+}
+
+static GDBusProxy *
+finish_proxy (GAsyncResult **res)
+{
+  g_autoptr(GError) error = NULL;
+  GDBusProxy *proxy;
+
+  proxy = g_dbus_proxy_new_for_bus_finish (mock_bus_wait_for_result (res), &error);
+  g_assert_no_error (error);
+
+  return proxy;
+}
+
+static void
+test_sections (void)
+{
+  g_autoptr(GAsyncResult) profiles_res = NULL;
+  g_autoptr(GAsyncResult) iio_res = NULL;
+  g_autoptr(GAsyncResult) rfkill_res = NULL;
+  g_autoptr(GAsyncResult) bt_properties_res = NULL;
+  g_autoptr(GDBusProxy) profiles_proxy = NULL;
+  g_autoptr(GDBusProxy) iio_proxy = NULL;
+  g_autoptr(GDBusProxy) rfkill_proxy = NULL;
+  g_autoptr(GDBusProxy) bt_properties_proxy = NULL;
+  g_auto(GStrv) profiles = NULL;
+  gboolean powered = FALSE;
+  gint64 start;
+
+  own_names ();
+
+  start = g_get_monotonic_time ();
+  new_proxy (G_BUS_TYPE_SYSTEM, "net.hadess.PowerProfiles", "/net/hadess/PowerProfiles",
+             "net.hadess.PowerProfiles", &profiles_res);
+  new_proxy (G_BUS_TYPE_SYSTEM, "net.hadess.SensorProxy", "/net/hadess/SensorProxy",
+             "net.hadess.SensorProxy", &iio_res);
+  new_proxy (G_BUS_TYPE_SESSION, "org.gnome.SettingsDaemon.Rfkill", "/org/gnome/SettingsDaemon/Rfkill",
+             "org.gnome.SettingsDaemon.Rfkill", &rfkill_res);
+  new_proxy (G_BUS_TYPE_SESSION, "org.gnome.SettingsDaemon.Rfkill", "/org/gnome/SettingsDaemon/Rfkill",
+             "org.freedesktop.DBus.Properties", &bt_properties_res);
+
+  /* None of them waits for another */
+  mock_bus_wait_in_flight (4);
+  g_assert_null (profiles_res);
+  g_assert_null (iio_res);
+  g_assert_null (rfkill_res);
+  g_assert_null (bt_properties_res);
+  mock_bus_release (NULL);
+
+  /* Each section shows up once its service has answered */
+  profiles_proxy = finish_proxy (&profiles_res);
+  profiles = cc_power_probe_get_power_profiles (profiles_proxy);
+  g_assert_nonnull (profiles);
+  g_assert_cmpuint (g_strv_length (profiles), ==, 3);
+  g_assert_cmpstr (profiles[0], ==, "power-saver");
+  g_assert_cmpstr (profiles[1], ==, "balanced");
+  g_assert_cmpstr (profiles[2], ==, "performance");
+
+  iio_proxy = finish_proxy (&iio_res);
+  g_assert_true (cc_power_probe_get_ambient_light (iio_proxy));
+
+  rfkill_proxy = finish_proxy (&rfkill_res);
+  g_assert_true (cc_power_probe_get_bluetooth (rfkill_proxy, &powered));
+  g_assert_true (powered);
+
+  bt_properties_proxy = finish_proxy (&bt_properties_res);
+
+  g_test_message ("4 proxies took %" G_GINT64_FORMAT " ms",
+                  (g_get_monotonic_time () - start) / 1000);
+}
+
+static void
+test_sections_absent (void)
+{
+  g_autoptr(GAsyncResult) profiles_res = NULL;
+  g_autoptr(GAsyncResult) rfkill_res = NULL;
+  g_autoptr(GDBusProxy) profiles_proxy = NULL;
+  g_autoptr(GDBusProxy) rfkill_proxy = NULL;
+  g_auto(GStrv) profiles = NULL;
+
+  if (owned)
+    {
+      g_test_skip ("The services are already on the bus");
+      return;
+    }
+
+  /* The proxies are still created, but the sections stay hidden */
+  new_proxy (G_BUS_TYPE_SYSTEM, "net.hadess.PowerProfiles", "/net/hadess/PowerProfiles",
+             "net.hadess.PowerProfiles", &profiles_res);
+  new_proxy (G_BUS_TYPE_SESSION, "org.gnome.SettingsDaemon.Rfkill", "/org/gnome/SettingsDaemon/Rfkill",
+             "org.gnome.SettingsDaemon.Rfkill", &rfkill_res);
+
+  profiles_proxy = finish_proxy (&profiles_res);
+  profiles = cc_power_probe_get_power_profiles (profiles_proxy);
+  g_assert_null (profiles);
+
+  rfkill_proxy = finish_proxy (&rfkill_res);
+  g_assert_false (cc_power_probe_get_bluetooth (rfkill_proxy, NULL));
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GError) error = NULL;
+
+  own_names ();
+
+  /* A service that is stuck doesn't hold up whoever gives up on it */
+  cancellable = g_cancellable_new ();
+  cc_power_probe_logind_can ("CanSuspend", cancellable, mock_bus_async_result_cb, &res);
+  mock_bus_wait_in_flight (1);
+  g_cancellable_cancel (cancellable);
+
+  g_assert_false (cc_power_probe_logind_can_finish (mock_bus_wait_for_result (&res), &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+  /* Nobody is listening for the answer anymore */
+  mock_bus_release (NULL);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  /* gsd-rfkill lives on the session bus, which the test bus stands in
+   * for, and the other services on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+  mock_bus_start (g_test_dbus_get_bus_address (bus), handle_method, NULL);
+
+  /* before any test puts the services on the bus */
+  g_test_add_func ("/power/probes/absent", test_absent);
+  g_test_add_func ("/power/probes/sections-absent", test_sections_absent);
+  g_test_add_func ("/power/probes/concurrent", test_concurrent);
+  g_test_add_func ("/power/probes/sections", test_sections);
+  g_test_add_func ("/power/probes/cancel", test_cancel);
+
+  return g_test_run ();
+}
@@ -0,0 +1,495 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+#include <cups/cups.h>
+
+#include "pp-utils.h"
+
+#define N_REQUESTS (3 * CUPS_WORKERS_MAX)
+
+/*
+ * A stand-in for cupsd which answers Get-Printer-Attributes over
+ * keep-alive HTTP connections and keeps track of how it is used.
+ */
+typedef struct
+{
+  GSocketService *service;
+  guint16         port;
+  gint            n_connections;
+  gint            n_requests;
+  gint            n_active;
+  gint            max_active;
+} Responder;
+
+typedef struct
+{
+  const guchar *data;
+  gsize         length;
+  gsize         offset;
+} IppBuffer;
+
+static ssize_t
+ipp_read_cb (void        *context,
+             ipp_uchar_t *buffer,
+             size_t       bytes)
+{
+  IppBuffer *source = context;
+  gsize      n;
+
+  n = MIN (bytes, source->length - source->offset);
+  memcpy (buffer, source->data + source->offset, n);
+  source->offset += n;
+
+  return n;
+}
+
+static ssize_t
+ipp_write_cb (void        *context,
+              ipp_uchar_t *buffer,
+              size_t       bytes)
+{
+  g_byte_array_append (context, buffer, bytes);
+
+  return bytes;
+}
+
+static ipp_t *
+create_response (ipp_t *request)
+{
+  ipp_t *response;
+
+  response = ippNewResponse (request);
+  if (ippGetOperation (request) == IPP_GET_PRINTER_ATTRIBUTES)
+    {
+      ippSetStatusCode (response, IPP_OK);
+      ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT,
+                    "printer-info", NULL, "Stand-in printer");
+      ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+                     "copies-default", 2);
+    }
+  else
+    {
+      ippSetStatusCode (response, IPP_OPERATION_NOT_SUPPORTED);
+    }
+
+  return response;
+}
+
+static void
+update_max_active (Responder *responder,
+                   gint       n_active)
+{
+  gint max_active;
+
+  do
+    max_active = g_atomic_int_get (&responder->max_active);
+  while (n_active > max_active &&
+         !g_atomic_int_compare_and_exchange (&responder->max_active, max_active, n_active));
+}
+
+static gboolean
+handle_request (Responder        *responder,
+                GDataInputStream *input,
+                GOutputStream    *output)
+{
+  g_autofree gchar     *request_line = NULL;
+  g_autofree guchar    *body = NULL;
+  g_autofree gchar     *header = NULL;
+  g_autoptr(GByteArray) reply = NULL;
+  IppBuffer             source = { 0, };
+  gboolean              expect_continue = FALSE;
+  gsize                 content_length = 0;
+  gsize                 n_read = 0;
+  ipp_t                *request;
+  ipp_t                *response;
+
+  request_line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+  if (request_line == NULL)
+    return FALSE;
+
+  while (TRUE)
+    {
+      g_autofree gchar *line = NULL;
+
+      line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+      if (line == NULL)
+        return FALSE;
+
+      if (*line == '\0')
+        break;
+
+      if (g_ascii_strncasecmp (line, "Content-Length:", 15) == 0)
+        content_length = g_ascii_strtoull (line + 15, NULL, 10);
+      else if (g_ascii_strncasecmp (line, "Expect:", 7) == 0)
+        expect_continue = TRUE;
+    }
+
+  if (expect_continue &&
+      !g_output_stream_write_all (output, "HTTP/1.1 100 Continue\r\n\r\n", 25, NULL, NULL, NULL))
+    return FALSE;
+
+  body = g_malloc (content_length);
+  if (!g_input_stream_read_all (G_INPUT_STREAM (input), body, content_length, &n_read, NULL, NULL) ||
+      n_read != content_length)
+    return FALSE;
+
+  g_atomic_int_inc (&responder->n_requests);
+  update_max_active (responder, g_atomic_int_add (&responder->n_active, 1) + 1);
+
+  source.data = body;
+  source.length = content_length;
+  request = ippNew ();
+  g_assert_cmpint (ippReadIO (&source, ipp_read_cb, 1, NULL, request), !=, IPP_ERROR);
+
+  /* Give other workers the chance to overlap with this request */
+  g_usleep (20 * G_TIME_SPAN_MILLISECOND);
+
+  response = create_response (request);
+  reply = g_byte_array_new ();
+  g_assert_cmpint (ippWriteIO (reply, ipp_write_cb, 1, NULL, response), !=, IPP_ERROR);
+  ippDelete (response);
+  ippDelete (request);
+
+  g_atomic_int_add (&responder->n_active, -1);
+
+  header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+                            "Content-Type: application/ipp\r\n"
+                            "Content-Length: %u\r\n"
+                            "\r\n",
+                            reply->len);
+
+  return g_output_stream_write_all (output, header, strlen (header), NULL, NULL, NULL) &&
+         g_output_stream_write_all (output, reply->data, reply->len, NULL, NULL, NULL);
+}
+
+static gboolean
+responder_run_cb (GThreadedSocketService *service,
+                  GSocketConnection      *connection,
+                  GObject                *source_object,
+                  gpointer                user_data)
+{
+  Responder                  *responder = user_data;
+  g_autoptr(GDataInputStream) input = NULL;
+  GOutputStream              *output;
+
+  g_atomic_int_inc (&responder->n_connections);
+
+  input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+  g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  while (handle_request (responder, input, output))
+    ;
+
+  return TRUE;
+}
+
+static void
+responder_start (Responder *responder)
+{
+  g_autoptr(GInetAddress)   loopback = NULL;
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(GSocketAddress) effective_address = NULL;
+  g_autoptr(GError)         error = NULL;
+  g_autofree gchar         *server = NULL;
+
+  responder->service = g_threaded_socket_service_new (2 * CUPS_WORKERS_MAX);
+  g_signal_connect (responder->service, "run", G_CALLBACK (responder_run_cb), responder);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+  g_socket_listener_add_address (G_SOCKET_LISTENER (responder->service),
+                                 address,
+                                 G_SOCKET_TYPE_STREAM,
+                                 G_SOCKET_PROTOCOL_TCP,
+                                 NULL,
+                                 &effective_address,
+                                 &error);
+  g_assert_no_error (error);
+
+  responder->port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective_address));
+  g_socket_service_start (responder->service);
+
+  /* Picked up by every worker thread when it first connects */
+  server = g_strdup_printf ("127.0.0.1:%u", responder->port);
+  g_setenv ("CUPS_SERVER", server, TRUE);
+}
+
+static void
+responder_stop (Responder *responder)
+{
+  g_socket_service_stop (responder->service);
+  g_socket_listener_close (G_SOCKET_LISTENER (responder->service));
+  g_clear_object (&responder->service);
+}
+
+static void
+get_ipp_attributes_cb (GHashTable *table,
+                       gpointer    user_data)
+{
+  gint         *n_pending = user_data;
+  IPPAttribute *attr;
+
+  g_assert_nonnull (table);
+
+  attr = g_hash_table_lookup (table, "printer-info");
+  g_assert_nonnull (attr);
+  g_assert_cmpint (attr->attribute_type, ==, IPP_ATTRIBUTE_TYPE_STRING);
+  g_assert_cmpstr (attr->attribute_values[0].string_value, ==, "Stand-in printer");
+
+  attr = g_hash_table_lookup (table, "copies-default");
+  g_assert_nonnull (attr);
+  g_assert_cmpint (attr->attribute_type, ==, IPP_ATTRIBUTE_TYPE_INTEGER);
+  g_assert_cmpint (attr->attribute_values[0].integer_value, ==, 2);
+
+  (*n_pending)--;
+}
+
+static void
+test_ipp_attributes (void)
+{
+  /* Outlives the test, the workers keep their connections open */
+  static Responder  responder = { 0, };
+  gchar            *attributes[] = { "printer-info", "copies-default", NULL };
+  gint              n_pending = N_REQUESTS;
+  gint              i;
+
+  responder_start (&responder);
+
+  for (i = 0; i < N_REQUESTS; i++)
+    get_ipp_attributes_async ("stand-in", attributes, get_ipp_attributes_cb, &n_pending);
+
+  while (n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (g_atomic_int_get (&responder.n_requests), ==, N_REQUESTS);
+  /* Bounded concurrency, and connections are reused between requests */
+  g_assert_cmpint (g_atomic_int_get (&responder.max_active), <=, CUPS_WORKERS_MAX);
+  g_assert_cmpint (g_atomic_int_get (&responder.n_connections), <=, CUPS_WORKERS_MAX);
+
+  responder_stop (&responder);
+}
+
+/*
+ * Tasks which keep every worker busy until they are released one by one,
+ * so that the order in which queued tasks are picked up can be observed.
+ */
+typedef struct
+{
+  GMutex     mutex;
+  GCond      cond;
+  gint       n_released;
+  gint       n_blocked;
+  GPtrArray *order;
+  gint       n_pending;
+} Gate;
+
+static void
+blocker_func (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  Gate *gate = task_data;
+
+  g_mutex_lock (&gate->mutex);
+  gate->n_blocked++;
+  g_cond_broadcast (&gate->cond);
+  while (gate->n_released == 0)
+    g_cond_wait (&gate->cond, &gate->mutex);
+  gate->n_released--;
+  g_mutex_unlock (&gate->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+record_func (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  Gate *gate = g_object_get_data (G_OBJECT (task), "gate");
+
+  g_mutex_lock (&gate->mutex);
+  g_ptr_array_add (gate->order, task_data);
+  g_mutex_unlock (&gate->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+task_done_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  Gate *gate = user_data;
+
+  g_assert_true (g_task_propagate_boolean (G_TASK (res), NULL));
+  gate->n_pending--;
+}
+
+static void
+gate_close (Gate *gate)
+{
+  gint i;
+
+  g_mutex_init (&gate->mutex);
+  g_cond_init (&gate->cond);
+  gate->order = g_ptr_array_new ();
+
+  for (i = 0; i < CUPS_WORKERS_MAX; i++)
+    {
+      g_autoptr(GTask) task = NULL;
+
+      task = g_task_new (NULL, NULL, task_done_cb, gate);
+      g_task_set_task_data (task, gate, NULL);
+      cups_task_run_in_pool (task, blocker_func);
+      gate->n_pending++;
+    }
+
+  g_mutex_lock (&gate->mutex);
+  while (gate->n_blocked < CUPS_WORKERS_MAX)
+    g_cond_wait (&gate->cond, &gate->mutex);
+  g_mutex_unlock (&gate->mutex);
+}
+
+static void
+gate_release (Gate *gate,
+              gint  n_workers)
+{
+  g_mutex_lock (&gate->mutex);
+  gate->n_released += n_workers;
+  g_cond_broadcast (&gate->cond);
+  g_mutex_unlock (&gate->mutex);
+}
+
+/* A single released worker drains the whole queue, in queue order */
+static void
+gate_drain (Gate *gate)
+{
+  gate_release (gate, 1);
+
+  while (gate->n_pending > CUPS_WORKERS_MAX - 1)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+gate_open (Gate *gate)
+{
+  gate_release (gate, CUPS_WORKERS_MAX);
+
+  while (gate->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_ptr_array_unref (gate->order);
+  g_cond_clear (&gate->cond);
+  g_mutex_clear (&gate->mutex);
+}
+
+static void
+queue_task (Gate                *gate,
+            const gchar         *name,
+            gint                 priority,
+            GCancellable        *cancellable,
+            GAsyncReadyCallback  callback)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, cancellable, callback, gate);
+  g_task_set_priority (task, priority);
+  g_task_set_task_data (task, (gpointer) name, NULL);
+  g_object_set_data (G_OBJECT (task), "gate", gate);
+  cups_task_run_in_pool (task, record_func);
+  gate->n_pending++;
+}
+
+static void
+test_priority (void)
+{
+  Gate gate = { 0, };
+
+  gate_close (&gate);
+
+  queue_task (&gate, "low", G_PRIORITY_LOW, NULL, task_done_cb);
+  queue_task (&gate, "default-1", G_PRIORITY_DEFAULT, NULL, task_done_cb);
+  queue_task (&gate, "high", G_PRIORITY_HIGH, NULL, task_done_cb);
+  queue_task (&gate, "default-2", G_PRIORITY_DEFAULT, NULL, task_done_cb);
+
+  gate_drain (&gate);
+
+  g_assert_cmpuint (gate.order->len, ==, 4);
+  g_assert_cmpstr (g_ptr_array_index (gate.order, 0), ==, "high");
+  g_assert_cmpstr (g_ptr_array_index (gate.order, 1), ==, "default-1");
+  g_assert_cmpstr (g_ptr_array_index (gate.order, 2), ==, "default-2");
+  g_assert_cmpstr (g_ptr_array_index (gate.order, 3), ==, "low");
+
+  gate_open (&gate);
+}
+
+static void
+cancelled_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  Gate              *gate = user_data;
+  g_autoptr(GError)  error = NULL;
+
+  g_assert_false (g_task_propagate_boolean (G_TASK (res), &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  gate->n_pending--;
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  Gate                    gate = { 0, };
+
+  gate_close (&gate);
+
+  cancellable = g_cancellable_new ();
+  queue_task (&gate, "cancelled", G_PRIORITY_DEFAULT, cancellable, cancelled_cb);
+  queue_task (&gate, "kept", G_PRIORITY_DEFAULT, NULL, task_done_cb);
+  g_cancellable_cancel (cancellable);
+
+  gate_drain (&gate);
+
+  /* The cancelled task never reached a worker */
+  g_assert_cmpuint (gate.order->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (gate.order, 0), ==, "kept");
+
+  gate_open (&gate);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/cups-pool/ipp-attributes", test_ipp_attributes);
+  g_test_add_func ("/printers/cups-pool/priority", test_priority);
+  g_test_add_func ("/printers/cups-pool/cancel", test_cancel);
+
+  return g_test_run ();
+}
@@ -0,0 +1,159 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+
+#include "cc-format-examples.h"
+
+static void
+test_lookup (void)
+{
+  g_autoptr(CcFormatExamplesCache) cache = NULL;
+  g_autoptr(GDateTime) dt = NULL;
+  g_autofree gchar *date = NULL;
+  const CcFormatExamples *examples;
+
+  cache = cc_format_examples_cache_new (4);
+  g_assert_null (cc_format_examples_cache_peek (cache, "C"));
+
+  examples = cc_format_examples_cache_lookup (cache, "C");
+  g_assert_cmpstr (examples->region, ==, "C");
+  g_assert_true (examples->locale != (locale_t) 0);
+  g_assert_cmpstr (examples->number, ==, "123456789.00");
+  g_assert_false (examples->imperial);
+  g_assert_true (cc_format_examples_cache_lookup (cache, "C") == examples);
+  g_assert_true (cc_format_examples_cache_peek (cache, "C") == examples);
+
+  dt = g_date_time_new_utc (2020, 1, 2, 3, 4, 5);
+  date = cc_format_examples_format_date (examples, dt, "%x");
+  g_assert_cmpstr (date, ==, "01/02/20");
+}
+
+static void
+test_evict (void)
+{
+  g_autoptr(CcFormatExamplesCache) cache = NULL;
+  const CcFormatExamples *examples;
+
+  cache = cc_format_examples_cache_new (1);
+  cc_format_examples_cache_lookup (cache, "C");
+  examples = cc_format_examples_cache_lookup (cache, "POSIX");
+
+  g_assert_null (cc_format_examples_cache_peek (cache, "C"));
+  g_assert_true (cc_format_examples_cache_peek (cache, "POSIX") == examples);
+}
+
+static void
+test_prefetch (void)
+{
+  g_autoptr(CcFormatExamplesCache) cache = NULL;
+  const gchar *first[] = { "C", NULL };
+  const gchar *second[] = { "POSIX", NULL };
+
+  cache = cc_format_examples_cache_new (4);
+
+  /* The second request waits for the first one to finish */
+  cc_format_examples_cache_prefetch (cache, first);
+  cc_format_examples_cache_prefetch (cache, second);
+  g_assert_null (cc_format_examples_cache_peek (cache, "C"));
+
+  while (cc_format_examples_cache_peek (cache, "C") == NULL ||
+         cc_format_examples_cache_peek (cache, "POSIX") == NULL)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_free_while_prefetching (void)
+{
+  CcFormatExamplesCache *cache;
+  const gchar *regions[] = { "C", "POSIX", NULL };
+  gint i;
+
+  cache = cc_format_examples_cache_new (4);
+  cc_format_examples_cache_prefetch (cache, regions);
+  cc_format_examples_cache_free (cache);
+
+  /* Let the cancelled result come back */
+  for (i = 0; i < 100; i++)
+    {
+      g_main_context_iteration (NULL, FALSE);
+      g_usleep (1000);
+    }
+}
+
+/* Previewing a few regions in turn, as when going up and down the list */
+static void
+test_benchmark (void)
+{
+  g_autoptr(CcFormatExamplesCache) cache = NULL;
+  const gchar *regions[] = { "C.UTF-8", "C", "POSIX" };
+  gdouble cached_time = 0, uncached_time = 0;
+  guint n_lookups = 300;
+  locale_t locale;
+  GTimer *timer;
+  guint i;
+
+  /* Something that has to be loaded from disk */
+  locale = newlocale (LC_ALL_MASK, regions[0], (locale_t) 0);
+  if (locale == (locale_t) 0)
+    {
+      g_test_skip ("C.UTF-8 is not available");
+      return;
+    }
+  freelocale (locale);
+
+  if (g_test_slow ())
+    n_lookups = 3000;
+
+  cache = cc_format_examples_cache_new (G_N_ELEMENTS (regions));
+  timer = g_timer_new ();
+
+  for (i = 0; i < n_lookups; i++)
+    {
+      const gchar *region = regions[i % G_N_ELEMENTS (regions)];
+      g_autoptr(CcFormatExamplesCache) uncached = NULL;
+
+      g_timer_start (timer);
+      cc_format_examples_cache_lookup (cache, region);
+      cached_time += g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      uncached = cc_format_examples_cache_new (1);
+      cc_format_examples_cache_lookup (uncached, region);
+      uncached_time += g_timer_elapsed (timer, NULL);
+    }
+
+  g_test_message ("%u previews: cached %.3f ms, uncached %.3f ms",
+                  n_lookups, cached_time * 1000, uncached_time * 1000);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  setlocale (LC_ALL, "C");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/region/format-examples/lookup", test_lookup);
+  g_test_add_func ("/region/format-examples/evict", test_evict);
+  g_test_add_func ("/region/format-examples/prefetch", test_prefetch);
+  g_test_add_func ("/region/format-examples/free-while-prefetching", test_free_while_prefetching);
+  g_test_add_func ("/region/format-examples/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,200 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mock-bus.h"
+
+/* Stand-in for the services a test talks to, on its own connection to
+ * the test bus. Whether a call gets answered straight away or held back
+ * is up to the test, so it can tell which calls are in flight together
+ * without going by the clock. */
+
+typedef struct
+{
+  gchar        *path;
+  GDBusMessage *reply;
+} HeldReply;
+
+static GDBusConnection *connection;
+static MockBusHandler   handler;
+static gpointer         handler_data;
+static GQueue           held; /* HeldReply, only touched from the main loop */
+
+static void
+held_reply_free (HeldReply *held_reply)
+{
+  g_free (held_reply->path);
+  g_object_unref (held_reply->reply);
+  g_free (held_reply);
+}
+
+static gboolean
+hold_reply_cb (gpointer user_data)
+{
+  g_queue_push_tail (&held, user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs in the GDBus worker thread: the calls the handler answers are
+ * taken off the connection here. The replies that aren't held are sent
+ * right away, so that synchronous calls from the main thread get them. */
+static GDBusMessage *
+filter_cb (GDBusConnection *bus,
+           GDBusMessage    *message,
+           gboolean         incoming,
+           gpointer         user_data)
+{
+  g_autoptr(GVariant) body = NULL;
+  GDBusMessage *reply;
+  const gchar *path;
+  gboolean hold = FALSE;
+
+  if (!incoming || g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+    return message;
+
+  path = g_dbus_message_get_path (message);
+  body = handler (path, g_dbus_message_get_member (message), &hold, handler_data);
+  if (body == NULL)
+    return message;
+  g_variant_take_ref (body);
+
+  reply = g_dbus_message_new_method_reply (message);
+  g_dbus_message_set_body (reply, body);
+
+  if (hold)
+    {
+      HeldReply *held_reply;
+
+      held_reply = g_new0 (HeldReply, 1);
+      held_reply->path = g_strdup (path);
+      held_reply->reply = reply;
+      g_idle_add (hold_reply_cb, held_reply);
+    }
+  else
+    {
+      g_dbus_connection_send_message (bus, reply,
+                                      G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+      g_object_unref (reply);
+    }
+
+  g_object_unref (message);
+  return NULL;
+}
+
+void
+mock_bus_start (const gchar    *address,
+                MockBusHandler  mock_handler,
+                gpointer        user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_assert_null (connection);
+
+  handler = mock_handler;
+  handler_data = user_data;
+
+  connection = g_dbus_connection_new_for_address_sync (address,
+                                                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                       NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_add_filter (connection, filter_cb, NULL, NULL);
+}
+
+static void
+name_acquired_cb (GDBusConnection *bus,
+                  const gchar     *name,
+                  gpointer         user_data)
+{
+  (*(guint *) user_data)++;
+}
+
+/* The services only show up on the bus once their names are owned */
+void
+mock_bus_own_names (const gchar * const *names)
+{
+  guint n_acquired = 0;
+  guint i;
+
+  for (i = 0; names[i] != NULL; i++)
+    g_bus_own_name_on_connection (connection, names[i], 0,
+                                  name_acquired_cb, NULL, &n_acquired, NULL);
+  while (n_acquired < i)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+void
+mock_bus_emit_signal (const gchar *path,
+                      const gchar *interface,
+                      const gchar *signal,
+                      GVariant    *parameters)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_dbus_connection_emit_signal (connection, NULL, path, interface, signal,
+                                 parameters, &error);
+  g_assert_no_error (error);
+}
+
+/* Waits until @n_calls held calls reached the services, none of which
+ * got answered yet */
+void
+mock_bus_wait_in_flight (guint n_calls)
+{
+  while (g_queue_get_length (&held) < n_calls)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (g_queue_get_length (&held), ==, n_calls);
+}
+
+/* Answers the held calls on @path, in the order they came in, or all of
+ * them if @path is NULL */
+void
+mock_bus_release (const gchar *path)
+{
+  GList *l, *next;
+
+  for (l = held.head; l != NULL; l = next)
+    {
+      HeldReply *held_reply = l->data;
+
+      next = l->next;
+      if (path != NULL && g_strcmp0 (held_reply->path, path) != 0)
+        continue;
+
+      g_dbus_connection_send_message (connection, held_reply->reply,
+                                      G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+      g_queue_delete_link (&held, l);
+      held_reply_free (held_reply);
+    }
+}
+
+void
+mock_bus_async_result_cb (GObject      *object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  *(GAsyncResult **) user_data = g_object_ref (res);
+}
+
+GAsyncResult *
+mock_bus_wait_for_result (GAsyncResult **res)
+{
+  while (*res == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  return *res;
+}
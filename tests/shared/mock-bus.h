@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Returns the body of the reply to a call of @member on @path, or NULL
+ * to let the call through. Setting @hold keeps the reply back until
+ * mock_bus_release() lets it go. Runs in the GDBus worker thread. */
+typedef GVariant *(*MockBusHandler) (const gchar *path,
+                                     const gchar *member,
+                                     gboolean    *hold,
+                                     gpointer     user_data);
+
+void          mock_bus_start           (const gchar    *address,
+                                        MockBusHandler  handler,
+                                        gpointer        user_data);
+
+void          mock_bus_own_names       (const gchar * const *names);
+
+void          mock_bus_emit_signal     (const gchar    *path,
+                                        const gchar    *interface,
+                                        const gchar    *signal,
+                                        GVariant       *parameters);
+
+void          mock_bus_wait_in_flight  (guint           n_calls);
+
+void          mock_bus_release         (const gchar    *path);
+
+void          mock_bus_async_result_cb (GObject        *object,
+                                        GAsyncResult   *res,
+                                        gpointer        user_data);
+
+GAsyncResult *mock_bus_wait_for_result (GAsyncResult  **res);
+
+G_END_DECLS
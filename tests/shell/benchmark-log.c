@@ -0,0 +1,67 @@
+/* benchmark-log.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "cc-log.h"
+
+#define N_THREADS  8
+#define N_MESSAGES 50000
+
+static gpointer
+flood_thread (gpointer user_data)
+{
+  guint thread_id = GPOINTER_TO_UINT (user_data);
+  guint i;
+
+  for (i = 0; i < N_MESSAGES; i++)
+    g_log ("benchmark", G_LOG_LEVEL_DEBUG, "thread %u message %u of %u", thread_id, i, N_MESSAGES);
+
+  return NULL;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GThread *threads[N_THREADS];
+  gint64 start, logged, flushed;
+  guint i;
+
+  cc_log_init ();
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = g_thread_new ("flood", flood_thread, GUINT_TO_POINTER (i));
+  for (i = 0; i < N_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  logged = g_get_monotonic_time ();
+
+  cc_log_flush ();
+
+  flushed = g_get_monotonic_time ();
+
+  /* Messages that did not fit in the ring are reported in the log itself */
+  g_printerr ("%u threads, %u messages: %.1f ms to log, %.1f ms until written (%.0f messages/s)\n",
+              N_THREADS, N_THREADS * N_MESSAGES,
+              (logged - start) / 1000.0,
+              (flushed - start) / 1000.0,
+              N_THREADS * N_MESSAGES / ((logged - start) / (gdouble) G_USEC_PER_SEC));
+
+  return 0;
+}
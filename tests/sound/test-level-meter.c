@@ -0,0 +1,257 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "cc-level-meter.h"
+
+/* Stand-in for the peak detect stream: 200 samples a second, handed
+ * over 8 at a time, while the frame clock ticks at 60 Hz */
+#define SAMPLE_RATE      200
+#define FRAGMENT_SAMPLES 8
+#define FRAME_RATE       60
+#define RESOLUTION       400
+
+typedef gdouble (*LevelFunc) (gdouble time);
+
+typedef struct
+{
+  LevelFunc level;
+  guint     n_samples;
+} FakeSource;
+
+typedef struct
+{
+  guint   n_frames;
+  guint   n_fragments;
+  guint   n_redraws;
+  gdouble min_rms_step;
+} RunStats;
+
+static gdouble
+tone (gdouble time)
+{
+  return 0.5 + 0.25 * sin (2 * G_PI * 5 * time);
+}
+
+static gdouble
+steady (gdouble time)
+{
+  return 0.6;
+}
+
+static gdouble
+burst (gdouble time)
+{
+  return time < 0.5 ? 0.8 : 0.0;
+}
+
+/* Hands over every complete fragment recorded by the time of @frame */
+static guint
+fake_source_deliver (FakeSource   *source,
+                     CcLevelMeter *meter,
+                     guint         frame)
+{
+  guint recorded = frame * SAMPLE_RATE / FRAME_RATE;
+  guint n_fragments = 0;
+
+  while (source->n_samples + FRAGMENT_SAMPLES <= recorded)
+    {
+      gfloat samples[FRAGMENT_SAMPLES];
+      guint i;
+
+      for (i = 0; i < FRAGMENT_SAMPLES; i++)
+        samples[i] = source->level ((gdouble) source->n_samples++ / SAMPLE_RATE);
+
+      cc_level_meter_add_samples (meter, samples, FRAGMENT_SAMPLES);
+      n_fragments++;
+    }
+
+  return n_fragments;
+}
+
+/* Plays @level from @first_frame for @n_frames frames */
+static void
+run (CcLevelMeter *meter,
+     LevelFunc     level,
+     guint         first_frame,
+     guint         n_frames,
+     RunStats     *stats)
+{
+  FakeSource source = { level, first_frame * SAMPLE_RATE / FRAME_RATE };
+  guint frame;
+
+  memset (stats, 0, sizeof (RunStats));
+  stats->min_rms_step = G_MAXDOUBLE;
+
+  for (frame = first_frame + 1; frame <= first_frame + n_frames; frame++)
+    {
+      gdouble rms = meter->rms;
+
+      stats->n_fragments += fake_source_deliver (&source, meter, frame);
+      if (cc_level_meter_update (meter, 1.0 / FRAME_RATE, RESOLUTION))
+        stats->n_redraws++;
+      stats->n_frames++;
+      stats->min_rms_step = MIN (stats->min_rms_step, meter->rms - rms);
+    }
+}
+
+static void
+test_fold (void)
+{
+  CcLevelMeter meter;
+  const gfloat first[] = { 0.1, 0.5, -0.3 };
+  const gfloat second[] = { 0.2, 1.5 };
+
+  cc_level_meter_reset (&meter);
+  g_assert_true (cc_level_meter_is_silent (&meter));
+
+  /* Out of range samples are clamped */
+  cc_level_meter_add_samples (&meter, first, G_N_ELEMENTS (first));
+  cc_level_meter_add_samples (&meter, second, G_N_ELEMENTS (second));
+  g_assert_false (cc_level_meter_is_silent (&meter));
+  g_assert_cmpuint (meter.pending_samples, ==, 5);
+  g_assert_cmpfloat_with_epsilon (meter.pending_peak, 1.0, 1e-6);
+
+  /* Peaks attack instantly, the RMS level gets there over time */
+  g_assert_true (cc_level_meter_update (&meter, 1.0 / FRAME_RATE, RESOLUTION));
+  g_assert_cmpfloat_with_epsilon (meter.peak, 1.0, 1e-6);
+  g_assert_cmpfloat_with_epsilon (meter.target_rms, sqrt ((0.01 + 0.25 + 0.04 + 1.0) / 5), 1e-6);
+  g_assert_cmpfloat (meter.rms, >, 0.0);
+  g_assert_cmpfloat (meter.rms, <, meter.target_rms);
+  g_assert_cmpuint (meter.pending_samples, ==, 0);
+
+  cc_level_meter_update (&meter, 10.0, RESOLUTION);
+  g_assert_cmpfloat_with_epsilon (meter.rms, meter.target_rms, 1e-2);
+}
+
+static void
+test_decay (void)
+{
+  CcLevelMeter meter;
+  RunStats stats;
+  gdouble peak;
+
+  cc_level_meter_reset (&meter);
+
+  run (&meter, burst, 0, FRAME_RATE / 2, &stats);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.8, 1e-6);
+  g_assert_cmpfloat_with_epsilon (meter.rms, 0.8, 1e-2);
+
+  /* Peaks fall linearly once the silence comes in */
+  run (&meter, burst, FRAME_RATE / 2, FRAME_RATE / 5, &stats);
+  peak = meter.peak;
+  g_assert_cmpfloat (peak, <, 0.8);
+  g_assert_cmpfloat (peak, >, 0.2);
+  g_assert_cmpfloat (meter.rms, <=, peak);
+  g_assert_false (cc_level_meter_is_silent (&meter));
+
+  run (&meter, burst, FRAME_RATE / 2 + FRAME_RATE / 5, 2, &stats);
+  g_assert_cmpfloat_with_epsilon (peak - meter.peak, 2.0 * CC_LEVEL_METER_PEAK_DECAY_RATE / FRAME_RATE, 1e-6);
+
+  /* Down to nothing in well under a second */
+  run (&meter, burst, FRAME_RATE, FRAME_RATE / 2, &stats);
+  g_assert_true (cc_level_meter_is_silent (&meter));
+  g_assert_cmpfloat (meter.peak, ==, 0.0);
+  g_assert_cmpfloat (meter.rms, ==, 0.0);
+  g_assert_cmpint (meter.drawn_peak, ==, 0);
+}
+
+static void
+test_between_fragments (void)
+{
+  CcLevelMeter meter;
+  RunStats stats;
+
+  cc_level_meter_reset (&meter);
+
+  /* Frames come more often than fragments, the levels must not sag
+   * in between */
+  run (&meter, steady, 0, FRAME_RATE / 2, &stats);
+  g_assert_cmpuint (stats.n_fragments, ==, SAMPLE_RATE / 2 / FRAGMENT_SAMPLES);
+  g_assert_cmpuint (stats.n_frames, ==, FRAME_RATE / 2);
+  g_assert_cmpfloat (stats.min_rms_step, >=, 0.0);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.6, 1e-6);
+}
+
+static void
+test_redraws (void)
+{
+  CcLevelMeter meter;
+  RunStats stats;
+
+  cc_level_meter_reset (&meter);
+
+  /* A level that doesn't move doesn't get redrawn */
+  run (&meter, steady, 0, FRAME_RATE, &stats);
+  g_assert_cmpuint (stats.n_redraws, >, 0);
+  run (&meter, steady, FRAME_RATE, FRAME_RATE, &stats);
+  g_test_message ("steady: %u redraws in %u frames", stats.n_redraws, stats.n_frames);
+  g_assert_cmpuint (stats.n_redraws, ==, 0);
+
+  /* One that does is redrawn at most once per frame */
+  run (&meter, tone, 2 * FRAME_RATE, FRAME_RATE, &stats);
+  g_test_message ("tone: %u redraws in %u frames, %u fragments",
+                  stats.n_redraws, stats.n_frames, stats.n_fragments);
+  g_assert_cmpuint (stats.n_redraws, >, 0);
+  g_assert_cmpuint (stats.n_redraws, <=, stats.n_frames);
+  g_assert_cmpuint (stats.n_fragments, ==, SAMPLE_RATE / FRAGMENT_SAMPLES);
+}
+
+static void
+test_stall (void)
+{
+  CcLevelMeter meter;
+  RunStats stats;
+  gdouble peak;
+  guint frame;
+
+  cc_level_meter_reset (&meter);
+  run (&meter, steady, 0, FRAME_RATE / 2, &stats);
+  peak = meter.peak;
+
+  /* The stream stops without a word: the levels hold for a fragment or
+   * two, then fall like they would for silence */
+  for (frame = 0; frame < FRAME_RATE * CC_LEVEL_METER_STALL_TIME / 2; frame++)
+    cc_level_meter_update (&meter, 1.0 / FRAME_RATE, RESOLUTION);
+  g_assert_cmpfloat_with_epsilon (meter.peak, peak, 1e-6);
+
+  for (frame = 0; frame < FRAME_RATE && !cc_level_meter_is_silent (&meter); frame++)
+    cc_level_meter_update (&meter, 1.0 / FRAME_RATE, RESOLUTION);
+  g_test_message ("silent %u frames after the stall", frame);
+  g_assert_true (cc_level_meter_is_silent (&meter));
+  g_assert_cmpint (meter.drawn_peak, ==, 0);
+
+  /* And come back with the samples */
+  run (&meter, steady, FRAME_RATE, FRAME_RATE / 2, &stats);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.6, 1e-6);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sound/level-meter/fold", test_fold);
+  g_test_add_func ("/sound/level-meter/decay", test_decay);
+  g_test_add_func ("/sound/level-meter/between-fragments", test_between_fragments);
+  g_test_add_func ("/sound/level-meter/redraws", test_redraws);
+  g_test_add_func ("/sound/level-meter/stall", test_stall);
+
+  return g_test_run ();
+}
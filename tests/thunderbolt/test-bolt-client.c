@@ -0,0 +1,289 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+
+#include "bolt-client.h"
+#include "bolt-device.h"
+#include "mock-bus.h"
+
+/* Stand-in for boltd, on a private system bus, which holds on to the
+ * properties of each device until a test lets them go */
+
+#define N_DEVICES 3
+
+static gchar *
+device_path (guint i)
+{
+  return g_strdup_printf ("/org/freedesktop/bolt/devices/dev_%u", i);
+}
+
+static GVariant *
+handle_method (const gchar *path,
+               const gchar *member,
+               gboolean    *hold,
+               gpointer     user_data)
+{
+  if (g_strcmp0 (path, "/org/freedesktop/bolt") == 0 && g_strcmp0 (member, "GetAll") == 0)
+    {
+      return g_variant_new_parsed ("({'Version': <uint32 1>},)");
+    }
+  else if (g_strcmp0 (path, "/org/freedesktop/bolt") == 0 && g_strcmp0 (member, "ListDevices") == 0)
+    {
+      g_autoptr(GVariantBuilder) builder = NULL;
+      guint i;
+
+      builder = g_variant_builder_new (G_VARIANT_TYPE ("ao"));
+      for (i = 0; i < N_DEVICES; i++)
+        {
+          g_autofree gchar *opath = device_path (i);
+          g_variant_builder_add (builder, "o", opath);
+        }
+      return g_variant_new ("(ao)", builder);
+    }
+  else if (g_str_has_prefix (path, "/org/freedesktop/bolt/devices/") && g_strcmp0 (member, "GetAll") == 0)
+    {
+      const gchar *uid = strrchr (path, '/') + 1;
+
+      *hold = TRUE;
+      return g_variant_new_parsed ("({'Uid': <%s>, 'Type': <'peripheral'>},)", uid);
+    }
+
+  return NULL;
+}
+
+static gint
+compare_uids (gconstpointer a,
+              gconstpointer b)
+{
+  BoltDevice *dev_a = *(BoltDevice **) a;
+  BoltDevice *dev_b = *(BoltDevice **) b;
+
+  return g_strcmp0 (bolt_device_get_uid (dev_a), bolt_device_get_uid (dev_b));
+}
+
+static void
+test_concurrent (void)
+{
+  g_autoptr(BoltClient) client = NULL;
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError) error = NULL;
+  gint64 start;
+  guint i;
+
+  client = bolt_client_new (&error);
+  g_assert_no_error (error);
+
+  start = g_get_monotonic_time ();
+  bolt_client_list_devices_async (client, NULL, NULL, mock_bus_async_result_cb, &res);
+
+  /* The device proxies are all loaded at the same time */
+  mock_bus_wait_in_flight (N_DEVICES);
+  g_assert_null (res);
+  mock_bus_release (NULL);
+
+  devices = bolt_client_list_devices_finish (client, mock_bus_wait_for_result (&res), &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (devices);
+  g_assert_cmpuint (devices->len, ==, N_DEVICES);
+
+  g_ptr_array_sort (devices, compare_uids);
+  for (i = 0; i < devices->len; i++)
+    {
+      BoltDevice *dev = g_ptr_array_index (devices, i);
+      g_autofree gchar *uid = g_strdup_printf ("dev_%u", i);
+
+      g_assert_cmpstr (bolt_device_get_uid (dev), ==, uid);
+      g_assert_cmpint (bolt_device_get_device_type (dev), ==, BOLT_DEVICE_PERIPHERAL);
+    }
+
+  g_test_message ("%d devices took %" G_GINT64_FORMAT " ms",
+                  N_DEVICES, (g_get_monotonic_time () - start) / 1000);
+}
+
+typedef struct
+{
+  GAsyncResult *res;
+  GPtrArray    *ready;
+} Listing;
+
+static void
+listing_device_ready_cb (BoltClient *client,
+                         BoltDevice *dev,
+                         gpointer    user_data)
+{
+  Listing *listing = user_data;
+
+  g_assert_null (listing->res);
+  g_ptr_array_add (listing->ready, g_strdup (bolt_device_get_uid (dev)));
+}
+
+static void
+listing_done_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  Listing *listing = user_data;
+
+  listing->res = g_object_ref (res);
+}
+
+static void
+test_incremental (void)
+{
+  g_autoptr(BoltClient) client = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError) error = NULL;
+  Listing listing = { NULL, };
+  guint i;
+
+  client = bolt_client_new (&error);
+  g_assert_no_error (error);
+
+  listing.ready = g_ptr_array_new_with_free_func (g_free);
+  bolt_client_list_devices_async (client, NULL,
+                                  listing_device_ready_cb,
+                                  listing_done_cb,
+                                  &listing);
+  mock_bus_wait_in_flight (N_DEVICES);
+
+  /* A slow device doesn't hold back the ones that are ready */
+  for (i = 0; i < N_DEVICES; i++)
+    {
+      g_autofree gchar *path = device_path (i);
+      g_autofree gchar *uid = g_strdup_printf ("dev_%u", i);
+
+      mock_bus_release (path);
+      while (listing.ready->len < i + 1)
+        g_main_context_iteration (NULL, TRUE);
+
+      g_assert_cmpuint (listing.ready->len, ==, i + 1);
+      g_assert_cmpstr (g_ptr_array_index (listing.ready, i), ==, uid);
+    }
+
+  devices = bolt_client_list_devices_finish (client, mock_bus_wait_for_result (&listing.res), &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, N_DEVICES);
+
+  g_clear_object (&listing.res);
+  g_ptr_array_unref (listing.ready);
+}
+
+static void
+device_removed_cb (BoltClient *client,
+                   const char *path,
+                   gpointer    user_data)
+{
+  *(gchar **) user_data = g_strdup (path);
+}
+
+static void
+test_removed (void)
+{
+  g_autoptr(BoltClient) client = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *removed_path = NULL;
+  g_autofree gchar *path = device_path (1);
+  Listing listing = { NULL, };
+
+  client = bolt_client_new (&error);
+  g_assert_no_error (error);
+  g_signal_connect (client, "device-removed", G_CALLBACK (device_removed_cb), &removed_path);
+
+  listing.ready = g_ptr_array_new_with_free_func (g_free);
+  bolt_client_list_devices_async (client, NULL,
+                                  listing_device_ready_cb,
+                                  listing_done_cb,
+                                  &listing);
+  mock_bus_wait_in_flight (N_DEVICES);
+
+  /* dev_1 goes away while its properties are on their way */
+  mock_bus_emit_signal ("/org/freedesktop/bolt",
+                        "org.freedesktop.bolt1.Manager",
+                        "DeviceRemoved",
+                        g_variant_new ("(o)", path));
+  while (removed_path == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpstr (removed_path, ==, path);
+
+  mock_bus_release (NULL);
+
+  devices = bolt_client_list_devices_finish (client, mock_bus_wait_for_result (&listing.res), &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, N_DEVICES - 1);
+
+  g_assert_cmpuint (listing.ready->len, ==, N_DEVICES - 1);
+  g_assert_cmpstr (g_ptr_array_index (listing.ready, 0), ==, "dev_0");
+  g_assert_cmpstr (g_ptr_array_index (listing.ready, 1), ==, "dev_2");
+
+  g_clear_object (&listing.res);
+  g_ptr_array_unref (listing.ready);
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(BoltClient) client = NULL;
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GAsyncResult) res = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError) error = NULL;
+
+  client = bolt_client_new (&error);
+  g_assert_no_error (error);
+
+  /* Giving up on the list doesn't wait for the devices to load */
+  cancellable = g_cancellable_new ();
+  bolt_client_list_devices_async (client, cancellable, NULL, mock_bus_async_result_cb, &res);
+  mock_bus_wait_in_flight (N_DEVICES);
+  g_cancellable_cancel (cancellable);
+
+  devices = bolt_client_list_devices_finish (client, mock_bus_wait_for_result (&res), &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (devices);
+
+  /* Nobody is listening for the answers anymore */
+  mock_bus_release (NULL);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+  const gchar *names[] = { "org.freedesktop.bolt", NULL };
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  /* boltd lives on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+  mock_bus_start (g_test_dbus_get_bus_address (bus), handle_method, NULL);
+  mock_bus_own_names (names);
+
+  g_test_add_func ("/thunderbolt/client/list-devices-concurrent", test_concurrent);
+  g_test_add_func ("/thunderbolt/client/list-devices-incremental", test_incremental);
+  g_test_add_func ("/thunderbolt/client/list-devices-removed", test_removed);
+  g_test_add_func ("/thunderbolt/client/list-devices-cancel", test_cancel);
+
+  return g_test_run ();
+}
@@ -0,0 +1,334 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cc-usage-purge.h"
+
+typedef struct
+{
+  GMainLoop    *loop;
+  GCancellable *cancellable;
+  gboolean      success;
+  GError       *error;
+  guint64       n_files;
+  guint64       n_bytes;
+  guint64       files_total;
+  guint64       bytes_total;
+} PurgeResult;
+
+static void
+write_file (const gchar *path,
+            gsize        size,
+            gint64       age)
+{
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) error = NULL;
+
+  contents = g_malloc0 (size);
+  g_file_set_contents (path, contents, size, &error);
+  g_assert_no_error (error);
+
+  if (age > 0)
+    {
+      struct timespec times[2];
+
+      times[0].tv_sec = times[1].tv_sec = g_get_real_time () / G_USEC_PER_SEC - age / G_TIME_SPAN_SECOND;
+      times[0].tv_nsec = times[1].tv_nsec = 0;
+      g_assert_cmpint (utimensat (AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW), ==, 0);
+    }
+}
+
+static gchar *
+make_tree (guint n_dirs,
+           guint files_per_dir,
+           gsize file_size)
+{
+  g_autoptr(GError) error = NULL;
+  gchar *root;
+  guint i, j;
+
+  root = g_dir_make_tmp ("test-purge-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < n_dirs; i++)
+    {
+      g_autofree gchar *dir = NULL;
+
+      /* Alternate between flat and nested directories */
+      if (i % 2 == 0)
+        dir = g_strdup_printf ("%s/dir-%u", root, i);
+      else
+        dir = g_strdup_printf ("%s/dir-%u/nested/deeper", root, i - 1);
+      g_assert_cmpint (g_mkdir_with_parents (dir, 0700), ==, 0);
+
+      for (j = 0; j < files_per_dir; j++)
+        {
+          g_autofree gchar *path = g_strdup_printf ("%s/file-%u", dir, j);
+          write_file (path, file_size, 0);
+        }
+    }
+
+  return root;
+}
+
+static void
+remove_tree (const gchar *path)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    {
+      g_remove (path);
+      return;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+      if (g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+        g_remove (child);
+      else
+        remove_tree (child);
+    }
+
+  g_rmdir (path);
+}
+
+static gboolean
+dir_is_empty (const gchar *path)
+{
+  g_autoptr(GDir) dir = NULL;
+
+  dir = g_dir_open (path, 0, NULL);
+  g_assert_nonnull (dir);
+
+  return g_dir_read_name (dir) == NULL;
+}
+
+static void
+progress_cb (guint64  files_done,
+             guint64  files_total,
+             guint64  bytes_done,
+             guint64  bytes_total,
+             gpointer user_data)
+{
+  PurgeResult *result = user_data;
+
+  g_assert_cmpuint (files_done, <=, files_total);
+  g_assert_cmpuint (bytes_done, <=, bytes_total);
+
+  result->files_total = files_total;
+  result->bytes_total = bytes_total;
+}
+
+static void
+purge_done_cb (GObject      *source_object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  PurgeResult *result = user_data;
+
+  result->success = cc_usage_purge_finish (res, &result->n_files, &result->n_bytes, &result->error);
+  g_main_loop_quit (result->loop);
+}
+
+static void
+run_purge (const gchar *root,
+           GTimeSpan    min_age,
+           PurgeResult *result)
+{
+  const gchar *directories[] = { root, NULL };
+
+  result->loop = g_main_loop_new (NULL, FALSE);
+  cc_usage_purge_async (directories, min_age, 0, result->cancellable,
+                        progress_cb, result,
+                        purge_done_cb, result);
+  if (result->cancellable != NULL)
+    g_cancellable_cancel (result->cancellable);
+  g_main_loop_run (result->loop);
+  g_main_loop_unref (result->loop);
+}
+
+static void
+test_purge_all (void)
+{
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *outside = NULL;
+  g_autofree gchar *outside_file = NULL;
+  g_autofree gchar *link = NULL;
+  PurgeResult result = { 0, };
+
+  root = make_tree (10, 10, 100);
+
+  /* Links must be removed, not followed */
+  outside = g_dir_make_tmp ("test-purge-outside-XXXXXX", NULL);
+  outside_file = g_build_filename (outside, "keep", NULL);
+  write_file (outside_file, 10, 0);
+  link = g_build_filename (root, "link", NULL);
+  g_assert_cmpint (symlink (outside, link), ==, 0);
+
+  run_purge (root, 0, &result);
+
+  g_assert_no_error (result.error);
+  g_assert_true (result.success);
+  /* 100 files plus the link */
+  g_assert_cmpuint (result.n_files, ==, 101);
+  g_assert_cmpuint (result.files_total, ==, 101);
+  g_assert_cmpuint (result.bytes_total, ==, result.n_bytes);
+  g_assert_true (dir_is_empty (root));
+  g_assert_true (g_file_test (outside_file, G_FILE_TEST_IS_REGULAR));
+
+  remove_tree (outside);
+  remove_tree (root);
+}
+
+static void
+test_purge_age (void)
+{
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *old_dir = NULL;
+  g_autofree gchar *mixed_dir = NULL;
+  g_autofree gchar *path = NULL;
+  PurgeResult result = { 0, };
+
+  root = g_dir_make_tmp ("test-purge-XXXXXX", NULL);
+
+  old_dir = g_build_filename (root, "old", NULL);
+  g_mkdir (old_dir, 0700);
+  path = g_build_filename (old_dir, "old-file", NULL);
+  write_file (path, 10, 2 * G_TIME_SPAN_DAY);
+
+  mixed_dir = g_build_filename (root, "mixed", NULL);
+  g_mkdir (mixed_dir, 0700);
+  g_free (path);
+  path = g_build_filename (mixed_dir, "old-file", NULL);
+  write_file (path, 10, 2 * G_TIME_SPAN_DAY);
+  g_free (path);
+  path = g_build_filename (mixed_dir, "new-file", NULL);
+  write_file (path, 10, 0);
+
+  run_purge (root, G_TIME_SPAN_DAY, &result);
+
+  g_assert_no_error (result.error);
+  g_assert_true (result.success);
+  g_assert_cmpuint (result.n_files, ==, 2);
+  g_assert_cmpuint (result.n_bytes, ==, 20);
+  g_assert_true (g_file_test (path, G_FILE_TEST_IS_REGULAR));
+  g_assert_true (g_file_test (old_dir, G_FILE_TEST_IS_DIR));
+  g_assert_true (dir_is_empty (old_dir));
+
+  remove_tree (root);
+}
+
+static void
+test_purge_old_directories (void)
+{
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *path = NULL;
+  PurgeResult result = { 0, };
+  struct timespec times[2];
+
+  root = g_dir_make_tmp ("test-purge-XXXXXX", NULL);
+  dir = g_build_filename (root, "old", NULL);
+  g_mkdir (dir, 0700);
+  path = g_build_filename (dir, "file", NULL);
+  write_file (path, 10, 2 * G_TIME_SPAN_DAY);
+
+  times[0].tv_sec = times[1].tv_sec = g_get_real_time () / G_USEC_PER_SEC - 2 * 24 * 60 * 60;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+  g_assert_cmpint (utimensat (AT_FDCWD, dir, times, 0), ==, 0);
+
+  run_purge (root, G_TIME_SPAN_DAY, &result);
+
+  g_assert_true (result.success);
+  g_assert_cmpuint (result.n_files, ==, 1);
+  g_assert_false (g_file_test (dir, G_FILE_TEST_EXISTS));
+  g_assert_true (dir_is_empty (root));
+
+  remove_tree (root);
+}
+
+static void
+test_purge_large (void)
+{
+  g_autofree gchar *root = NULL;
+  PurgeResult result = { 0, };
+  guint n_dirs, files_per_dir;
+  gint64 start;
+
+  /* Hundreds of thousands of files when running the slow tests */
+  n_dirs = g_test_slow () ? 200 : 20;
+  files_per_dir = 1000;
+  root = make_tree (n_dirs, files_per_dir, 0);
+
+  start = g_get_monotonic_time ();
+  run_purge (root, 0, &result);
+  g_test_message ("Deleted %" G_GUINT64_FORMAT " files in %.2f s",
+                  result.n_files,
+                  (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+
+  g_assert_no_error (result.error);
+  g_assert_true (result.success);
+  g_assert_cmpuint (result.n_files, ==, n_dirs * files_per_dir);
+  g_assert_true (dir_is_empty (root));
+
+  remove_tree (root);
+}
+
+static void
+test_purge_cancel (void)
+{
+  g_autofree gchar *root = NULL;
+  PurgeResult result = { 0, };
+
+  root = make_tree (20, 1000, 0);
+
+  result.cancellable = g_cancellable_new ();
+  run_purge (root, 0, &result);
+
+  g_assert_false (result.success);
+  g_assert_error (result.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&result.error);
+  g_clear_object (&result.cancellable);
+
+  remove_tree (root);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/usage/purge/all", test_purge_all);
+  g_test_add_func ("/usage/purge/age", test_purge_age);
+  g_test_add_func ("/usage/purge/old-directories", test_purge_old_directories);
+  g_test_add_func ("/usage/purge/large", test_purge_large);
+  g_test_add_func ("/usage/purge/cancel", test_purge_cancel);
+
+  return g_test_run ();
+}
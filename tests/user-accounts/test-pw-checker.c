@@ -0,0 +1,291 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <string.h>
+
+#include "pw-utils.h"
+
+/* Matches the debounce delay in pw-utils.c */
+#define PW_CHECK_DELAY 100
+
+#define DICT_WORD "zebracrossingwidget"
+#define STRONG_PASSWORD "Vq7#tLm2!xRb9$wK"
+
+static gchar *dict_dir;
+
+typedef struct
+{
+  guint n_calls;
+  gint  strength_level;
+} CheckResult;
+
+static void
+check_cb (gint         strength_level,
+          const gchar *hint,
+          gpointer     user_data)
+{
+  CheckResult *result = user_data;
+
+  result->n_calls++;
+  result->strength_level = strength_level;
+}
+
+static gboolean
+tick_cb (gpointer user_data)
+{
+  (*(guint *) user_data)++;
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+iterate_for (guint ms)
+{
+  gint64 end = g_get_monotonic_time () + ms * 1000;
+
+  while (g_get_monotonic_time () < end)
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static void
+wait_for_calls (CheckResult *result,
+                guint        n_calls)
+{
+  while (result->n_calls < n_calls)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+/* A cracklib dictionary of a handful of words, so that the checks
+ * don't depend on the one installed on the system */
+static gboolean
+build_dictionary (void)
+{
+  g_autoptr(GSubprocess) packer = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *program = NULL;
+  g_autofree gchar *prefix = NULL;
+
+  program = g_find_program_in_path ("cracklib-packer");
+  if (program == NULL)
+    return FALSE;
+
+  dict_dir = g_dir_make_tmp ("test-pw-checker-XXXXXX", &error);
+  g_assert_no_error (error);
+  prefix = g_build_filename (dict_dir, "words", NULL);
+
+  packer = g_subprocess_new (G_SUBPROCESS_FLAGS_STDIN_PIPE | G_SUBPROCESS_FLAGS_STDOUT_SILENCE,
+                             &error, program, prefix, NULL);
+  g_assert_no_error (error);
+
+  /* cracklib-packer wants the words sorted */
+  g_subprocess_communicate_utf8 (packer, "applesauce\nmarmalade\n" DICT_WORD "\n",
+                                 NULL, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_true (g_subprocess_get_successful (packer));
+
+  pw_set_dict_path (prefix);
+
+  return TRUE;
+}
+
+static void
+remove_dictionary (void)
+{
+  const gchar *suffixes[] = { ".pwd", ".pwi", ".hwm" };
+  guint i;
+
+  if (dict_dir == NULL)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (suffixes); i++)
+    {
+      g_autofree gchar *path = g_strconcat (dict_dir, "/words", suffixes[i], NULL);
+      g_unlink (path);
+    }
+  g_rmdir (dict_dir);
+  g_clear_pointer (&dict_dir, g_free);
+}
+
+static void
+test_dictionary (void)
+{
+  const gchar *hint = NULL;
+  gint level = -1;
+
+  if (dict_dir == NULL)
+    {
+      g_test_skip ("cracklib-packer is not available");
+      return;
+    }
+
+  /* Long enough and mixed enough for everything but cracklib */
+  pw_strength (DICT_WORD, NULL, "tester", &hint, &level);
+  g_assert_cmpstr (hint, ==, "Try to avoid common words.");
+  g_assert_cmpint (level, ==, 1);
+
+  pw_strength (STRONG_PASSWORD, NULL, "tester", &hint, &level);
+  g_assert_cmpint (level, >=, 2);
+}
+
+static void
+test_main_loop (void)
+{
+  g_autoptr(PwChecker) checker = NULL;
+  CheckResult result = { 0, -1 };
+  const gchar *hint = NULL;
+  gint level = -1;
+  guint n_ticks = 0;
+  guint tick_id;
+  gint64 start, elapsed;
+
+  checker = pw_checker_new (check_cb, &result);
+  tick_id = g_timeout_add (5, tick_cb, &n_ticks);
+
+  /* Asking never evaluates on the spot */
+  start = g_get_monotonic_time ();
+  g_assert_false (pw_checker_lookup (checker, DICT_WORD, NULL, "tester", &level, &hint));
+  elapsed = g_get_monotonic_time () - start;
+  g_assert_cmpint (elapsed, <, PW_CHECK_DELAY * 1000 / 2);
+
+  wait_for_calls (&result, 1);
+  elapsed = g_get_monotonic_time () - start;
+  g_source_remove (tick_id);
+
+  /* The main loop kept going while the check was pending */
+  g_test_message ("%u ticks in %" G_GINT64_FORMAT " ms", n_ticks, elapsed / 1000);
+  g_assert_cmpuint (n_ticks, >=, PW_CHECK_DELAY / 5 / 2);
+
+  /* The result is remembered for the same input */
+  g_assert_true (pw_checker_lookup (checker, DICT_WORD, NULL, "tester", &level, &hint));
+  g_assert_cmpint (level, ==, result.strength_level);
+  g_assert_nonnull (hint);
+  g_assert_cmpuint (result.n_calls, ==, 1);
+}
+
+static void
+test_debounce (void)
+{
+  g_autoptr(PwChecker) checker = NULL;
+  CheckResult result = { 0, -1 };
+  const gchar *hint = NULL;
+  gint level = -1;
+  gint64 start, elapsed;
+  gsize i;
+
+  checker = pw_checker_new (check_cb, &result);
+
+  /* Typing STRONG_PASSWORD one key at a time, faster than the delay */
+  for (i = 1; i <= strlen (STRONG_PASSWORD); i++)
+    {
+      g_autofree gchar *typed = g_strndup (STRONG_PASSWORD, i);
+
+      start = g_get_monotonic_time ();
+      g_assert_false (pw_checker_lookup (checker, typed, NULL, "tester", NULL, NULL));
+      iterate_for (PW_CHECK_DELAY / 10);
+    }
+
+  wait_for_calls (&result, 1);
+  elapsed = g_get_monotonic_time () - start;
+  g_assert_cmpint (elapsed, >=, PW_CHECK_DELAY * 1000);
+
+  /* Only the last input was evaluated */
+  iterate_for (3 * PW_CHECK_DELAY);
+  g_assert_cmpuint (result.n_calls, ==, 1);
+  g_assert_true (pw_checker_lookup (checker, STRONG_PASSWORD, NULL, "tester", &level, &hint));
+  g_assert_cmpint (level, ==, result.strength_level);
+  g_assert_cmpint (level, >=, 2);
+}
+
+static void
+test_superseded (void)
+{
+  g_autoptr(PwChecker) checker = NULL;
+  CheckResult result = { 0, -1 };
+  guint n_calls;
+
+  checker = pw_checker_new (check_cb, &result);
+
+  /* An empty password is level 0, the strong one isn't, so a late
+   * result for the first would show */
+  g_assert_false (pw_checker_lookup (checker, "", NULL, "tester", NULL, NULL));
+
+  /* Far enough for the first check to be handed to the worker */
+  iterate_for (PW_CHECK_DELAY + PW_CHECK_DELAY / 10);
+  n_calls = result.n_calls;
+
+  g_assert_false (pw_checker_lookup (checker, STRONG_PASSWORD, NULL, "tester", NULL, NULL));
+  wait_for_calls (&result, n_calls + 1);
+  g_assert_cmpint (result.strength_level, >=, 2);
+
+  iterate_for (3 * PW_CHECK_DELAY);
+  g_assert_cmpuint (result.n_calls, ==, n_calls + 1);
+  g_assert_cmpint (result.strength_level, >=, 2);
+}
+
+static void
+test_free_pending (void)
+{
+  PwChecker *checker;
+  CheckResult result = { 0, -1 };
+  guint n_calls;
+
+  /* Freed before the delay is up */
+  checker = pw_checker_new (check_cb, &result);
+  g_assert_false (pw_checker_lookup (checker, DICT_WORD, NULL, "tester", NULL, NULL));
+  g_clear_pointer (&checker, pw_checker_free);
+
+  iterate_for (3 * PW_CHECK_DELAY);
+  g_assert_cmpuint (result.n_calls, ==, 0);
+
+  /* Freed once the input may be with the worker */
+  checker = pw_checker_new (check_cb, &result);
+  g_assert_false (pw_checker_lookup (checker, DICT_WORD, NULL, "tester", NULL, NULL));
+  iterate_for (PW_CHECK_DELAY + PW_CHECK_DELAY / 10);
+  n_calls = result.n_calls;
+  g_clear_pointer (&checker, pw_checker_free);
+
+  iterate_for (3 * PW_CHECK_DELAY);
+  g_assert_cmpuint (result.n_calls, ==, n_calls);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gboolean has_dictionary;
+  int ret;
+
+  setlocale (LC_ALL, "C");
+  g_test_init (&argc, &argv, NULL);
+
+  has_dictionary = build_dictionary ();
+  if (!has_dictionary)
+    g_test_message ("cracklib-packer not found, using the system dictionary");
+
+  g_test_add_func ("/user-accounts/pw-utils/dictionary", test_dictionary);
+  g_test_add_func ("/user-accounts/pw-checker/main-loop", test_main_loop);
+  g_test_add_func ("/user-accounts/pw-checker/debounce", test_debounce);
+  g_test_add_func ("/user-accounts/pw-checker/superseded", test_superseded);
+  g_test_add_func ("/user-accounts/pw-checker/free-pending", test_free_pending);
+
+  ret = g_test_run ();
+
+  remove_dictionary ();
+
+  return ret;
+}